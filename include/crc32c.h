@@ -0,0 +1,42 @@
+#ifndef __CRC32C___
+#define __CRC32C___
+
+/*-----------------------------------------------------------------------------
+Função: Calcula o CRC32C (polinômio de Castagnoli) de um buffer. Usa a instrução
+        crc32 do SSE4.2 quando o processador a possui e, caso contrário, a versão
+        portável (crc32c_portable).
+
+Entra:
+    crc -> CRC do trecho anterior (0 no início)
+    buffer -> bytes a serem somados
+    size -> número de bytes
+
+Saída:
+    O CRC32C acumulado.
+-----------------------------------------------------------------------------*/
+unsigned int crc32c(unsigned int crc, unsigned char *buffer, int size);
+
+/*-----------------------------------------------------------------------------
+Função: Calcula o CRC32C sem instruções específicas do processador (tabelas de
+        8 bytes por passo)
+
+Entra:
+    crc -> CRC do trecho anterior (0 no início)
+    buffer -> bytes a serem somados
+    size -> número de bytes
+
+Saída:
+    O CRC32C acumulado.
+-----------------------------------------------------------------------------*/
+unsigned int crc32c_portable(unsigned int crc, unsigned char *buffer, int size);
+
+/*-----------------------------------------------------------------------------
+Função: Informa se crc32c usa a instrução do processador
+
+Saída:
+    Se usa, retorna 1
+    Se usa a versão portável, 0.
+-----------------------------------------------------------------------------*/
+int crc32c_hardware();
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef __LZ___
+#define __LZ___
+
+/*-----------------------------------------------------------------------------
+Função: Comprime um buffer com o codificador LZ do T2FS. Cada sequência é formada
+        por um byte de controle (tamanho dos literais e da cópia), os literais, a
+        distância da cópia (2 bytes, little endian) e a extensão do tamanho da cópia.
+
+Entra:
+    src -> dados a serem comprimidos
+    srcSize -> número de bytes de 'src'
+    dst -> buffer de saída
+    dstCapacity -> tamanho do buffer de saída
+
+Saída:
+    Se os dados couberam em 'dst', retorna o número de bytes comprimidos
+    Se não couberam, retorna 0.
+-----------------------------------------------------------------------------*/
+int lz_compress(unsigned char *src, int srcSize, unsigned char *dst, int dstCapacity);
+
+/*-----------------------------------------------------------------------------
+Função: Descomprime dados gerados por lz_compress até preencher 'dstSize' bytes
+
+Entra:
+    src -> dados comprimidos
+    srcSize -> número máximo de bytes a serem lidos de 'src'
+    dst -> buffer de saída
+    dstSize -> número exato de bytes descomprimidos
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna 0
+    Se os dados comprimidos são inválidos, retorna -1.
+-----------------------------------------------------------------------------*/
+int lz_decompress(unsigned char *src, int srcSize, unsigned char *dst, int dstSize);
+
+#endif
@@ -13,6 +13,18 @@ Saída:
 -----------------------------------------------------------------------------*/
 struct t2fs_superbloco* buffer_to_superblock(unsigned char *buffer, int start);
 
+/*-----------------------------------------------------------------------------
+Função: Cria um 't2fs_superbloco_ext' a partir do buffer
+
+Entra:
+    buffer -> buffer com os dados para a estrutura
+    start -> começo do dado no buffer
+
+Saída:
+    A struct criada a partir dos dados.
+-----------------------------------------------------------------------------*/
+struct t2fs_superbloco_ext* buffer_to_superblock_ext(unsigned char *buffer, int start);
+
 /*-----------------------------------------------------------------------------
 Função: Cria um 't2fs_inode' a partir do buffer
 
@@ -37,6 +49,26 @@ Saída:
 -----------------------------------------------------------------------------*/
 struct t2fs_record* buffer_to_record(unsigned char *buffer, int start);
 
+/*-----------------------------------------------------------------------------
+Função: Preenche um 't2fs_inode' já alocado a partir do buffer (sem alocação)
+
+Entra:
+    buffer -> buffer com os dados para a estrutura
+    start -> começo do dado no buffer
+    inode -> estrutura a ser preenchida
+-----------------------------------------------------------------------------*/
+void buffer_read_inode(unsigned char *buffer, int start, struct t2fs_inode *inode);
+
+/*-----------------------------------------------------------------------------
+Função: Preenche um 't2fs_record' já alocado a partir do buffer (sem alocação)
+
+Entra:
+    buffer -> buffer com os dados para a estrutura
+    start -> começo do dado no buffer
+    record -> estrutura a ser preenchida
+-----------------------------------------------------------------------------*/
+void buffer_read_record(unsigned char *buffer, int start, struct t2fs_record *record);
+
 /*-----------------------------------------------------------------------------
 Função: Cria um valor DWORD a partir de um buffer
 
@@ -49,6 +81,28 @@ Saída:
 -----------------------------------------------------------------------------*/
 DWORD buffer_to_dword(unsigned char *buffer, int start);
 
+/*-----------------------------------------------------------------------------
+Função: Cria um buffer a partir de um 't2fs_superbloco'
+
+Entra:
+    sb -> superbloco a ser transformado
+
+Saída:
+    O buffer representando a estrutura.
+-----------------------------------------------------------------------------*/
+unsigned char* superblock_to_buffer(struct t2fs_superbloco *sb);
+
+/*-----------------------------------------------------------------------------
+Função: Cria um buffer a partir de um 't2fs_superbloco_ext'
+
+Entra:
+    ext -> extensão do superbloco a ser transformada
+
+Saída:
+    O buffer representando a estrutura.
+-----------------------------------------------------------------------------*/
+unsigned char* superblock_ext_to_buffer(struct t2fs_superbloco_ext *ext);
+
 /*-----------------------------------------------------------------------------
 Função: Cria um buffer a partir de um 't2fs_inode'
 
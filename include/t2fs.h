@@ -12,6 +12,11 @@
 
 #define MAX_NUM_HANDLERS 10
 
+/** Modos de reposicionamento de lseek2 */
+#define SEEK2_SET   0
+#define SEEK2_DATA  3
+#define SEEK2_HOLE  4
+
 typedef int FILE2;
 typedef int DIR2;
 
@@ -33,6 +38,72 @@ struct t2fs_superbloco {
 	DWORD   diskSize;		/* Quantidade total de blocos na partição T2FS. Inclui o superbloco, áreas de bitmap, área de i-node e blocos de dados */
 };
 
+/** Extensão do superbloco: resumo de espaço livre e tabela de referências, armazenado no setor 0 a partir de SB_EXT_OFFSET */
+#define SB_EXT_OFFSET   32
+#define SB_EXT_ID       "T2SX"
+
+#define SB_STATE_CLEAN  0x01
+#define SB_STATE_DIRTY  0x02
+
+/** Marca de desmontagem limpa: o disco não foi alterado desde t2fs_unmount, que gravou as dicas
+    dos diretórios no bloco do superbloco a partir do setor SB_HINTS_SECTOR */
+#define SB_UNMOUNT_CLEAN    0x4E4D5532
+#define SB_HINTS_SECTOR     1
+
+/** Contadores das zonas de alocação de um disco sem grupos, gravados por t2fs_unmount no setor 0 logo
+    após a extensão do superbloco (válidos com SB_UNMOUNT_CLEAN): número de zonas (0 se não há) e, para
+    cada zona, i-nodes e blocos livres */
+#define SB_ZONES_OFFSET     112
+
+#define SB_FEATURE_TAILPACK 0x01    /* Caudas de arquivos empacotadas em fragmentos ao fechar o arquivo */
+#define SB_FEATURE_CHECKSUM 0x02    /* Blocos de dados gravados com checksum (CRC32C), verificado na leitura */
+#define SB_FEATURE_DEDUP    0x04    /* Blocos inteiros iguais a um bloco já gravado são compartilhados na escrita */
+
+/** Grupos de alocação: o grupo g possui os blocos [g * groupBlocks, (g + 1) * groupBlocks) e os
+    i-nodes [g * groupInodes, (g + 1) * groupInodes). Os dois tamanhos são múltiplos de GROUP_ALIGN,
+    de forma que cada grupo tem setores próprios nos dois bitmaps. A tabela de descritores guarda
+    GROUP_DESC_WORDS palavras por grupo. */
+#define GROUP_ALIGN         (SECTOR_SIZE * 8)
+#define GROUP_DESC_WORDS    4
+#define GROUP_FREE_BLOCKS   0       /* Blocos livres do grupo */
+#define GROUP_FREE_INODES   1       /* I-nodes livres do grupo */
+#define GROUP_BLOCK_HINT    2       /* Nenhum bloco do grupo antes deste está livre */
+#define GROUP_INODE_HINT    3       /* Nenhum i-node do grupo antes deste está livre */
+
+/** A tabela de referências tem uma entrada (DWORD) por bloco, dividida em páginas de um bloco. No disco,
+    refcountBlock guarda o diretório das páginas: o bloco de cada página, ou 0 se todas as suas entradas são 0 */
+
+/** Marca, na tabela de referências, um bloco de fragmentos; os bits baixos indicam os setores ocupados */
+#define REFCOUNT_FRAGMENT   0x80000000
+
+/** Nos demais blocos, os bits 24 a 30 guardam os setores ocupados pelo bloco comprimido (0 se está sem compressão) */
+#define REFCOUNT_ZSECTORS   0x7F000000
+#define REFCOUNT_ZSHIFT     24
+#define REFCOUNT_COUNT      0x00FFFFFF  /* Referências além da primeira */
+
+struct t2fs_superbloco_ext {
+	char    id[4];          	/* Identificação da extensão. É formado pelas letras T2SX. */
+	DWORD   state;          	/* SB_STATE_CLEAN se os contadores refletem os bitmaps; SB_STATE_DIRTY se há alteração em andamento */
+	DWORD   freeBlocks;     	/* Quantidade de blocos livres no bitmap de dados */
+	DWORD   freeInodes;     	/* Quantidade de i-nodes livres no bitmap de i-nodes */
+	DWORD   freeBlockRuns;  	/* Quantidade de trechos contíguos de blocos livres */
+	DWORD   refcountBlock;  	/* Primeiro bloco do diretório das páginas da tabela de contadores de referência (válido se refcountSize > 0) */
+	DWORD   refcountSize;   	/* Quantidade de blocos do diretório das páginas (0 se a tabela não existe) */
+	DWORD   features;       	/* Modos opcionais ligados no disco (SB_FEATURE_*) */
+	DWORD   checksumBlock;  	/* Primeiro bloco do diretório das páginas da tabela de checksums dos blocos (válido se checksumSize > 0) */
+	DWORD   checksumSize;   	/* Quantidade de blocos do diretório das páginas (0 se a tabela não existe) */
+	DWORD   dedupBlock;     	/* Primeiro bloco do diretório das páginas da tabela de impressões digitais dos blocos (válido se dedupSize > 0) */
+	DWORD   dedupSize;      	/* Quantidade de blocos do diretório das páginas (0 se a tabela não existe) */
+	DWORD   unmountState;   	/* SB_UNMOUNT_CLEAN se o disco não foi alterado desde a última desmontagem */
+	DWORD   blockHint;      	/* Nenhum bloco antes deste está livre: a busca por blocos livres começa nele */
+	DWORD   inodeHint;      	/* Nenhum i-node antes deste está livre: a busca por i-nodes livres começa nele */
+	DWORD   fragmentHint;   	/* Último bloco de fragmentos usado: a busca por setores livres começa por ele */
+	DWORD   groupBlocks;    	/* Blocos por grupo de alocação (0 se o disco não é dividido em grupos) */
+	DWORD   groupInodes;    	/* I-nodes por grupo de alocação */
+	DWORD   groupTableBlock;	/* Primeiro bloco da tabela de descritores dos grupos (válido se groupBlocks > 0) */
+	DWORD   groupTableSize; 	/* Quantidade de blocos da tabela de descritores dos grupos */
+};
+
 /** Registro de diretório (entrada de diretório) */
 struct t2fs_record {
 	BYTE    TypeVal;        /* Tipo da entrada. Indica se o registro é inválido (TYPEVAL_INVALIDO), arquivo (TYPEVAL_REGULAR) ou diretório (TYPEVAL_DIRETORIO) */
@@ -40,6 +111,15 @@ struct t2fs_record {
 	DWORD   inodeNumber;    /* Número do i-node (se inválido, recebe INVALID_PTR)  */
 };
 
+/** Uso das palavras reservadas do i-node */
+#define INODE_FLAGS         0       /* reservado[INODE_FLAGS]: flags do i-node */
+#define INODE_FRAGMENT      1       /* reservado[INODE_FRAGMENT]: primeiro setor do fragmento do arquivo (INVALID_PTR se não há) */
+
+#define INODE_FLAG_INLINE   0x01    /* Conteúdo inteiro no fragmento, sem blocos de dados */
+#define INODE_FLAG_TAIL     0x02    /* Último bloco (parcial) do arquivo guardado no fragmento */
+#define INODE_FLAG_COMPRESSED 0x04  /* Blocos de dados gravados comprimidos (ver fcompress2) */
+#define INLINE_DATA_SIZE    SECTOR_SIZE
+
 /** i-node */
 struct t2fs_inode {
 	DWORD	blocksFileSize;	/* Tamanho do arquivo expresso em quantidade de  blocos */
@@ -47,7 +127,7 @@ struct t2fs_inode {
 	DWORD	dataPtr[2];	/* Dois ponteiros diretos (little endian). Se inválido, recebe INVALID_PTR.        */
 	DWORD	singleIndPtr;   /* Ponteiro de indireção simples (little endian). Se inválido, recebe INVALID_PTR. */
 	DWORD	doubleIndPtr;   /* Ponteiro de indireção dupla (little endian) Se inválido, recebe INVALID_PTR.    */
-	DWORD	reservado[2];	/* Reservado */
+	DWORD	reservado[2];	/* Flags e fragmento do i-node (ver INODE_FLAGS e INODE_FRAGMENT) */
 };
 
 /** Registro com as informações da entrada de diretório, lida com readdir2 */
@@ -58,6 +138,104 @@ typedef struct {
     DWORD   fileSize;                   /* Numero de bytes do arquivo                          */
 } DIRENT2;
 
+/** Função chamada por nftw2 para cada entrada visitada. Um retorno diferente de zero interrompe o percurso. */
+typedef int (*NFTW2_FN)(const char *path, const DIRENT2 *entry, void *arg);
+
+/** Metadados de um arquivo ou diretório, lidos com stat2 e fstat2 */
+typedef struct {
+    BYTE    fileType;                   /* Tipo do arquivo: regular (0x01) ou diretório (0x02) */
+    DWORD   inodeNumber;                /* Número do i-node                                   */
+    DWORD   fileSize;                   /* Numero de bytes do arquivo                          */
+    DWORD   blocksFileSize;             /* Numero de blocos de dados alocados (sem buracos)    */
+    DWORD   directBlocks;               /* Ponteiros diretos em uso (0 a 2)                    */
+    DWORD   indirectBlocks;             /* Blocos de indireção (simples, dupla e suas listas)  */
+    DWORD   extents;                    /* Trechos contíguos de blocos de dados               */
+    DWORD   dataSectors;                /* Setores ocupados pelos dados (menos que os blocos se comprimidos) */
+} STAT2;
+
+/** Informações sobre o espaço do sistema de arquivos, lidas com statfs2 */
+typedef struct {
+    DWORD   blockSize;                  /* Tamanho do bloco lógico, em bytes                  */
+    DWORD   totalBlocks;                /* Quantidade total de blocos (inclui áreas de controle) */
+    DWORD   freeBlocks;                 /* Quantidade de blocos livres                        */
+    DWORD   totalInodes;                /* Quantidade total de i-nodes                        */
+    DWORD   freeInodes;                 /* Quantidade de i-nodes livres                       */
+    DWORD   freeBlockRuns;              /* Quantidade de trechos contíguos de blocos livres   */
+    DWORD   avgFreeRunSize;             /* Tamanho médio, em blocos, dos trechos livres       */
+    DWORD   dedupBlocks;                /* Blocos no índice de deduplicação                   */
+    DWORD   dedupSavedBlocks;           /* Referências extras aos blocos do índice (blocos poupados) */
+    DWORD   dedupLookups;               /* Blocos inteiros procurados no índice desde a montagem */
+    DWORD   dedupHits;                  /* Blocos encontrados no índice (não gravados) desde a montagem */
+    DWORD   dedupFalseMatches;          /* Impressões iguais com conteúdo diferente desde a montagem */
+    DWORD   groups;                     /* Quantidade de grupos de alocação (0 se o disco não tem grupos) */
+} STATFS2;
+
+/** Resultado de uma verificação do sistema de arquivos, feita com fsck2 */
+typedef struct {
+    DWORD   inodesUsed;                 /* I-nodes alcançáveis a partir do diretório raiz      */
+    DWORD   blocksUsed;                 /* Blocos em uso (áreas de controle, tabelas, dados e fragmentos) */
+    DWORD   badRecords;                 /* Registros com i-node livre no bitmap, fora da área ou já visto */
+    DWORD   badPointers;                /* Ponteiros de blocos ou fragmentos fora da área de dados */
+    DWORD   orphanInodes;               /* I-nodes ocupados no bitmap sem nenhum registro     */
+    DWORD   leakedBlocks;               /* Blocos ocupados no bitmap sem nenhuma referência    */
+    DWORD   missingBlocks;              /* Blocos referenciados e livres no bitmap            */
+    DWORD   duplicateBlocks;            /* Blocos (ou setores de fragmentos) com mais referências do que o permitido */
+    DWORD   badRefcounts;               /* Contadores de referência diferentes das referências encontradas */
+    DWORD   badCounters;                /* Contadores de livres da extensão do superbloco e dos grupos divergentes */
+    DWORD   repaired;                   /* Inconsistências corrigidas (com "repair")           */
+} FSCK2_STATS;
+
+/** Progresso e resultado de uma desfragmentação, feita com defrag2 */
+typedef struct {
+    DWORD   files;                      /* Arquivos e diretórios visitados                    */
+    DWORD   filesMoved;                 /* Arquivos cujos blocos foram realocados              */
+    DWORD   filesSkipped;               /* Arquivos fragmentados sem trecho livre suficiente   */
+    DWORD   blocksMoved;                /* Blocos realocados (dados e indireção)               */
+    DWORD   extentsBefore;              /* Trechos contíguos de blocos de dados antes          */
+    DWORD   extentsAfter;               /* Trechos contíguos de blocos de dados depois         */
+} DEFRAG2_STATS;
+
+/** Função chamada por defrag2 após cada arquivo. Um retorno diferente de zero interrompe a desfragmentação. */
+typedef int (*DEFRAG2_FN)(const char *path, const DEFRAG2_STATS *progress, void *arg);
+
+/** Disposição de um arquivo ou diretório no disco, informada por layout2 */
+typedef struct {
+    BYTE    fileType;                   /* Tipo do arquivo: regular (0x01) ou diretório (0x02) */
+    DWORD   inodeNumber;                /* Número do i-node                                   */
+    DWORD   fileSize;                   /* Numero de bytes do arquivo                          */
+    DWORD   blocks;                     /* Blocos de dados alocados (sem buracos)              */
+    DWORD   runs;                       /* Trechos contíguos de blocos de dados               */
+    DWORD   holes;                      /* Blocos do arquivo em buracos                       */
+    DWORD   sharedBlocks;               /* Blocos de dados compartilhados com outros arquivos  */
+    DWORD   indirectBlocks;             /* Blocos de indireção (simples, dupla e suas listas)  */
+    DWORD   dataSectors;                /* Setores ocupados pelos dados (menos que os blocos se comprimidos) */
+    DWORD   records;                    /* Diretórios: registros que cabem nos blocos alocados */
+    DWORD   liveRecords;                /* Diretórios: registros válidos (incluindo "." e "..") */
+} LAYOUT2_FILE;
+
+/** Função chamada por layout2 para cada arquivo ou diretório. Um retorno diferente de zero interrompe o relatório. */
+typedef int (*LAYOUT2_FN)(const char *path, const LAYOUT2_FILE *file, void *arg);
+
+/** Histograma dos trechos livres de layout2: a posição i conta os trechos de 2^i a 2^(i+1)-1 blocos (a última, os maiores) */
+#define LAYOUT2_HISTOGRAM_SIZE 16
+
+/** Resumo da disposição do sistema de arquivos, informado por layout2 */
+typedef struct {
+    DWORD   files;                      /* Arquivos regulares visitados                       */
+    DWORD   directories;                /* Diretórios visitados                               */
+    DWORD   fragmentedFiles;            /* Arquivos e diretórios com mais de um trecho         */
+    DWORD   dataBlocks;                 /* Blocos de dados dos arquivos e diretórios visitados */
+    DWORD   runs;                       /* Trechos contíguos de blocos de dados               */
+    DWORD   indirectBlocks;             /* Blocos de indireção                                */
+    DWORD   dirBlocks;                  /* Blocos de dados dos diretórios                     */
+    DWORD   dirRecords;                 /* Registros que cabem nos blocos dos diretórios       */
+    DWORD   dirLiveRecords;             /* Registros válidos dos diretórios                   */
+    DWORD   freeBlocks;                 /* Blocos livres (todo o disco)                       */
+    DWORD   freeExtents;                /* Trechos contíguos de blocos livres                 */
+    DWORD   largestFreeExtent;          /* Tamanho, em blocos, do maior trecho livre          */
+    DWORD   freeExtentHistogram[LAYOUT2_HISTOGRAM_SIZE]; /* Trechos livres por tamanho (ver LAYOUT2_HISTOGRAM_SIZE) */
+} LAYOUT2_STATS;
+
 /** Handler */
 typedef struct {
     struct t2fs_record *record; /* Record associado ao handler */
@@ -69,6 +247,39 @@ typedef struct {
 
 #pragma pack(pop)
 
+/** Dispositivo de setores onde fica a imagem de um sistema de arquivos (ver t2fs_mount) */
+typedef struct {
+    int (*readSector)(void *data, unsigned int sector, unsigned char *buffer);  /* Lê um setor de SECTOR_SIZE bytes; retorna 0 se conseguiu */
+    int (*writeSector)(void *data, unsigned int sector, unsigned char *buffer); /* Escreve um setor; retorna 0 se conseguiu */
+    int (*flush)(void *data);   /* Garante que as escritas chegaram ao dispositivo (NULL se não é necessário); retorna 0 se conseguiu */
+    void *data;                 /* Argumento das funções (ex.: arquivo da imagem) */
+    int (*readSectors)(void *data, unsigned int sector, unsigned int count, unsigned char *buffer); /* Lê setores consecutivos (NULL: lidos um a um); retorna 0 se conseguiu */
+} T2FS_BACKEND;
+
+/** Opções de montagem (ver t2fs_mount) */
+typedef struct {
+    int readOnly;               /* Diferente de zero para montar sem permitir alterações */
+    int oldAlloc;               /* Diferente de zero para alocar inodes e blocos no primeiro livre do disco, sem aproximá-los do diretório pai */
+} T2FS_OPTIONS;
+
+/** Sistema de arquivos montado, com todo o seu estado (ver t2fs_mount) */
+typedef struct t2fs_fs T2FS;
+
+/** Geometria de uma imagem criada com mkfs2 */
+typedef struct {
+    DWORD   diskSize;               /* Quantidade total de blocos, incluindo as áreas de controle */
+    WORD    blockSize;              /* Setores por bloco lógico (0 para MKFS2_DEFAULT_BLOCK_SIZE) */
+    DWORD   inodes;                 /* I-nodes desejados (0 para um a cada MKFS2_BLOCKS_PER_INODE blocos); a área é completada */
+    WORD    freeBlocksBitmapSize;   /* Blocos do bitmap de dados (0 para o mínimo necessário) */
+    WORD    freeInodeBitmapSize;    /* Blocos do bitmap de i-nodes (0 para o mínimo necessário) */
+    DWORD   groupBlocks;            /* Blocos por grupo de alocação (0 sem grupos); múltiplo de GROUP_ALIGN e
+                                       bloco com um número de setores potência de 2 */
+} MKFS2_OPTIONS;
+
+#define MKFS2_DEFAULT_BLOCK_SIZE    4
+#define MKFS2_MAX_BLOCK_SIZE        64
+#define MKFS2_BLOCKS_PER_INODE      2
+
 
 /*-----------------------------------------------------------------------------
 Função: Usada para identificar os desenvolvedores do T2FS.
@@ -114,6 +325,46 @@ Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero)
 int delete2 (char *filename);
 
 
+/*-----------------------------------------------------------------------------
+Função:	Move (renomeia) um arquivo ou diretório.
+	Apenas as entradas de diretório são alteradas: a entrada "newpath" é escrita com o mesmo i-node
+		de "oldpath" e, em seguida, a entrada "oldpath" é removida. Os dados não são copiados.
+	Uma falha no meio da operação pode deixar os dois nomes, mas nunca nenhum deles.
+	Ao mover um diretório para outro diretório pai, a sua entrada ".." é atualizada.
+	Se "newpath" já existe e é um arquivo regular (não aberto), ele é substituído por "oldpath".
+	São considerados erros:
+		(a) "oldpath" não existente ou diretório pai de "newpath" não existente;
+		(b) "newpath" existente que não seja um arquivo regular, ou "oldpath" diretório e "newpath" existente;
+		(c) mover um diretório para dentro de si mesmo.
+
+Entra:	oldpath -> caminho atual do arquivo ou diretório
+	newpath -> novo caminho do arquivo ou diretório
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int rename2 (char *oldpath, char *newpath);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Cria o arquivo "dstpath" como uma cópia do arquivo regular "srcpath" (reflink).
+	Os blocos de dados não são copiados: os dois arquivos passam a compartilhá-los e apenas os
+		blocos de indireção são duplicados. O número de referências de cada bloco é mantido numa
+		tabela criada no disco no primeiro uso (declarada na extensão do superbloco).
+	Ao escrever num bloco compartilhado, o arquivo recebe uma cópia privada do bloco (copy-on-write);
+		o conteúdo do outro arquivo não é alterado.
+	São considerados erros: "srcpath" inexistente ou que não seja um arquivo regular,
+		"dstpath" já existente e falta de espaço para os blocos de indireção.
+
+Entra:	srcpath -> caminho do arquivo a ser clonado
+	dstpath -> caminho do novo arquivo
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int clone2 (char *srcpath, char *dstpath);
+
+
 /*-----------------------------------------------------------------------------
 Função:	Abre um arquivo existente no disco.
 	O nome desse novo arquivo é aquele informado pelo parâmetro "filename".
@@ -173,6 +424,27 @@ Saída:	Se a operação foi realizada com sucesso, a função retorna o número
 int write2 (FILE2 handle, char *buffer, int size);
 
 
+/*-----------------------------------------------------------------------------
+Função:	Copia "len" bytes do arquivo "src", a partir da posição "srcOffset", para o arquivo "dst",
+		a partir da posição "dstOffset", sem passar os dados pela aplicação.
+	Os blocos necessários no destino são alocados antes da cópia e os dados são copiados bloco a bloco
+		dentro da biblioteca. Diferente de read2, bytes nulos são copiados normalmente.
+	Se a origem tem menos de "srcOffset + len" bytes, são copiados apenas os bytes existentes.
+	Os contadores de posição (current pointer) dos dois arquivos não são alterados.
+	Se "src" e "dst" são o mesmo arquivo, os trechos de origem e destino não podem se sobrepor.
+
+Entra:	src -> identificador do arquivo de origem
+	srcOffset -> deslocamento, em bytes, do início da cópia na origem
+	dst -> identificador do arquivo de destino
+	dstOffset -> deslocamento, em bytes, do início da cópia no destino
+	len -> número de bytes a serem copiados
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o número de bytes copiados.
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int copy_file_range2 (FILE2 src, DWORD srcOffset, FILE2 dst, DWORD dstOffset, DWORD len);
+
+
 /*-----------------------------------------------------------------------------
 Função:	Função usada para truncar um arquivo.
 	Remove do arquivo todos os bytes a partir da posição atual do contador de posição (CP)
@@ -187,6 +459,66 @@ Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero)
 int truncate2 (FILE2 handle);
 
 
+/*-----------------------------------------------------------------------------
+Função:	Altera o tamanho do arquivo identificado por "handle" para "size" bytes.
+	Se "size" é menor que o tamanho atual, os bytes a partir da posição "size" são removidos e os
+		blocos que deixam de ser usados são liberados. Se é maior, o trecho acrescentado fica como
+		um buraco, que é lido como zeros e não ocupa blocos. Um tamanho maior que o máximo de um
+		arquivo (blocos diretos, de indireção simples e dupla) é um erro.
+	O contador de posição (current pointer) do arquivo não é alterado.
+
+Entra:	handle -> identificador do arquivo
+	size -> novo tamanho do arquivo, em bytes
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int ftruncate2 (FILE2 handle, DWORD size);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Liga ou desliga a compressão do arquivo identificado por "handle".
+	Com a compressão ligada, cada bloco gravado é comprimido de forma independente e ocupa apenas
+		os setores necessários, de forma que leituras em posições aleatórias descomprimem um único
+		bloco. Blocos que não diminuem ao menos um setor são gravados sem compressão.
+	Leituras e escritas continuam transparentes. Blocos já gravados ficam como estão até serem
+		reescritos; a escolha é gravada no i-node e herdada por clone2.
+
+Entra:	handle -> identificador do arquivo
+	enable -> diferente de zero para ligar, zero para desligar
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int fcompress2 (FILE2 handle, int enable);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Informa os metadados do arquivo ou diretório indicado por "pathname", sem abrir um handle.
+	São informados o tipo, o tamanho em bytes e em blocos, o número do i-node e o layout dos blocos
+		(ponteiros diretos em uso, blocos de indireção e número de trechos contíguos de dados).
+
+Entra:	pathname -> caminho do arquivo ou diretório
+	stats -> estrutura de dados onde a função coloca as informações.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int stat2 (char *pathname, STAT2 *stats);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Informa os metadados do arquivo identificado por "handle" (ver stat2).
+
+Entra:	handle -> identificador do arquivo
+	stats -> estrutura de dados onde a função coloca as informações.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int fstat2 (FILE2 handle, STAT2 *stats);
+
+
 /*-----------------------------------------------------------------------------
 Função:	Reposiciona o contador de posições (current pointer) do arquivo identificado por "handle".
 	A nova posição é determinada pelo parâmetro "offset".
@@ -203,6 +535,27 @@ Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero)
 int seek2 (FILE2 handle, DWORD offset);
 
 
+/*-----------------------------------------------------------------------------
+Função:	Reposiciona o contador de posições (current pointer) do arquivo identificado por "handle",
+		de acordo com o modo "whence":
+	SEEK2_SET  -> posiciona em "offset" (como seek2). A posição pode estar além do fim do arquivo:
+		uma escrita nessa posição deixa um buraco, que não ocupa blocos e é lido como zeros.
+	SEEK2_DATA -> posiciona no primeiro byte, a partir de "offset", que pertence a um bloco com dados.
+	SEEK2_HOLE -> posiciona no primeiro byte, a partir de "offset", que pertence a um buraco.
+		O fim do arquivo é considerado um buraco.
+	Com SEEK2_DATA e SEEK2_HOLE, é erro "offset" estar no fim do arquivo ou além dele, assim
+		como não existir dados após "offset" (SEEK2_DATA).
+
+Entra:	handle -> identificador do arquivo
+	offset -> deslocamento, em bytes, a partir do início do arquivo
+	whence -> modo de reposicionamento (SEEK2_SET, SEEK2_DATA ou SEEK2_HOLE)
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna a nova posição do arquivo.
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int lseek2 (FILE2 handle, DWORD offset, int whence);
+
+
 /*-----------------------------------------------------------------------------
 Função:	Criar um novo diretório.
 	O caminho desse novo diretório é aquele informado pelo parâmetro "pathname".
@@ -236,6 +589,23 @@ Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero)
 int rmdir2 (char *pathname);
 
 
+/*-----------------------------------------------------------------------------
+Função:	Apaga o diretório "pathname" e todo o seu conteúdo (arquivos e subdiretórios).
+	A árvore é percorrida uma única vez, em pós-ordem; os i-nodes e blocos de todos os seus
+		elementos são liberados em lote ao final.
+	São considerados erros:
+		(a) "pathname" não existente ou que não seja um diretório;
+		(b) "pathname" ser o diretório raiz;
+		(c) algum arquivo ou diretório da árvore estar aberto, ou o diretório corrente estar na árvore.
+
+Entra:	pathname -> caminho do diretório a ser apagado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int rmtree2 (char *pathname);
+
+
 /*-----------------------------------------------------------------------------
 Função:	Altera o diretório atual de trabalho (working directory).
 		O caminho desse diretório é informado no parâmetro "pathname".
@@ -302,6 +672,202 @@ Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero)
 int readdir2 (DIR2 handle, DIRENT2 *dentry);
 
 
+/*-----------------------------------------------------------------------------
+Função:	Realiza a leitura, em lote, das entradas do diretório identificado por "handle".
+	A partir do ponteiro de entradas (current entry), lê até "max" entradas válidas, colocando-as em "dentries".
+	Cada bloco do diretório é lido uma única vez e os inodes das entradas são buscados em ordem crescente,
+		de forma que entradas cujos inodes estão no mesmo setor compartilham a mesma leitura.
+	Após a leitura, o ponteiro de entradas é ajustado para a entrada seguinte à última lida.
+
+Entra:	handle -> identificador do diretório cujas entradas deseja-se ler.
+	dentries -> vetor com espaço para pelo menos "max" entradas.
+	max -> número máximo de entradas a serem lidas.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o número de entradas lidas.
+		Se retornar "0" (zero), não há mais entradas válidas (e o ponteiro volta ao início do diretório).
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int getdents2 (DIR2 handle, DIRENT2 *dentries, int max);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Percorre a árvore do diretório "pathname", chamando "fn" para cada arquivo e subdiretório encontrado
+		(o próprio "pathname" e as entradas "." e ".." não são visitados).
+	Os diretórios são distribuídos entre "nthreads" threads: cada thread tem sua fila de diretórios e,
+		quando ela se esvazia, rouba trabalho das filas das outras (work stealing); sem trabalho, a
+		thread dorme até que um diretório seja enfileirado.
+	Os acessos ao disco são serializados por uma única trava do sistema de arquivos, liberada entre
+		uma leitura e outra: o que roda em paralelo é a decodificação dos diretórios e as chamadas
+		de "fn", não a leitura do disco.
+	Cada diretório é lido uma única vez e os i-nodes das suas entradas são buscados em lote, de forma que
+		"entry" já traz o tipo e o tamanho da entrada.
+	A ordem das visitas não é definida e "fn" pode ser chamada simultaneamente por threads diferentes;
+		"fn" não deve chamar outras funções da biblioteca.
+
+Entra:	pathname -> caminho do diretório raiz do percurso
+	fn -> função chamada com o caminho absoluto e os dados de cada entrada, além de "arg"
+	arg -> argumento repassado a "fn"
+	nthreads -> número de threads (valores menores que 1 percorrem a árvore na thread chamadora)
+
+Saída:	Se todo o percurso foi realizado, a função retorna "0" (zero).
+	Se "fn" interrompeu o percurso, retorna o valor diferente de zero retornado por "fn".
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int nftw2 (char *pathname, NFTW2_FN fn, void *arg, int nthreads);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Compacta o diretório informado por "pathname".
+	As entradas válidas são movidas para o início do diretório (mantendo a ordem) e os blocos
+		que ficaram sem entradas são liberados.
+	Os handles abertos para o diretório continuam válidos: seus ponteiros de entradas são ajustados
+		para a mesma entrada seguinte de antes da compactação.
+	A compactação também é realizada automaticamente quando, após uma remoção, menos de 1/4
+		das entradas de um diretório com mais de um bloco estão ocupadas.
+
+Entra:	pathname -> caminho do diretório a ser compactado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int compactdir2 (char *pathname);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Informa o espaço total e livre do sistema de arquivos.
+	Os valores vêm de contadores mantidos em memória e persistidos na extensão do superbloco,
+		de forma que a consulta não percorre os bitmaps.
+	Além dos totais, informa um resumo da fragmentação do espaço livre (quantidade e tamanho médio
+		dos trechos contíguos de blocos livres).
+	Também informa o estado da deduplicação (ver dedup2): o tamanho do índice, os blocos poupados
+		e os contadores de buscas desde a inicialização.
+	Em discos formatados com grupos de alocação (ver mkfs2), informa também o número de grupos.
+
+Entra:	stats -> estrutura de dados onde a função coloca as informações.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int statfs2 (STATFS2 *stats);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Liga ou desliga o empacotamento de caudas no disco.
+	Com o empacotamento ligado, ao fechar um arquivo o seu último bloco, se parcial, é movido
+		para um fragmento dentro de um bloco compartilhado com as caudas de outros arquivos.
+	A escolha é gravada no disco. Caudas já empacotadas continuam válidas ao desligar o modo.
+
+Entra:	enable -> diferente de zero para ligar, zero para desligar
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int tailpack2 (int enable);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Liga ou desliga os checksums dos blocos de dados no disco.
+	Com os checksums ligados, cada bloco de dados de arquivo gravado tem o seu CRC32C registrado
+		numa tabela declarada na extensão do superbloco (criada quando o modo é ligado).
+		Ao ler o bloco, o CRC é conferido e uma divergência faz a leitura falhar.
+	Ao desligar o modo a tabela é descartada: os blocos já gravados ficam sem checksum, assim como
+		os fragmentos de arquivos pequenos. A escolha é gravada no disco.
+
+Entra:	enable -> diferente de zero para ligar, zero para desligar
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int checksum2 (int enable);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Liga ou desliga a deduplicação de blocos no disco.
+	Com a deduplicação ligada, cada bloco inteiro escrito num arquivo é procurado, pela sua impressão
+		digital (CRC32C do conteúdo), num índice dos blocos já gravados. Se existe um bloco com o mesmo
+		conteúdo (conferido byte a byte), o arquivo passa a apontar para ele, que ganha uma referência,
+		e nada é gravado. Uma escrita posterior em qualquer um dos arquivos copia o bloco (copy-on-write).
+	As impressões ficam numa tabela declarada na extensão do superbloco (criada quando o modo é
+		ligado), a partir da qual o índice é montado em memória na primeira escrita deduplicada.
+		Ao desligar o modo a tabela é descartada: os blocos já gravados deixam de ser procurados.
+	Escritas parciais de blocos não são deduplicadas. A escolha é gravada no disco.
+
+Entra:	enable -> diferente de zero para ligar, zero para desligar
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int dedup2 (int enable);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Verifica a consistência do sistema de arquivos e, opcionalmente, corrige o que encontrou.
+	A árvore de diretórios é percorrida a partir da raiz por "nthreads" threads (como em nftw2),
+		marcando os i-nodes alcançáveis; em seguida a área de i-nodes é lida em leituras sequenciais
+		grandes, dividida entre as threads, e os blocos de cada i-node alcançável (dados, indireção
+		e fragmentos) são contados. Os bitmaps montados em memória são comparados com os bitmaps
+		do disco, e as referências de cada bloco com a tabela de contadores de referência.
+	Com "repair", os bitmaps do disco passam a refletir a árvore: i-nodes órfãos e blocos sem
+		referência são liberados, i-nodes e blocos em uso são marcados como ocupados, registros
+		que apontam para fora da área de i-nodes são removidos, os contadores de referência
+		são ajustados e os contadores de livres são recalculados. Ponteiros inválidos e setores
+		de fragmentos reclamados por dois arquivos são apenas informados.
+	Não deve haver arquivos abertos durante a verificação.
+
+Entra:	stats -> estrutura de dados onde a função coloca o resultado da verificação
+	repair -> diferente de zero para corrigir as inconsistências encontradas
+	nthreads -> número de threads (valores menores que 1 usam apenas a thread chamadora)
+
+Saída:	Se a verificação foi realizada, a função retorna "0" (zero), mesmo que tenha encontrado
+		inconsistências (ver "stats").
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int fsck2 (FSCK2_STATS *stats, int repair, int nthreads);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Desfragmenta o arquivo "pathname" ou, se for um diretório, o diretório e toda a sua árvore
+		("/" desfragmenta o sistema de arquivos inteiro).
+	Os blocos de cada arquivo fragmentado são copiados para um trecho contíguo de blocos livres: os
+		blocos de indireção no início do trecho, seguidos dos blocos de dados na ordem do arquivo.
+		O i-node passa a apontar para as cópias de uma vez e só então os blocos antigos são liberados.
+	Blocos compartilhados com outros arquivos (clone2 e dedup2) ficam no lugar. Um arquivo sem trecho
+		livre do tamanho necessário não é alterado.
+	Os handles abertos continuam válidos.
+
+Entra:	pathname -> caminho do arquivo ou do diretório
+	maxBlocksPerSecond -> limite de blocos copiados por segundo (0 para não limitar)
+	fn -> função chamada após cada arquivo com o caminho e o progresso, além de "arg" (pode ser NULL)
+	arg -> argumento repassado a "fn"
+	stats -> estrutura de dados onde a função coloca o resultado (pode ser NULL)
+
+Saída:	Se toda a desfragmentação foi realizada, a função retorna "0" (zero).
+	Se "fn" interrompeu a desfragmentação, retorna o valor diferente de zero retornado por "fn".
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int defrag2 (char *pathname, DWORD maxBlocksPerSecond, DEFRAG2_FN fn, void *arg, DEFRAG2_STATS *stats);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Informa a disposição no disco do arquivo "pathname" ou, se for um diretório, do diretório e de toda
+		a sua árvore ("/" cobre o sistema de arquivos inteiro), sem alterar o disco.
+	Para cada arquivo, "fn" recebe os trechos contíguos, os buracos, os blocos compartilhados e os blocos
+		de indireção, lidos do mapa de blocos do i-node; para diretórios, também os registros válidos
+		e os que cabem nos blocos alocados.
+	"stats" recebe os totais e os trechos de blocos livres do disco inteiro, agrupados por tamanho.
+
+Entra:	pathname -> caminho do arquivo ou do diretório
+	fn -> função chamada com o caminho absoluto e a disposição de cada arquivo, além de "arg" (pode ser NULL)
+	arg -> argumento repassado a "fn"
+	stats -> estrutura de dados onde a função coloca o resumo
+
+Saída:	Se todo o relatório foi feito, a função retorna "0" (zero).
+	Se "fn" interrompeu o relatório, retorna o valor diferente de zero retornado por "fn".
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int layout2 (char *pathname, LAYOUT2_FN fn, void *arg, LAYOUT2_STATS *stats);
+
+
 /*-----------------------------------------------------------------------------
 Função:	Fecha o diretório identificado pelo parâmetro "handle".
 
@@ -313,4 +879,130 @@ Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero)
 int closedir2 (DIR2 handle);
 
 
+/*-----------------------------------------------------------------------------
+Função:	Monta o sistema de arquivos gravado num dispositivo, criando um contexto próprio
+		(superbloco, tabelas, caches, handles e diretório corrente) que é usado com as
+		variantes t2fs_* das funções da API. Várias imagens podem ficar montadas ao mesmo
+		tempo. As funções sem o prefixo t2fs_ usam um sistema de arquivos padrão, montado
+		na primeira chamada sobre o disco de apidisk.
+
+Entra:	backend -> dispositivo da imagem (a estrutura é copiada; 'data' deve continuar válido
+		até a desmontagem)
+	options -> opções de montagem (NULL para as opções padrão)
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o sistema de arquivos montado.
+	Em caso de erro, será retornado NULL.
+-----------------------------------------------------------------------------*/
+T2FS *t2fs_mount (T2FS_BACKEND *backend, T2FS_OPTIONS *options);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Desmonta um sistema de arquivos montado com t2fs_mount.
+	Os arquivos que ainda estão abertos são fechados, as tabelas são gravadas no dispositivo
+		e toda a memória do contexto é liberada. O dispositivo não é fechado.
+	A desmontagem grava as dicas de registros livres dos diretórios e marca o disco como
+		desmontado corretamente: a próxima montagem carrega os contadores, os cursores de
+		alocação e as dicas sem percorrer os bitmaps. Se o disco foi alterado sem ser
+		desmontado e uma operação foi interrompida, a montagem reconstrói os contadores a
+		partir dos bitmaps, com várias threads.
+
+Entra:	fs -> sistema de arquivos a ser desmontado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_unmount (T2FS *fs);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Prepara um dispositivo sobre um arquivo de imagem (no mesmo formato de apidisk:
+		setores gravados em sequência, a partir do setor zero).
+
+Entra:	backend -> estrutura onde a função coloca o dispositivo
+	path -> caminho do arquivo de imagem, que deve existir
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_backend_file (T2FS_BACKEND *backend, char *path);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Fecha um dispositivo preparado com t2fs_backend_file (após desmontar o sistema de
+		arquivos que o usa).
+
+Entra:	backend -> dispositivo a ser fechado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_backend_close (T2FS_BACKEND *backend);
+
+
+/*-----------------------------------------------------------------------------
+Função:	Cria (ou sobrescreve) um arquivo de imagem com um sistema de arquivos vazio: superbloco
+		(com a extensão e os contadores já calculados), bitmaps, área de i-nodes e o diretório
+		raiz. O arquivo é criado esparso: apenas os setores com conteúdo diferente de zero
+		são escritos.
+	Com options->groupBlocks, o disco é dividido em grupos de alocação (ver GROUP_ALIGN): os
+		i-nodes são arredondados para o mesmo número em cada grupo e a tabela de descritores
+		(livres e cursores de busca de cada grupo) é gravada logo após a área de i-nodes. Cada
+		grupo é procurado a partir do seu próprio cursor, e grupos cheios são pulados pelos
+		contadores, sem leitura do bitmap.
+
+Entra:	path -> caminho do arquivo de imagem
+	options -> geometria da imagem (ver MKFS2_OPTIONS)
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro (inclusive geometria que não cabe nos campos do superbloco, ou imagem de 2 GB
+		ou mais compilada sem off_t de 64 bits), será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int mkfs2 (char *path, MKFS2_OPTIONS *options);
+
+
+/*-----------------------------------------------------------------------------
+Variantes das funções da API que operam sobre um sistema de arquivos montado com
+	t2fs_mount. Recebem o sistema de arquivos como primeiro parâmetro e têm o mesmo
+	comportamento e retorno da função sem o prefixo t2fs_ (que opera sobre o sistema
+	de arquivos padrão). Handles de arquivos e diretórios e o diretório corrente são
+	próprios de cada sistema de arquivos.
+	Sistemas de arquivos diferentes podem ser usados ao mesmo tempo por threads diferentes;
+	um mesmo sistema de arquivos não deve ser usado por duas threads ao mesmo tempo.
+-----------------------------------------------------------------------------*/
+FILE2 t2fs_create2 (T2FS *fs, char *filename);
+int t2fs_delete2 (T2FS *fs, char *filename);
+int t2fs_rename2 (T2FS *fs, char *oldpath, char *newpath);
+int t2fs_clone2 (T2FS *fs, char *srcpath, char *dstpath);
+FILE2 t2fs_open2 (T2FS *fs, char *filename);
+int t2fs_close2 (T2FS *fs, FILE2 handle);
+int t2fs_read2 (T2FS *fs, FILE2 handle, char *buffer, int size);
+int t2fs_write2 (T2FS *fs, FILE2 handle, char *buffer, int size);
+int t2fs_copy_file_range2 (T2FS *fs, FILE2 src, DWORD srcOffset, FILE2 dst, DWORD dstOffset, DWORD len);
+int t2fs_truncate2 (T2FS *fs, FILE2 handle);
+int t2fs_ftruncate2 (T2FS *fs, FILE2 handle, DWORD size);
+int t2fs_fcompress2 (T2FS *fs, FILE2 handle, int enable);
+int t2fs_stat2 (T2FS *fs, char *pathname, STAT2 *stats);
+int t2fs_fstat2 (T2FS *fs, FILE2 handle, STAT2 *stats);
+int t2fs_seek2 (T2FS *fs, FILE2 handle, DWORD offset);
+int t2fs_lseek2 (T2FS *fs, FILE2 handle, DWORD offset, int whence);
+int t2fs_mkdir2 (T2FS *fs, char *pathname);
+int t2fs_rmdir2 (T2FS *fs, char *pathname);
+int t2fs_rmtree2 (T2FS *fs, char *pathname);
+int t2fs_chdir2 (T2FS *fs, char *pathname);
+int t2fs_getcwd2 (T2FS *fs, char *pathname, int size);
+DIR2 t2fs_opendir2 (T2FS *fs, char *pathname);
+int t2fs_readdir2 (T2FS *fs, DIR2 handle, DIRENT2 *dentry);
+int t2fs_getdents2 (T2FS *fs, DIR2 handle, DIRENT2 *dentries, int max);
+int t2fs_nftw2 (T2FS *fs, char *pathname, NFTW2_FN fn, void *arg, int nthreads);
+int t2fs_compactdir2 (T2FS *fs, char *pathname);
+int t2fs_statfs2 (T2FS *fs, STATFS2 *stats);
+int t2fs_tailpack2 (T2FS *fs, int enable);
+int t2fs_checksum2 (T2FS *fs, int enable);
+int t2fs_dedup2 (T2FS *fs, int enable);
+int t2fs_fsck2 (T2FS *fs, FSCK2_STATS *stats, int repair, int nthreads);
+int t2fs_defrag2 (T2FS *fs, char *pathname, DWORD maxBlocksPerSecond, DEFRAG2_FN fn, void *arg, DEFRAG2_STATS *stats);
+int t2fs_layout2 (T2FS *fs, char *pathname, LAYOUT2_FN fn, void *arg, LAYOUT2_STATS *stats);
+int t2fs_closedir2 (T2FS *fs, DIR2 handle);
+
+
 #endif
@@ -0,0 +1,195 @@
+#include "../include/crc32c.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define CRC32C_HAS_SSE42 1
+#endif
+
+/* Polinômio de Castagnoli, na forma refletida */
+#define CRC32C_POLY 0x82F63B78
+
+/*-----------------------------------------------------------------------------
+Tabelas da versão portável: g_crc32c_table[k][b] é o CRC do byte 'b' seguido de 'k'
+bytes nulos. São montadas na primeira chamada.
+-----------------------------------------------------------------------------*/
+unsigned int g_crc32c_table[8][256];
+int g_crc32c_table_ready = 0;
+
+/*-----------------------------------------------------------------------------
+Estado da detecção da instrução crc32 (-1 enquanto não verificado)
+-----------------------------------------------------------------------------*/
+int g_crc32c_hardware = -1;
+
+/*-----------------------------------------------------------------------------
+Função: Monta as tabelas da versão portável
+-----------------------------------------------------------------------------*/
+void __crc32c_init_table()
+{
+    unsigned int crc;
+    int i, j, k;
+
+    for( i = 0; i < 256; i++ )
+    {
+        crc = i;
+
+        for( j = 0; j < 8; j++ )
+        {
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+        }
+
+        g_crc32c_table[0][i] = crc;
+    }
+
+    for( i = 0; i < 256; i++ )
+    {
+        for( k = 1; k < 8; k++ )
+        {
+            g_crc32c_table[k][i] = (g_crc32c_table[k - 1][i] >> 8) ^ g_crc32c_table[0][g_crc32c_table[k - 1][i] & 0xFF];
+        }
+    }
+
+    g_crc32c_table_ready = 1;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula o CRC32C sem instruções específicas do processador (ver crc32c.h)
+
+Entra:
+    crc -> CRC do trecho anterior (0 no início)
+    buffer -> bytes a serem somados
+    size -> número de bytes
+
+Saída:
+    O CRC32C acumulado.
+-----------------------------------------------------------------------------*/
+unsigned int crc32c_portable(unsigned int crc, unsigned char *buffer, int size)
+{
+    unsigned int low, high;
+
+    if( !g_crc32c_table_ready )
+    {
+        __crc32c_init_table();
+    }
+
+    crc = ~crc;
+
+    while( size >= 8 )
+    {
+        low = crc ^ (buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((unsigned int)buffer[3] << 24));
+        high = buffer[4] | (buffer[5] << 8) | (buffer[6] << 16) | ((unsigned int)buffer[7] << 24);
+
+        crc = g_crc32c_table[7][low & 0xFF] ^ g_crc32c_table[6][(low >> 8) & 0xFF] ^
+              g_crc32c_table[5][(low >> 16) & 0xFF] ^ g_crc32c_table[4][low >> 24] ^
+              g_crc32c_table[3][high & 0xFF] ^ g_crc32c_table[2][(high >> 8) & 0xFF] ^
+              g_crc32c_table[1][(high >> 16) & 0xFF] ^ g_crc32c_table[0][high >> 24];
+
+        buffer += 8;
+        size -= 8;
+    }
+
+    while( size-- > 0 )
+    {
+        crc = (crc >> 8) ^ g_crc32c_table[0][(crc ^ *buffer++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+#ifdef CRC32C_HAS_SSE42
+/*-----------------------------------------------------------------------------
+Função: Calcula o CRC32C com a instrução crc32 do SSE4.2, 8 bytes por instrução
+        (4 bytes em 32 bits, onde não há a forma de 64 bits)
+
+Entra:
+    crc -> CRC do trecho anterior (0 no início)
+    buffer -> bytes a serem somados
+    size -> número de bytes
+
+Saída:
+    O CRC32C acumulado.
+-----------------------------------------------------------------------------*/
+__attribute__((target("sse4.2")))
+unsigned int __crc32c_sse42(unsigned int crc, unsigned char *buffer, int size)
+{
+#ifdef __x86_64__
+    unsigned long long crc64 = ~crc;
+    unsigned long long value;
+
+    while( size >= 8 )
+    {
+        memcpy(&value, buffer, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+        buffer += 8;
+        size -= 8;
+    }
+
+    crc = (unsigned int)crc64;
+#else
+    unsigned int value;
+
+    crc = ~crc;
+
+    while( size >= 4 )
+    {
+        memcpy(&value, buffer, sizeof(value));
+        crc = _mm_crc32_u32(crc, value);
+        buffer += 4;
+        size -= 4;
+    }
+#endif
+
+    while( size-- > 0 )
+    {
+        crc = _mm_crc32_u8(crc, *buffer++);
+    }
+
+    return ~crc;
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+Função: Informa se crc32c usa a instrução do processador (ver crc32c.h)
+
+Saída:
+    Se usa, retorna 1
+    Se usa a versão portável, 0.
+-----------------------------------------------------------------------------*/
+int crc32c_hardware()
+{
+    if( g_crc32c_hardware < 0 )
+    {
+#ifdef CRC32C_HAS_SSE42
+        g_crc32c_hardware = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+#else
+        g_crc32c_hardware = 0;
+#endif
+    }
+
+    return g_crc32c_hardware;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula o CRC32C de um buffer (ver crc32c.h)
+
+Entra:
+    crc -> CRC do trecho anterior (0 no início)
+    buffer -> bytes a serem somados
+    size -> número de bytes
+
+Saída:
+    O CRC32C acumulado.
+-----------------------------------------------------------------------------*/
+unsigned int crc32c(unsigned int crc, unsigned char *buffer, int size)
+{
+#ifdef CRC32C_HAS_SSE42
+    if( crc32c_hardware() )
+    {
+        return __crc32c_sse42(crc, buffer, size);
+    }
+#endif
+
+    return crc32c_portable(crc, buffer, size);
+}
@@ -0,0 +1,305 @@
+#include "../include/lz.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH    4
+#define LZ_MAX_OFFSET   0xFFFF
+#define LZ_HASH_BITS    12
+#define LZ_HASH_SIZE    (1 << LZ_HASH_BITS)
+
+/*-----------------------------------------------------------------------------
+Função: Calcula a posição na tabela de busca dos 4 bytes a partir de 'p'
+
+Entra:
+    p -> primeiro dos 4 bytes
+
+Saída:
+    Índice na tabela de busca.
+-----------------------------------------------------------------------------*/
+unsigned int __lz_hash(unsigned char *p)
+{
+    unsigned int seq = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+
+    return (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve a extensão de um tamanho que não coube nos 4 bits do byte de controle
+
+Entra:
+    dst -> buffer de saída
+    op -> posição de escrita em 'dst'
+    dstCapacity -> tamanho do buffer de saída
+    length -> tamanho menos 15
+
+Saída:
+    Se coube, retorna a nova posição de escrita
+    Se não coube, retorna -1.
+-----------------------------------------------------------------------------*/
+int __lz_emit_length(unsigned char *dst, int op, int dstCapacity, int length)
+{
+    while( length >= 255 )
+    {
+        if( op >= dstCapacity )
+        {
+            return -1;
+        }
+
+        dst[op++] = 255;
+        length -= 255;
+    }
+
+    if( op >= dstCapacity )
+    {
+        return -1;
+    }
+
+    dst[op++] = (unsigned char)length;
+
+    return op;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve uma sequência: 'numLiterals' literais seguidos de uma cópia de
+        'matchLength' bytes a 'offset' bytes para trás (matchLength 0: sem cópia,
+        apenas na última sequência)
+
+Entra:
+    dst -> buffer de saída
+    op -> posição de escrita em 'dst'
+    dstCapacity -> tamanho do buffer de saída
+    literals -> literais
+    numLiterals -> número de literais
+    offset -> distância da cópia
+    matchLength -> tamanho da cópia
+
+Saída:
+    Se coube, retorna a nova posição de escrita
+    Se não coube, retorna -1.
+-----------------------------------------------------------------------------*/
+int __lz_emit(unsigned char *dst, int op, int dstCapacity, unsigned char *literals, int numLiterals, int offset, int matchLength)
+{
+    int matchCode = matchLength > 0 ? matchLength - LZ_MIN_MATCH : 0;
+    int tokenPos = op;
+
+    if( op >= dstCapacity )
+    {
+        return -1;
+    }
+
+    dst[tokenPos] = (unsigned char)(((numLiterals < 15 ? numLiterals : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    op++;
+
+    if( numLiterals >= 15 && (op = __lz_emit_length(dst, op, dstCapacity, numLiterals - 15)) < 0 )
+    {
+        return -1;
+    }
+
+    if( op + numLiterals > dstCapacity )
+    {
+        return -1;
+    }
+
+    memcpy(dst + op, literals, numLiterals);
+    op += numLiterals;
+
+    if( matchLength == 0 )
+    {
+        return op;
+    }
+
+    if( op + 2 > dstCapacity )
+    {
+        return -1;
+    }
+
+    dst[op++] = (unsigned char)(offset & 0xFF);
+    dst[op++] = (unsigned char)(offset >> 8);
+
+    if( matchCode >= 15 )
+    {
+        op = __lz_emit_length(dst, op, dstCapacity, matchCode - 15);
+    }
+
+    return op;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê a extensão de um tamanho (ver __lz_emit_length)
+
+Entra:
+    src -> dados comprimidos
+    ip -> posição de leitura em 'src' (é atualizada)
+    srcSize -> número de bytes de 'src'
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna a extensão
+    Se os dados acabaram, retorna -1.
+-----------------------------------------------------------------------------*/
+int __lz_read_length(unsigned char *src, int *ip, int srcSize)
+{
+    int length = 0;
+    unsigned char byte;
+
+    do
+    {
+        if( *ip >= srcSize )
+        {
+            return -1;
+        }
+
+        byte = src[(*ip)++];
+        length += byte;
+    } while( byte == 255 );
+
+    return length;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Comprime um buffer (ver lz.h)
+
+Entra:
+    src -> dados a serem comprimidos
+    srcSize -> número de bytes de 'src'
+    dst -> buffer de saída
+    dstCapacity -> tamanho do buffer de saída
+
+Saída:
+    Se os dados couberam em 'dst', retorna o número de bytes comprimidos
+    Se não couberam, retorna 0.
+-----------------------------------------------------------------------------*/
+int lz_compress(unsigned char *src, int srcSize, unsigned char *dst, int dstCapacity)
+{
+    int table[LZ_HASH_SIZE];
+    int ip = 0, anchor = 0, op = 0;
+    int ref, length;
+    unsigned int hash;
+
+    memset(table, 0xFF, sizeof(table));
+
+    while( ip + LZ_MIN_MATCH <= srcSize )
+    {
+        hash = __lz_hash(src + ip);
+        ref = table[hash];
+        table[hash] = ip;
+
+        if( ref < 0 || ip - ref > LZ_MAX_OFFSET || memcmp(src + ref, src + ip, LZ_MIN_MATCH) != 0 )
+        {
+            ip++;
+            continue;
+        }
+
+        length = LZ_MIN_MATCH;
+
+        while( ip + length < srcSize && src[ref + length] == src[ip + length] )
+        {
+            length++;
+        }
+
+        op = __lz_emit(dst, op, dstCapacity, src + anchor, ip - anchor, ip - ref, length);
+
+        if( op < 0 )
+        {
+            return 0;
+        }
+
+        ip += length;
+        anchor = ip;
+    }
+
+    // Literais finais (o descompressor para ao preencher a saída)
+    if( anchor < srcSize )
+    {
+        op = __lz_emit(dst, op, dstCapacity, src + anchor, srcSize - anchor, 0, 0);
+    }
+
+    return op < 0 ? 0 : op;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Descomprime dados gerados por lz_compress até preencher 'dstSize' bytes
+
+Entra:
+    src -> dados comprimidos
+    srcSize -> número máximo de bytes a serem lidos de 'src'
+    dst -> buffer de saída
+    dstSize -> número exato de bytes descomprimidos
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna 0
+    Se os dados comprimidos são inválidos, retorna -1.
+-----------------------------------------------------------------------------*/
+int lz_decompress(unsigned char *src, int srcSize, unsigned char *dst, int dstSize)
+{
+    int ip = 0, op = 0;
+    int token, numLiterals, matchLength, offset, extra;
+
+    while( op < dstSize )
+    {
+        if( ip >= srcSize )
+        {
+            return -1;
+        }
+
+        token = src[ip++];
+        numLiterals = token >> 4;
+
+        if( numLiterals == 15 )
+        {
+            if( (extra = __lz_read_length(src, &ip, srcSize)) < 0 )
+            {
+                return -1;
+            }
+
+            numLiterals += extra;
+        }
+
+        if( ip + numLiterals > srcSize || op + numLiterals > dstSize )
+        {
+            return -1;
+        }
+
+        memcpy(dst + op, src + ip, numLiterals);
+        ip += numLiterals;
+        op += numLiterals;
+
+        if( op == dstSize )
+        {
+            break;
+        }
+
+        if( ip + 2 > srcSize )
+        {
+            return -1;
+        }
+
+        offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        matchLength = (token & 0x0F) + LZ_MIN_MATCH;
+
+        if( (token & 0x0F) == 15 )
+        {
+            if( (extra = __lz_read_length(src, &ip, srcSize)) < 0 )
+            {
+                return -1;
+            }
+
+            matchLength += extra;
+        }
+
+        if( offset == 0 || offset > op || op + matchLength > dstSize )
+        {
+            return -1;
+        }
+
+        // Cópia byte a byte: a origem pode sobrepor o destino (sequências repetidas)
+        while( matchLength-- > 0 )
+        {
+            dst[op] = dst[op - offset];
+            op++;
+        }
+    }
+
+    return 0;
+}
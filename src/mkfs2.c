@@ -0,0 +1,406 @@
+#include "../include/t2fs.h"
+#include "../include/parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define OP_SUCCESS 0
+#define OP_ERROR -1
+
+#define MKFS2_VERSION       0x7E21
+#define MKFS2_MAX_AREA      0xFFFF      /* Maior área de controle (campos WORD do superbloco), em blocos */
+#define MKFS2_FILL_CHUNK    (64 * 1024) /* Bytes escritos por chamada ao marcar os blocos ocupados */
+
+/*-----------------------------------------------------------------------------
+Função: Calcula o número de blocos necessários para guardar 'bytes' bytes
+
+Entra:
+    bytes -> número de bytes
+    blockBytes -> tamanho do bloco, em bytes
+
+Saída:
+    Número de blocos (arredondado para cima).
+-----------------------------------------------------------------------------*/
+unsigned long long __mkfs2_blocks(unsigned long long bytes, DWORD blockBytes)
+{
+    return (bytes + blockBytes - 1) / blockBytes;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula a geometria da imagem: tamanhos das áreas do superbloco, número de
+        i-nodes (todos os que cabem na área de i-nodes) e grupos de alocação
+
+Entra:
+    options -> geometria pedida
+    sb -> superbloco a ser preenchido
+    sbe -> extensão do superbloco (recebe a geometria dos grupos)
+    totalInodes -> onde colocar o número de i-nodes
+
+Saída:
+    Se a geometria é válida, retorna OP_SUCCESS
+    Se não cabe nos campos do superbloco ou no disco, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __mkfs2_geometry(MKFS2_OPTIONS *options, struct t2fs_superbloco *sb, struct t2fs_superbloco_ext *sbe, DWORD *totalInodes)
+{
+    WORD blockSize = options->blockSize != 0 ? options->blockSize : MKFS2_DEFAULT_BLOCK_SIZE;
+    DWORD blockBytes = blockSize * SECTOR_SIZE;
+    unsigned long long inodes = options->inodes;
+    unsigned long long dataBitmap, inodeBitmap, inodeArea, groupTable = 0, metadata;
+    DWORD groups = 0;
+
+    if( blockSize > MKFS2_MAX_BLOCK_SIZE || (unsigned long long)options->diskSize * blockSize > 0xFFFFFFFFull )
+    {
+        return OP_ERROR;
+    }
+
+    // Por padrão, um i-node a cada MKFS2_BLOCKS_PER_INODE blocos, limitado à maior área de i-nodes
+    if( inodes == 0 )
+    {
+        inodes = options->diskSize / MKFS2_BLOCKS_PER_INODE;
+        inodes = inodes < MKFS2_MAX_AREA * (blockBytes / sizeof(struct t2fs_inode)) ? inodes : MKFS2_MAX_AREA * (blockBytes / sizeof(struct t2fs_inode));
+    }
+
+    // O i-node 0 é o diretório raiz: o disco precisa de pelo menos mais um
+    inodes = inodes < 2 ? 2 : inodes;
+
+    // Grupos com setores próprios nos bitmaps e o mesmo número de i-nodes, que precisa ocupar
+    // blocos inteiros da área de i-nodes (blocos com um número de setores potência de 2)
+    if( options->groupBlocks != 0 )
+    {
+        if( options->groupBlocks % GROUP_ALIGN != 0 || (blockSize & (blockSize - 1)) != 0 )
+        {
+            return OP_ERROR;
+        }
+
+        groups = (DWORD)__mkfs2_blocks(options->diskSize, options->groupBlocks);
+        inodes = __mkfs2_blocks(__mkfs2_blocks(inodes, groups), GROUP_ALIGN) * GROUP_ALIGN * groups;
+        groupTable = __mkfs2_blocks((unsigned long long)groups * GROUP_DESC_WORDS * sizeof(DWORD), blockBytes);
+    }
+
+    dataBitmap = __mkfs2_blocks(__mkfs2_blocks(options->diskSize, 8), blockBytes);
+    inodeArea = __mkfs2_blocks(inodes * sizeof(struct t2fs_inode), blockBytes);
+    *totalInodes = (DWORD)(inodeArea * (blockBytes / sizeof(struct t2fs_inode)));
+    inodeBitmap = __mkfs2_blocks(__mkfs2_blocks(*totalInodes, 8), blockBytes);
+
+    if( (options->freeBlocksBitmapSize != 0 && options->freeBlocksBitmapSize < dataBitmap) ||
+        (options->freeInodeBitmapSize != 0 && options->freeInodeBitmapSize < inodeBitmap) )
+    {
+        return OP_ERROR;
+    }
+
+    dataBitmap = options->freeBlocksBitmapSize != 0 ? options->freeBlocksBitmapSize : dataBitmap;
+    inodeBitmap = options->freeInodeBitmapSize != 0 ? options->freeInodeBitmapSize : inodeBitmap;
+    metadata = 1 + dataBitmap + inodeBitmap + inodeArea + groupTable;
+
+    // Áreas de controle, bloco do diretório raiz e pelo menos um bloco livre
+    if( dataBitmap > MKFS2_MAX_AREA || inodeBitmap > MKFS2_MAX_AREA || inodeArea > MKFS2_MAX_AREA || metadata + 2 > options->diskSize )
+    {
+        return OP_ERROR;
+    }
+
+    memcpy(sb->id, "T2FS", 4);
+    sb->version = MKFS2_VERSION;
+    sb->superblockSize = 1;
+    sb->freeBlocksBitmapSize = (WORD)dataBitmap;
+    sb->freeInodeBitmapSize = (WORD)inodeBitmap;
+    sb->inodeAreaSize = (WORD)inodeArea;
+    sb->blockSize = blockSize;
+    sb->diskSize = options->diskSize;
+
+    memset(sbe, 0, sizeof(struct t2fs_superbloco_ext));
+
+    if( groups != 0 )
+    {
+        sbe->groupBlocks = options->groupBlocks;
+        sbe->groupInodes = *totalInodes / groups;
+        sbe->groupTableBlock = (DWORD)(metadata - groupTable);
+        sbe->groupTableSize = (DWORD)groupTable;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve bytes numa posição do arquivo de imagem
+
+Entra:
+    image -> arquivo de imagem
+    offset -> posição, em bytes
+    buffer -> bytes a serem escritos
+    size -> número de bytes
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __mkfs2_write(FILE *image, off_t offset, BYTE *buffer, size_t size)
+{
+    if( fseeko(image, offset, SEEK_SET) != 0 || fwrite(buffer, 1, size, image) != size )
+    {
+        return OP_ERROR;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Marca como ocupados os primeiros bits de um bitmap, escrevendo os bytes
+        cheios em blocos de MKFS2_FILL_CHUNK bytes
+
+Entra:
+    image -> arquivo de imagem
+    offset -> posição do bitmap, em bytes
+    numBits -> número de bits ocupados, a partir do bit 0
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __mkfs2_fill_bitmap(FILE *image, off_t offset, DWORD numBits)
+{
+    BYTE *chunk = (BYTE*)malloc(MKFS2_FILL_CHUNK);
+    DWORD fullBytes = numBits / 8, written, size;
+    BYTE last = (BYTE)((1 << (numBits % 8)) - 1);
+    int result = OP_SUCCESS;
+
+    memset(chunk, 0xFF, MKFS2_FILL_CHUNK);
+
+    for( written = 0; result == OP_SUCCESS && written < fullBytes; written += size )
+    {
+        size = fullBytes - written < MKFS2_FILL_CHUNK ? fullBytes - written : MKFS2_FILL_CHUNK;
+        result = __mkfs2_write(image, offset + written, chunk, size);
+    }
+
+    if( result == OP_SUCCESS && last != 0 )
+    {
+        result = __mkfs2_write(image, offset + fullBytes, &last, 1);
+    }
+
+    free(chunk);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve o superbloco e a sua extensão (contadores de espaço livre da imagem vazia)
+
+Entra:
+    image -> arquivo de imagem
+    sb -> superbloco
+    sbe -> extensão do superbloco, com a geometria dos grupos (recebe os contadores)
+    totalInodes -> número de i-nodes
+    firstFree -> primeiro bloco livre (após o bloco do diretório raiz)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __mkfs2_write_superblock(FILE *image, struct t2fs_superbloco *sb, struct t2fs_superbloco_ext *sbe, DWORD totalInodes, DWORD firstFree)
+{
+    BYTE sector[SECTOR_SIZE], *buffer;
+
+    memset(sector, 0, SECTOR_SIZE);
+
+    buffer = superblock_to_buffer(sb);
+    memcpy(sector, buffer, sizeof(struct t2fs_superbloco));
+    free(buffer);
+
+    memcpy(sbe->id, SB_EXT_ID, 4);
+    sbe->state = SB_STATE_CLEAN;
+    sbe->freeBlocks = sb->diskSize - firstFree;
+    sbe->freeInodes = totalInodes - 1;
+    sbe->freeBlockRuns = 1;
+    sbe->blockHint = firstFree;
+    sbe->inodeHint = 1;
+
+    buffer = superblock_ext_to_buffer(sbe);
+    memcpy(sector + SB_EXT_OFFSET, buffer, sizeof(struct t2fs_superbloco_ext));
+    free(buffer);
+
+    return __mkfs2_write(image, 0, sector, SECTOR_SIZE);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve a tabela de descritores dos grupos da imagem vazia: todos os blocos e
+        i-nodes de cada grupo estão livres, exceto as áreas de controle, o bloco do
+        diretório raiz e o i-node 0, que ficam no grupo 0
+
+Entra:
+    image -> arquivo de imagem
+    sb -> superbloco
+    sbe -> extensão do superbloco, com a geometria dos grupos
+    firstFree -> primeiro bloco livre (após o bloco do diretório raiz)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __mkfs2_write_groups(FILE *image, struct t2fs_superbloco *sb, struct t2fs_superbloco_ext *sbe, DWORD firstFree)
+{
+    DWORD blockBytes = sb->blockSize * SECTOR_SIZE;
+    DWORD groups = (sb->diskSize + sbe->groupBlocks - 1) / sbe->groupBlocks;
+    DWORD desc[GROUP_DESC_WORDS], start, end, g;
+    BYTE *table, *buffer;
+    int result, i;
+
+    table = (BYTE*)calloc(sbe->groupTableSize, blockBytes);
+
+    for( g = 0; g < groups; g++ )
+    {
+        start = g * sbe->groupBlocks < firstFree ? firstFree : g * sbe->groupBlocks;
+        end = g * sbe->groupBlocks + sbe->groupBlocks < sb->diskSize ? g * sbe->groupBlocks + sbe->groupBlocks : sb->diskSize;
+        start = start < end ? start : end;
+
+        desc[GROUP_FREE_BLOCKS] = end - start;
+        desc[GROUP_FREE_INODES] = sbe->groupInodes - (g == 0);
+        desc[GROUP_BLOCK_HINT] = start;
+        desc[GROUP_INODE_HINT] = g * sbe->groupInodes + (g == 0);
+
+        for( i = 0; i < GROUP_DESC_WORDS; i++ )
+        {
+            buffer = dword_to_buffer(desc[i]);
+            memcpy(table + (g * GROUP_DESC_WORDS + i) * sizeof(DWORD), buffer, sizeof(DWORD));
+            free(buffer);
+        }
+    }
+
+    result = __mkfs2_write(image, (off_t)sbe->groupTableBlock * blockBytes, table, (size_t)sbe->groupTableSize * blockBytes);
+    free(table);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve o i-node 0 e o bloco do diretório raiz (registros "." e "..")
+
+Entra:
+    image -> arquivo de imagem
+    sb -> superbloco
+    rootBlock -> bloco de dados do diretório raiz
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __mkfs2_write_root(FILE *image, struct t2fs_superbloco *sb, DWORD rootBlock)
+{
+    off_t blockBytes = sb->blockSize * SECTOR_SIZE;
+    off_t inodeArea = (sb->superblockSize + sb->freeBlocksBitmapSize + sb->freeInodeBitmapSize) * blockBytes;
+    struct t2fs_inode inode;
+    struct t2fs_record record;
+    BYTE *buffer;
+    int result, i;
+
+    inode.blocksFileSize = 1;
+    inode.bytesFileSize = (DWORD)blockBytes;
+    inode.dataPtr[0] = rootBlock;
+    inode.dataPtr[1] = INVALID_PTR;
+    inode.singleIndPtr = INVALID_PTR;
+    inode.doubleIndPtr = INVALID_PTR;
+    inode.reservado[INODE_FLAGS] = 0;
+    inode.reservado[INODE_FRAGMENT] = INVALID_PTR;
+
+    buffer = inode_to_buffer(&inode);
+    result = __mkfs2_write(image, inodeArea, buffer, sizeof(struct t2fs_inode));
+    free(buffer);
+
+    // O diretório raiz é o seu próprio pai
+    for( i = 0; result == OP_SUCCESS && i < 2; i++ )
+    {
+        memset(&record, 0, sizeof(record));
+        strcpy(record.name, i == 0 ? "." : "..");
+        record.TypeVal = TYPEVAL_DIRETORIO;
+        record.inodeNumber = 0;
+
+        buffer = record_to_buffer(&record);
+        result = __mkfs2_write(image, rootBlock * blockBytes + i * sizeof(struct t2fs_record), buffer, sizeof(struct t2fs_record));
+        free(buffer);
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Cria (ou sobrescreve) um arquivo de imagem com um sistema de arquivos vazio: superbloco
+		(com a extensão e os contadores já calculados), bitmaps, área de i-nodes e o diretório
+		raiz. O arquivo é criado esparso: apenas os setores com conteúdo diferente de zero
+		são escritos.
+	Com options->groupBlocks, o disco é dividido em grupos de alocação (ver GROUP_ALIGN): os
+		i-nodes são arredondados para o mesmo número em cada grupo e a tabela de descritores
+		(livres e cursores de busca de cada grupo) é gravada logo após a área de i-nodes. Cada
+		grupo é procurado a partir do seu próprio cursor, e grupos cheios são pulados pelos
+		contadores, sem leitura do bitmap.
+
+Entra:	path -> caminho do arquivo de imagem
+	options -> geometria da imagem (ver MKFS2_OPTIONS)
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro (inclusive geometria que não cabe nos campos do superbloco, ou imagem de 2 GB
+		ou mais compilada sem off_t de 64 bits), será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int mkfs2 (char *path, MKFS2_OPTIONS *options)
+{
+    struct t2fs_superbloco sb;
+    struct t2fs_superbloco_ext sbe;
+    DWORD totalInodes, rootBlock;
+    off_t blockBytes;
+    FILE *image;
+    int result;
+
+    if( path == NULL || options == NULL || __mkfs2_geometry(options, &sb, &sbe, &totalInodes) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    // Sem _FILE_OFFSET_BITS=64 (ver makefile), um off_t de 32 bits não endereça imagens de 2 GB ou mais
+    if( sizeof(off_t) < 8 && (unsigned long long)sb.diskSize * sb.blockSize * SECTOR_SIZE > 0x7FFFFFFFULL )
+    {
+        return OP_ERROR;
+    }
+
+    if( (image = fopen(path, "wb")) == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    blockBytes = sb.blockSize * SECTOR_SIZE;
+    rootBlock = sb.superblockSize + sb.freeBlocksBitmapSize + sb.freeInodeBitmapSize + sb.inodeAreaSize + sbe.groupTableSize;
+
+    // O arquivo vazio é estendido até o tamanho do disco sem escrever os zeros
+    result = ftruncate(fileno(image), (off_t)sb.diskSize * blockBytes) == 0 ? OP_SUCCESS : OP_ERROR;
+
+    // Blocos de controle (com a tabela dos grupos) e do diretório raiz ocupados; i-node 0 ocupado
+    if( result == OP_SUCCESS )
+    {
+        result = __mkfs2_write_superblock(image, &sb, &sbe, totalInodes, rootBlock + 1);
+    }
+
+    if( result == OP_SUCCESS && sbe.groupBlocks != 0 )
+    {
+        result = __mkfs2_write_groups(image, &sb, &sbe, rootBlock + 1);
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        result = __mkfs2_fill_bitmap(image, sb.superblockSize * blockBytes, rootBlock + 1);
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        result = __mkfs2_fill_bitmap(image, (sb.superblockSize + sb.freeBlocksBitmapSize) * blockBytes, 1);
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        result = __mkfs2_write_root(image, &sb, rootBlock);
+    }
+
+    if( fclose(image) != 0 )
+    {
+        result = OP_ERROR;
+    }
+
+    return result;
+}
@@ -92,7 +92,7 @@ struct t2fs_superbloco* buffer_to_superblock(BYTE *buffer, int start)
 }
 
 /*-----------------------------------------------------------------------------
-Função: Cria um 't2fs_inode' a partir do buffer
+Função: Cria um 't2fs_superbloco_ext' a partir do buffer
 
 Entra:
     buffer -> buffer com os dados para a estrutura
@@ -101,23 +101,63 @@ Entra:
 Saída:
     A struct criada a partir dos dados.
 -----------------------------------------------------------------------------*/
-struct t2fs_inode* buffer_to_inode(BYTE *buffer, int start)
+struct t2fs_superbloco_ext* buffer_to_superblock_ext(BYTE *buffer, int start)
 {
-    struct t2fs_inode *inode = NULL;
-    inode = (struct t2fs_inode*)malloc(sizeof(struct t2fs_inode));
+    struct t2fs_superbloco_ext *ext = NULL;
+    int i = 0;
+
+    ext = (struct t2fs_superbloco_ext*)malloc(sizeof(struct t2fs_superbloco_ext));
+
+    for( i = 0; i < 4; i++ )
+    {
+        ext->id[i] = (char)buffer[start + i];
+    }
+
+    ext->state = __get_value_from_buffer(buffer, start + 4, 4);
+    ext->freeBlocks = __get_value_from_buffer(buffer, start + 8, 4);
+    ext->freeInodes = __get_value_from_buffer(buffer, start + 12, 4);
+    ext->freeBlockRuns = __get_value_from_buffer(buffer, start + 16, 4);
+    ext->refcountBlock = __get_value_from_buffer(buffer, start + 20, 4);
+    ext->refcountSize = __get_value_from_buffer(buffer, start + 24, 4);
+    ext->features = __get_value_from_buffer(buffer, start + 28, 4);
+    ext->checksumBlock = __get_value_from_buffer(buffer, start + 32, 4);
+    ext->checksumSize = __get_value_from_buffer(buffer, start + 36, 4);
+    ext->dedupBlock = __get_value_from_buffer(buffer, start + 40, 4);
+    ext->dedupSize = __get_value_from_buffer(buffer, start + 44, 4);
+    ext->unmountState = __get_value_from_buffer(buffer, start + 48, 4);
+    ext->blockHint = __get_value_from_buffer(buffer, start + 52, 4);
+    ext->inodeHint = __get_value_from_buffer(buffer, start + 56, 4);
+    ext->fragmentHint = __get_value_from_buffer(buffer, start + 60, 4);
+    ext->groupBlocks = __get_value_from_buffer(buffer, start + 64, 4);
+    ext->groupInodes = __get_value_from_buffer(buffer, start + 68, 4);
+    ext->groupTableBlock = __get_value_from_buffer(buffer, start + 72, 4);
+    ext->groupTableSize = __get_value_from_buffer(buffer, start + 76, 4);
+
+    return ext;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Preenche um 't2fs_inode' já alocado a partir do buffer
 
+Entra:
+    buffer -> buffer com os dados para a estrutura
+    start -> começo do dado no buffer
+    inode -> estrutura a ser preenchida
+-----------------------------------------------------------------------------*/
+void buffer_read_inode(BYTE *buffer, int start, struct t2fs_inode *inode)
+{
     inode->blocksFileSize = __get_value_from_buffer(buffer, start + 0, 4);
     inode->bytesFileSize = __get_value_from_buffer(buffer, start + 4, 4);
     inode->dataPtr[0] = __get_value_from_buffer(buffer, start + 8, 4);
     inode->dataPtr[1] = __get_value_from_buffer(buffer, start + 12, 4);
     inode->singleIndPtr = __get_value_from_buffer(buffer, start + 16, 4);
     inode->doubleIndPtr = __get_value_from_buffer(buffer, start + 20, 4);
-
-    return inode;
+    inode->reservado[0] = __get_value_from_buffer(buffer, start + 24, 4);
+    inode->reservado[1] = __get_value_from_buffer(buffer, start + 28, 4);
 }
 
 /*-----------------------------------------------------------------------------
-Função: Cria um 't2fs_record' a partir do buffer
+Função: Cria um 't2fs_inode' a partir do buffer
 
 Entra:
     buffer -> buffer com os dados para a estrutura
@@ -126,12 +166,27 @@ Entra:
 Saída:
     A struct criada a partir dos dados.
 -----------------------------------------------------------------------------*/
-struct t2fs_record* buffer_to_record(BYTE *buffer, int start)
+struct t2fs_inode* buffer_to_inode(BYTE *buffer, int start)
 {
-    struct t2fs_record *record = NULL;
-    int i;
+    struct t2fs_inode *inode = NULL;
+    inode = (struct t2fs_inode*)malloc(sizeof(struct t2fs_inode));
 
-    record = (struct t2fs_record*)malloc(sizeof(struct t2fs_record));
+    buffer_read_inode(buffer, start, inode);
+
+    return inode;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Preenche um 't2fs_record' já alocado a partir do buffer
+
+Entra:
+    buffer -> buffer com os dados para a estrutura
+    start -> começo do dado no buffer
+    record -> estrutura a ser preenchida
+-----------------------------------------------------------------------------*/
+void buffer_read_record(BYTE *buffer, int start, struct t2fs_record *record)
+{
+    int i;
 
     record->TypeVal = buffer[start + 0];
     record->inodeNumber = __get_value_from_buffer(buffer, start + 60, 4);
@@ -142,6 +197,25 @@ struct t2fs_record* buffer_to_record(BYTE *buffer, int start)
     }
 
 	record->name[58] = '\0';
+}
+
+/*-----------------------------------------------------------------------------
+Função: Cria um 't2fs_record' a partir do buffer
+
+Entra:
+    buffer -> buffer com os dados para a estrutura
+    start -> começo do dado no buffer
+
+Saída:
+    A struct criada a partir dos dados.
+-----------------------------------------------------------------------------*/
+struct t2fs_record* buffer_to_record(BYTE *buffer, int start)
+{
+    struct t2fs_record *record = NULL;
+
+    record = (struct t2fs_record*)malloc(sizeof(struct t2fs_record));
+
+    buffer_read_record(buffer, start, record);
 
     return record;
 }
@@ -161,6 +235,84 @@ DWORD buffer_to_dword(BYTE *buffer, int start)
     return __get_value_from_buffer(buffer, start, 4);
 }
 
+/*-----------------------------------------------------------------------------
+Função: Cria um buffer a partir de um 't2fs_superbloco'
+
+Entra:
+    sb -> superbloco a ser transformado
+
+Saída:
+    O buffer representando a estrutura.
+-----------------------------------------------------------------------------*/
+BYTE* superblock_to_buffer(struct t2fs_superbloco *sb)
+{
+    BYTE *buffer = NULL;
+    int i;
+
+    buffer = (BYTE*)calloc(sizeof(struct t2fs_superbloco), sizeof(BYTE));
+
+    for( i = 0; i < 4; i++ )
+    {
+        buffer[i] = (BYTE)sb->id[i];
+        buffer[16 + i] = __convert_value_to_buffer(sb->diskSize, 4)[i];
+    }
+
+    for( i = 0; i < 2; i++ )
+    {
+        buffer[4 + i] = __convert_value_to_buffer(sb->version, 2)[i];
+        buffer[6 + i] = __convert_value_to_buffer(sb->superblockSize, 2)[i];
+        buffer[8 + i] = __convert_value_to_buffer(sb->freeBlocksBitmapSize, 2)[i];
+        buffer[10 + i] = __convert_value_to_buffer(sb->freeInodeBitmapSize, 2)[i];
+        buffer[12 + i] = __convert_value_to_buffer(sb->inodeAreaSize, 2)[i];
+        buffer[14 + i] = __convert_value_to_buffer(sb->blockSize, 2)[i];
+    }
+
+    return buffer;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Cria um buffer a partir de um 't2fs_superbloco_ext'
+
+Entra:
+    ext -> extensão do superbloco a ser transformada
+
+Saída:
+    O buffer representando a estrutura.
+-----------------------------------------------------------------------------*/
+BYTE* superblock_ext_to_buffer(struct t2fs_superbloco_ext *ext)
+{
+    BYTE *buffer = NULL;
+    int i;
+
+    buffer = (BYTE*)calloc(sizeof(struct t2fs_superbloco_ext), sizeof(BYTE));
+
+    for( i = 0; i < 4; i++ )
+    {
+        buffer[i] = (BYTE)ext->id[i];
+        buffer[4 + i] = __convert_value_to_buffer(ext->state, 4)[i];
+        buffer[8 + i] = __convert_value_to_buffer(ext->freeBlocks, 4)[i];
+        buffer[12 + i] = __convert_value_to_buffer(ext->freeInodes, 4)[i];
+        buffer[16 + i] = __convert_value_to_buffer(ext->freeBlockRuns, 4)[i];
+        buffer[20 + i] = __convert_value_to_buffer(ext->refcountBlock, 4)[i];
+        buffer[24 + i] = __convert_value_to_buffer(ext->refcountSize, 4)[i];
+        buffer[28 + i] = __convert_value_to_buffer(ext->features, 4)[i];
+        buffer[32 + i] = __convert_value_to_buffer(ext->checksumBlock, 4)[i];
+        buffer[36 + i] = __convert_value_to_buffer(ext->checksumSize, 4)[i];
+        buffer[40 + i] = __convert_value_to_buffer(ext->dedupBlock, 4)[i];
+        buffer[44 + i] = __convert_value_to_buffer(ext->dedupSize, 4)[i];
+        buffer[48 + i] = __convert_value_to_buffer(ext->unmountState, 4)[i];
+        buffer[52 + i] = __convert_value_to_buffer(ext->blockHint, 4)[i];
+        buffer[56 + i] = __convert_value_to_buffer(ext->inodeHint, 4)[i];
+        buffer[60 + i] = __convert_value_to_buffer(ext->fragmentHint, 4)[i];
+        buffer[64 + i] = __convert_value_to_buffer(ext->groupBlocks, 4)[i];
+        buffer[68 + i] = __convert_value_to_buffer(ext->groupInodes, 4)[i];
+        buffer[72 + i] = __convert_value_to_buffer(ext->groupTableBlock, 4)[i];
+        buffer[76 + i] = __convert_value_to_buffer(ext->groupTableSize, 4)[i];
+    }
+
+    return buffer;
+}
+
 /*-----------------------------------------------------------------------------
 Função: Cria um buffer a partir de um 't2fs_inode'
 
@@ -185,6 +337,8 @@ BYTE* inode_to_buffer(struct t2fs_inode *inode)
         buffer[12 + i] = __convert_value_to_buffer(inode->dataPtr[1], 4)[i];
         buffer[16 + i] = __convert_value_to_buffer(inode->singleIndPtr, 4)[i];
         buffer[20 + i] = __convert_value_to_buffer(inode->doubleIndPtr, 4)[i];
+        buffer[24 + i] = __convert_value_to_buffer(inode->reservado[0], 4)[i];
+        buffer[28 + i] = __convert_value_to_buffer(inode->reservado[1], 4)[i];
     }
 
     return buffer;
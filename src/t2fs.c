@@ -2,47 +2,397 @@
 #include "../include/bitmap2.h"
 #include "../include/apidisk.h"
 #include "../include/parser.h"
+#include "../include/lz.h"
+#include "../include/crc32c.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
 
 #define OP_SUCCESS 0
 #define OP_ERROR -1
 
 /*-----------------------------------------------------------------------------
-Flag de inicialização da biblioteca
+Dica de registro livre de um diretório: nenhum registro antes de 'firstFree' está livre
 -----------------------------------------------------------------------------*/
-int g_initialized = 0;
+#define DIR_HINT_CACHE_SIZE 64
+#define DIR_HINT_DISK_SIZE 12           /* Bytes de uma dica gravada na desmontagem (ver __dir_hints_write) */
+#define DIR_HINT_LIVE_UNKNOWN 0xFFFFFFFF
+
+typedef struct {
+    DWORD inodeNumber;  /* Inode do diretório */
+    DWORD firstFree;    /* Limite inferior para o primeiro registro livre */
+    DWORD liveRecords;  /* Número de registros válidos (se liveKnown) */
+    int liveKnown;      /* Flag indicando se liveRecords é conhecido */
+    DWORD lastChild;    /* Último inode alocado para uma entrada do diretório (0 se desconhecido) */
+    int valid;          /* Flag indicando se a dica é válida */
+} DIR_HINT;
 
 /*-----------------------------------------------------------------------------
-Superbloco do disco
+Um diretório com mais de um bloco é compactado quando menos de 1/DIR_COMPACT_RATIO
+dos seus registros estão ocupados.
 -----------------------------------------------------------------------------*/
-struct t2fs_superbloco *g_sb;
+#define DIR_COMPACT_RATIO 4
 
 /*-----------------------------------------------------------------------------
-Inode associado ao diretório raiz
+Cache de inodes (write-through), mapeado diretamente pelo número do inode
 -----------------------------------------------------------------------------*/
-struct t2fs_inode *g_ri;
+#define INODE_CACHE_SIZE 256
+
+typedef struct {
+    DWORD inodeNumber;          /* Número do inode */
+    struct t2fs_inode inode;    /* Cópia do inode no disco */
+    int valid;                  /* Flag indicando se a entrada é válida */
+} INODE_CACHE_ENTRY;
+
+
+/*-----------------------------------------------------------------------------
+Cache de resolução de caminhos (apenas caminhos existentes), mapeado pelo hash do
+caminho absoluto. É descartado inteiro sempre que um record é removido.
+-----------------------------------------------------------------------------*/
+#define PATH_CACHE_SIZE 64
+
+typedef struct {
+    char *path;                 /* Caminho absoluto normalizado */
+    struct t2fs_record record;  /* Record associado ao caminho */
+} PATH_CACHE_ENTRY;
+
+
+/*-----------------------------------------------------------------------------
+Referência a um inode de uma entrada lida em lote (ver getdents2)
+-----------------------------------------------------------------------------*/
+typedef struct {
+    DWORD inodeNumber;  /* Número do inode da entrada */
+    int idxEntry;       /* Índice da entrada no vetor de saída */
+} INODE_REF;
+
+/*-----------------------------------------------------------------------------
+Diretório a ser visitado por nftw2
+-----------------------------------------------------------------------------*/
+typedef struct {
+    DWORD inodeNumber;  /* Inode do diretório */
+    char *path;         /* Caminho absoluto do diretório */
+} WALK_ITEM;
+
+/*-----------------------------------------------------------------------------
+Fila de diretórios de uma thread de nftw2: a dona insere e retira no fim ('tail');
+as outras threads roubam do início ('head').
+-----------------------------------------------------------------------------*/
+typedef struct {
+    WALK_ITEM *items;       /* Diretórios na fila, de 'head' até 'tail' - 1 */
+    int head;               /* Posição do item mais antigo */
+    int tail;               /* Posição seguinte ao item mais novo */
+    int capacity;           /* Capacidade alocada de 'items' */
+    pthread_mutex_t lock;   /* Trava da fila */
+} WALK_DEQUE;
+
+/*-----------------------------------------------------------------------------
+Estado compartilhado de um percurso de nftw2 (ou da verificação de fsck2)
+-----------------------------------------------------------------------------*/
+struct walk_worker;
+
+typedef struct {
+    WALK_DEQUE *deques;     /* Uma fila por thread */
+    int nthreads;           /* Número de threads */
+    void (*visit)(struct walk_worker *worker, WALK_ITEM *item);    /* Visita um diretório (ver __walk_dir) */
+    NFTW2_FN fn;            /* Função chamada para cada entrada */
+    void *arg;              /* Argumento de 'fn' (ou de 'visit') */
+    int pending;            /* Diretórios enfileirados ou em processamento */
+    int queued;             /* Diretórios enfileirados e ainda não retirados */
+    int stop;               /* Valor que interrompeu o percurso (0 se nenhum) */
+    int error;              /* Flag indicando erro de leitura */
+    pthread_mutex_t lock;   /* Trava de 'pending', 'queued', 'stop' e 'error' */
+    pthread_cond_t wake;    /* Sinalizada quando um diretório é enfileirado ou o percurso termina */
+    T2FS *fs;               /* Sistema de arquivos percorrido */
+} WALK_POOL;
+
+/*-----------------------------------------------------------------------------
+Argumento de uma thread de nftw2
+-----------------------------------------------------------------------------*/
+typedef struct walk_worker {
+    WALK_POOL *pool;        /* Percurso */
+    int id;                 /* Índice da fila da thread */
+} WALK_WORKER;
+
+/*-----------------------------------------------------------------------------
+Lista crescente de números (blocos ou inodes) coletados para liberação em lote
+-----------------------------------------------------------------------------*/
+typedef struct {
+    DWORD *items;       /* Números coletados */
+    DWORD count;        /* Quantidade de números na lista */
+    DWORD capacity;     /* Capacidade alocada de 'items' */
+} DWORD_LIST;
+
+/*-----------------------------------------------------------------------------
+Trecho de um bitmap contado por uma thread na reconstrução dos contadores (ver
+__bitmap_count). Os trechos são divididos em setores inteiros do bitmap.
+-----------------------------------------------------------------------------*/
+#define SUMMARY_REBUILD_THREADS 4
+#define SUMMARY_REBUILD_MIN_SECTORS 16  /* Setores mínimos por trecho: bitmaps menores são contados sem criar threads */
+
+typedef struct {
+    T2FS *fs;               /* Sistema de arquivos (a thread o escolhe como corrente) */
+    int handle;             /* Bitmap (BITMAP_INODE ou BITMAP_DADOS) */
+    DWORD firstBit;         /* Primeiro bit do trecho */
+    DWORD endBit;           /* Bit seguinte ao último do trecho */
+    DWORD freeBits;         /* Bits livres do trecho */
+    DWORD freeRuns;         /* Trechos de bits livres contidos no trecho */
+    DWORD firstFree;        /* Primeiro bit livre do trecho ('endBit' se não há) */
+    int lastFree;           /* Flag indicando se o último bit do trecho está livre */
+    int result;             /* OP_SUCCESS ou OP_ERROR */
+} BITMAP_REGION;
+
+/*-----------------------------------------------------------------------------
+Zonas de alocação (ver __zone_load): a área de inodes é dividida em até ZONE_MAX_COUNT
+faixas de setores inteiros e a área de dados em outras tantas faixas proporcionais. Os
+inodes de uma zona guardam seus blocos de dados na faixa correspondente. Num disco com
+grupos de alocação (ver GROUP_ALIGN), as zonas são os próprios grupos.
+-----------------------------------------------------------------------------*/
+#define ZONE_MAX_COUNT 16
+#define ZONE_MIN_INODES 64      /* Inodes mínimos por zona: discos pequenos têm menos zonas */
+
+/*-----------------------------------------------------------------------------
+Verificação de fsck2: o percurso da árvore marca os inodes alcançáveis e cada thread
+coleta, de um trecho da área de inodes, os blocos referenciados pelos inodes marcados
+-----------------------------------------------------------------------------*/
+#define FSCK_READ_SECTORS 256   /* Setores por leitura dos bitmaps e da área de inodes */
+
+typedef struct {
+    BYTE *inodeBitmap;      /* Bitmap de inodes lido do disco */
+    BYTE *reachable;        /* Um byte por inode: 1 se alcançável a partir da raiz */
+    int repair;             /* Flag indicando se os registros inválidos devem ser removidos */
+    DWORD badRecords;       /* Registros com inode livre, fora da área ou já visto */
+    DWORD removedRecords;   /* Registros removidos */
+    pthread_mutex_t lock;   /* Trava de 'reachable' e dos contadores */
+} FSCK_STATE;
+
+typedef struct {
+    T2FS *fs;               /* Sistema de arquivos (a thread o escolhe como corrente) */
+    FSCK_STATE *state;      /* Estado da verificação */
+    DWORD firstSector;      /* Primeiro setor do trecho, relativo ao início da área de inodes */
+    DWORD endSector;        /* Setor seguinte ao último do trecho */
+    DWORD_LIST blocks;      /* Blocos referenciados pelos inodes do trecho (com repetições) */
+    DWORD_LIST fragments;   /* Fragmentos dos inodes do trecho (setor inicial e número de setores) */
+    DWORD badPointers;      /* Ponteiros fora da área de dados */
+    int result;             /* OP_SUCCESS ou OP_ERROR */
+} FSCK_REGION;
+
+/*-----------------------------------------------------------------------------
+Bloco de um arquivo a ser realocado por defrag2, na ordem em que ficará no disco
+-----------------------------------------------------------------------------*/
+#define DEFRAG_DATA 0       /* Bloco de dados */
+#define DEFRAG_SINGLE 1     /* Bloco de indireção simples */
+#define DEFRAG_DOUBLE 2     /* Bloco de indireção dupla */
+#define DEFRAG_LIST 3       /* Bloco de indireção apontado pelo bloco de indireção dupla */
+
+typedef struct {
+    int kind;               /* DEFRAG_DATA, DEFRAG_SINGLE, DEFRAG_DOUBLE ou DEFRAG_LIST */
+    DWORD index;            /* Índice do bloco no arquivo (dados) ou na indireção dupla (DEFRAG_LIST) */
+    DWORD oldBlock;         /* Bloco atual */
+} DEFRAG_MOVE;
+
+/*-----------------------------------------------------------------------------
+Estado de uma desfragmentação (ver defrag2)
+-----------------------------------------------------------------------------*/
+typedef struct {
+    DWORD maxBlocksPerSecond;   /* Limite de blocos copiados por segundo (0 se sem limite) */
+    struct timespec start;      /* Início da desfragmentação */
+    DEFRAG2_STATS *stats;       /* Progresso */
+} DEFRAG_STATE;
+
+/*-----------------------------------------------------------------------------
+Lista crescente de caminhos coletados pelos percursos de defrag2 e layout2
+-----------------------------------------------------------------------------*/
+typedef struct {
+    char **items;       /* Caminhos coletados */
+    DWORD count;        /* Quantidade de caminhos na lista */
+    DWORD capacity;     /* Capacidade alocada de 'items' */
+} PATH_LIST;
+
+/*-----------------------------------------------------------------------------
+Tabela com uma entrada (DWORD) por bloco de dados, dividida em páginas de um bloco.
+As páginas são criadas apenas para os trechos do disco com alguma entrada diferente de
+zero: o diretório guarda o bloco de cada página (0 se a página não existe) e cada página
+é lida na primeira consulta a uma entrada do seu trecho (ver __paged_entry).
+-----------------------------------------------------------------------------*/
+typedef struct {
+    DWORD *dir;             /* Diretório (NULL se o disco não possui a tabela) */
+    BYTE *dirDirty;         /* Setores do diretório alterados e ainda não escritos */
+    DWORD **pages;          /* Páginas já lidas (NULL se ainda não lida ou se não existe) */
+    BYTE **pagesDirty;      /* Setores de cada página alterados e ainda não escritos */
+    int loaded;             /* Flag indicando que o diretório já foi lido (ver __paged_load) */
+} PAGED_TABLE;
+
+/*-----------------------------------------------------------------------------
+Sistema de arquivos montado (ver t2fs_mount): todo o estado de uma imagem
+-----------------------------------------------------------------------------*/
+struct t2fs_fs {
+    T2FS_BACKEND backend;               /* Dispositivo da imagem */
+    int readOnly;                       /* Flag indicando montagem sem alterações */
+    struct t2fs_superbloco *sb;         /* Superbloco do disco */
+    struct t2fs_superbloco_ext *sbe;    /* Extensão do superbloco: contadores de espaço livre (mantidos em memória) */
+
+    /* Tabela de contadores de referência dos blocos de dados. Cada entrada guarda o número de
+       referências além da primeira (um bloco com contador 0 pertence a um único arquivo) e, se o
+       bloco está comprimido, o número de setores que ele ocupa (ver REFCOUNT_ZSECTORS). */
+    PAGED_TABLE refcount;
+
+    /* Tabela de checksums (CRC32C) dos blocos de dados, consultada apenas com SB_FEATURE_CHECKSUM.
+       Uma entrada 0 indica um bloco sem checksum, que não é verificado na leitura. */
+    PAGED_TABLE checksum;
+
+    /* Tabela de impressões digitais dos blocos de dados, consultada apenas com SB_FEATURE_DEDUP.
+       Uma entrada 0 indica um bloco fora do índice de deduplicação. */
+    PAGED_TABLE dedup;
+
+    DWORD tablePageCount;               /* Entradas do diretório de cada tabela (páginas possíveis) */
+
+    /* Índice de deduplicação em memória, montado a partir de 'dedup' na primeira escrita
+       deduplicada (dedupHead é NULL até lá): dedupHead guarda o primeiro bloco de cada balde
+       (0 se vazio) e dedupNext o próximo bloco do mesmo balde. O número de baldes é uma potência de 2. */
+    DWORD *dedupHead;
+    DWORD *dedupNext;
+    DWORD dedupBuckets;
+
+    DWORD dedupLookups;                 /* Blocos procurados no índice desde a montagem (ver statfs2) */
+    DWORD dedupHits;                    /* Blocos encontrados no índice desde a montagem */
+    DWORD dedupFalseMatches;            /* Impressões iguais com conteúdo diferente desde a montagem */
+
+    /* Último bloco de dados comprimido ou com checksum lido por inteiro e o seu conteúdo (já
+       verificado e descomprimido): leituras pequenas e sequenciais não descomprimem nem verificam
+       o mesmo bloco a cada chamada */
+    DWORD dataCacheBlock;
+    BYTE *dataCache;
+
+    /* Zonas de alocação, calculadas na primeira criação de arquivo (zones é NULL até lá) ou, num
+       disco com grupos, lidas na montagem. Cada zona tem GROUP_DESC_WORDS palavras em 'zones'
+       (livres e cursores de busca), mantidas junto com os contadores do superbloco; num disco com
+       grupos, 'zones' é a tabela de descritores do disco. */
+    int oldAlloc;                       /* Flag indicando alocação no primeiro livre do disco, sem localidade */
+    DWORD zoneCount;                    /* Quantidade de zonas */
+    DWORD zoneInodes;                   /* Inodes por zona (múltiplo dos inodes de um setor) */
+    DWORD zoneBlocks;                   /* Blocos de dados por zona */
+    DWORD zoneDataStart;                /* Primeiro bloco da primeira zona (0 num disco com grupos) */
+    DWORD zoneNext;                     /* Zona em que começa a procura pela zona do próximo diretório do raiz */
+    DWORD *zones;
+    BYTE *zonesDirty;                   /* Setores da tabela de descritores alterados e ainda não escritos (NULL sem grupos) */
+
+    struct t2fs_inode *ri;              /* Inode associado ao diretório raiz */
+    HANDLER files[MAX_NUM_HANDLERS];    /* Handlers dos arquivos */
+    HANDLER dirs[MAX_NUM_HANDLERS];     /* Handlers dos diretórios */
+    char *cwd;                          /* Caminho corrente de trabalho */
+    struct t2fs_record *cwdRecord;      /* Record associado ao caminho corrente de trabalho */
+
+    DIR_HINT dirHints[DIR_HINT_CACHE_SIZE];         /* Dicas de registros livres, mapeadas pelo número do inode do diretório */
+    INODE_CACHE_ENTRY inodeCache[INODE_CACHE_SIZE]; /* Cache de inodes */
+    PATH_CACHE_ENTRY pathCache[PATH_CACHE_SIZE];    /* Cache de resolução de caminhos */
+
+    pthread_mutex_t lock;               /* Trava das estruturas internas (caches e acesso ao disco) usada pelas threads de nftw2 */
+};
+
+/*-----------------------------------------------------------------------------
+Sistema de arquivos corrente da thread: escolhido na entrada de cada função da API
+(ver __fs_enter) e usado por todas as funções internas
+-----------------------------------------------------------------------------*/
+__thread T2FS *g_fs = NULL;
 
 /*-----------------------------------------------------------------------------
-Handlers dos arquivos.
+Sistema de arquivos padrão, sobre o disco de apidisk, usado pelas funções da API sem
+o prefixo t2fs_ (montado na primeira chamada)
 -----------------------------------------------------------------------------*/
-HANDLER g_files[MAX_NUM_HANDLERS];
+T2FS *g_fs_default = NULL;
 
 /*-----------------------------------------------------------------------------
-Handlers dos diretórios.
+Função: Lê um setor do dispositivo do sistema de arquivos corrente
+
+Entra:
+    sector -> setor a ser lido
+    buffer -> buffer com o tamanho de um setor
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-HANDLER g_dirs[MAX_NUM_HANDLERS];
+int __disk_read(unsigned int sector, BYTE *buffer)
+{
+    return g_fs->backend.readSector(g_fs->backend.data, sector, buffer) == 0 ? OP_SUCCESS : OP_ERROR;
+}
 
 /*-----------------------------------------------------------------------------
-Caminho corrente de trabalho.
+Função: Lê setores consecutivos do dispositivo do sistema de arquivos corrente, numa
+        única leitura se o dispositivo permite
+
+Entra:
+    sector -> primeiro setor a ser lido
+    count -> número de setores
+    buffer -> buffer com o tamanho de 'count' setores
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-char *g_cwd;
+int __disk_read_range(unsigned int sector, unsigned int count, BYTE *buffer)
+{
+    unsigned int i;
+
+    if( g_fs->backend.readSectors != NULL )
+    {
+        return g_fs->backend.readSectors(g_fs->backend.data, sector, count, buffer) == 0 ? OP_SUCCESS : OP_ERROR;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        if( __disk_read(sector + i, buffer + i * SECTOR_SIZE) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    return OP_SUCCESS;
+}
+
+int __summary_write();
+void __table_alloc(DWORD **table, BYTE **dirty, DWORD numBlocks);
+int __table_read(DWORD **table, BYTE **dirty, DWORD firstBlock, DWORD numBlocks);
+int __refcount_load();
+int __checksum_load();
+int __dedup_load();
+void __paged_flush(PAGED_TABLE *table, DWORD firstBlock, DWORD numBlocks);
 
 /*-----------------------------------------------------------------------------
-Record associado ao caminho corrente de trabalho.
+Função: Escreve um setor no dispositivo do sistema de arquivos corrente (nunca num
+        sistema de arquivos montado sem alterações)
+
+Entra:
+    sector -> setor a ser escrito
+    buffer -> buffer com o tamanho de um setor
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-struct t2fs_record *g_cwd_record;
+int __disk_write(unsigned int sector, BYTE *buffer)
+{
+    if( g_fs->readOnly )
+    {
+        return OP_ERROR;
+    }
+
+    // A primeira escrita após uma montagem limpa invalida as dicas gravadas na desmontagem
+    if( g_fs->sbe != NULL && g_fs->sbe->unmountState == SB_UNMOUNT_CLEAN )
+    {
+        g_fs->sbe->unmountState = 0;
+
+        if( __summary_write() != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    return g_fs->backend.writeSector(g_fs->backend.data, sector, buffer) == 0 ? OP_SUCCESS : OP_ERROR;
+}
 
 void __print_superbloco(char *label, struct t2fs_superbloco *bloco)
 {
@@ -93,7 +443,7 @@ Saída:
 -----------------------------------------------------------------------------*/
 unsigned int __inode_get_sector(DWORD inodeNumber)
 {
-    unsigned int base_sector = (g_sb->superblockSize + g_sb->freeBlocksBitmapSize + g_sb->freeInodeBitmapSize) * g_sb->blockSize;
+    unsigned int base_sector = (g_fs->sb->superblockSize + g_fs->sb->freeBlocksBitmapSize + g_fs->sb->freeInodeBitmapSize) * g_fs->sb->blockSize;
 
     return base_sector + ((inodeNumber * sizeof(struct t2fs_inode)) / SECTOR_SIZE);
 }
@@ -117,60 +467,44 @@ Saída:
 -----------------------------------------------------------------------------*/
 unsigned int __block_get_sector(DWORD blockNumber)
 {
-    return blockNumber * g_sb->blockSize;
+    return blockNumber * g_fs->sb->blockSize;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Encontra o ponteiro assoc. ao inodeNumber informado
-
-Entra:
-    inodeNumber -> número do inode a ser encontrado
+Função: Calcula o número total de inodes do disco
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna o inode
-    Se ocorreu algum erro, retorna NULL.
+    Número de inodes que cabem na área de inodes.
 -----------------------------------------------------------------------------*/
-struct t2fs_inode* __inode_get_by_idx(DWORD inodeNumber)
+DWORD __inode_get_total()
 {
-    BYTE buffer[SECTOR_SIZE];
-    unsigned int idxInode = __inode_get_sector_idx(inodeNumber);
-
-    if( read_sector(__inode_get_sector(inodeNumber), buffer) == OP_SUCCESS )
-    {
-        return buffer_to_inode(buffer, idxInode);
-    }
-
-    return NULL;
+    return (g_fs->sb->inodeAreaSize * g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(struct t2fs_inode);
 }
 
 /*-----------------------------------------------------------------------------
-Função: Cria um novo inode
-
-Entra:
-    inode -> dados a serem salvos
-    inodeNumber -> número do inode
+Função: Escreve a extensão do superbloco no setor 0, preservando o superbloco
 
 Saída:
     Se a operação foi realizada com sucesso, retorna OP_SUCCESS
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __inode_write(struct t2fs_inode *inode, int inodeNumber)
+int __summary_write()
 {
-    BYTE buffer[SECTOR_SIZE], *buffer_inode = NULL;
-    unsigned int sector = __inode_get_sector(inodeNumber);
-    int idxInode = __inode_get_sector_idx(inodeNumber);
+    BYTE buffer[SECTOR_SIZE], *buffer_ext = NULL;
     int i;
 
-    if( read_sector(sector, buffer) == OP_SUCCESS )
+    if( __disk_read(0, buffer) == OP_SUCCESS )
     {
-        buffer_inode = inode_to_buffer(inode);
+        buffer_ext = superblock_ext_to_buffer(g_fs->sbe);
 
-        for(i = 0; i < sizeof(struct t2fs_inode); i++)
+        for( i = 0; i < sizeof(struct t2fs_superbloco_ext); i++ )
         {
-            buffer[idxInode + i] = buffer_inode[i];
+            buffer[SB_EXT_OFFSET + i] = buffer_ext[i];
         }
 
-        if( write_sector(sector, buffer) == OP_SUCCESS )
+        free(buffer_ext);
+
+        if( __disk_write(0, buffer) == OP_SUCCESS )
         {
             return OP_SUCCESS;
         }
@@ -180,284 +514,444 @@ int __inode_write(struct t2fs_inode *inode, int inodeNumber)
 }
 
 /*-----------------------------------------------------------------------------
-Função: Lê a 'idxEntry'-ézima de tamanho 'size' entrada do bloco especificado
+Função: Marca no disco que os contadores não refletem mais os bitmaps.
+        Apenas a primeira alteração de uma operação escreve no disco.
+-----------------------------------------------------------------------------*/
+void __summary_mark_dirty()
+{
+    if( g_fs->sbe->state != SB_STATE_DIRTY )
+    {
+        g_fs->sbe->state = SB_STATE_DIRTY;
+        __summary_write();
+    }
+}
 
-Entra:
-    idxEntry -> índice da entrada no bloco
-    size -> tamanho da entrada
-    blockNumber -> o bloco onde ler a entrada
+/*-----------------------------------------------------------------------------
+Função: Escreve no disco os setores alterados de uma tabela de DWORDs (diretório ou página
+        de uma tabela paginada, ou descritores dos grupos)
 
-Saída:
-    Se a operação foi realizada com sucesso, retorna um buffer com a entrada
-    Se ocorreu algum erro, retorna NULL.
+Entra:
+    table -> tabela em memória (NULL se o disco não possui a tabela)
+    dirty -> setores da tabela alterados e ainda não escritos
+    firstBlock -> primeiro bloco da tabela no disco
+    numBlocks -> número de blocos da tabela no disco
 -----------------------------------------------------------------------------*/
-BYTE* __block_get_entry(DWORD idxEntry, int size, DWORD blockNumber)
+void __table_flush(DWORD *table, BYTE *dirty, DWORD firstBlock, DWORD numBlocks)
 {
-    BYTE buffer[SECTOR_SIZE], *entryBuffer;
-    DWORD idxSector = (idxEntry * size) / SECTOR_SIZE;
-    DWORD idxSectorEntry = (idxEntry * size) % SECTOR_SIZE;
-    int i;
+    DWORD entriesPerSector = SECTOR_SIZE / sizeof(DWORD);
+    DWORD numSectors = numBlocks * g_fs->sb->blockSize;
+    BYTE buffer[SECTOR_SIZE], *buffer_entry;
+    DWORD idxSector, i;
+    int j;
 
-    if( read_sector(__block_get_sector(blockNumber) + idxSector, buffer) == OP_SUCCESS )
+    for( idxSector = 0; table != NULL && idxSector < numSectors; idxSector++ )
     {
-        entryBuffer = (BYTE*)malloc(size);
-
-        for( i = 0; i < size; i++ )
+        if( dirty[idxSector] )
         {
-            entryBuffer[i] = buffer[idxSectorEntry + i];
+            for( i = 0; i < entriesPerSector; i++ )
+            {
+                DWORD idxEntry = idxSector * entriesPerSector + i;
+
+                buffer_entry = dword_to_buffer(idxEntry < g_fs->sb->diskSize ? table[idxEntry] : 0);
+
+                for( j = 0; j < sizeof(DWORD); j++ )
+                {
+                    buffer[i * sizeof(DWORD) + j] = buffer_entry[j];
+                }
+
+                free(buffer_entry);
+            }
+
+            if( __disk_write(__block_get_sector(firstBlock) + idxSector, buffer) == OP_SUCCESS )
+            {
+                dirty[idxSector] = 0;
+            }
         }
+    }
+}
 
-        return entryBuffer;
+/*-----------------------------------------------------------------------------
+Função: Persiste os contadores ao fim de uma operação que alterou os bitmaps
+-----------------------------------------------------------------------------*/
+void __summary_flush()
+{
+    if( g_fs->readOnly )
+    {
+        return;
     }
 
-    return NULL;
+    __paged_flush(&g_fs->refcount, g_fs->sbe->refcountBlock, g_fs->sbe->refcountSize);
+    __paged_flush(&g_fs->checksum, g_fs->sbe->checksumBlock, g_fs->sbe->checksumSize);
+    __paged_flush(&g_fs->dedup, g_fs->sbe->dedupBlock, g_fs->sbe->dedupSize);
+    __table_flush(g_fs->zonesDirty != NULL ? g_fs->zones : NULL, g_fs->zonesDirty, g_fs->sbe->groupTableBlock, g_fs->sbe->groupTableSize);
+
+    if( g_fs->sbe != NULL && g_fs->sbe->state == SB_STATE_DIRTY )
+    {
+        g_fs->sbe->state = SB_STATE_CLEAN;
+        __summary_write();
+    }
 }
 
 /*-----------------------------------------------------------------------------
-Função: Escreve um ponteiro para um bloco num dado bloco de indireção
+Função: Informa o número de bits do bitmap
 
 Entra:
-    idxPtr -> índice do ponteiro no bloco
-    blockNumber -> valor do ponteiro para o bloco
-    indBlockNumber -> bloco onde o ponteiro deve ser escrito
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
-    Se ocorreu algum erro, retorna OP_ERROR.
+    Número de inodes ou de blocos do disco.
 -----------------------------------------------------------------------------*/
-int __block_write_ptr(DWORD idxPtr, DWORD blockNumber, DWORD indBlockNumber)
+DWORD __bitmap_size(int handle)
 {
-    BYTE buffer[SECTOR_SIZE], *buffer_ptr;
-    unsigned int sector = indBlockNumber * g_sb->blockSize + ((idxPtr * sizeof(DWORD)) / SECTOR_SIZE);
-    int idxSectorPtr = (idxPtr % (SECTOR_SIZE/sizeof(DWORD))) * sizeof(DWORD);
-    int i;
+    return handle == BITMAP_INODE ? __inode_get_total() : g_fs->sb->diskSize;
+}
 
-    if( read_sector(sector, buffer) == OP_SUCCESS )
-    {
-        buffer_ptr = dword_to_buffer(blockNumber);
+/*-----------------------------------------------------------------------------
+Função: Calcula o setor do disco que contém o bit do bitmap
 
-        for(i = 0; i < sizeof(DWORD); i++)
-        {
-            buffer[idxSectorPtr + i] = buffer_ptr[i];
-        }
+Entra:
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    bitNumber -> bit
 
-        if( write_sector(sector, buffer) == OP_SUCCESS )
-        {
-            return OP_SUCCESS;
-        }
+Saída:
+    Número do setor.
+-----------------------------------------------------------------------------*/
+unsigned int __bitmap_get_sector(int handle, DWORD bitNumber)
+{
+    DWORD firstBlock = g_fs->sb->superblockSize + (handle == BITMAP_INODE ? g_fs->sb->freeBlocksBitmapSize : 0);
+
+    return __block_get_sector(firstBlock) + bitNumber / (SECTOR_SIZE * 8);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê um bit do bitmap diretamente no dispositivo do sistema de arquivos
+
+Entra:
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    bitNumber -> bit a ser lido
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o valor do bit (0 ou 1)
+    Se ocorreu algum erro (ou o bit está fora do bitmap), retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __bitmap_get(int handle, int bitNumber)
+{
+    BYTE buffer[SECTOR_SIZE];
+
+    if( bitNumber < 0 || bitNumber >= __bitmap_size(handle) ||
+        __disk_read(__bitmap_get_sector(handle, bitNumber), buffer) != OP_SUCCESS )
+    {
+        return OP_ERROR;
     }
 
-    return OP_ERROR;
+    return (buffer[(bitNumber % (SECTOR_SIZE * 8)) / 8] >> (bitNumber % 8)) & 1;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Encontra o 'idxBlock'ézimo bloco no inode
+Função: Escreve um bit do bitmap diretamente no dispositivo, sem atualizar os
+        contadores de livres (ver __bitmap_set)
 
 Entra:
-    idxBlock -> índice do bloco relativo ao inode
-    inode -> inode onde está o bloco
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    bitNumber -> bit a ser escrito
+    bitValue -> valor do bit
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna o número do ponteiro
-    Se ocorreu algum erro, retorna INVALID_PTR.
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-DWORD __block_get_by_idx(DWORD idxBlock, struct t2fs_inode *inode)
+int __bitmap_put(int handle, int bitNumber, int bitValue)
 {
-    DWORD dataBlockNumber = 0;
+    BYTE buffer[SECTOR_SIZE];
+    unsigned int sector;
+    DWORD *hint;
+    BYTE mask = 1 << (bitNumber % 8);
 
-    if( idxBlock < inode->blocksFileSize )
+    if( bitNumber < 0 || bitNumber >= __bitmap_size(handle) )
     {
-        if( idxBlock == 0 )
-        {
-            dataBlockNumber = inode->dataPtr[0];
-        }
-        else if( idxBlock == 1 )
-        {
-            dataBlockNumber = inode->dataPtr[1];
-        }
-        else
-        {
-            int blockNumberPerBlock = (g_sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
-            int idxBase = idxBlock - 2;
+        return OP_ERROR;
+    }
 
-            if( idxBase < blockNumberPerBlock  )
-            {
-                dataBlockNumber = buffer_to_dword(__block_get_entry(idxBase, sizeof(DWORD), inode->singleIndPtr), 0);
-            }
-            else
-            {
-                idxBase = idxBlock - blockNumberPerBlock - 2;
-                int idxIndBlockList = idxBase / blockNumberPerBlock;
-                int idxIndBlock = idxBase % blockNumberPerBlock;
+    sector = __bitmap_get_sector(handle, bitNumber);
 
-                DWORD ptrBlockNumber = buffer_to_dword(__block_get_entry(idxIndBlockList, sizeof(DWORD), inode->doubleIndPtr), 0);
+    if( __disk_read(sector, buffer) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
 
-                dataBlockNumber = buffer_to_dword(__block_get_entry(idxIndBlock, sizeof(DWORD), ptrBlockNumber), 0);
-            }
-        }
+    if( bitValue )
+    {
+        buffer[(bitNumber % (SECTOR_SIZE * 8)) / 8] |= mask;
+    }
+    else
+    {
+        buffer[(bitNumber % (SECTOR_SIZE * 8)) / 8] &= ~mask;
+    }
 
-        return dataBlockNumber;
+    if( __disk_write(sector, buffer) != OP_SUCCESS )
+    {
+        return OP_ERROR;
     }
 
-    return INVALID_PTR;
+    // Um bit liberado antes do início da busca passa a ser o início da busca
+    hint = handle == BITMAP_INODE ? &g_fs->sbe->inodeHint : &g_fs->sbe->blockHint;
+
+    if( !bitValue && bitNumber < *hint )
+    {
+        *hint = bitNumber;
+    }
+
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Inicializa o bloco com dado valor
+Função: Procura no bitmap o primeiro bit com o valor indicado. A procura por bits
+        livres começa no cursor do bitmap (nenhum bit antes dele está livre), que
+        passa a apontar para o bit encontrado.
 
 Entra:
-    blockNumber -> número do bloco
-    value -> valor a ser escrito
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    bitValue -> valor procurado
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se encontrou, retorna o número do bit
+    Se não encontrou, retorna 0 (o bit 0 dos dois bitmaps está sempre ocupado)
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __block_init(DWORD blockNumber, char value)
+int __bitmap_search(int handle, int bitValue)
 {
-    int i, j;
     BYTE buffer[SECTOR_SIZE];
-
-    for( i = 0; i < g_sb->blockSize; i++ )
+    DWORD bitsPerSector = SECTOR_SIZE * 8;
+    DWORD numBits = __bitmap_size(handle);
+    BYTE skip = bitValue ? 0x00 : 0xFF;
+    DWORD *hint = handle == BITMAP_INODE ? &g_fs->sbe->inodeHint : &g_fs->sbe->blockHint;
+    DWORD start = !bitValue && *hint < numBits ? *hint : 0;
+    DWORD bit;
+
+    for( bit = start; bit < numBits; bit++ )
     {
-        if( read_sector(__block_get_sector(blockNumber) + i, buffer) != OP_SUCCESS )
+        if( (bit == start || bit % bitsPerSector == 0) && __disk_read(__bitmap_get_sector(handle, bit), buffer) != OP_SUCCESS )
         {
             return OP_ERROR;
         }
-        else
+
+        // Bytes sem nenhum bit com o valor procurado são pulados inteiros
+        if( bit % 8 == 0 && buffer[(bit % bitsPerSector) / 8] == skip )
         {
-            for( j = 0; j < SECTOR_SIZE; j++ )
-            {
-                buffer[j] = (BYTE)value;
-            }
+            bit += 7;
+            continue;
+        }
 
-            if( write_sector(__block_get_sector(blockNumber) + i, buffer) != OP_SUCCESS )
+        if( ((buffer[(bit % bitsPerSector) / 8] >> (bit % 8)) & 1) == (bitValue != 0) )
+        {
+            if( !bitValue )
             {
-                return OP_ERROR;
+                *hint = bit;
             }
+
+            return bit;
         }
     }
 
-    return OP_SUCCESS;
+    return 0;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Navega sequencialmente pelos registros até encontrar o registro apontado
-        por 'pointer', retornando o bloco onde este se encontra
+Função: Procura, a partir da dica de alocação, o primeiro trecho de blocos livres
+        consecutivos com o tamanho pedido
 
 Entra:
-    pointer -> 'pointer'-ézimo item
-    size -> tamanho do 'pointer'-ézimo item
-    inode -> inode que contém os ponteiros para os blocos de dados
+    count -> número de blocos do trecho
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna o número do bloco
-    Se ocorreu algum erro, retorna INVALID_PTR.
+    Se encontrou, retorna o primeiro bloco do trecho
+    Se não encontrou, retorna 0
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-DWORD __block_navigate(DWORD pointer, int size, struct t2fs_inode *inode)
+int __bitmap_search_run(DWORD count)
 {
-    int entryPerBlock = (g_sb->blockSize * SECTOR_SIZE) / size;
-    int entryBlock = pointer / entryPerBlock;
+    BYTE buffer[SECTOR_SIZE];
+    DWORD bitsPerSector = SECTOR_SIZE * 8;
+    DWORD numBits = __bitmap_size(BITMAP_DADOS);
+    DWORD start = g_fs->sbe->blockHint < numBits ? g_fs->sbe->blockHint : 0;
+    DWORD bit, run = 0;
 
-    return __block_get_by_idx(entryBlock, inode);
+    for( bit = start; bit < numBits && count > 0; bit++ )
+    {
+        if( (bit == start || bit % bitsPerSector == 0) && __disk_read(__bitmap_get_sector(BITMAP_DADOS, bit), buffer) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        run = ((buffer[(bit % bitsPerSector) / 8] >> (bit % 8)) & 1) ? 0 : run + 1;
+
+        if( run == count )
+        {
+            return bit - count + 1;
+        }
+    }
+
+    return 0;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Navega sequencialmente pelos registros até encontrar o registro apontado
-        por 'pointer', retornando o bloco onde este se encontra
+Função: Procura o primeiro bit livre de um trecho do bitmap, sem alterar o cursor
 
 Entra:
-    pointer -> 'pointer'-ézimo item
-    buffer -> buffer a ser escrito
-    size -> tamanho do buffer a ser escrito
-    inode -> inode que contém as informações de onde escrever
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    start -> primeiro bit do trecho
+    end -> bit seguinte ao último do trecho
+    wholeByte -> se diferente de zero, procura o primeiro byte com todos os bits livres
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se encontrou, retorna o número do bit (o primeiro bit do byte, se wholeByte)
+    Se não encontrou, retorna 0
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __inode_write_bytes(DWORD pointer, char *buffer, int size, struct t2fs_inode *inode)
+int __bitmap_search_range(int handle, DWORD start, DWORD end, int wholeByte)
 {
-    BYTE readBuffer[SECTOR_SIZE];
-    DWORD idxBloco = pointer / (g_sb->blockSize * SECTOR_SIZE);
-    DWORD idxSector = ((pointer * sizeof(BYTE)) / SECTOR_SIZE) % g_sb->blockSize;
-    DWORD idxSectorStart = (pointer * sizeof(BYTE)) % SECTOR_SIZE;
-    int idxBuffer = 0;
-    int i, j, k;
+    BYTE buffer[SECTOR_SIZE];
+    DWORD bitsPerSector = SECTOR_SIZE * 8;
+    DWORD bit;
+
+    if( wholeByte )
+    {
+        start = (start + 7) / 8 * 8;
+        end = end / 8 * 8;
+    }
 
-    for( k = 0; k <= size / (g_sb->blockSize * SECTOR_SIZE); k++ )
+    for( bit = start; bit < end; bit++ )
     {
-        DWORD blockNumber = __block_get_by_idx(idxBloco + k, inode);
-        for( i = idxSector; i < g_sb->blockSize && idxBuffer < size; i++ )
+        if( (bit == start || bit % bitsPerSector == 0) && __disk_read(__bitmap_get_sector(handle, bit), buffer) != OP_SUCCESS )
         {
-            if( read_sector(__block_get_sector(blockNumber) + i, readBuffer) == OP_SUCCESS )
-            {
-                for( j = idxSectorStart; j < SECTOR_SIZE && idxBuffer < size; j++ )
-                {
-                    readBuffer[j] = (BYTE) buffer[idxBuffer];
-                    idxBuffer++;
-                }
+            return OP_ERROR;
+        }
 
-                if( write_sector(__block_get_sector(blockNumber) + i, readBuffer) == OP_SUCCESS )
-                {
-                    idxSectorStart = 0;
-                }
-                else
-                {
-                    return OP_ERROR;
-                }
-            }
-            else
+        if( bit % 8 == 0 && buffer[(bit % bitsPerSector) / 8] == (wholeByte ? 0x00 : 0xFF) )
+        {
+            if( wholeByte )
             {
-                return OP_ERROR;
+                return bit;
             }
+
+            bit += 7;
+            continue;
+        }
+
+        if( wholeByte )
+        {
+            bit += 7;
+        }
+        else if( ((buffer[(bit % bitsPerSector) / 8] >> (bit % 8)) & 1) == 0 )
+        {
+            return bit;
         }
     }
 
-    return OP_SUCCESS;
+    return 0;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Lê sequencialmente pelos registros até encontrar o registro apontado
-        por 'pointer', retornando o bloco onde este se encontra
+Função: Verifica se o bit está livre, tratando bits fora do bitmap como ocupados
 
 Entra:
-    pointer -> 'pointer'-ézimo item
-    buffer -> buffer a ser escrito
-    size -> tamanho do buffer a ser escrito
-    inode -> inode que contém as informações de onde escrever
+    handle -> bitmap
+    bitNumber -> bit a ser verificado
+    numBits -> número de bits do bitmap
+
+Saída:
+    Se livre, retorna 1
+    Se ocupado (ou fora do bitmap), 0.
+-----------------------------------------------------------------------------*/
+int __bitmap_is_free(int handle, int bitNumber, DWORD numBits)
+{
+    if( bitNumber < 0 || bitNumber >= numBits )
+    {
+        return 0;
+    }
+
+    return __bitmap_get(handle, bitNumber) == 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa as palavras do descritor de uma zona (ver GROUP_DESC_WORDS)
+
+Entra:
+    zone -> número da zona
+
+Saída:
+    Ponteiro para a primeira palavra do descritor.
+-----------------------------------------------------------------------------*/
+DWORD* __zone_desc(DWORD zone)
+{
+    return &g_fs->zones[zone * GROUP_DESC_WORDS];
+}
+
+/*-----------------------------------------------------------------------------
+Função: Marca como alterado o setor da tabela de descritores que guarda a zona (apenas
+        num disco com grupos, em que a tabela é gravada no disco)
+
+Entra:
+    zone -> número da zona
+-----------------------------------------------------------------------------*/
+void __zone_dirty(DWORD zone)
+{
+    if( g_fs->zonesDirty != NULL )
+    {
+        g_fs->zonesDirty[(zone * GROUP_DESC_WORDS * sizeof(DWORD)) / SECTOR_SIZE] = 1;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Conta, por zona, os bits livres de um trecho do bitmap e coloca o cursor de
+        cada zona no seu primeiro bit livre (no fim da zona, se não há)
+
+Entra:
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    start -> primeiro bit do trecho (o primeiro bit da zona 0)
+    end -> bit seguinte ao último do trecho
+    span -> bits por zona
+    freeWord -> palavra do descritor com os livres (GROUP_FREE_BLOCKS ou GROUP_FREE_INODES)
+    hintWord -> palavra do descritor com o cursor (GROUP_BLOCK_HINT ou GROUP_INODE_HINT)
 
 Saída:
     Se a operação foi realizada com sucesso, retorna OP_SUCCESS
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __inode_read_bytes(DWORD pointer, char *buffer, int size, struct t2fs_inode *inode)
+int __zone_scan(int handle, DWORD start, DWORD end, DWORD span, int freeWord, int hintWord)
 {
-    BYTE readBuffer[SECTOR_SIZE];
-    DWORD idxBloco = pointer / (g_sb->blockSize * SECTOR_SIZE);
-    DWORD idxSector = ((pointer * sizeof(BYTE)) / SECTOR_SIZE) % g_sb->blockSize;
-    DWORD idxSectorStart = (pointer * sizeof(BYTE)) % SECTOR_SIZE;
-    int idxBuffer = 0;
-    int i, j, k;
+    BYTE buffer[SECTOR_SIZE];
+    DWORD bitsPerSector = SECTOR_SIZE * 8;
+    DWORD bit, *desc;
+
+    for( bit = start; bit < end; bit += span )
+    {
+        desc = __zone_desc((bit - start) / span);
+        desc[freeWord] = 0;
+        desc[hintWord] = end - bit > span ? bit + span : end;
+    }
 
-    for( k = 0; k <= size / (g_sb->blockSize * SECTOR_SIZE); k++ )
+    for( bit = start; bit < end; bit++ )
     {
-        DWORD blockNumber = __block_get_by_idx(idxBloco + k, inode);
-        for( i = idxSector; i < g_sb->blockSize && idxBuffer < size; i++ )
+        if( (bit == start || bit % bitsPerSector == 0) && __disk_read(__bitmap_get_sector(handle, bit), buffer) != OP_SUCCESS )
         {
-            if( read_sector(__block_get_sector(blockNumber) + i, readBuffer) == OP_SUCCESS )
-            {
-                for( j = idxSectorStart; j < SECTOR_SIZE && idxBuffer < size; j++ )
-                {
-                    buffer[idxBuffer] = (char)readBuffer[j];
-                    idxBuffer++;
-                }
+            return OP_ERROR;
+        }
 
-                idxSectorStart = 0;
-            }
-            else
+        // Bytes sem nenhum bit livre são pulados inteiros
+        if( bit % 8 == 0 && buffer[(bit % bitsPerSector) / 8] == 0xFF )
+        {
+            bit += 7;
+            continue;
+        }
+
+        if( ((buffer[(bit % bitsPerSector) / 8] >> (bit % 8)) & 1) == 0 )
+        {
+            desc = __zone_desc((bit - start) / span);
+
+            if( desc[freeWord]++ == 0 )
             {
-                return OP_ERROR;
+                desc[hintWord] = bit;
             }
         }
     }
@@ -466,623 +960,766 @@ int __inode_read_bytes(DWORD pointer, char *buffer, int size, struct t2fs_inode
 }
 
 /*-----------------------------------------------------------------------------
-Função: Aloca um novo bloco de dados para o dado inode
+Função: Descarta os descritores das zonas (recalculados ou relidos no próximo uso)
+-----------------------------------------------------------------------------*/
+void __zone_forget()
+{
+    free(g_fs->zones);
+    free(g_fs->zonesDirty);
+    g_fs->zones = NULL;
+    g_fs->zonesDirty = NULL;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula a geometria das zonas de um disco sem grupos: faixas de setores inteiros
+        da área de inodes e faixas proporcionais da área de dados
+-----------------------------------------------------------------------------*/
+void __zone_geometry()
+{
+    DWORD totalInodes = __inode_get_total();
+    DWORD inodesPerSector = SECTOR_SIZE / sizeof(struct t2fs_inode);
+    DWORD dataBlocks;
+
+    g_fs->zoneDataStart = g_fs->sb->superblockSize + g_fs->sb->freeBlocksBitmapSize + g_fs->sb->freeInodeBitmapSize + g_fs->sb->inodeAreaSize;
+    dataBlocks = g_fs->sb->diskSize > g_fs->zoneDataStart ? g_fs->sb->diskSize - g_fs->zoneDataStart : 0;
+
+    g_fs->zoneCount = totalInodes / ZONE_MIN_INODES;
+    g_fs->zoneCount = g_fs->zoneCount > ZONE_MAX_COUNT ? ZONE_MAX_COUNT : g_fs->zoneCount;
+    g_fs->zoneCount = g_fs->zoneCount < 1 ? 1 : g_fs->zoneCount;
+
+    // As zonas ocupam setores inteiros da área de inodes; a última pode ser menor
+    g_fs->zoneInodes = (totalInodes + g_fs->zoneCount - 1) / g_fs->zoneCount;
+    g_fs->zoneInodes = (g_fs->zoneInodes + inodesPerSector - 1) / inodesPerSector * inodesPerSector;
+    g_fs->zoneCount = (totalInodes + g_fs->zoneInodes - 1) / g_fs->zoneInodes;
+    g_fs->zoneBlocks = (dataBlocks + g_fs->zoneCount - 1) / g_fs->zoneCount;
+    g_fs->zoneBlocks = g_fs->zoneBlocks < 1 ? 1 : g_fs->zoneBlocks;
+    g_fs->zoneNext = 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula as zonas de alocação do disco e conta os inodes e blocos livres de
+        cada uma (apenas na primeira chamada após a montagem ou a reconstrução dos
+        contadores). Num disco com grupos, as zonas são os grupos e os descritores são
+        lidos da tabela do disco, sem percorrer os bitmaps, a não ser que a recontagem
+        seja pedida; a tabela recontada é gravada inteira no próximo __summary_flush.
+        Num disco sem grupos desmontado de forma limpa, os contadores gravados na
+        desmontagem já foram lidos na montagem (ver __zone_counts_read).
 
 Entra:
-    inode -> inode no qual deve ser alocado o bloco
-    inodeNumber -> índice do inode
+    recount -> se diferente de zero, recalcula os descritores dos grupos a partir dos bitmaps
 
 Saída:
     Se a operação foi realizada com sucesso, retorna OP_SUCCESS
-    Se ocorreu algum erro, retorna OP_ERROR.
+    Se ocorreu algum erro (ou a geometria dos grupos é inválida), retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __block_alocate(struct t2fs_inode *inode, DWORD inodeNumber)
+int __zone_load(int recount)
 {
-    int idxBlockBase = inode->blocksFileSize;
-    int blockNumberPerBlock = (g_sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD totalInodes = __inode_get_total();
+    DWORD tableSectors;
 
-    DWORD dataBlockNumber = searchBitmap2(BITMAP_DADOS, 0);
+    if( g_fs->zones != NULL )
+    {
+        return OP_SUCCESS;
+    }
 
-    if( dataBlockNumber > 0 )
+    if( g_fs->sbe->groupBlocks != 0 )
     {
-        if( idxBlockBase == 0 )
+        g_fs->zoneDataStart = 0;
+        g_fs->zoneBlocks = g_fs->sbe->groupBlocks;
+        g_fs->zoneInodes = g_fs->sbe->groupInodes;
+        g_fs->zoneCount = (g_fs->sb->diskSize + g_fs->zoneBlocks - 1) / g_fs->zoneBlocks;
+        g_fs->zoneNext = 0;
+        tableSectors = g_fs->sbe->groupTableSize * g_fs->sb->blockSize;
+
+        // Cada grupo precisa de setores próprios nos bitmaps e de um descritor na tabela
+        if( g_fs->zoneBlocks % GROUP_ALIGN != 0 || g_fs->zoneInodes == 0 || g_fs->zoneInodes % GROUP_ALIGN != 0 ||
+            (unsigned long long)g_fs->zoneInodes * g_fs->zoneCount != totalInodes ||
+            (unsigned long long)tableSectors * SECTOR_SIZE < (unsigned long long)g_fs->zoneCount * GROUP_DESC_WORDS * sizeof(DWORD) ||
+            g_fs->sbe->groupTableBlock + g_fs->sbe->groupTableSize > g_fs->sb->diskSize )
         {
-            inode->dataPtr[0] = dataBlockNumber;
-
-            setBitmap2(BITMAP_DADOS, dataBlockNumber, 1);
-
-            __block_init(dataBlockNumber, 0);
+            return OP_ERROR;
         }
-        else if( idxBlockBase == 1 )
-        {
-            inode->dataPtr[1] = dataBlockNumber;
 
-            setBitmap2(BITMAP_DADOS, dataBlockNumber, 1);
-
-            __block_init(dataBlockNumber, 0);
-        }
-        else
+        if( !recount )
         {
-            int idxBase = idxBlockBase - 2;
-
-            if( idxBase < blockNumberPerBlock )
+            if( __table_read(&g_fs->zones, &g_fs->zonesDirty, g_fs->sbe->groupTableBlock, g_fs->sbe->groupTableSize) == OP_SUCCESS )
             {
-                if( inode->singleIndPtr == INVALID_PTR )
-                {
-                    int indBlockNumber = dataBlockNumber;
-
-                    setBitmap2(BITMAP_DADOS, indBlockNumber, 1);
+                return OP_SUCCESS;
+            }
 
-                    dataBlockNumber = searchBitmap2(BITMAP_DADOS, 0);
+            __zone_forget();
 
-                    if( dataBlockNumber <= 0 )
-                    {
-                        setBitmap2(BITMAP_DADOS, indBlockNumber, 0);
+            return OP_ERROR;
+        }
 
-                        return OP_ERROR;
-                    }
-                    else
-                    {
-                        inode->singleIndPtr = indBlockNumber;
-                    }
-                }
+        __table_alloc(&g_fs->zones, &g_fs->zonesDirty, g_fs->sbe->groupTableSize);
+        memset(g_fs->zonesDirty, 1, tableSectors);
+    }
+    else
+    {
+        __zone_geometry();
 
-                if( __block_write_ptr(idxBase, dataBlockNumber, inode->singleIndPtr) == OP_SUCCESS )
-                {
-                    setBitmap2(BITMAP_DADOS, dataBlockNumber, 1);
-                    __block_init(dataBlockNumber, 0);
-                }
-            }
-            else
-            {
-                idxBase = idxBlockBase - blockNumberPerBlock - 2;
-                int idxIndBlockList = idxBase / blockNumberPerBlock;
-                int idxBlock = idxBase % blockNumberPerBlock;
+        g_fs->zones = (DWORD*)calloc(g_fs->zoneCount * GROUP_DESC_WORDS, sizeof(DWORD));
+    }
 
-                if( inode->doubleIndPtr == INVALID_PTR )
-                {
-                    int doubleIndBlockNumber = dataBlockNumber;
+    if( __zone_scan(BITMAP_INODE, 0, totalInodes, g_fs->zoneInodes, GROUP_FREE_INODES, GROUP_INODE_HINT) != OP_SUCCESS ||
+        __zone_scan(BITMAP_DADOS, g_fs->zoneDataStart, g_fs->sb->diskSize, g_fs->zoneBlocks, GROUP_FREE_BLOCKS, GROUP_BLOCK_HINT) != OP_SUCCESS )
+    {
+        __zone_forget();
 
-                    setBitmap2(BITMAP_DADOS, doubleIndBlockNumber, 1);
+        return OP_ERROR;
+    }
 
-                    dataBlockNumber = searchBitmap2(BITMAP_DADOS, 0);
+    return OP_SUCCESS;
+}
 
-                    if( dataBlockNumber <= 0 )
-                    {
-                        setBitmap2(BITMAP_DADOS, doubleIndBlockNumber, 0);
+/*-----------------------------------------------------------------------------
+Função: Atualiza o contador de livres da zona de um bit que mudou de valor. Um bit
+        liberado antes do cursor da zona passa a ser o cursor.
 
-                        return OP_ERROR;
-                    }
-                    else
-                    {
-                        inode->doubleIndPtr = doubleIndBlockNumber;
+Entra:
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    bitNumber -> bit alterado
+    delta -> variação dos livres (1 se o bit foi liberado, -1 se foi ocupado)
+-----------------------------------------------------------------------------*/
+void __zone_count(int handle, DWORD bitNumber, int delta)
+{
+    DWORD zone, *desc;
 
-                        int i;
+    if( g_fs->zones == NULL || (handle == BITMAP_DADOS && bitNumber < g_fs->zoneDataStart) )
+    {
+        return;
+    }
 
-                        for( i = 0; i < blockNumberPerBlock; i++ )
-                        {
-                            __block_write_ptr(i, INVALID_PTR, inode->doubleIndPtr);
-                        }
-                    }
-                }
+    zone = handle == BITMAP_INODE ? bitNumber / g_fs->zoneInodes : (bitNumber - g_fs->zoneDataStart) / g_fs->zoneBlocks;
 
-                DWORD ptrBlockNumber = buffer_to_dword(__block_get_entry(idxIndBlockList, sizeof(DWORD), inode->doubleIndPtr), 0);
+    if( zone >= g_fs->zoneCount )
+    {
+        return;
+    }
 
-                if( ptrBlockNumber == INVALID_PTR )
-                {
-                    int indBlockNumber = dataBlockNumber;
+    desc = __zone_desc(zone);
+    desc[handle == BITMAP_INODE ? GROUP_FREE_INODES : GROUP_FREE_BLOCKS] += delta;
 
-                    setBitmap2(BITMAP_DADOS, indBlockNumber, 1);
+    if( delta > 0 && bitNumber < desc[handle == BITMAP_INODE ? GROUP_INODE_HINT : GROUP_BLOCK_HINT] )
+    {
+        desc[handle == BITMAP_INODE ? GROUP_INODE_HINT : GROUP_BLOCK_HINT] = bitNumber;
+    }
 
-                    dataBlockNumber = searchBitmap2(BITMAP_DADOS, 0);
+    __zone_dirty(zone);
+}
 
-                    if( dataBlockNumber <= 0 )
-                    {
-                        setBitmap2(BITMAP_DADOS, indBlockNumber, 0);
+/*-----------------------------------------------------------------------------
+Função: Escolhe a zona de um novo diretório, espalhando os diretórios como o alocador
+        Orlov do ext2: os filhos do raiz vão, em rodízio, para zonas com pelo menos a
+        média de inodes e blocos livres; os demais ficam na zona do pai enquanto ela
+        tem ao menos um quarto da média livre.
 
-                        return OP_ERROR;
-                    }
-                    else
-                    {
-                        ptrBlockNumber = indBlockNumber;
-                        __block_write_ptr(idxIndBlockList, ptrBlockNumber, inode->doubleIndPtr);
-                    }
-                }
+Entra:
+    parentInodeNumber -> inode do diretório pai
 
-                if( __block_write_ptr(idxBlock, dataBlockNumber, ptrBlockNumber) == OP_SUCCESS )
-                {
-                    setBitmap2(BITMAP_DADOS, dataBlockNumber, 1);
-                    __block_init(dataBlockNumber, 0);
-                }
-            }
-        }
+Saída:
+    Número da zona.
+-----------------------------------------------------------------------------*/
+DWORD __zone_for_dir(DWORD parentInodeNumber)
+{
+    DWORD avgInodes = g_fs->sbe->freeInodes / g_fs->zoneCount;
+    DWORD avgBlocks = g_fs->sbe->freeBlocks / g_fs->zoneCount;
+    DWORD parentZone = parentInodeNumber / g_fs->zoneInodes;
+    DWORD *parent = __zone_desc(parentZone);
+    DWORD i, zone, best = parentZone, *desc;
+
+    if( parentInodeNumber != 0 && parent[GROUP_FREE_INODES] > 0 &&
+        parent[GROUP_FREE_INODES] >= avgInodes / 4 && parent[GROUP_FREE_BLOCKS] >= avgBlocks / 4 )
+    {
+        return parentZone;
+    }
 
-        inode->blocksFileSize += 1;
+    for( i = 0; i < g_fs->zoneCount; i++ )
+    {
+        zone = (g_fs->zoneNext + i) % g_fs->zoneCount;
+        desc = __zone_desc(zone);
 
-        if( __inode_write(inode, inodeNumber) == OP_SUCCESS )
+        if( desc[GROUP_FREE_INODES] > 0 && desc[GROUP_FREE_INODES] >= avgInodes && desc[GROUP_FREE_BLOCKS] >= avgBlocks )
         {
-            return OP_SUCCESS;
+            g_fs->zoneNext = (zone + 1) % g_fs->zoneCount;
+
+            return zone;
         }
-        else
+
+        // Sem zona acima da média: a que tem mais inodes livres
+        if( desc[GROUP_FREE_INODES] > __zone_desc(best)[GROUP_FREE_INODES] )
         {
-            setBitmap2(BITMAP_DADOS, dataBlockNumber, 0);
+            best = zone;
         }
     }
 
-    return OP_ERROR;
+    return best;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Remove o bloco do dado inode
+Função: Procura um bit livre zona a zona, começando pela zona do bit desejado. Nela, a
+        procura começa no bit desejado e volta ao cursor da zona; nas seguintes, começa
+        no cursor, que passa a apontar para o bit encontrado. Zonas sem livres são
+        puladas pelos contadores, sem leitura do bitmap.
 
 Entra:
-    inode -> inode de onde remover o bloco
-    inodeNumber -> número do inode
-    blockNumber -> número do bloco
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    goal -> bit desejado (0 ou fora das zonas: a procura começa pela zona do cursor do bitmap)
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se encontrou, retorna o número do bit
+    Se não encontrou, retorna 0
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __inode_remove_block(struct t2fs_inode *inode, DWORD inodeNumber, DWORD blockNumber)
+int __zone_search(int handle, DWORD goal)
 {
-    __block_init(blockNumber, 0);
-    setBitmap2(BITMAP_DADOS, blockNumber, 0);
-
-    int newBlocksSize = inode->blocksFileSize - 1;
-
-    if( newBlocksSize == 0 )
-    {
-        inode->dataPtr[0] = INVALID_PTR;
-    }
-    else if( newBlocksSize == 1 )
-    {
-        inode->dataPtr[1] = INVALID_PTR;
-    }
-    else if( newBlocksSize == 2 )
-    {
-        setBitmap2(BITMAP_DADOS, inode->singleIndPtr, 0);
-        inode->singleIndPtr = INVALID_PTR;
-    }
-    else if( newBlocksSize == 258 )
+    DWORD numBits = __bitmap_size(handle);
+    DWORD base = handle == BITMAP_INODE ? 0 : g_fs->zoneDataStart;
+    DWORD span = handle == BITMAP_INODE ? g_fs->zoneInodes : g_fs->zoneBlocks;
+    DWORD hint = handle == BITMAP_INODE ? g_fs->sbe->inodeHint : g_fs->sbe->blockHint;
+    DWORD freeBits = handle == BITMAP_INODE ? g_fs->sbe->freeInodes : g_fs->sbe->freeBlocks;
+    int freeWord = handle == BITMAP_INODE ? GROUP_FREE_INODES : GROUP_FREE_BLOCKS;
+    int hintWord = handle == BITMAP_INODE ? GROUP_INODE_HINT : GROUP_BLOCK_HINT;
+    DWORD i, zone, start, end, zoneHint, *desc;
+    int bit = 0;
+
+    if( goal == 0 || goal < base || goal >= numBits )
     {
-        setBitmap2(BITMAP_DADOS, inode->doubleIndPtr, 0);
-        inode->doubleIndPtr = INVALID_PTR;
+        goal = hint >= base && hint < numBits ? hint : base;
     }
-    else if( newBlocksSize > 258 )
+
+    for( i = 0; i < g_fs->zoneCount && bit == 0; i++ )
     {
-        int blockNumberPerBlock = (g_sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
-        int idxIndBlockList = inode->blocksFileSize / blockNumberPerBlock;
-        setBitmap2(BITMAP_DADOS, buffer_to_dword(__block_get_entry(idxIndBlockList, sizeof(DWORD), inode->doubleIndPtr), 0), 0);
-        __block_write_ptr(idxIndBlockList, INVALID_PTR, inode->doubleIndPtr);
-    }
+        zone = ((goal - base) / span + i) % g_fs->zoneCount;
+        desc = __zone_desc(zone);
+        start = base + zone * span;
+        end = numBits - start > span ? start + span : numBits;
+        zoneHint = desc[hintWord] > start ? desc[hintWord] : start;
+
+        if( desc[freeWord] == 0 || start >= numBits )
+        {
+            continue;
+        }
 
-    inode->blocksFileSize = newBlocksSize;
-    inode->bytesFileSize = (inode->blocksFileSize * SECTOR_SIZE * g_sb->blockSize) < inode->bytesFileSize ? (inode->blocksFileSize * SECTOR_SIZE * g_sb->blockSize) : inode->bytesFileSize;
+        if( i == 0 && goal > zoneHint && goal < end )
+        {
+            bit = __bitmap_search_range(handle, goal, end, 0);
+            bit = bit != 0 ? bit : __bitmap_search_range(handle, zoneHint, goal, 0);
+        }
+        else if( (bit = __bitmap_search_range(handle, zoneHint, end, 0)) >= 0 )
+        {
+            desc[hintWord] = bit != 0 ? bit : end;
+            __zone_dirty(zone);
+        }
+    }
 
-    if( __inode_write(inode, inodeNumber) == OP_SUCCESS )
+    // Contadores das zonas divergentes dos bitmaps: procura no bitmap inteiro
+    if( bit == 0 && freeBits > 0 )
     {
-        return OP_SUCCESS;
+        bit = __bitmap_search(handle, 0);
     }
 
-    return OP_ERROR;
+    return bit;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Desaloca um novo bloco de dados para o dado inode
+Função: Procura um bit livre a partir do bit desejado. Com as zonas calculadas, a procura
+        é feita zona a zona (ver __zone_search); sem elas (ou com a alocação no primeiro
+        livre), volta ao cursor do bitmap se não há nenhum livre depois do bit desejado.
+        O cursor do bitmap só é alterado pela procura sem bit desejado (ver __bitmap_search).
 
 Entra:
-    inode -> inode no qual deve ser desalocado o bloco
-    inodeNumber -> índice do inode
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    goal -> bit desejado (0 procura o primeiro livre do bitmap)
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se encontrou, retorna o número do bit
+    Se não encontrou, retorna 0
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __block_free(struct t2fs_inode *inode, DWORD inodeNumber)
+int __bitmap_search_from(int handle, DWORD goal)
 {
-    int idxBlock = inode->blocksFileSize - 1;
+    DWORD numBits = __bitmap_size(handle);
+    DWORD hint = handle == BITMAP_INODE ? g_fs->sbe->inodeHint : g_fs->sbe->blockHint;
+    int bit;
+
+    if( g_fs->zones != NULL && !g_fs->oldAlloc )
+    {
+        return __zone_search(handle, goal);
+    }
 
-    DWORD dataBlockNumber = __block_get_by_idx(idxBlock, inode);
+    // Nenhum bit antes do cursor está livre
+    if( goal <= hint || goal >= numBits )
+    {
+        return __bitmap_search(handle, 0);
+    }
 
-    return __inode_remove_block(inode, inodeNumber, dataBlockNumber);
+    bit = __bitmap_search_range(handle, goal, numBits, 0);
+
+    return bit != 0 ? bit : __bitmap_search_range(handle, hint, goal, 0);
 }
 
 /*-----------------------------------------------------------------------------
-Função: Lê a entrada referenciada por pointer
+Função: Seta o bit indicado do bitmap, mantendo os contadores de livres.
+        Os trechos livres são atualizados a partir dos bits vizinhos: ocupar um bit
+        com os dois vizinhos livres divide um trecho; liberar um bit entre dois trechos
+        livres os une.
 
 Entra:
-    pointer -> ponteiro de entrada com referencia ao handler
-    size -> tamanho da entrada
-    inode -> inode onde procurar
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    bitNumber -> bit a ser setado
+    bitValue -> valor a ser escrito no bit
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna um buffer com a entrada
-    Se ocorreu algum erro, retorna NULL.
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-BYTE* __entry_read(DWORD pointer, int size, struct t2fs_inode *inode)
+int __bitmap_set(int handle, int bitNumber, int bitValue)
 {
-    DWORD dataBlockNumber = __block_navigate(pointer, size, inode);
+    int oldValue = __bitmap_get(handle, bitNumber);
 
-    if( dataBlockNumber != INVALID_PTR )
-    {
-        int entryPerBlock = (g_sb->blockSize * SECTOR_SIZE) / size;
-        int idxEntry = pointer % entryPerBlock;
+    bitValue = bitValue != 0;
 
-        return __block_get_entry(idxEntry, size, dataBlockNumber);
+    if( oldValue < 0 )
+    {
+        return OP_ERROR;
     }
 
-    return NULL;
-}
+    if( oldValue == bitValue )
+    {
+        return OP_SUCCESS;
+    }
 
-/*-----------------------------------------------------------------------------
-Função: Encontra o record pelo ponteiro
+    __summary_mark_dirty();
 
-Entra:
-    idxRecord -> índice do record no bloco
-    inode -> inode associado
+    if( __bitmap_put(handle, bitNumber, bitValue) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
 
-Saída:
-    Se a operação foi realizada com sucesso, retorna o record
-    Se ocorreu algum erro, retorna NULL.
------------------------------------------------------------------------------*/
-struct t2fs_record* __record_get_by_idx(DWORD pointer, struct t2fs_inode *inode)
-{
-    BYTE* entryBuffer = __entry_read(pointer, sizeof(struct t2fs_record), inode);
-    struct t2fs_record *record = NULL;
+    __zone_count(handle, bitNumber, bitValue ? -1 : 1);
 
-    if( entryBuffer != NULL )
+    if( handle == BITMAP_INODE )
     {
-        record = buffer_to_record(entryBuffer, 0);
+        g_fs->sbe->freeInodes += bitValue ? -1 : 1;
+    }
+    else
+    {
+        int neighbours = __bitmap_is_free(BITMAP_DADOS, bitNumber - 1, g_fs->sb->diskSize) + __bitmap_is_free(BITMAP_DADOS, bitNumber + 1, g_fs->sb->diskSize);
 
-        return record;
+        g_fs->sbe->freeBlocks += bitValue ? -1 : 1;
+
+        if( neighbours == 2 )
+        {
+            g_fs->sbe->freeBlockRuns += bitValue ? 1 : -1;
+        }
+        else if( neighbours == 0 )
+        {
+            g_fs->sbe->freeBlockRuns += bitValue ? -1 : 1;
+        }
     }
 
-    return NULL;
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Encontra o registro associado ao nome no inode especificado
+Função: Libera um trecho de blocos ocupados do bitmap de dados, atualizando os
+        contadores uma única vez para o trecho inteiro
 
 Entra:
-    name -> nome da entrada
-    inode -> inode para procurar
+    start -> primeiro bloco do trecho
+    count -> número de blocos do trecho (todos devem estar ocupados)
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna o record
-    Se ocorreu algum erro, retorna NULL.
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-struct t2fs_record* __record_get_by_name(char *name, struct t2fs_inode *inode)
+int __bitmap_free_range(DWORD start, DWORD count)
 {
-    int pointer = 0;
-    struct t2fs_record *record = NULL, *foundRecord = NULL;
+    int neighbours = __bitmap_is_free(BITMAP_DADOS, start - 1, g_fs->sb->diskSize) + __bitmap_is_free(BITMAP_DADOS, start + count, g_fs->sb->diskSize);
+    DWORD bit;
 
-    do
-    {
-        record = __record_get_by_idx(pointer, inode);
+    __summary_mark_dirty();
 
-        if( record != NULL )
+    for( bit = start; bit < start + count; bit++ )
+    {
+        if( __bitmap_put(BITMAP_DADOS, bit, 0) != OP_SUCCESS )
         {
-            if( record->TypeVal == TYPEVAL_REGULAR || record->TypeVal == TYPEVAL_DIRETORIO )
-            {
-                if( strcmp(name, record->name) == 0 )
-                {
-                    foundRecord = record;
-
-                    return foundRecord;
-                }
-            }
+            return OP_ERROR;
         }
 
-        pointer++;
+        __zone_count(BITMAP_DADOS, bit, 1);
+    }
 
-    } while( record != NULL );
+    // O novo trecho livre se une aos trechos vizinhos
+    g_fs->sbe->freeBlocks += count;
+    g_fs->sbe->freeBlockRuns += 1 - neighbours;
 
-    return foundRecord;
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Encontra o índice de um 'record' pelo seu nome
+Função: Conta os bits livres de um trecho de bitmap lendo seus setores diretamente.
+        As leituras são feitas com a trava do sistema de arquivos travada.
 
 Entra:
-    name -> nome pelo qual procurar
-    inode -> inode onde procurar
-
-Saída:
-    Se a operação foi realizada com sucesso, retorna o índice (int. >= 0)
-    Se ocorreu algum erro, retorna INVALID_PTR.
+    arg -> BITMAP_REGION do trecho (recebe o resultado)
 -----------------------------------------------------------------------------*/
-DWORD __record_get_idx_by_name(char *name, struct t2fs_inode *inode)
+void *__bitmap_count_region(void *arg)
 {
-    int pointer = 0;
-    int idxFound = INVALID_PTR;
-    struct t2fs_record *record = NULL;
+    BITMAP_REGION *region = (BITMAP_REGION*)arg;
+    BYTE buffer[SECTOR_SIZE];
+    DWORD bitsPerSector = SECTOR_SIZE * 8;
+    DWORD bit;
+    int isFree, previousFree = 0, result;
 
-    do
+    g_fs = region->fs;
+
+    region->freeBits = 0;
+    region->freeRuns = 0;
+    region->firstFree = region->endBit;
+    region->result = OP_SUCCESS;
+
+    for( bit = region->firstBit; bit < region->endBit; bit++ )
     {
-        record = __record_get_by_idx(pointer, inode);
+        if( bit % bitsPerSector == 0 )
+        {
+            pthread_mutex_lock(&g_fs->lock);
+            result = __disk_read(__bitmap_get_sector(region->handle, bit), buffer);
+            pthread_mutex_unlock(&g_fs->lock);
 
-        if( record != NULL )
+            if( result != OP_SUCCESS )
+            {
+                region->result = OP_ERROR;
+
+                return NULL;
+            }
+        }
+
+        isFree = ((buffer[(bit % bitsPerSector) / 8] >> (bit % 8)) & 1) == 0;
+
+        if( isFree )
         {
-            if( record->TypeVal == TYPEVAL_REGULAR || record->TypeVal == TYPEVAL_DIRETORIO )
+            region->freeBits += 1;
+
+            if( !previousFree )
             {
-                if( strcmp(name, record->name) == 0)
-                {
-                    idxFound = pointer;
+                region->freeRuns += 1;
+            }
 
-                    return idxFound;
-                }
+            if( region->firstFree == region->endBit )
+            {
+                region->firstFree = bit;
             }
         }
 
-        pointer++;
+        previousFree = isFree;
+    }
 
-    } while( record != NULL );
+    region->lastFree = previousFree;
 
-    return idxFound;
+    return NULL;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Encontra o primeiro registro de 'record' livre
+Função: Conta os bits livres de um bitmap lendo seus setores diretamente. O bitmap é
+        dividido em até SUMMARY_REBUILD_THREADS trechos de pelo menos
+        SUMMARY_REBUILD_MIN_SECTORS setores, contados em paralelo; um trecho livre que atravessa a divisa de dois trechos é contado
+        uma única vez.
 
 Entra:
-    inode -> inode onde procurar
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+    numBits -> número de bits válidos do bitmap
+    freeBits -> onde colocar a quantidade de bits livres
+    freeRuns -> onde colocar a quantidade de trechos de bits livres
+    firstFree -> onde colocar o primeiro bit livre ('numBits' se não há)
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna o índice (int. >= 0)
-    Se ocorreu algum erro, retorna INVALID_PTR.
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-DWORD __record_get_free_idx(struct t2fs_inode *inode)
+int __bitmap_count(int handle, DWORD numBits, DWORD *freeBits, DWORD *freeRuns, DWORD *firstFree)
 {
-    int pointer = 0;
-    struct t2fs_record *record = NULL;
+    BITMAP_REGION regions[SUMMARY_REBUILD_THREADS];
+    pthread_t threads[SUMMARY_REBUILD_THREADS];
+    int started[SUMMARY_REBUILD_THREADS];
+    DWORD bitsPerSector = SECTOR_SIZE * 8;
+    DWORD numSectors = (numBits + bitsPerSector - 1) / bitsPerSector;
+    DWORD numRegions = numSectors / SUMMARY_REBUILD_MIN_SECTORS;
+    DWORD i, sectorsPerRegion;
+    int result = OP_SUCCESS;
+
+    *freeBits = 0;
+    *freeRuns = 0;
+    *firstFree = numBits;
+
+    if( numSectors == 0 )
+    {
+        return OP_SUCCESS;
+    }
 
-    do
+    numRegions = numRegions < 1 ? 1 : numRegions;
+    numRegions = numRegions > SUMMARY_REBUILD_THREADS ? SUMMARY_REBUILD_THREADS : numRegions;
+    sectorsPerRegion = (numSectors + numRegions - 1) / numRegions;
+
+    for( i = 0; i < numRegions; i++ )
     {
-        record = __record_get_by_idx(pointer, inode);
+        regions[i].fs = g_fs;
+        regions[i].handle = handle;
+        regions[i].firstBit = i * sectorsPerRegion * bitsPerSector;
+        regions[i].endBit = (i + 1) * sectorsPerRegion * bitsPerSector;
+        regions[i].endBit = regions[i].endBit < numBits ? regions[i].endBit : numBits;
+        regions[i].firstBit = regions[i].firstBit < regions[i].endBit ? regions[i].firstBit : regions[i].endBit;
+    }
 
-        if( record != NULL )
+    // O primeiro trecho é contado pela própria thread; se não foi possível criar uma thread, o trecho também é
+    for( i = 1; i < numRegions; i++ )
+    {
+        started[i] = pthread_create(&threads[i], NULL, __bitmap_count_region, &regions[i]) == 0;
+    }
+
+    __bitmap_count_region(&regions[0]);
+
+    for( i = 1; i < numRegions; i++ )
+    {
+        if( started[i] )
         {
-            if( record->TypeVal == TYPEVAL_INVALIDO )
-            {
-                return pointer;
-            }
+            pthread_join(threads[i], NULL);
+        }
+        else
+        {
+            __bitmap_count_region(&regions[i]);
         }
+    }
 
-        pointer++;
+    for( i = 0; i < numRegions; i++ )
+    {
+        if( regions[i].result != OP_SUCCESS )
+        {
+            result = OP_ERROR;
+            continue;
+        }
 
-    } while( record != NULL );
+        *freeBits += regions[i].freeBits;
+        *freeRuns += regions[i].freeRuns;
 
-    return INVALID_PTR;
+        // Trecho livre que continua do trecho anterior
+        if( i > 0 && regions[i - 1].lastFree && regions[i].firstFree == regions[i].firstBit && regions[i].firstBit < regions[i].endBit )
+        {
+            *freeRuns -= 1;
+        }
+
+        if( *firstFree == numBits && regions[i].firstFree < regions[i].endBit )
+        {
+            *firstFree = regions[i].firstFree;
+        }
+    }
+
+    return result;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Cria um record no índice do bloco indicado
-
-Entra:
-    record -> dados a serem salvos
-    idxFreeRecord -> índice do espaço livre no bloco
-    blockNumber -> número do bloco onde salvar
+Função: Recalcula os contadores, os cursores de busca e os descritores dos grupos a partir
+        dos bitmaps e os persiste
 
 Saída:
     Se a operação foi realizada com sucesso, retorna OP_SUCCESS
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __record_write(struct t2fs_record *record, int idxFreeRecord, int blockNumber)
+int __summary_rebuild()
 {
-    BYTE buffer[SECTOR_SIZE], *buffer_record = NULL;
-    unsigned int sector = __block_get_sector(blockNumber) + (((idxFreeRecord * sizeof(struct t2fs_record)) / SECTOR_SIZE) % g_sb->blockSize);
-    int idxRecord = (idxFreeRecord % (SECTOR_SIZE/sizeof(struct t2fs_record))) * sizeof(struct t2fs_record);
-    int i;
+    DWORD inodeRuns;
 
-    if( read_sector(sector, buffer) == OP_SUCCESS )
-    {
-        buffer_record = record_to_buffer(record);
+    __zone_forget();
 
-        for(i = 0; i < sizeof(struct t2fs_record); i++)
-        {
-            buffer[idxRecord + i] = buffer_record[i];
-        }
+    if( __bitmap_count(BITMAP_DADOS, g_fs->sb->diskSize, &g_fs->sbe->freeBlocks, &g_fs->sbe->freeBlockRuns, &g_fs->sbe->blockHint) == OP_SUCCESS &&
+        __bitmap_count(BITMAP_INODE, __inode_get_total(), &g_fs->sbe->freeInodes, &inodeRuns, &g_fs->sbe->inodeHint) == OP_SUCCESS &&
+        (g_fs->sbe->groupBlocks == 0 || __zone_load(1) == OP_SUCCESS) )
+    {
+        memcpy(g_fs->sbe->id, SB_EXT_ID, 4);
+        g_fs->sbe->state = SB_STATE_CLEAN;
+        g_fs->sbe->unmountState = 0;
 
-        if( write_sector(sector, buffer) == OP_SUCCESS )
+        // Montado sem alterações: os contadores recalculados ficam apenas em memória
+        if( g_fs->readOnly )
         {
             return OP_SUCCESS;
         }
+
+        // A tabela dos grupos é gravada antes da marca de contadores válidos
+        __table_flush(g_fs->zonesDirty != NULL ? g_fs->zones : NULL, g_fs->zonesDirty, g_fs->sbe->groupTableBlock, g_fs->sbe->groupTableSize);
+
+        return __summary_write();
     }
 
     return OP_ERROR;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Realiza a alocação dos diversos recursos necessários
+Função: Encontra o ponteiro assoc. ao inodeNumber informado
 
 Entra:
-    name -> nome do record
-    type -> tipo do record
-    parentRecord -> onde escrever o record
+    inodeNumber -> número do inode a ser encontrado
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
-    Se ocorreu algum erro, retorna OP_ERROR.
+    Se a operação foi realizada com sucesso, retorna o inode
+    Se ocorreu algum erro, retorna NULL.
 -----------------------------------------------------------------------------*/
-int __record_alocate(char *name, int type, struct t2fs_record* parentRecord)
+struct t2fs_inode* __inode_get_by_idx(DWORD inodeNumber)
 {
-    struct t2fs_record *record = NULL;
-    struct t2fs_inode *inode = NULL;
-
-    struct t2fs_inode *parentInode = __inode_get_by_idx(parentRecord->inodeNumber);
-    int idxFreeRecord = __record_get_free_idx(parentInode);
+    BYTE buffer[SECTOR_SIZE];
+    unsigned int idxInode = __inode_get_sector_idx(inodeNumber);
+    INODE_CACHE_ENTRY *entry = &g_fs->inodeCache[inodeNumber % INODE_CACHE_SIZE];
+    struct t2fs_inode *inode;
 
-    if( idxFreeRecord == OP_ERROR )
+    if( entry->valid && entry->inodeNumber == inodeNumber )
     {
-        if( __block_alocate(parentInode, parentRecord->inodeNumber) == OP_SUCCESS )
-        {
-            if( type == TYPEVAL_DIRETORIO )
-            {
-                parentInode->bytesFileSize = parentInode->blocksFileSize * g_sb->blockSize * SECTOR_SIZE;
-                __inode_write(parentInode, parentRecord->inodeNumber);
-            }
+        inode = (struct t2fs_inode*)malloc(sizeof(struct t2fs_inode));
+        memcpy(inode, &entry->inode, sizeof(struct t2fs_inode));
 
-            idxFreeRecord = __record_get_free_idx(parentInode);
-        }
+        return inode;
     }
 
-    if( idxFreeRecord != OP_ERROR )
+    if( __disk_read(__inode_get_sector(inodeNumber), buffer) == OP_SUCCESS )
     {
-        record = (struct t2fs_record*)calloc(1, sizeof(struct t2fs_record));
+        inode = buffer_to_inode(buffer, idxInode);
 
-        if( strlen(name) <= (RECORD_NAME_SIZE - 1) )
-        {
-            int b_inode = searchBitmap2(BITMAP_INODE, 0);
-            int b_dados = searchBitmap2(BITMAP_DADOS, 0);
+        entry->inodeNumber = inodeNumber;
+        memcpy(&entry->inode, inode, sizeof(struct t2fs_inode));
+        entry->valid = 1;
 
-            if( b_inode > 0 && b_dados > 0 )
-            {
-                strncpy(record->name, name, RECORD_NAME_SIZE - 1);
-                record->TypeVal = type;
-                record->inodeNumber = b_inode;
+        return inode;
+    }
 
-                inode = (struct t2fs_inode*)calloc(1, sizeof(struct t2fs_inode));
+    return NULL;
+}
 
-                inode->blocksFileSize = 1;
-                inode->bytesFileSize = type == TYPEVAL_DIRETORIO ? g_sb->blockSize * SECTOR_SIZE : 0;
-                inode->dataPtr[0] = b_dados;
-                inode->dataPtr[1] = INVALID_PTR;
-                inode->singleIndPtr = INVALID_PTR;
-                inode->doubleIndPtr = INVALID_PTR;
+/*-----------------------------------------------------------------------------
+Função: Cria um novo inode
 
-                if( __inode_write(inode, b_inode) == OP_SUCCESS )
-                {
-                    if( __record_write(record, idxFreeRecord, __block_navigate(idxFreeRecord, sizeof(struct t2fs_record), parentInode)) == OP_SUCCESS )
-                    {
-                        setBitmap2(BITMAP_INODE, b_inode, 1);
-                        setBitmap2(BITMAP_DADOS, b_dados, 1);
+Entra:
+    inode -> dados a serem salvos
+    inodeNumber -> número do inode
 
-                        __block_init(b_dados, 0);
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_write(struct t2fs_inode *inode, int inodeNumber)
+{
+    BYTE buffer[SECTOR_SIZE], *buffer_inode = NULL;
+    unsigned int sector = __inode_get_sector(inodeNumber);
+    int idxInode = __inode_get_sector_idx(inodeNumber);
+    int i;
 
-                        if( type == TYPEVAL_DIRETORIO )
-                        {
-                            struct t2fs_record *selfRecord = (struct t2fs_record*)calloc(1, sizeof(struct t2fs_record));
-                            struct t2fs_record *selfParentRecord = (struct t2fs_record*)calloc(1, sizeof(struct t2fs_record));
+    if( __disk_read(sector, buffer) == OP_SUCCESS )
+    {
+        buffer_inode = inode_to_buffer(inode);
 
-                            strcpy(selfRecord->name, ".");
-                            selfRecord->TypeVal = TYPEVAL_DIRETORIO;
-                            selfRecord->inodeNumber = b_inode;
+        for(i = 0; i < sizeof(struct t2fs_inode); i++)
+        {
+            buffer[idxInode + i] = buffer_inode[i];
+        }
 
-                            strcpy(selfParentRecord->name, "..");
-                            selfParentRecord->TypeVal = TYPEVAL_DIRETORIO;
-                            selfParentRecord->inodeNumber = parentRecord->inodeNumber;
+        free(buffer_inode);
 
-                            __record_write(selfRecord, 0, b_dados);
-                            __record_write(selfParentRecord, 1, b_dados);
+        if( __disk_write(sector, buffer) == OP_SUCCESS )
+        {
+            INODE_CACHE_ENTRY *entry = &g_fs->inodeCache[inodeNumber % INODE_CACHE_SIZE];
 
-                            free(selfRecord);
-                            free(selfParentRecord);
-                        }
+            entry->inodeNumber = inodeNumber;
+            memcpy(&entry->inode, inode, sizeof(struct t2fs_inode));
+            entry->valid = 1;
 
-                        free(inode);
-                        free(record);
+            return OP_SUCCESS;
+        }
+    }
 
+    return OP_ERROR;
+}
 
-                        return OP_SUCCESS;
-                    }
-                }
-            }
-        }
-    }
+/*-----------------------------------------------------------------------------
+Função: Mantém a cópia em memória do inode raiz igual ao inode informado,
+        caso este seja o inode do diretório raiz
 
-    return OP_ERROR;
+Entra:
+    inode -> inode recém atualizado
+    inodeNumber -> número do inode
+-----------------------------------------------------------------------------*/
+void __inode_sync_root(struct t2fs_inode *inode, DWORD inodeNumber)
+{
+    if( inodeNumber == 0 && g_fs->ri != NULL && inode != g_fs->ri )
+    {
+        memcpy(g_fs->ri, inode, sizeof(struct t2fs_inode));
+    }
 }
 
 /*-----------------------------------------------------------------------------
-Função: Encontra o record indicado pelo caminho informado
+Função: Lê a 'idxEntry'-ézima de tamanho 'size' entrada do bloco especificado
 
 Entra:
-    parsedPath -> caminho já normalizado
+    idxEntry -> índice da entrada no bloco
+    size -> tamanho da entrada
+    blockNumber -> o bloco onde ler a entrada
 
 Saída:
-    Se a operação foi realizada com sucesso, retorna o record associado
+    Se a operação foi realizada com sucesso, retorna um buffer com a entrada
     Se ocorreu algum erro, retorna NULL.
 -----------------------------------------------------------------------------*/
-struct t2fs_record* __record_navigate(char *parsedPath)
+BYTE* __block_get_entry(DWORD idxEntry, int size, DWORD blockNumber)
 {
-    char *auxPathname;
-    struct t2fs_record *record = NULL;
-    struct t2fs_inode *inode = NULL;
+    BYTE buffer[SECTOR_SIZE], *entryBuffer;
+    DWORD idxSector = (idxEntry * size) / SECTOR_SIZE;
+    DWORD idxSectorEntry = (idxEntry * size) % SECTOR_SIZE;
+    int i;
 
-    if( parsedPath != NULL )
+    if( __disk_read(__block_get_sector(blockNumber) + idxSector, buffer) == OP_SUCCESS )
     {
-        auxPathname = (char*)calloc(strlen(parsedPath) + 1, sizeof(char));
-        strcpy(auxPathname, parsedPath);
-
-
-        // Caminho absoluto
-        if( auxPathname[0] == '/' )
-        {
-            record = __record_get_by_name(".", g_ri);
-            inode = g_ri;
-        }
-        else
-        {
-            record = g_cwd_record;
-            inode = __inode_get_by_idx(g_cwd_record->inodeNumber);
-        }
-
-        char *token;
+        entryBuffer = (BYTE*)malloc(size);
 
-        while( (token = strsep(&auxPathname, "/")) )
+        for( i = 0; i < size; i++ )
         {
-            if( strlen(token) > 0 )
-            {
-                record = __record_get_by_name(token, inode);
-
-                if( record != NULL )
-                {
-                    inode = __inode_get_by_idx(record->inodeNumber);
-                }
-                else
-                {
-                    return NULL;
-                }
-            }
+            entryBuffer[i] = buffer[idxSectorEntry + i];
         }
 
-        return record;
+        return entryBuffer;
     }
 
     return NULL;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Cria um record no caminho especificado
+Função: Escreve um ponteiro para um bloco num dado bloco de indireção
 
 Entra:
-    path -> caminho para o record
-    type -> tipo do record
+    idxPtr -> índice do ponteiro no bloco
+    blockNumber -> valor do ponteiro para o bloco
+    indBlockNumber -> bloco onde o ponteiro deve ser escrito
 
 Saída:
     Se a operação foi realizada com sucesso, retorna OP_SUCCESS
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __record_create(char *pathname, int type)
+int __block_write_ptr(DWORD idxPtr, DWORD blockNumber, DWORD indBlockNumber)
 {
-    char* parsedPath = parse_path(pathname, g_cwd);
+    BYTE buffer[SECTOR_SIZE], *buffer_ptr;
+    unsigned int sector = indBlockNumber * g_fs->sb->blockSize + ((idxPtr * sizeof(DWORD)) / SECTOR_SIZE);
+    int idxSectorPtr = (idxPtr % (SECTOR_SIZE/sizeof(DWORD))) * sizeof(DWORD);
+    int i;
 
-    if( parsedPath != NULL )
+    if( __disk_read(sector, buffer) == OP_SUCCESS )
     {
-        struct t2fs_record *record = __record_navigate(parsedPath);
+        buffer_ptr = dword_to_buffer(blockNumber);
 
-        // Se já não existe algum record com esse nome
-        if( record == NULL )
+        for(i = 0; i < sizeof(DWORD); i++)
         {
-            char* recordName = extract_recordname(parsedPath);
-            struct t2fs_record *parentRecord = __record_navigate(parsedPath);
+            buffer[idxSectorPtr + i] = buffer_ptr[i];
+        }
 
-            // Se o record pai existe
-            if( parentRecord != NULL && strlen(recordName) > 0 )
-            {
-                return __record_alocate(recordName, type, parentRecord);
-            }
+        if( __disk_write(sector, buffer) == OP_SUCCESS )
+        {
+            return OP_SUCCESS;
         }
     }
 
@@ -1090,939 +1727,9736 @@ int __record_create(char *pathname, int type)
 }
 
 /*-----------------------------------------------------------------------------
-Função: Verifica se um dado record está aberto
+Função: Verifica se um ponteiro de bloco aponta para um bloco de dados. Ponteiros
+        inválidos (INVALID_PTR ou fora do disco) representam buracos do arquivo.
 
 Entra:
-    recordName -> nome do record
-    type -> tipo do record
-    recordWd-> "contexto" do record
+    blockNumber -> ponteiro a ser verificado
 
 Saída:
-    Se veradeiro, retorna 1
-    Se falso 0.
+    Se aponta para um bloco, retorna 1
+    Se é um buraco, 0.
 -----------------------------------------------------------------------------*/
-int __record_is_opened(char* recordName, int type, char* recordWd)
+int __block_is_valid(DWORD blockNumber)
 {
-    HANDLER *handler = NULL;
-    int i;
+    return blockNumber != INVALID_PTR && blockNumber > 0 && blockNumber < g_fs->sb->diskSize;
+}
 
-    if( type == TYPEVAL_REGULAR )
-    {
-        handler = g_files;
-    }
-    else
+/*-----------------------------------------------------------------------------
+Função: Lê o ponteiro de índice 'idxPtr' de um bloco de indireção
+
+Entra:
+    idxPtr -> índice do ponteiro no bloco
+    indBlockNumber -> bloco de indireção (pode ser um buraco)
+
+Saída:
+    O ponteiro lido, ou INVALID_PTR se o bloco de indireção não existe.
+-----------------------------------------------------------------------------*/
+DWORD __block_read_ptr(DWORD idxPtr, DWORD indBlockNumber)
+{
+    BYTE *entry;
+    DWORD blockNumber;
+
+    if( !__block_is_valid(indBlockNumber) )
     {
-        handler = g_dirs;
+        return INVALID_PTR;
     }
 
-    for( i = 0; i < MAX_NUM_HANDLERS; i++ )
+    entry = __block_get_entry(idxPtr, sizeof(DWORD), indBlockNumber);
+
+    if( entry == NULL )
     {
-        if( !handler[i].free )
-        {
-            if( handler[i].record != NULL )
-            {
-                if( strcmp(handler[i].record->name, recordName) == 0 && strcmp(handler[i].wd, recordWd) == 0 )
-                {
-                    return 1;
-                }
-            }
-        }
+        return INVALID_PTR;
     }
 
-    return 0;
+    blockNumber = buffer_to_dword(entry, 0);
+    free(entry);
+
+    return blockNumber;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Verifica se um dado diretório está vazio
+Função: Encontra o 'idxBlock'ézimo bloco no inode
 
 Entra:
-    recordName -> nome do record
+    idxBlock -> índice do bloco relativo ao inode
+    inode -> inode onde está o bloco
 
 Saída:
-    Se veradeiro, retorna 1
-    Se falso 0.
+    Se a operação foi realizada com sucesso, retorna o número do ponteiro
+    Se o bloco é um buraco ou está fora do arquivo, retorna INVALID_PTR.
 -----------------------------------------------------------------------------*/
-int __record_is_dir_empty(struct t2fs_record* dir)
+DWORD __block_get_by_idx(DWORD idxBlock, struct t2fs_inode *inode)
 {
-    struct t2fs_record *record;
-    struct t2fs_inode *inode = __inode_get_by_idx(dir->inodeNumber);
-    int pointer = 0, recordCounter = 0;
-
-    record = __record_get_by_idx(pointer, inode);
+    DWORD dataBlockNumber = INVALID_PTR;
 
-    while( record != NULL )
+    if( idxBlock < inode->blocksFileSize )
     {
-        if( record->TypeVal == TYPEVAL_REGULAR || record->TypeVal == TYPEVAL_DIRETORIO )
+        int blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+
+        if( idxBlock < 2 )
         {
-            if( strcmp(record->name, ".") != 0 && strcmp(record->name, "..") != 0 )
-            {
-                recordCounter++;
-            }
+            dataBlockNumber = inode->dataPtr[idxBlock];
         }
-        else
+        else if( idxBlock - 2 < blockNumberPerBlock )
         {
-            break;
+            dataBlockNumber = __block_read_ptr(idxBlock - 2, inode->singleIndPtr);
         }
+        else
+        {
+            int idxBase = idxBlock - blockNumberPerBlock - 2;
+            DWORD ptrBlockNumber = __block_read_ptr(idxBase / blockNumberPerBlock, inode->doubleIndPtr);
 
-        pointer++;
-        record = __record_get_by_idx(pointer, inode);
+            dataBlockNumber = __block_read_ptr(idxBase % blockNumberPerBlock, ptrBlockNumber);
+        }
     }
 
-    return recordCounter == 0;
+    return __block_is_valid(dataBlockNumber) ? dataBlockNumber : INVALID_PTR;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Remove o record pelo nome
+Função: Inicializa o bloco com dado valor
 
 Entra:
-    name -> nome do record
-    parentRecord -> record pai
+    blockNumber -> número do bloco
+    value -> valor a ser escrito
 
 Saída:
     Se a operação foi realizada com sucesso, retorna OP_SUCCESS
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __record_free(char* name, struct t2fs_record* parentRecord)
+int __block_init(DWORD blockNumber, char value)
 {
-    struct t2fs_inode *inode;
-    struct t2fs_inode *parentInode = __inode_get_by_idx(parentRecord->inodeNumber);
-    struct t2fs_record *record;
-    int idxRecord = __record_get_idx_by_name(name, parentInode);
+    int i, j;
+    BYTE buffer[SECTOR_SIZE];
 
-    if( idxRecord != OP_ERROR )
+    for( i = 0; i < g_fs->sb->blockSize; i++ )
     {
-        record = __record_get_by_name(name, parentInode);
-        inode = __inode_get_by_idx(record->inodeNumber);
-
-        record->TypeVal = TYPEVAL_INVALIDO;
-
-        __record_write(record, idxRecord, __block_navigate(idxRecord, sizeof(struct t2fs_record), parentInode));
-
-        while( inode->blocksFileSize > 0 )
+        if( __disk_read(__block_get_sector(blockNumber) + i, buffer) != OP_SUCCESS )
         {
-            __block_free(inode, record->inodeNumber);
+            return OP_ERROR;
         }
+        else
+        {
+            for( j = 0; j < SECTOR_SIZE; j++ )
+            {
+                buffer[j] = (BYTE)value;
+            }
 
-        setBitmap2(BITMAP_INODE, record->inodeNumber, 0);
-
-        return OP_SUCCESS;
+            if( __disk_write(__block_get_sector(blockNumber) + i, buffer) != OP_SUCCESS )
+            {
+                return OP_ERROR;
+            }
+        }
     }
 
-    return OP_ERROR;
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Deleta o record
+Função: Lê todos os setores de um bloco, em ordem, para o buffer informado
 
 Entra:
-    path -> caminho para o record
-    type -> tipo do record
+    blockNumber -> número do bloco
+    buffer -> buffer com pelo menos (blockSize * SECTOR_SIZE) bytes
 
 Saída:
     Se a operação foi realizada com sucesso, retorna OP_SUCCESS
     Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __record_delete(char *pathname, int type)
+int __block_read(DWORD blockNumber, BYTE *buffer)
 {
-    char* parsedPath = parse_path(pathname, g_cwd);
+    int i;
 
-    if( parsedPath != NULL )
+    for( i = 0; i < g_fs->sb->blockSize; i++ )
     {
-        struct t2fs_record *record = __record_navigate(parsedPath);
-
-        // Se existe algum record com esse nome
-        if( record != NULL )
+        if( __disk_read(__block_get_sector(blockNumber) + i, buffer + (i * SECTOR_SIZE)) != OP_SUCCESS )
         {
-            char* recordName = extract_recordname(parsedPath);
-            struct t2fs_record *parentRecord = __record_navigate(parsedPath);
-
-            // Se é válido e se é do tipo indicado
-            if( strlen(recordName) > 0 && record->TypeVal == type )
-            {
-                if( !__record_is_opened(recordName, type, parsedPath) )
-                {
-                    if( type == TYPEVAL_DIRETORIO )
-                    {
-                        if( !__record_is_dir_empty(record) )
-                        {
-
-                            return OP_ERROR;
-                        }
-                    }
-
-                    return __record_free(recordName, parentRecord);
-                }
-            }
+            return OP_ERROR;
         }
     }
 
-    return OP_ERROR;
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Encontra (ou não) um handler de diretório e ou arquivo disponível
+Função: Escreve todos os setores de um bloco, em ordem, a partir do buffer informado
 
 Entra:
-    type -> tipo do record (o que implica no tipo do handler)
+    blockNumber -> número do bloco
+    buffer -> buffer com pelo menos (blockSize * SECTOR_SIZE) bytes
 
 Saída:
-    Se há handler disponível, retorna o índice
-    Se ocorreu algum erro, retorn OP_ERROR.
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __handler_get_free_idx(int type)
+int __block_write(DWORD blockNumber, BYTE *buffer)
 {
     int i;
-    HANDLER *handler;
 
-    if( type == TYPEVAL_REGULAR || type == TYPEVAL_DIRETORIO )
+    for( i = 0; i < g_fs->sb->blockSize; i++ )
     {
-        handler = type == TYPEVAL_REGULAR ? g_files : g_dirs;
-
-        for(i = 0; i < MAX_NUM_HANDLERS; i++)
+        if( __disk_write(__block_get_sector(blockNumber) + i, buffer + (i * SECTOR_SIZE)) != OP_SUCCESS )
         {
-            if( handler[i].free )
-            {
-                return i;
-            }
+            return OP_ERROR;
         }
     }
 
-    return INVALID_PTR;
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Aloca um dado caminho
-
-Entra:
-    pathname -> caminho a ser alocado
-    type -> tipo do caminho (o que implica no tipo do handler)
+Função: Informa quantas entradas de uma tabela paginada cabem numa página (um bloco)
 
 Saída:
-    Se há handler disponível, retorna o índice
-    Se ocorreu algum erro, retorn OP_ERROR.
+    Número de entradas por página.
 -----------------------------------------------------------------------------*/
-int __handler_alocate(char* pathname, int type)
+DWORD __paged_page_entries()
 {
-    char* parsedPath = parse_path(pathname, g_cwd);
+    return (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+}
 
-    if( parsedPath != NULL )
+void __table_alloc(DWORD **table, BYTE **dirty, DWORD numBlocks);
+int __table_read(DWORD **table, BYTE **dirty, DWORD firstBlock, DWORD numBlocks);
+
+/*-----------------------------------------------------------------------------
+Função: Localiza a entrada do bloco numa tabela paginada, lendo a sua página na
+        primeira vez. Com 'create', uma página que ainda não existe é criada num bloco
+        livre, zerada. Se a leitura da página falhar, o sistema de arquivos passa a ser
+        montado sem alterações (ver __table_load).
+
+Entra:
+    table -> tabela (o diretório já deve ter sido lido)
+    blockNumber -> número do bloco
+    create -> flag indicando se a página deve ser criada
+
+Saída:
+    Ponteiro para a entrada do bloco
+    NULL se a tabela ou a página não existe (entrada 0) ou se ocorreu algum erro.
+-----------------------------------------------------------------------------*/
+DWORD* __paged_entry(PAGED_TABLE *table, DWORD blockNumber, int create)
+{
+    DWORD entries = __paged_page_entries();
+    DWORD page = blockNumber / entries;
+    int newBlock;
+
+    if( table->dir == NULL || blockNumber >= g_fs->sb->diskSize || page >= g_fs->tablePageCount )
     {
-        struct t2fs_record *record = __record_navigate(parsedPath);
+        return NULL;
+    }
 
-        if( record != NULL )
-        {
-            int freeHandler = -1;
-            HANDLER *handler = NULL;
+    if( table->pages == NULL )
+    {
+        table->pages = (DWORD**)calloc(g_fs->tablePageCount, sizeof(DWORD*));
+        table->pagesDirty = (BYTE**)calloc(g_fs->tablePageCount, sizeof(BYTE*));
+    }
 
-            freeHandler = __handler_get_free_idx(type);
-            handler = type == TYPEVAL_REGULAR ? g_files : g_dirs;
+    if( table->pages[page] == NULL )
+    {
+        if( table->dir[page] != 0 && table->dir[page] < g_fs->sb->diskSize )
+        {
+            if( __table_read(&table->pages[page], &table->pagesDirty[page], table->dir[page], 1) != OP_SUCCESS )
+            {
+                free(table->pages[page]);
+                free(table->pagesDirty[page]);
+                table->pages[page] = NULL;
+                table->pagesDirty[page] = NULL;
+                g_fs->readOnly = 1;
 
-            if( freeHandler != INVALID_PTR )
+                return NULL;
+            }
+        }
+        else
+        {
+            if( !create || (newBlock = __bitmap_search_from(BITMAP_DADOS, 0)) <= 0 )
             {
-                handler[freeHandler].record = record;
-                handler[freeHandler].pointer = 0;
-                handler[freeHandler].free = 0;
+                return NULL;
+            }
 
-                // Tira o nome do record sendo adicionado do path
-                extract_recordname(parsedPath);
-                handler[freeHandler].wd = parsedPath;
+            // Sem o bloco da página gravado, o diretório continua sem a página
+            if( __bitmap_set(BITMAP_DADOS, newBlock, 1) != OP_SUCCESS || __block_init(newBlock, 0) != OP_SUCCESS )
+            {
+                __bitmap_set(BITMAP_DADOS, newBlock, 0);
 
-                return freeHandler;
+                return NULL;
             }
+
+            __table_alloc(&table->pages[page], &table->pagesDirty[page], 1);
+
+            table->dir[page] = newBlock;
+            table->dirDirty[(page * sizeof(DWORD)) / SECTOR_SIZE] = 1;
         }
     }
 
-    return OP_ERROR;
+    return &table->pages[page][blockNumber % entries];
 }
 
 /*-----------------------------------------------------------------------------
-Função: Desaloca um dado caminho
+Função: Informa a entrada do bloco numa tabela paginada
 
 Entra:
-    handle -> id no handler
-    type -> tipo do caminho (o que implica no tipo do handler)
+    table -> tabela (o diretório já deve ter sido lido)
+    blockNumber -> número do bloco
 
 Saída:
-    Se há handler disponível, retorna OP_SUCCESS
-    Se ocorreu algum erro, retorn OP_ERROR.
+    Valor da entrada (0 se o bloco não possui entrada).
 -----------------------------------------------------------------------------*/
-int __handler_free(int handle, int type)
+DWORD __paged_get(PAGED_TABLE *table, DWORD blockNumber)
 {
-    HANDLER *handler = NULL;
-
-    if( handle >= 0 && handle < MAX_NUM_HANDLERS )
-    {
-        if( type == TYPEVAL_REGULAR || type == TYPEVAL_DIRETORIO )
-        {
-            handler = type == TYPEVAL_REGULAR ? g_files : g_dirs;
-
-            if( !(handler[handle].free || handler[handle].record == NULL) )
-            {
-                handler[handle].record = NULL;
-                handler[handle].wd = NULL;
-                handler[handle].pointer = 0;
-                handler[handle].free = 1;
+    DWORD *entry = __paged_entry(table, blockNumber, 0);
 
-                return OP_SUCCESS;
-            }
-        }
-    }
-
-    return OP_ERROR;
+    return entry != NULL ? *entry : 0;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Realiza a leitura do superbloco do disco
+Função: Substitui o valor da entrada do bloco numa tabela paginada, criando a sua
+        página se necessário. O setor alterado só é escrito no disco ao fim da operação
+        (ver __paged_flush).
+
+Entra:
+    table -> tabela (o diretório já deve ter sido lido)
+    blockNumber -> número do bloco
+    value -> novo valor da entrada
 
 Saída:
     Se a operação foi realizada com sucesso, retorna OP_SUCCESS
-    Se ocorreu algum erro, retorna OP_ERROR.
+    Se ocorreu algum erro (tabela inexistente ou sem espaço para a página), retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int __init_superblock_read()
+int __paged_set(PAGED_TABLE *table, DWORD blockNumber, DWORD value)
 {
-    BYTE buffer[SECTOR_SIZE];
-    unsigned int sector_superblock = 0;
+    DWORD *entry = __paged_entry(table, blockNumber, value != 0);
+    DWORD entries = __paged_page_entries();
 
-    if( read_sector(sector_superblock, buffer) == OP_SUCCESS )
+    if( entry == NULL )
     {
-        g_sb = buffer_to_superblock(buffer, 0);
+        return value == 0 ? OP_SUCCESS : OP_ERROR;
+    }
 
-        return OP_SUCCESS;
+    if( *entry != value )
+    {
+        *entry = value;
+        table->pagesDirty[blockNumber / entries][((blockNumber % entries) * sizeof(DWORD)) / SECTOR_SIZE] = 1;
     }
 
-    return OP_ERROR;
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Realiza a leitura do inode referente ao diretório raiz
+Função: Grava o diretório e as páginas alterados de uma tabela paginada (ver __table_flush)
 
-Saída:
-    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
-    Se ocorreu algum erro, retorna OP_ERROR.
+Entra:
+    table -> tabela
+    firstBlock -> primeiro bloco do diretório no disco
+    numBlocks -> número de blocos do diretório no disco
 -----------------------------------------------------------------------------*/
-int __init_rootinode_read()
+void __paged_flush(PAGED_TABLE *table, DWORD firstBlock, DWORD numBlocks)
 {
-    g_ri = __inode_get_by_idx(0);
+    DWORD page;
+
+    __table_flush(table->dir, table->dirDirty, firstBlock, numBlocks);
 
-    if( g_ri != NULL )
+    for( page = 0; table->pages != NULL && page < g_fs->tablePageCount; page++ )
     {
-        return OP_SUCCESS;
+        if( table->pages[page] != NULL )
+        {
+            __table_flush(table->pages[page], table->pagesDirty[page], table->dir[page], 1);
+        }
     }
-
-    return OP_ERROR;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Inicializa as varíaveis necessárias para correta execução
+Função: Libera a memória de uma tabela paginada (o disco não é alterado)
 
-Saída:
-    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
-    Se ocorreu algum erro, retorna OP_ERROR.
+Entra:
+    table -> tabela
+    pageCount -> entradas do diretório da tabela
 -----------------------------------------------------------------------------*/
-int __init()
+void __paged_free(PAGED_TABLE *table, DWORD pageCount)
 {
-    int i;
+    DWORD page;
 
-    if( __init_superblock_read() == OP_SUCCESS && __init_rootinode_read() == OP_SUCCESS )
+    for( page = 0; table->pages != NULL && page < pageCount; page++ )
     {
-        for(i = 0; i < MAX_NUM_HANDLERS; i++)
-        {
-            g_files[i].free = 1;
-            g_files[i].record = NULL;
-            g_files[i].wd = NULL;
+        free(table->pages[page]);
+        free(table->pagesDirty[page]);
+    }
 
-            g_dirs[i].free = 1;
-            g_dirs[i].record = NULL;
-            g_dirs[i].wd = NULL;
-        }
+    free(table->dir);
+    free(table->dirDirty);
+    free(table->pages);
+    free(table->pagesDirty);
+    memset(table, 0, sizeof(PAGED_TABLE));
+}
 
-        g_cwd = "/";
-        g_cwd_record = __record_get_by_name(".", g_ri);
+/*-----------------------------------------------------------------------------
+Função: Localiza a entrada do bloco na tabela de contadores (ver __paged_entry)
 
-        g_initialized = 1;
+Entra:
+    blockNumber -> número do bloco
+    create -> flag indicando se a página deve ser criada
 
-        return OP_SUCCESS;
+Saída:
+    Ponteiro para a entrada do bloco
+    NULL se a tabela ou a página não existe (contador 0) ou se ocorreu algum erro.
+-----------------------------------------------------------------------------*/
+DWORD* __refcount_entry(DWORD blockNumber, int create)
+{
+    if( __refcount_load() != OP_SUCCESS )
+    {
+        return NULL;
     }
 
-    return OP_ERROR;
+    return __paged_entry(&g_fs->refcount, blockNumber, create);
 }
 
 /*-----------------------------------------------------------------------------
-Função: Usada para identificar os desenvolvedores do T2FS.
-	Essa função copia um string de identificação para o ponteiro indicado por "name".
-	Essa cópia não pode exceder o tamanho do buffer, informado pelo parâmetro "size".
-	O string deve ser formado apenas por caracteres ASCII (Valores entre 0x20 e 0x7A) e terminado por \0.
-	O string deve conter o nome e número do cartão dos participantes do grupo.
+Função: Informa a entrada do bloco na tabela de contadores (ver REFCOUNT_*)
 
-Entra:	name -> buffer onde colocar o string de identificação.
-	size -> tamanho do buffer "name" (número máximo de bytes a serem copiados).
+Entra:
+    blockNumber -> número do bloco
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-	Em caso de erro, será retornado um valor diferente de zero.
+Saída:
+    Valor da entrada (0 se o bloco não possui entrada).
 -----------------------------------------------------------------------------*/
-int identify2 (char *name, int size)
+DWORD __refcount_value(DWORD blockNumber)
 {
-    char names[150] = "Luís Augusto Weber Mercado - 265041\nMatheus Tavares Frigo - 262521\nNicholas de Aquino Lau - 268618\n";
+    DWORD *entry = __refcount_entry(blockNumber, 0);
 
-    if( size >= strlen(names) )
-    {
-        strcpy(name, names);
+    return entry != NULL ? *entry : 0;
+}
 
-        return OP_SUCCESS;
-    }
+/*-----------------------------------------------------------------------------
+Função: Informa quantas referências, além da primeira, o bloco de dados possui
 
-    return OP_ERROR;
+Entra:
+    blockNumber -> número do bloco
+
+Saída:
+    Número de referências extras (0 se o bloco não é compartilhado).
+-----------------------------------------------------------------------------*/
+DWORD __refcount_get(DWORD blockNumber)
+{
+    return __refcount_value(blockNumber) & REFCOUNT_COUNT;
 }
 
 /*-----------------------------------------------------------------------------
-Função: Criar um novo arquivo.
-	O nome desse novo arquivo é aquele informado pelo parâmetro "filename".
-	O contador de posição do arquivo (current pointer) deve ser colocado na posição zero.
-	Caso já exista um arquivo ou diretório com o mesmo nome, a função deverá retornar um erro de criação.
-	A função deve retornar o identificador (handle) do arquivo.
-	Esse handle será usado em chamadas posteriores do sistema de arquivo para fins de manipulação do arquivo criado.
+Função: Substitui o valor da entrada do bloco na tabela de contadores (ver __paged_set)
 
-Entra:	filename -> nome do arquivo a ser criado.
+Entra:
+    blockNumber -> número do bloco
+    value -> novo valor da entrada
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna o handle do arquivo (número positivo).
-	Em caso de erro, deve ser retornado um valor negativo.
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro (tabela inexistente ou sem espaço para a página), retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-FILE2 create2 (char *filename)
+int __refcount_set(DWORD blockNumber, DWORD value)
 {
-    if( !g_initialized )
+    if( __refcount_load() != OP_SUCCESS )
     {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
-
+        return OP_ERROR;
     }
 
-    return __record_create(filename, TYPEVAL_REGULAR);
+    return __paged_set(&g_fs->refcount, blockNumber, value);
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Apagar um arquivo do disco.
-	O nome do arquivo a ser apagado é aquele informado pelo parâmetro "filename".
+Função: Soma 'delta' ao contador de referências do bloco (ver __refcount_set)
 
-Entra:	filename -> nome do arquivo a ser apagado.
+Entra:
+    blockNumber -> número do bloco
+    delta -> valor a ser somado ao contador
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-	Em caso de erro, será retornado um valor diferente de zero.
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int delete2 (char *filename)
+int __refcount_add(DWORD blockNumber, int delta)
 {
-    if( !g_initialized )
-    {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
-    }
-
-    return __record_delete(filename, TYPEVAL_REGULAR);
+    return __refcount_set(blockNumber, __refcount_value(blockNumber) + delta);
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Abre um arquivo existente no disco.
-	O nome desse novo arquivo é aquele informado pelo parâmetro "filename".
-	Ao abrir um arquivo, o contador de posição do arquivo (current pointer) deve ser colocado na posição zero.
-	A função deve retornar o identificador (handle) do arquivo.
-	Esse handle será usado em chamadas posteriores do sistema de arquivo para fins de manipulação do arquivo criado.
-	Todos os arquivos abertos por esta chamada são abertos em leitura e em escrita.
-	O ponto em que a leitura, ou escrita, será realizada é fornecido pelo valor current_pointer (ver função seek2).
+Função: Garante que a página da entrada do bloco existe, para que alterações posteriores
+        do contador não falhem no meio de uma operação
 
-Entra:	filename -> nome do arquivo a ser apagado.
+Entra:
+    blockNumber -> número do bloco
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna o handle do arquivo (número positivo)
-	Em caso de erro, deve ser retornado um valor negativo
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-FILE2 open2 (char *filename)
+int __refcount_reserve(DWORD blockNumber)
 {
-    if( !g_initialized )
-    {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
-    }
-
-    return __handler_alocate(filename, TYPEVAL_REGULAR);
+    return __refcount_entry(blockNumber, 1) != NULL ? OP_SUCCESS : OP_ERROR;
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Fecha o arquivo identificado pelo parâmetro "handle".
-
-Entra:	handle -> identificador do arquivo a ser fechado
+Função: Aloca em memória (zerada) uma tabela de DWORDs que ocupa 'numBlocks' blocos
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-	Em caso de erro, será retornado um valor diferente de zero.
+Entra:
+    table -> onde colocar a tabela
+    dirty -> onde colocar os indicadores de setores alterados
+    numBlocks -> número de blocos da tabela no disco
 -----------------------------------------------------------------------------*/
-int close2 (FILE2 handle)
+void __table_alloc(DWORD **table, BYTE **dirty, DWORD numBlocks)
 {
-    if( !g_initialized )
-    {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
-    }
+    free(*table);
+    free(*dirty);
 
-    return __handler_free(handle, TYPEVAL_REGULAR);
+    *table = (DWORD*)calloc((numBlocks * g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD), sizeof(DWORD));
+    *dirty = (BYTE*)calloc(numBlocks * g_fs->sb->blockSize, sizeof(BYTE));
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Realiza a leitura de "size" bytes do arquivo identificado por "handle".
-	Os bytes lidos são colocados na área apontada por "buffer".
-	Após a leitura, o contador de posição (current pointer) deve ser ajustado para o byte seguinte ao último lido.
+Função: Lê do disco uma tabela de DWORDs, se o disco a possui
 
-Entra:	handle -> identificador do arquivo a ser lido
-	buffer -> buffer onde colocar os bytes lidos do arquivo
-	size -> número de bytes a serem lidos
+Entra:
+    table -> onde colocar a tabela
+    dirty -> onde colocar os indicadores de setores alterados
+    firstBlock -> primeiro bloco da tabela no disco
+    numBlocks -> número de blocos da tabela (0 se o disco não a possui)
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna o número de bytes lidos.
-	Se o valor retornado for menor do que "size", então o contador de posição atingiu o final do arquivo.
-	Em caso de erro, será retornado um valor negativo.
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int read2 (FILE2 handle, char *buffer, int size)
+int __table_read(DWORD **table, BYTE **dirty, DWORD firstBlock, DWORD numBlocks)
 {
-    if( !g_initialized )
+    BYTE *buffer;
+    DWORD entriesPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD i, j;
+
+    if( numBlocks == 0 )
     {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
+        return OP_SUCCESS;
     }
 
-    if( handle >= 0 )
+    __table_alloc(table, dirty, numBlocks);
+    buffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+
+    for( i = 0; i < numBlocks; i++ )
     {
-        if( !(g_files[handle].free || g_files[handle].record == NULL) )
+        if( __block_read(firstBlock + i, buffer) != OP_SUCCESS )
         {
-            int i;
-            struct t2fs_inode *inode = __inode_get_by_idx(g_files[handle].record->inodeNumber);
-
-            if( __inode_read_bytes(g_files[handle].pointer, buffer, size, inode) != OP_SUCCESS )
-            {
-                return OP_ERROR;
-            }
-
-            for( i = 0; i < size; i++ )
-            {
-                g_files[handle].pointer += 1;
+            free(buffer);
 
-                if( buffer[i] == 0 )
-                {
-                    return i;
-                }
-            }
+            return OP_ERROR;
+        }
 
-            return size;
+        for( j = 0; j < entriesPerBlock; j++ )
+        {
+            (*table)[i * entriesPerBlock + j] = buffer_to_dword(buffer, j * sizeof(DWORD));
         }
     }
 
-    return OP_ERROR;
+    free(buffer);
+
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Realiza a escrita de "size" bytes no arquivo identificado por "handle".
-	Os bytes a serem escritos estão na área apontada por "buffer".
-	Após a escrita, o contador de posição (current pointer) deve ser ajustado para o byte seguinte ao último escrito.
+Função: Lê a tabela do disco na primeira vez que é usada. As tabelas não são lidas na
+        montagem: uma montagem só paga pelas tabelas que as operações seguintes usam.
+        Se a leitura falhar, o sistema de arquivos passa a ser montado sem alterações,
+        pois as operações não poderiam manter a tabela.
 
-Entra:	handle -> identificador do arquivo a ser escrito
-	buffer -> buffer de onde pegar os bytes a serem escritos no arquivo
-	size -> número de bytes a serem escritos
+Entra:
+    loaded -> flag indicando que a tabela já foi lida (é atualizada)
+    table -> onde colocar a tabela
+    dirty -> onde colocar os indicadores de setores alterados
+    firstBlock -> primeiro bloco da tabela no disco
+    numBlocks -> número de blocos da tabela (0 se o disco não a possui)
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna o número de bytes efetivamente escritos.
-	Em caso de erro, será retornado um valor negativo.
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int write2 (FILE2 handle, char *buffer, int size)
+int __table_load(int *loaded, DWORD **table, BYTE **dirty, DWORD firstBlock, DWORD numBlocks)
 {
-    if( !g_initialized )
+    if( *loaded )
     {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
+        return OP_SUCCESS;
     }
 
-    if( handle >= 0 )
+    if( __table_read(table, dirty, firstBlock, numBlocks) != OP_SUCCESS )
     {
-        if( !(g_files[handle].free || g_files[handle].record == NULL) )
-        {
-            struct t2fs_inode *inode = __inode_get_by_idx(g_files[handle].record->inodeNumber);
+        free(*table);
+        free(*dirty);
+        *table = NULL;
+        *dirty = NULL;
+        g_fs->readOnly = 1;
 
-            while( (inode->bytesFileSize + size) > (inode->blocksFileSize * SECTOR_SIZE * g_sb->blockSize) )
-            {
-                if ( __block_alocate(inode, g_files[handle].record->inodeNumber) != OP_SUCCESS )
-                {
-                    return OP_ERROR;
-                }
-            }
+        return OP_ERROR;
+    }
 
-            if( __inode_write_bytes(g_files[handle].pointer, buffer, size, inode) != OP_SUCCESS )
-            {
-                return OP_ERROR;
-            }
+    *loaded = 1;
 
-            int newFileSize = ((size + g_files[handle].pointer) - inode->bytesFileSize);
+    return OP_SUCCESS;
+}
 
-            if( newFileSize > 0 )
-            {
-                inode->bytesFileSize += (size + g_files[handle].pointer) - inode->bytesFileSize;
-            }
+/*-----------------------------------------------------------------------------
+Função: Lê o diretório de uma tabela paginada, se ainda não foi lido (ver __table_load)
 
-            g_files[handle].pointer += size;
+Entra:
+    table -> tabela
+    firstBlock -> primeiro bloco do diretório no disco
+    numBlocks -> número de blocos do diretório (0 se o disco não possui a tabela)
 
-            __inode_write(inode, g_files[handle].record->inodeNumber);
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __paged_load(PAGED_TABLE *table, DWORD firstBlock, DWORD numBlocks)
+{
+    return __table_load(&table->loaded, &table->dir, &table->dirDirty, firstBlock, numBlocks);
+}
 
-            return size;
-        }
-    }
+/*-----------------------------------------------------------------------------
+Função: Lê o diretório da tabela de contadores de referência, se ainda não foi lido
 
-    return OP_ERROR;
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __refcount_load()
+{
+    return __paged_load(&g_fs->refcount, g_fs->sbe->refcountBlock, g_fs->sbe->refcountSize);
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Função usada para truncar um arquivo.
-	Remove do arquivo todos os bytes a partir da posição atual do contador de posição (CP)
-	Todos os bytes a partir da posição CP (inclusive) serão removidos do arquivo.
-	Após a operação, o arquivo deverá contar com CP bytes e o ponteiro estará no final do arquivo
+Função: Lê o diretório da tabela de checksums, se ainda não foi lido
 
-Entra:	handle -> identificador do arquivo a ser truncado
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __checksum_load()
+{
+    return __paged_load(&g_fs->checksum, g_fs->sbe->checksumBlock, g_fs->sbe->checksumSize);
+}
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-	Em caso de erro, será retornado um valor diferente de zero.
+/*-----------------------------------------------------------------------------
+Função: Lê o diretório da tabela de impressões digitais, se ainda não foi lido. O
+        índice de deduplicação é montado à parte (ver __dedup_index_build).
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int truncate2 (FILE2 handle)
+int __dedup_load()
 {
-    if( !g_initialized )
-    {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
-    }
+    return __paged_load(&g_fs->dedup, g_fs->sbe->dedupBlock, g_fs->sbe->dedupSize);
+}
 
-    if( handle >= 0 )
-    {
-        if( !(g_files[handle].free || g_files[handle].record == NULL) )
-        {
-            struct t2fs_inode *inode = __inode_get_by_idx(g_files[handle].record->inodeNumber);
+/*-----------------------------------------------------------------------------
+Função: Cria uma tabela de DWORDs zerada num trecho contíguo de blocos livres
 
-            int i;
-            int start = (g_files[handle].pointer / (g_sb->blockSize * SECTOR_SIZE)) + 2;
-            int end = inode->blocksFileSize;
+Entra:
+    table -> onde colocar a tabela
+    dirty -> onde colocar os indicadores de setores alterados
+    firstBlock -> onde colocar o primeiro bloco da tabela no disco
+    numBlocks -> onde colocar o número de blocos da tabela no disco
+    numEntries -> número de entradas da tabela
 
-            for( i = start; i <= end; i++ )
-            {
-                if( __inode_remove_block(inode, g_files[handle].record->inodeNumber, __block_get_by_idx(i, inode)) != OP_SUCCESS )
-                {
-                    return OP_ERROR;
-                }
-            }
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __table_create(DWORD **table, BYTE **dirty, DWORD *firstBlock, DWORD *numBlocks, DWORD numEntries)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD size = (numEntries * sizeof(DWORD) + blockBytes - 1) / blockBytes;
+    DWORD bit, run = 0;
 
-            int size = (g_sb->blockSize * SECTOR_SIZE) - (g_files[handle].pointer % (g_sb->blockSize * SECTOR_SIZE));
-            char *buffer = (char*) calloc(size, sizeof(char));
+    for( bit = 1; bit < g_fs->sb->diskSize && run < size; bit++ )
+    {
+        run = __bitmap_is_free(BITMAP_DADOS, bit, g_fs->sb->diskSize) ? run + 1 : 0;
+    }
 
-            if( __inode_write_bytes(g_files[handle].pointer, buffer, size, inode) == OP_SUCCESS )
-            {
-                inode->bytesFileSize = g_files[handle].pointer;
-            }
+    if( run < size )
+    {
+        return OP_ERROR;
+    }
 
-            return __inode_write(inode, g_files[handle].record->inodeNumber);
-        }
+    *firstBlock = bit - size;
+    *numBlocks = size;
+
+    for( bit = *firstBlock; bit < *firstBlock + size; bit++ )
+    {
+        __bitmap_set(BITMAP_DADOS, bit, 1);
+        __block_init(bit, 0);
     }
 
-    return OP_ERROR;
+    __table_alloc(table, dirty, size);
+
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Reposiciona o contador de posições (current pointer) do arquivo identificado por "handle".
-	A nova posição é determinada pelo parâmetro "offset".
-	O parâmetro "offset" corresponde ao deslocamento, em bytes, contados a partir do início do arquivo.
-	Se o valor de "offset" for "-1", o current_pointer deverá ser posicionado no byte seguinte ao final do arquivo,
-		Isso é útil para permitir que novos dados sejam adicionados no final de um arquivo já existente.
+Função: Cria uma tabela paginada, se ainda não existe. Apenas o diretório das páginas
+        é criado (as páginas são criadas na primeira entrada diferente de zero do seu
+        trecho); a posição do diretório é registrada na extensão do superbloco.
 
-Entra:	handle -> identificador do arquivo a ser escrito
-	offset -> deslocamento, em bytes, onde posicionar o "current pointer".
+Entra:
+    table -> tabela
+    firstBlock -> primeiro bloco do diretório no disco (é atualizado)
+    numBlocks -> número de blocos do diretório no disco (é atualizado)
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-	Em caso de erro, será retornado um valor diferente de zero.
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int seek2 (FILE2 handle, DWORD offset)
+int __paged_create(PAGED_TABLE *table, DWORD *firstBlock, DWORD *numBlocks)
 {
-    if( !g_initialized )
+    if( __paged_load(table, *firstBlock, *numBlocks) != OP_SUCCESS )
     {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
+        return OP_ERROR;
     }
 
-    if( handle >= 0 )
+    if( table->dir != NULL )
     {
-        if( !(g_files[handle].free || g_files[handle].record == NULL) )
-        {
-            if( offset != -1 )
-            {
-                g_files[handle].pointer = offset;
-            }
-            else
-            {
-                g_files[handle].pointer = __inode_get_by_idx(g_files[handle].record->inodeNumber)->bytesFileSize;
-            }
-
-            return OP_SUCCESS;
-        }
+        return OP_SUCCESS;
     }
 
-    return OP_ERROR;
+    return __table_create(&table->dir, &table->dirDirty, firstBlock, numBlocks, g_fs->tablePageCount);
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Criar um novo diretório.
-	O caminho desse novo diretório é aquele informado pelo parâmetro "pathname".
-		O caminho pode ser ser absoluto ou relativo.
-	São considerados erros de criação quaisquer situações em que o diretório não possa ser criado.
-		Isso inclui a existência de um arquivo ou diretório com o mesmo "pathname".
+Função: Descarta uma tabela paginada: os blocos do diretório e das páginas são
+        liberados e a extensão do superbloco deixa de declarar a tabela
 
-Entra:	pathname -> caminho do diretório a ser criado
+Entra:
+    table -> tabela
+    firstBlock -> primeiro bloco do diretório no disco (é zerado)
+    numBlocks -> número de blocos do diretório no disco (é zerado)
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-	Em caso de erro, será retornado um valor diferente de zero.
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int mkdir2 (char *pathname)
+int __paged_discard(PAGED_TABLE *table, DWORD *firstBlock, DWORD *numBlocks)
 {
-    if( !g_initialized )
+    DWORD page, b;
+
+    if( __paged_load(table, *firstBlock, *numBlocks) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    for( page = 0; table->dir != NULL && page < g_fs->tablePageCount; page++ )
     {
-        if( __init() != 0 )
+        if( table->dir[page] != 0 && table->dir[page] < g_fs->sb->diskSize )
         {
-            return OP_ERROR;
+            __bitmap_set(BITMAP_DADOS, table->dir[page], 0);
         }
     }
 
-    return __record_create(pathname, TYPEVAL_DIRETORIO);
+    for( b = *firstBlock; table->dir != NULL && b < *firstBlock + *numBlocks; b++ )
+    {
+        __bitmap_set(BITMAP_DADOS, b, 0);
+    }
+
+    __paged_free(table, g_fs->tablePageCount);
+    table->loaded = 1;
+    *firstBlock = 0;
+    *numBlocks = 0;
+
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Apagar um subdiretório do disco.
-	O caminho do diretório a ser apagado é aquele informado pelo parâmetro "pathname".
-	São considerados erros quaisquer situações que impeçam a operação.
-		Isso inclui:
-			(a) o diretório a ser removido não está vazio;
-			(b) "pathname" não existente;
-			(c) algum dos componentes do "pathname" não existe (caminho inválido);
-			(d) o "pathname" indicado não é um arquivo;
+Função: Cria a tabela de contadores de referência, se ainda não existe (ver __paged_create)
 
-Entra:	pathname -> caminho do diretório a ser criado
-
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-	Em caso de erro, será retornado um valor diferente de zero.
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int rmdir2 (char *pathname)
+int __refcount_create()
 {
-    if( !g_initialized )
-    {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
-    }
-
-    return __record_delete(pathname, TYPEVAL_DIRETORIO);
+    return __paged_create(&g_fs->refcount, &g_fs->sbe->refcountBlock, &g_fs->sbe->refcountSize);
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Altera o diretório atual de trabalho (working directory).
-		O caminho desse diretório é informado no parâmetro "pathname".
-		São considerados erros:
-			(a) qualquer situação que impeça a realização da operação
-			(b) não existência do "pathname" informado.
+Função: Informa quantos setores o bloco de dados comprimido ocupa
 
-Entra:	pathname -> caminho do novo diretório de trabalho.
+Entra:
+    blockNumber -> número do bloco
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-		Em caso de erro, será retornado um valor diferente de zero.
+Saída:
+    Número de setores ocupados (0 se o bloco está sem compressão).
 -----------------------------------------------------------------------------*/
-int chdir2 (char *pathname)
+DWORD __block_zsectors(DWORD blockNumber)
 {
-    if( !g_initialized )
+    DWORD value = __refcount_value(blockNumber);
+
+    if( (value & REFCOUNT_FRAGMENT) != 0 )
     {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
+        return 0;
     }
 
-    char* parsedPath = parse_path(pathname, g_cwd);
-
-    if( parsedPath != NULL )
-    {
-        struct t2fs_record *record = __record_navigate(parsedPath);
+    return (value & REFCOUNT_ZSECTORS) >> REFCOUNT_ZSHIFT;
+}
 
-        if( record != NULL )
-        {
-            if( record->TypeVal == TYPEVAL_DIRETORIO )
-            {
-                g_cwd = parsedPath;
-                g_cwd_record = record;
+/*-----------------------------------------------------------------------------
+Função: Informa se o bloco é um bloco de fragmentos (ver __fragment_alloc)
 
-                return OP_SUCCESS;
-            }
-        }
-    }
+Entra:
+    blockNumber -> número do bloco
 
-    return OP_ERROR;
+Saída:
+    Se verdadeiro, retorna 1
+    Se falso 0.
+-----------------------------------------------------------------------------*/
+int __block_is_fragment(DWORD blockNumber)
+{
+    return (__refcount_value(blockNumber) & REFCOUNT_FRAGMENT) != 0;
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Informa o diretório atual de trabalho.
-		O "pathname" do diretório de trabalho deve ser copiado para o buffer indicado por "pathname".
-			Essa cópia não pode exceder o tamanho do buffer, informado pelo parâmetro "size".
-		São considerados erros:
-			(a) quaisquer situações que impeçam a realização da operação
-			(b) espaço insuficiente no buffer "pathname", cujo tamanho está informado por "size".
-
-Entra:	pathname -> buffer para onde copiar o pathname do diretório de trabalho
-		size -> tamanho do buffer pathname
+Função: Descarta a cópia do bloco guardada em g_fs->dataCache, se houver
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-		Em caso de erro, será retornado um valor diferente de zero.
+Entra:
+    blockNumber -> número do bloco
 -----------------------------------------------------------------------------*/
-int getcwd2 (char *pathname, int size)
+void __data_cache_drop(DWORD blockNumber)
 {
-    if( !g_initialized )
+    if( blockNumber == g_fs->dataCacheBlock )
     {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
+        g_fs->dataCacheBlock = INVALID_PTR;
     }
+}
 
-    if( size >= strlen(g_cwd) )
-    {
-        strncpy(pathname, g_cwd, strlen(g_cwd));
+/*-----------------------------------------------------------------------------
+Função: Registra quantos setores o bloco de dados comprimido ocupa, mantendo o seu
+        contador de referências
 
-        pathname[strlen(g_cwd)] = '\0';
+Entra:
+    blockNumber -> número do bloco
+    numSectors -> número de setores (0 se o bloco está sem compressão)
 
-        return OP_SUCCESS;
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro (sem espaço para a página da tabela), retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __block_set_zsectors(DWORD blockNumber, DWORD numSectors)
+{
+    __data_cache_drop(blockNumber);
+
+    if( __block_zsectors(blockNumber) != numSectors )
+    {
+        return __refcount_set(blockNumber, __refcount_get(blockNumber) | (numSectors << REFCOUNT_ZSHIFT));
     }
 
-    return OP_ERROR;
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Abre um diretório existente no disco.
-	O caminho desse diretório é aquele informado pelo parâmetro "pathname".
-	Se a operação foi realizada com sucesso, a função:
-		(a) deve retornar o identificador (handle) do diretório
-		(b) deve posicionar o ponteiro de entradas (current entry) na primeira posição válida do diretório "pathname".
-	O handle retornado será usado em chamadas posteriores do sistema de arquivo para fins de manipulação do diretório.
+Função: Informa o checksum registrado para o bloco
 
-Entra:	pathname -> caminho do diretório a ser aberto
+Entra:
+    blockNumber -> número do bloco
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna o identificador do diretório (handle).
-	Em caso de erro, será retornado um valor negativo.
+Saída:
+    O CRC32C do conteúdo gravado no bloco (0 se o bloco não tem checksum).
 -----------------------------------------------------------------------------*/
-DIR2 opendir2 (char *pathname)
+DWORD __checksum_get(DWORD blockNumber)
 {
-    if( !g_initialized )
+    if( !(g_fs->sbe->features & SB_FEATURE_CHECKSUM) || __checksum_load() != OP_SUCCESS )
     {
-        if( __init() != 0 )
-        {
-            return OP_ERROR;
-        }
+        return 0;
     }
 
-    return __handler_alocate(pathname, TYPEVAL_DIRETORIO);
+    return __paged_get(&g_fs->checksum, blockNumber);
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Realiza a leitura das entradas do diretório identificado por "handle".
-	A cada chamada da função é lida a entrada seguinte do diretório representado pelo identificador "handle".
-	Algumas das informações dessas entradas devem ser colocadas no parâmetro "dentry".
-	Após realizada a leitura de uma entrada, o ponteiro de entradas (current entry) deve ser ajustado para a próxima entrada válida, seguinte à última lida.
-	São considerados erros:
-		(a) qualquer situação que impeça a realização da operação
-		(b) término das entradas válidas do diretório identificado por "handle".
+Função: Verifica se o bloco de dados é lido diretamente do disco: não é um bloco de
+        fragmentos e não está comprimido. O checksum, se houver, é conferido pelo
+        chamador sobre os bytes lidos (ver __inode_read_bytes).
 
-Entra:	handle -> identificador do diretório cujas entradas deseja-se ler.
-	dentry -> estrutura de dados onde a função coloca as informações da entrada lida.
+Entra:
+    blockNumber -> número do bloco
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero)
-	Em caso de erro, será retornado um valor diferente de zero ( e "dentry" não será válido).
+Saída:
+    Se o bloco é lido diretamente, retorna 1
+    Caso contrário, retorna 0.
 -----------------------------------------------------------------------------*/
-int readdir2 (DIR2 handle, DIRENT2 *dentry)
+int __block_is_plain(DWORD blockNumber)
+{
+    return !__block_is_fragment(blockNumber) && __block_zsectors(blockNumber) == 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Registra o checksum do bloco. O setor alterado da tabela só é escrito no
+        disco ao fim da operação (ver __paged_flush). Com os checksums desligados a
+        tabela não existe e nada é registrado.
+
+Entra:
+    blockNumber -> número do bloco
+    checksum -> CRC32C do conteúdo gravado (0 para deixar o bloco sem checksum)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro (sem espaço para a página da tabela), retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __checksum_set(DWORD blockNumber, DWORD checksum)
+{
+    if( !(g_fs->sbe->features & SB_FEATURE_CHECKSUM) )
+    {
+        return OP_SUCCESS;
+    }
+
+    if( __checksum_load() != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return __paged_set(&g_fs->checksum, blockNumber, checksum);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Garante que a página da entrada do bloco na tabela de checksums existe, para
+        que o checksum possa ser registrado depois da gravação do bloco
+
+Entra:
+    blockNumber -> número do bloco
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __checksum_reserve(DWORD blockNumber)
+{
+    if( !(g_fs->sbe->features & SB_FEATURE_CHECKSUM) )
+    {
+        return OP_SUCCESS;
+    }
+
+    if( __checksum_load() != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return __paged_entry(&g_fs->checksum, blockNumber, 1) != NULL ? OP_SUCCESS : OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula o checksum de um bloco (nunca 0, que indica um bloco sem checksum)
+
+Entra:
+    data -> bytes do bloco (o bloco inteiro ou os setores comprimidos)
+    size -> número de bytes
+
+Saída:
+    O checksum dos bytes.
+-----------------------------------------------------------------------------*/
+DWORD __checksum_of(BYTE *data, DWORD size)
+{
+    DWORD crc = crc32c(0, data, size);
+
+    return crc != 0 ? crc : 1;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Atualiza o checksum do bloco após a gravação do seu conteúdo (a página da
+        entrada já deve existir, ver __checksum_reserve)
+
+Entra:
+    blockNumber -> número do bloco
+    data -> bytes gravados no bloco (o bloco inteiro ou os setores comprimidos)
+    size -> número de bytes gravados
+-----------------------------------------------------------------------------*/
+void __checksum_update(DWORD blockNumber, BYTE *data, DWORD size)
+{
+    if( g_fs->sbe->features & SB_FEATURE_CHECKSUM )
+    {
+        __checksum_set(blockNumber, __checksum_of(data, size));
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Confere os bytes lidos de um bloco com o checksum registrado
+
+Entra:
+    blockNumber -> número do bloco
+    data -> bytes lidos do bloco (o bloco inteiro ou os setores comprimidos)
+    size -> número de bytes lidos
+
+Saída:
+    Se o bloco não tem checksum ou o conteúdo confere, retorna OP_SUCCESS
+    Se o conteúdo está corrompido, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __checksum_verify(DWORD blockNumber, BYTE *data, DWORD size)
+{
+    DWORD expected = __checksum_get(blockNumber);
+
+    if( expected != 0 && __checksum_of(data, size) != expected )
+    {
+        return OP_ERROR;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula a impressão digital do conteúdo de um bloco (nunca 0, que indica um
+        bloco fora do índice)
+
+Entra:
+    data -> conteúdo do bloco (descomprimido)
+
+Saída:
+    A impressão digital do bloco.
+-----------------------------------------------------------------------------*/
+DWORD __dedup_fingerprint(BYTE *data)
+{
+    DWORD fingerprint = crc32c(0, data, g_fs->sb->blockSize * SECTOR_SIZE);
+
+    return fingerprint != 0 ? fingerprint : 1;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa a impressão digital registrada para o bloco
+
+Entra:
+    blockNumber -> número do bloco
+
+Saída:
+    A impressão digital do bloco (0 se o bloco está fora do índice).
+-----------------------------------------------------------------------------*/
+DWORD __dedup_get(DWORD blockNumber)
+{
+    if( !(g_fs->sbe->features & SB_FEATURE_DEDUP) || __dedup_load() != OP_SUCCESS )
+    {
+        return 0;
+    }
+
+    return __paged_get(&g_fs->dedup, blockNumber);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Coloca o bloco no índice de deduplicação. A impressão é registrada na tabela
+        e, se o índice em memória já foi montado, o bloco entra no seu balde.
+
+Entra:
+    blockNumber -> número do bloco
+    fingerprint -> impressão digital do conteúdo gravado no bloco
+-----------------------------------------------------------------------------*/
+void __dedup_insert(DWORD blockNumber, DWORD fingerprint)
+{
+    DWORD bucket;
+
+    if( __dedup_get(blockNumber) != 0 || __paged_set(&g_fs->dedup, blockNumber, fingerprint) != OP_SUCCESS )
+    {
+        return;
+    }
+
+    if( g_fs->dedupHead != NULL )
+    {
+        bucket = fingerprint & (g_fs->dedupBuckets - 1);
+        g_fs->dedupNext[blockNumber] = g_fs->dedupHead[bucket];
+        g_fs->dedupHead[bucket] = blockNumber;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Retira o bloco do índice de deduplicação (o seu conteúdo vai mudar ou o
+        bloco foi liberado)
+
+Entra:
+    blockNumber -> número do bloco
+-----------------------------------------------------------------------------*/
+void __dedup_remove(DWORD blockNumber)
 {
-    if( !g_initialized )
+    DWORD fingerprint = __dedup_get(blockNumber);
+    DWORD *link;
+
+    if( fingerprint == 0 )
     {
-        if( __init() != 0 )
+        return;
+    }
+
+    if( g_fs->dedupHead != NULL )
+    {
+        link = &g_fs->dedupHead[fingerprint & (g_fs->dedupBuckets - 1)];
+
+        while( *link != 0 && *link != blockNumber )
         {
-            return OP_ERROR;
+            link = &g_fs->dedupNext[*link];
+        }
+
+        if( *link == blockNumber )
+        {
+            *link = g_fs->dedupNext[blockNumber];
         }
     }
 
-    if( handle >= 0 )
+    __paged_set(&g_fs->dedup, blockNumber, 0);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Monta o índice de deduplicação em memória a partir das páginas existentes da
+        tabela de impressões digitais, se ainda não foi montado. Só a escrita deduplicada
+        precisa do índice (ver __dedup_find). Entradas de blocos livres (restos de uma
+        interrupção) são descartadas.
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __dedup_index_build()
+{
+    DWORD entries = __paged_page_entries();
+    DWORD page, j, blockNumber, fingerprint, *entry;
+
+    if( g_fs->dedupHead != NULL || !(g_fs->sbe->features & SB_FEATURE_DEDUP) )
     {
-        if( !(g_dirs[handle].free || g_dirs[handle].record == NULL) )
-        {
-            struct t2fs_record *record;
-            struct t2fs_inode *inode = __inode_get_by_idx(g_dirs[handle].record->inodeNumber);
+        return OP_SUCCESS;
+    }
 
-            record = __record_get_by_idx(g_dirs[handle].pointer, inode);
+    if( __dedup_load() != OP_SUCCESS || g_fs->dedup.dir == NULL )
+    {
+        return OP_ERROR;
+    }
 
-            if( record != NULL )
-            {
-                while( record->TypeVal == TYPEVAL_INVALIDO )
-                {
-                    g_dirs[handle].pointer += 1;
-                    record = __record_get_by_idx(g_dirs[handle].pointer, inode);
+    for( g_fs->dedupBuckets = 1; g_fs->dedupBuckets < g_fs->sb->diskSize; g_fs->dedupBuckets <<= 1 );
 
-                    if( record == NULL )
-                    {
-                        break;
-                    }
-                }
+    g_fs->dedupHead = (DWORD*)calloc(g_fs->dedupBuckets, sizeof(DWORD));
+    g_fs->dedupNext = (DWORD*)calloc(g_fs->sb->diskSize, sizeof(DWORD));
 
-                if( record != NULL )
-                {
-                    if( record->TypeVal == TYPEVAL_REGULAR || record->TypeVal == TYPEVAL_DIRETORIO )
-                    {
-                        strcpy(dentry->name, record->name);
-                        dentry->fileType = record->TypeVal;
-                        dentry->fileSize = (__inode_get_by_idx(record->inodeNumber))->bytesFileSize;
+    for( page = 0; g_fs->dedupHead != NULL && g_fs->dedupNext != NULL && page < g_fs->tablePageCount; page++ )
+    {
+        if( g_fs->dedup.dir[page] == 0 )
+        {
+            continue;
+        }
 
-                        g_dirs[handle].pointer += 1;
+        // Página que não pôde ser lida: o sistema de arquivos já ficou sem alterações
+        if( (entry = __paged_entry(&g_fs->dedup, page * entries, 0)) == NULL )
+        {
+            break;
+        }
 
-                        return OP_SUCCESS;
-                    }
-                }
+        for( j = 0; j < entries && page * entries + j < g_fs->sb->diskSize; j++ )
+        {
+            blockNumber = page * entries + j;
+            fingerprint = entry[j];
+
+            if( fingerprint == 0 )
+            {
+                continue;
             }
 
-            g_dirs[handle].pointer = 0;
+            if( !__bitmap_is_free(BITMAP_DADOS, blockNumber, g_fs->sb->diskSize) && !__block_is_fragment(blockNumber) )
+            {
+                g_fs->dedupNext[blockNumber] = g_fs->dedupHead[fingerprint & (g_fs->dedupBuckets - 1)];
+                g_fs->dedupHead[fingerprint & (g_fs->dedupBuckets - 1)] = blockNumber;
+            }
+            else
+            {
+                __paged_set(&g_fs->dedup, blockNumber, 0);
+            }
         }
     }
 
-    return OP_ERROR;
+    if( g_fs->dedupHead == NULL || g_fs->dedupNext == NULL || page < g_fs->tablePageCount )
+    {
+        free(g_fs->dedupHead);
+        free(g_fs->dedupNext);
+        g_fs->dedupHead = NULL;
+        g_fs->dedupNext = NULL;
+
+        return OP_ERROR;
+    }
+
+    return OP_SUCCESS;
 }
 
 /*-----------------------------------------------------------------------------
-Função:	Fecha o diretório identificado pelo parâmetro "handle".
+Função: Descarta os dados associados ao conteúdo de um bloco de dados liberado
+        (setores comprimidos, checksum, impressão digital e cópia em g_fs->dataCache)
 
-Entra:	handle -> identificador do diretório que se deseja fechar (encerrar a operação).
+Entra:
+    blockNumber -> número do bloco
+-----------------------------------------------------------------------------*/
+void __block_forget(DWORD blockNumber)
+{
+    __block_set_zsectors(blockNumber, 0);
+    __checksum_set(blockNumber, 0);
+    __dedup_remove(blockNumber);
+}
 
-Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
-	Em caso de erro, será retornado um valor diferente de zero.
+/*-----------------------------------------------------------------------------
+Função: Lê o conteúdo de um bloco de dados, conferindo o seu checksum e
+        descomprimindo-o se necessário
+
+Entra:
+    blockNumber -> número do bloco
+    buffer -> buffer com o tamanho de um bloco
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro (inclusive checksum que não confere), retorna OP_ERROR.
 -----------------------------------------------------------------------------*/
-int closedir2 (DIR2 handle)
+int __block_read_data(DWORD blockNumber, BYTE *buffer)
 {
-    if( !g_initialized )
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD numSectors;
+    BYTE *compressed;
+    DWORD i;
+    int result = OP_SUCCESS;
+
+    // Sem o diretório dos contadores (ou, com checksums, o da tabela de checksums) um bloco
+    // comprimido ou com checksum seria lido como um bloco comum
+    if( __refcount_load() != OP_SUCCESS ||
+        ((g_fs->sbe->features & SB_FEATURE_CHECKSUM) && __checksum_load() != OP_SUCCESS) )
+    {
+        return OP_ERROR;
+    }
+
+    numSectors = __block_zsectors(blockNumber);
+
+    if( numSectors == 0 && __checksum_get(blockNumber) == 0 )
+    {
+        return __block_read(blockNumber, buffer);
+    }
+
+    if( blockNumber == g_fs->dataCacheBlock )
+    {
+        memcpy(buffer, g_fs->dataCache, blockBytes);
+
+        return OP_SUCCESS;
+    }
+
+    if( numSectors == 0 )
     {
-        if( __init() != 0 )
+        result = __block_read(blockNumber, buffer);
+
+        if( result == OP_SUCCESS )
         {
-            return OP_ERROR;
+            result = __checksum_verify(blockNumber, buffer, blockBytes);
         }
     }
+    else
+    {
+        compressed = (BYTE*)malloc(numSectors * SECTOR_SIZE);
 
-    return __handler_free(handle, TYPEVAL_DIRETORIO);
+        for( i = 0; i < numSectors && result == OP_SUCCESS; i++ )
+        {
+            result = __disk_read(__block_get_sector(blockNumber) + i, compressed + i * SECTOR_SIZE) == OP_SUCCESS ? OP_SUCCESS : OP_ERROR;
+        }
+
+        if( result == OP_SUCCESS )
+        {
+            result = __checksum_verify(blockNumber, compressed, numSectors * SECTOR_SIZE);
+        }
+
+        if( result == OP_SUCCESS && lz_decompress(compressed, numSectors * SECTOR_SIZE, buffer, blockBytes) != 0 )
+        {
+            result = OP_ERROR;
+        }
+
+        free(compressed);
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        if( g_fs->dataCache == NULL )
+        {
+            g_fs->dataCache = (BYTE*)malloc(blockBytes);
+        }
+
+        memcpy(g_fs->dataCache, buffer, blockBytes);
+        g_fs->dataCacheBlock = blockNumber;
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Grava o conteúdo de um bloco de dados e atualiza o seu checksum. Com
+        compressão, o bloco é comprimido e apenas os setores necessários são escritos;
+        um bloco que não economiza ao menos um setor é gravado sem compressão.
+
+Entra:
+    blockNumber -> número do bloco
+    buffer -> conteúdo do bloco
+    compress -> flag indicando se o bloco deve ser comprimido
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __block_write_data(DWORD blockNumber, BYTE *buffer, int compress)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD numSectors = 0;
+    BYTE *compressed = NULL;
+    DWORD i;
+    int length, result = OP_SUCCESS;
+
+    // A página do checksum é criada antes: um bloco gravado sem o seu checksum seria lido sem verificação
+    if( __checksum_reserve(blockNumber) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    // A impressão digital do conteúdo anterior não vale mais (ver __inode_store_dedup)
+    __dedup_remove(blockNumber);
+
+    // A página da entrada do bloco é criada antes: um bloco comprimido sem registro seria lido errado
+    if( compress && __refcount_load() == OP_SUCCESS && g_fs->refcount.dir != NULL && g_fs->sb->blockSize <= (REFCOUNT_ZSECTORS >> REFCOUNT_ZSHIFT) &&
+        __refcount_reserve(blockNumber) == OP_SUCCESS )
+    {
+        compressed = (BYTE*)malloc(blockBytes);
+        length = lz_compress(buffer, blockBytes, compressed, blockBytes - SECTOR_SIZE);
+        numSectors = (length + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        memset(compressed + length, 0, numSectors * SECTOR_SIZE - length);
+    }
+
+    if( numSectors == 0 )
+    {
+        result = __block_write(blockNumber, buffer);
+    }
+
+    for( i = 0; i < numSectors && result == OP_SUCCESS; i++ )
+    {
+        result = __disk_write(__block_get_sector(blockNumber) + i, compressed + i * SECTOR_SIZE) == OP_SUCCESS ? OP_SUCCESS : OP_ERROR;
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        __block_set_zsectors(blockNumber, numSectors);
+        __checksum_update(blockNumber, numSectors > 0 ? compressed : buffer, numSectors > 0 ? numSectors * SECTOR_SIZE : blockBytes);
+    }
+    else
+    {
+        __block_forget(blockNumber);
+    }
+
+    free(compressed);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Procura no índice de deduplicação um bloco com o conteúdo informado. Os
+        candidatos com a mesma impressão digital são conferidos byte a byte.
+
+Entra:
+    data -> conteúdo procurado (um bloco inteiro)
+    fingerprint -> impressão digital de 'data'
+
+Saída:
+    Se encontrou, retorna o número do bloco
+    Se não encontrou, retorna INVALID_PTR.
+-----------------------------------------------------------------------------*/
+DWORD __dedup_find(BYTE *data, DWORD fingerprint)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD blockNumber, result = INVALID_PTR;
+    BYTE *buffer;
+
+    // O índice é montado na primeira escrita deduplicada
+    if( __dedup_index_build() != OP_SUCCESS || g_fs->dedupHead == NULL )
+    {
+        return INVALID_PTR;
+    }
+
+    buffer = (BYTE*)malloc(blockBytes);
+
+    for( blockNumber = g_fs->dedupHead[fingerprint & (g_fs->dedupBuckets - 1)]; blockNumber != 0 && result == INVALID_PTR; blockNumber = g_fs->dedupNext[blockNumber] )
+    {
+        // Um bloco com o contador de referências no limite não pode ganhar outra
+        if( __dedup_get(blockNumber) != fingerprint || __refcount_get(blockNumber) >= REFCOUNT_COUNT )
+        {
+            continue;
+        }
+
+        if( __block_read_data(blockNumber, buffer) == OP_SUCCESS && memcmp(buffer, data, blockBytes) == 0 )
+        {
+            result = blockNumber;
+        }
+        else
+        {
+            g_fs->dedupFalseMatches++;
+        }
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Reserva 'numSectors' setores contíguos num bloco de fragmentos, que guarda o
+        conteúdo de vários arquivos pequenos. O contador de referências de um bloco de
+        fragmentos tem REFCOUNT_FRAGMENT ligado e um bit por setor ocupado. Os setores
+        reservados não são inicializados: quem os reserva deve escrevê-los inteiros.
+
+Entra:
+    numSectors -> número de setores (menor que o número de setores de um bloco)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o primeiro setor reservado
+    Se ocorreu algum erro, retorna INVALID_PTR.
+-----------------------------------------------------------------------------*/
+DWORD __fragment_alloc(DWORD numSectors)
+{
+    DWORD mask = (1u << numSectors) - 1;
+    DWORD blockNumber, i, j, *entry;
+    int newBlock;
+
+    if( numSectors == 0 || numSectors >= g_fs->sb->blockSize || g_fs->sb->blockSize >= 32 || __refcount_create() != OP_SUCCESS )
+    {
+        return INVALID_PTR;
+    }
+
+    for( i = 0; i < g_fs->sb->diskSize; i++ )
+    {
+        blockNumber = (g_fs->sbe->fragmentHint + i) % g_fs->sb->diskSize;
+
+        // Trecho sem página: nenhum bloco de fragmentos até o fim da página
+        if( (entry = __refcount_entry(blockNumber, 0)) == NULL )
+        {
+            i += __paged_page_entries() - 1 - blockNumber % __paged_page_entries();
+            continue;
+        }
+
+        if( (*entry & REFCOUNT_FRAGMENT) == 0 )
+        {
+            continue;
+        }
+
+        for( j = 0; j + numSectors <= g_fs->sb->blockSize; j++ )
+        {
+            if( (*entry & (mask << j)) == 0 )
+            {
+                __refcount_set(blockNumber, *entry | (mask << j));
+                g_fs->sbe->fragmentHint = blockNumber;
+
+                return __block_get_sector(blockNumber) + j;
+            }
+        }
+    }
+
+    newBlock = __bitmap_search_from(BITMAP_DADOS, 0);
+
+    if( newBlock <= 0 )
+    {
+        return INVALID_PTR;
+    }
+
+    __bitmap_set(BITMAP_DADOS, newBlock, 1);
+
+    if( __refcount_set(newBlock, REFCOUNT_FRAGMENT | mask) != OP_SUCCESS )
+    {
+        __bitmap_set(BITMAP_DADOS, newBlock, 0);
+
+        return INVALID_PTR;
+    }
+
+    g_fs->sbe->fragmentHint = newBlock;
+
+    return __block_get_sector(newBlock);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Libera setores reservados por __fragment_alloc. O bloco de fragmentos é
+        liberado quando não resta nenhum setor ocupado.
+
+Entra:
+    sector -> primeiro setor (INVALID_PTR é ignorado)
+    numSectors -> número de setores
+-----------------------------------------------------------------------------*/
+void __fragment_free(DWORD sector, DWORD numSectors)
+{
+    DWORD blockNumber, value;
+
+    if( sector == INVALID_PTR )
+    {
+        return;
+    }
+
+    blockNumber = sector / g_fs->sb->blockSize;
+    value = __refcount_value(blockNumber);
+
+    if( (value & REFCOUNT_FRAGMENT) == 0 )
+    {
+        return;
+    }
+
+    value &= ~(((1u << numSectors) - 1) << (sector % g_fs->sb->blockSize));
+
+    if( value == REFCOUNT_FRAGMENT )
+    {
+        __refcount_set(blockNumber, 0);
+        __bitmap_set(BITMAP_DADOS, blockNumber, 0);
+    }
+    else
+    {
+        __refcount_set(blockNumber, value);
+        g_fs->sbe->fragmentHint = blockNumber;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa se o conteúdo do inode fica inteiro num fragmento (arquivo embutido)
+
+Entra:
+    inode -> inode a ser verificado
+
+Saída:
+    Se verdadeiro, retorna 1
+    Se falso 0.
+-----------------------------------------------------------------------------*/
+int __inode_is_inline(struct t2fs_inode *inode)
+{
+    return (inode->reservado[INODE_FLAGS] & INODE_FLAG_INLINE) != 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa se o último bloco (parcial) do inode está guardado num fragmento
+
+Entra:
+    inode -> inode a ser verificado
+
+Saída:
+    Se verdadeiro, retorna 1
+    Se falso 0.
+-----------------------------------------------------------------------------*/
+int __inode_has_tail(struct t2fs_inode *inode)
+{
+    return (inode->reservado[INODE_FLAGS] & INODE_FLAG_TAIL) != 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula quantos setores o fragmento do inode ocupa
+
+Entra:
+    inode -> inode embutido ou com a cauda num fragmento
+
+Saída:
+    Número de setores do fragmento.
+-----------------------------------------------------------------------------*/
+DWORD __inode_fragment_sectors(struct t2fs_inode *inode)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+
+    if( __inode_is_inline(inode) )
+    {
+        return INLINE_DATA_SIZE / SECTOR_SIZE;
+    }
+
+    return ((inode->bytesFileSize % blockBytes) + SECTOR_SIZE - 1) / SECTOR_SIZE;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Copia um fragmento para setores recém reservados
+
+Entra:
+    sector -> primeiro setor do fragmento
+    numSectors -> número de setores
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o primeiro setor da cópia
+    Se ocorreu algum erro, retorna INVALID_PTR.
+-----------------------------------------------------------------------------*/
+DWORD __fragment_copy(DWORD sector, DWORD numSectors)
+{
+    BYTE buffer[SECTOR_SIZE];
+    DWORD copy = __fragment_alloc(numSectors);
+    DWORD i;
+
+    for( i = 0; i < numSectors && copy != INVALID_PTR; i++ )
+    {
+        if( __disk_read(sector + i, buffer) != OP_SUCCESS || __disk_write(copy + i, buffer) != OP_SUCCESS )
+        {
+            __fragment_free(copy, numSectors);
+            copy = INVALID_PTR;
+        }
+    }
+
+    return copy;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê o mapa de blocos do inode, lendo cada bloco de indireção uma única vez.
+        Buracos do arquivo aparecem no mapa como INVALID_PTR.
+
+Entra:
+    inode -> inode cujo mapa deve ser lido
+    blocks -> vetor com espaço para 'blocksFileSize' números de bloco (pode ser NULL)
+    indBlocks -> onde colocar o número de blocos de indireção em uso (pode ser NULL)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_map_read(struct t2fs_inode *inode, DWORD *blocks, DWORD *indBlocks)
+{
+    DWORD blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    BYTE *indBuffer = NULL, *listBuffer = NULL;
+    DWORD idxBlock, numIndBlocks = 0;
+    DWORD i, j;
+    int result = OP_SUCCESS;
+
+    for( idxBlock = 0; blocks != NULL && idxBlock < inode->blocksFileSize; idxBlock++ )
+    {
+        blocks[idxBlock] = idxBlock < 2 && __block_is_valid(inode->dataPtr[idxBlock]) ? inode->dataPtr[idxBlock] : INVALID_PTR;
+    }
+
+    if( __block_is_valid(inode->singleIndPtr) || __block_is_valid(inode->doubleIndPtr) )
+    {
+        indBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+        listBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+
+        if( __block_is_valid(inode->singleIndPtr) )
+        {
+            numIndBlocks++;
+
+            if( __block_read(inode->singleIndPtr, indBuffer) != OP_SUCCESS )
+            {
+                result = OP_ERROR;
+            }
+
+            for( i = 0; i < blockNumberPerBlock && 2 + i < inode->blocksFileSize && blocks != NULL && result == OP_SUCCESS; i++ )
+            {
+                DWORD blockNumber = buffer_to_dword(indBuffer, i * sizeof(DWORD));
+
+                blocks[2 + i] = __block_is_valid(blockNumber) ? blockNumber : INVALID_PTR;
+            }
+        }
+
+        if( __block_is_valid(inode->doubleIndPtr) && result == OP_SUCCESS )
+        {
+            numIndBlocks++;
+
+            if( __block_read(inode->doubleIndPtr, listBuffer) != OP_SUCCESS )
+            {
+                result = OP_ERROR;
+            }
+
+            for( j = 0; j < blockNumberPerBlock && result == OP_SUCCESS; j++ )
+            {
+                DWORD indBlockNumber = buffer_to_dword(listBuffer, j * sizeof(DWORD));
+                DWORD idxBase = 2 + blockNumberPerBlock + j * blockNumberPerBlock;
+
+                if( !__block_is_valid(indBlockNumber) )
+                {
+                    continue;
+                }
+
+                numIndBlocks++;
+
+                if( idxBase >= inode->blocksFileSize || blocks == NULL )
+                {
+                    continue;
+                }
+
+                if( __block_read(indBlockNumber, indBuffer) != OP_SUCCESS )
+                {
+                    result = OP_ERROR;
+                    break;
+                }
+
+                for( i = 0; i < blockNumberPerBlock && idxBase + i < inode->blocksFileSize; i++ )
+                {
+                    DWORD blockNumber = buffer_to_dword(indBuffer, i * sizeof(DWORD));
+
+                    blocks[idxBase + i] = __block_is_valid(blockNumber) ? blockNumber : INVALID_PTR;
+                }
+            }
+        }
+
+        free(indBuffer);
+        free(listBuffer);
+    }
+
+    if( indBlocks != NULL )
+    {
+        *indBlocks = numIndBlocks;
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Navega sequencialmente pelos registros até encontrar o registro apontado
+        por 'pointer', retornando o bloco onde este se encontra
+
+Entra:
+    pointer -> 'pointer'-ézimo item
+    size -> tamanho do 'pointer'-ézimo item
+    inode -> inode que contém os ponteiros para os blocos de dados
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o número do bloco
+    Se ocorreu algum erro, retorna INVALID_PTR.
+-----------------------------------------------------------------------------*/
+DWORD __block_navigate(DWORD pointer, int size, struct t2fs_inode *inode)
+{
+    int entryPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / size;
+    int entryBlock = pointer / entryPerBlock;
+
+    return __block_get_by_idx(entryBlock, inode);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula o setor que guarda o byte 'position' do inode
+
+Entra:
+    position -> posição, em bytes, no arquivo
+    inode -> inode do arquivo
+
+Saída:
+    Se a posição está num bloco (ou fragmento) alocado, retorna o setor
+    Se a posição está num buraco, retorna INVALID_PTR.
+-----------------------------------------------------------------------------*/
+DWORD __inode_get_data_sector(DWORD position, struct t2fs_inode *inode)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD blockNumber;
+
+    if( __inode_is_inline(inode) )
+    {
+        if( inode->reservado[INODE_FRAGMENT] == INVALID_PTR || position >= INLINE_DATA_SIZE )
+        {
+            return INVALID_PTR;
+        }
+
+        return inode->reservado[INODE_FRAGMENT] + position / SECTOR_SIZE;
+    }
+
+    if( __inode_has_tail(inode) && position / blockBytes == inode->bytesFileSize / blockBytes )
+    {
+        return inode->reservado[INODE_FRAGMENT] + (position % blockBytes) / SECTOR_SIZE;
+    }
+
+    blockNumber = __block_get_by_idx(position / blockBytes, inode);
+
+    if( blockNumber == INVALID_PTR )
+    {
+        return INVALID_PTR;
+    }
+
+    return __block_get_sector(blockNumber) + (position % blockBytes) / SECTOR_SIZE;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve 'size' bytes a partir da posição 'pointer' do inode. Todos os blocos
+        atingidos já devem estar alocados. Com checksums ligados, e nos blocos de um
+        arquivo comprimido (ou já gravados comprimidos), cada bloco é montado em memória
+        e regravado inteiro (ver __block_write_data).
+
+Entra:
+    pointer -> posição, em bytes, do início da escrita
+    buffer -> buffer a ser escrito
+    size -> tamanho do buffer a ser escrito
+    inode -> inode que contém as informações de onde escrever
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro (inclusive escrita num buraco), retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_write_bytes(DWORD pointer, char *buffer, int size, struct t2fs_inode *inode)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    int compress = (inode->reservado[INODE_FLAGS] & (INODE_FLAG_COMPRESSED | INODE_FLAG_INLINE | INODE_FLAG_TAIL)) == INODE_FLAG_COMPRESSED;
+    int checksum = (g_fs->sbe->features & SB_FEATURE_CHECKSUM) != 0;
+    BYTE readBuffer[SECTOR_SIZE];
+    BYTE *blockBuffer = NULL;
+    int idxBuffer = 0;
+    int result = OP_SUCCESS;
+
+    while( idxBuffer < size && result == OP_SUCCESS )
+    {
+        DWORD position = pointer + idxBuffer;
+        DWORD sector = __inode_get_data_sector(position, inode);
+        int idxSectorStart = position % SECTOR_SIZE;
+        int chunk = SECTOR_SIZE - idxSectorStart;
+
+        if( chunk > size - idxBuffer )
+        {
+            chunk = size - idxBuffer;
+        }
+
+        if( sector == INVALID_PTR )
+        {
+            result = OP_ERROR;
+            break;
+        }
+
+        // Fragmentos são gravados setor a setor, sem compressão nem checksum
+        if( !__block_is_fragment(sector / g_fs->sb->blockSize) &&
+            (compress || checksum || __block_zsectors(sector / g_fs->sb->blockSize) > 0) )
+        {
+            DWORD blockNumber = sector / g_fs->sb->blockSize;
+            int idxBlockStart = position % blockBytes;
+
+            chunk = blockBytes - idxBlockStart;
+
+            if( chunk > size - idxBuffer )
+            {
+                chunk = size - idxBuffer;
+            }
+
+            if( blockBuffer == NULL )
+            {
+                blockBuffer = (BYTE*)malloc(blockBytes);
+            }
+
+            // Bloco inteiro sobrescrito: não é preciso lê-lo (nem descomprimi-lo) antes
+            if( chunk < (int)blockBytes && __block_read_data(blockNumber, blockBuffer) != OP_SUCCESS )
+            {
+                result = OP_ERROR;
+                break;
+            }
+
+            memcpy(blockBuffer + idxBlockStart, buffer + idxBuffer, chunk);
+            result = __block_write_data(blockNumber, blockBuffer, compress);
+            idxBuffer += chunk;
+            continue;
+        }
+
+        // Setor inteiro sobrescrito: não é preciso lê-lo antes
+        if( chunk < SECTOR_SIZE && __disk_read(sector, readBuffer) != OP_SUCCESS )
+        {
+            result = OP_ERROR;
+            break;
+        }
+
+        memcpy(readBuffer + idxSectorStart, buffer + idxBuffer, chunk);
+
+        if( __disk_write(sector, readBuffer) != OP_SUCCESS )
+        {
+            result = OP_ERROR;
+            break;
+        }
+
+        // O checksum e a impressão digital anteriores do bloco não valem mais
+        __checksum_set(sector / g_fs->sb->blockSize, 0);
+        __dedup_remove(sector / g_fs->sb->blockSize);
+        __data_cache_drop(sector / g_fs->sb->blockSize);
+        idxBuffer += chunk;
+    }
+
+    free(blockBuffer);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê 'size' bytes a partir da posição 'pointer' do inode. Buracos do arquivo
+        são lidos como zeros. Blocos comprimidos, com checksum ou cobertos inteiros pela
+        leitura são lidos de uma vez (ver __block_read_data); blocos inteiros contíguos
+        e sem compressão vão numa só leitura, com o checksum conferido em seguida.
+
+Entra:
+    pointer -> posição, em bytes, do início da leitura
+    buffer -> buffer onde colocar os bytes lidos
+    size -> número de bytes a serem lidos
+    inode -> inode que contém as informações de onde ler
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_read_bytes(DWORD pointer, char *buffer, int size, struct t2fs_inode *inode)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    BYTE readBuffer[SECTOR_SIZE];
+    BYTE *blockBuffer = NULL;
+    DWORD idxRun;
+    int idxBuffer = 0;
+    int result = OP_SUCCESS;
+
+    // Sem os diretórios das tabelas, um bloco comprimido ou com checksum seria lido como um bloco comum
+    if( __refcount_load() != OP_SUCCESS ||
+        ((g_fs->sbe->features & SB_FEATURE_CHECKSUM) && __checksum_load() != OP_SUCCESS) )
+    {
+        return OP_ERROR;
+    }
+
+    while( idxBuffer < size && result == OP_SUCCESS )
+    {
+        DWORD position = pointer + idxBuffer;
+        DWORD sector = __inode_get_data_sector(position, inode);
+        int idxSectorStart = position % SECTOR_SIZE;
+        int chunk = SECTOR_SIZE - idxSectorStart;
+
+        if( chunk > size - idxBuffer )
+        {
+            chunk = size - idxBuffer;
+        }
+
+        if( sector == INVALID_PTR )
+        {
+            memset(buffer + idxBuffer, 0, chunk);
+        }
+        // Bloco comprimido, com checksum ou lido por inteiro: o mapa é consultado uma vez por bloco
+        else if( !__block_is_fragment(sector / g_fs->sb->blockSize) &&
+                 (__block_zsectors(sector / g_fs->sb->blockSize) > 0 || __checksum_get(sector / g_fs->sb->blockSize) != 0 ||
+                  (position % blockBytes == 0 && size - idxBuffer >= (int)blockBytes)) )
+        {
+            chunk = blockBytes - position % blockBytes;
+
+            if( chunk > size - idxBuffer )
+            {
+                chunk = size - idxBuffer;
+            }
+
+            if( chunk == (int)blockBytes && __block_is_plain(sector / g_fs->sb->blockSize) )
+            {
+                // Blocos inteiros seguintes, sem compressão e contíguos no disco, vão na mesma leitura
+                while( size - idxBuffer >= chunk + (int)blockBytes &&
+                       __inode_get_data_sector(position + chunk, inode) == sector + (chunk / SECTOR_SIZE) &&
+                       __block_is_plain(sector / g_fs->sb->blockSize + chunk / blockBytes) )
+                {
+                    chunk += blockBytes;
+                }
+
+                result = __disk_read_range(sector, chunk / SECTOR_SIZE, (BYTE*)buffer + idxBuffer);
+
+                // Os checksums dos blocos do trecho são conferidos no próprio buffer da leitura
+                for( idxRun = 0; idxRun < (DWORD)chunk / blockBytes && result == OP_SUCCESS; idxRun++ )
+                {
+                    result = __checksum_verify(sector / g_fs->sb->blockSize + idxRun, (BYTE*)buffer + idxBuffer + idxRun * blockBytes, blockBytes);
+                }
+            }
+            else if( chunk == (int)blockBytes )
+            {
+                result = __block_read_data(sector / g_fs->sb->blockSize, (BYTE*)buffer + idxBuffer);
+            }
+            else
+            {
+                if( blockBuffer == NULL )
+                {
+                    blockBuffer = (BYTE*)malloc(blockBytes);
+                }
+
+                result = __block_read_data(sector / g_fs->sb->blockSize, blockBuffer);
+
+                if( result == OP_SUCCESS )
+                {
+                    memcpy(buffer + idxBuffer, blockBuffer + position % blockBytes, chunk);
+                }
+            }
+        }
+        else if( __disk_read(sector, readBuffer) == OP_SUCCESS )
+        {
+            memcpy(buffer + idxBuffer, readBuffer + idxSectorStart, chunk);
+        }
+        else
+        {
+            result = OP_ERROR;
+        }
+
+        idxBuffer += chunk;
+    }
+
+    free(blockBuffer);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa o início da faixa de dados da zona de um inode, onde começa a procura
+        pelo primeiro bloco do arquivo
+
+Entra:
+    inodeNumber -> número do inode
+
+Saída:
+    Número do bloco desejado (0 se a alocação é no primeiro livre do disco).
+-----------------------------------------------------------------------------*/
+DWORD __zone_dir_block_goal(DWORD inodeNumber)
+{
+    if( g_fs->oldAlloc || __zone_load(0) != OP_SUCCESS )
+    {
+        return 0;
+    }
+
+    return g_fs->zoneDataStart + (inodeNumber / g_fs->zoneInodes) * g_fs->zoneBlocks;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escolhe o bloco desejado para o 'idxBlock'ézimo bloco de um inode: o bloco
+        seguinte ao bloco anterior do arquivo ou, se não há, o início da faixa de dados
+        da zona do inode
+
+Entra:
+    inode -> inode dono do bloco
+    inodeNumber -> número do inode
+    idxBlock -> índice do bloco relativo ao inode
+
+Saída:
+    Número do bloco desejado (0 se a alocação é no primeiro livre do disco).
+-----------------------------------------------------------------------------*/
+DWORD __zone_block_goal(struct t2fs_inode *inode, DWORD inodeNumber, DWORD idxBlock)
+{
+    DWORD previous = idxBlock > 0 ? __block_get_by_idx(idxBlock - 1, inode) : INVALID_PTR;
+
+    if( g_fs->oldAlloc )
+    {
+        return 0;
+    }
+
+    return __block_is_valid(previous) ? previous + 1 : __zone_dir_block_goal(inodeNumber);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Reserva um bloco livre e o inicializa com dado valor
+
+Entra:
+    value -> valor de cada byte do bloco (0xFF inicializa um bloco de indireção vazio)
+    goal -> bloco desejado: a procura começa nele (0 procura o primeiro livre do disco)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o número do bloco
+    Se ocorreu algum erro, retorna INVALID_PTR.
+-----------------------------------------------------------------------------*/
+DWORD __block_new(char value, DWORD goal)
+{
+    int blockNumber = __bitmap_search_from(BITMAP_DADOS, goal);
+
+    if( blockNumber <= 0 )
+    {
+        return INVALID_PTR;
+    }
+
+    __bitmap_set(BITMAP_DADOS, blockNumber, 1);
+
+    if( __block_init(blockNumber, value) != OP_SUCCESS )
+    {
+        __bitmap_set(BITMAP_DADOS, blockNumber, 0);
+
+        return INVALID_PTR;
+    }
+
+    return blockNumber;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Faz o 'idxBlock'ézimo ponteiro de dados do inode apontar para o bloco
+        informado, criando os blocos de indireção necessários. O bloco anterior (se
+        havia) não é liberado.
+
+Entra:
+    inode -> inode a ser alterado
+    inodeNumber -> índice do inode
+    idxBlock -> índice do bloco relativo ao inode
+    dataBlockNumber -> bloco de dados
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __block_map_at(struct t2fs_inode *inode, DWORD inodeNumber, DWORD idxBlock, DWORD dataBlockNumber)
+{
+    DWORD blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD indGoal = g_fs->oldAlloc ? 0 : dataBlockNumber;     /* Blocos de indireção novos ficam junto dos dados */
+    DWORD ptrBlockNumber;
+    int result = OP_SUCCESS;
+
+    if( idxBlock >= 2 + blockNumberPerBlock + blockNumberPerBlock * blockNumberPerBlock )
+    {
+        return OP_ERROR;
+    }
+
+    if( idxBlock < 2 )
+    {
+        inode->dataPtr[idxBlock] = dataBlockNumber;
+    }
+    else if( idxBlock - 2 < blockNumberPerBlock )
+    {
+        if( !__block_is_valid(inode->singleIndPtr) )
+        {
+            inode->singleIndPtr = __block_new((char)0xFF, indGoal);
+        }
+
+        result = __block_is_valid(inode->singleIndPtr) ? __block_write_ptr(idxBlock - 2, dataBlockNumber, inode->singleIndPtr) : OP_ERROR;
+    }
+    else
+    {
+        DWORD idxBase = idxBlock - blockNumberPerBlock - 2;
+
+        if( !__block_is_valid(inode->doubleIndPtr) )
+        {
+            inode->doubleIndPtr = __block_new((char)0xFF, indGoal);
+        }
+
+        ptrBlockNumber = __block_read_ptr(idxBase / blockNumberPerBlock, inode->doubleIndPtr);
+
+        if( __block_is_valid(inode->doubleIndPtr) && !__block_is_valid(ptrBlockNumber) )
+        {
+            ptrBlockNumber = __block_new((char)0xFF, indGoal);
+
+            if( __block_is_valid(ptrBlockNumber) )
+            {
+                __block_write_ptr(idxBase / blockNumberPerBlock, ptrBlockNumber, inode->doubleIndPtr);
+            }
+        }
+
+        result = __block_is_valid(ptrBlockNumber) ? __block_write_ptr(idxBase % blockNumberPerBlock, dataBlockNumber, ptrBlockNumber) : OP_ERROR;
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        if( idxBlock >= inode->blocksFileSize )
+        {
+            inode->blocksFileSize = idxBlock + 1;
+        }
+
+        result = __inode_write(inode, inodeNumber);
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Aloca o 'idxBlock'ézimo bloco de dados do inode, criando os blocos de
+        indireção necessários. Os blocos entre o fim do arquivo e 'idxBlock' ficam
+        como buracos.
+
+Entra:
+    inode -> inode no qual deve ser alocado o bloco
+    inodeNumber -> índice do inode
+    idxBlock -> índice do bloco relativo ao inode (deve ser um buraco)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __block_alocate_at(struct t2fs_inode *inode, DWORD inodeNumber, DWORD idxBlock)
+{
+    DWORD blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD dataBlockNumber;
+
+    if( idxBlock >= 2 + blockNumberPerBlock + blockNumberPerBlock * blockNumberPerBlock )
+    {
+        return OP_ERROR;
+    }
+
+    dataBlockNumber = __block_new(0, __zone_block_goal(inode, inodeNumber, idxBlock));
+
+    if( dataBlockNumber == INVALID_PTR )
+    {
+        return OP_ERROR;
+    }
+
+    if( __block_map_at(inode, inodeNumber, idxBlock, dataBlockNumber) != OP_SUCCESS )
+    {
+        __bitmap_set(BITMAP_DADOS, dataBlockNumber, 0);
+
+        return OP_ERROR;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Aloca um novo bloco de dados no fim do dado inode
+
+Entra:
+    inode -> inode no qual deve ser alocado o bloco
+    inodeNumber -> índice do inode
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __block_alocate(struct t2fs_inode *inode, DWORD inodeNumber)
+{
+    return __block_alocate_at(inode, inodeNumber, inode->blocksFileSize);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Aloca os buracos entre os bytes [pointer, pointer + size) do inode
+
+Entra:
+    inode -> inode no qual devem ser alocados os blocos
+    inodeNumber -> índice do inode
+    pointer -> posição do primeiro byte
+    size -> número de bytes
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_alocate_range(struct t2fs_inode *inode, DWORD inodeNumber, DWORD pointer, DWORD size)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD idxBlock;
+
+    for( idxBlock = pointer / blockBytes; size > 0 && idxBlock <= (pointer + size - 1) / blockBytes; idxBlock++ )
+    {
+        if( __block_get_by_idx(idxBlock, inode) == INVALID_PTR )
+        {
+            if( __block_alocate_at(inode, inodeNumber, idxBlock) != OP_SUCCESS )
+            {
+                return OP_ERROR;
+            }
+        }
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Libera um bloco que deixou de ser usado por um inode. Um bloco compartilhado
+        (ver clone2) apenas perde uma referência. O conteúdo não é apagado: todo bloco
+        é inicializado ao ser alocado.
+
+Entra:
+    blockNumber -> número do bloco (buracos são ignorados)
+-----------------------------------------------------------------------------*/
+void __block_release(DWORD blockNumber)
+{
+    if( !__block_is_valid(blockNumber) )
+    {
+        return;
+    }
+
+    if( __refcount_get(blockNumber) > 0 )
+    {
+        __refcount_add(blockNumber, -1);
+    }
+    else
+    {
+        __block_forget(blockNumber);
+        __bitmap_set(BITMAP_DADOS, blockNumber, 0);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Desaloca o último bloco do dado inode, liberando também os blocos de
+        indireção que ficarem vazios
+
+Entra:
+    inode -> inode no qual deve ser desalocado o bloco
+    inodeNumber -> índice do inode
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __block_free(struct t2fs_inode *inode, DWORD inodeNumber)
+{
+    DWORD blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD idxBlock = inode->blocksFileSize - 1;
+
+    if( inode->blocksFileSize == 0 )
+    {
+        return OP_ERROR;
+    }
+
+    __block_release(__block_get_by_idx(idxBlock, inode));
+
+    if( idxBlock < 2 )
+    {
+        inode->dataPtr[idxBlock] = INVALID_PTR;
+    }
+    else if( idxBlock - 2 < blockNumberPerBlock )
+    {
+        if( idxBlock == 2 )
+        {
+            __block_release(inode->singleIndPtr);
+            inode->singleIndPtr = INVALID_PTR;
+        }
+        else if( __block_is_valid(inode->singleIndPtr) )
+        {
+            __block_write_ptr(idxBlock - 2, INVALID_PTR, inode->singleIndPtr);
+        }
+    }
+    else
+    {
+        DWORD idxBase = idxBlock - blockNumberPerBlock - 2;
+        DWORD ptrBlockNumber = __block_read_ptr(idxBase / blockNumberPerBlock, inode->doubleIndPtr);
+
+        if( idxBase % blockNumberPerBlock == 0 )
+        {
+            __block_release(ptrBlockNumber);
+
+            if( __block_is_valid(inode->doubleIndPtr) )
+            {
+                __block_write_ptr(idxBase / blockNumberPerBlock, INVALID_PTR, inode->doubleIndPtr);
+            }
+        }
+        else if( __block_is_valid(ptrBlockNumber) )
+        {
+            __block_write_ptr(idxBase % blockNumberPerBlock, INVALID_PTR, ptrBlockNumber);
+        }
+
+        if( idxBase == 0 )
+        {
+            __block_release(inode->doubleIndPtr);
+            inode->doubleIndPtr = INVALID_PTR;
+        }
+    }
+
+    inode->blocksFileSize = idxBlock;
+    inode->bytesFileSize = (inode->blocksFileSize * SECTOR_SIZE * g_fs->sb->blockSize) < inode->bytesFileSize ? (inode->blocksFileSize * SECTOR_SIZE * g_fs->sb->blockSize) : inode->bytesFileSize;
+
+    return __inode_write(inode, inodeNumber);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Compara dois números de bloco (para qsort)
+-----------------------------------------------------------------------------*/
+int __block_number_compare(const void *a, const void *b)
+{
+    DWORD blockA = *(const DWORD*)a;
+    DWORD blockB = *(const DWORD*)b;
+
+    return blockA < blockB ? -1 : (blockA > blockB ? 1 : 0);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Libera uma lista de blocos. Os blocos compartilhados perdem uma referência;
+        os demais são ordenados e liberados no bitmap em trechos contíguos.
+
+Entra:
+    blocks -> blocos a serem liberados (o vetor é reordenado; buracos são ignorados)
+    count -> número de blocos no vetor
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __block_release_list(DWORD *blocks, DWORD count)
+{
+    DWORD i, numOwned = 0, runStart = 0;
+    int result = OP_SUCCESS;
+
+    for( i = 0; i < count; i++ )
+    {
+        if( !__block_is_valid(blocks[i]) )
+        {
+            continue;
+        }
+
+        if( __refcount_get(blocks[i]) > 0 )
+        {
+            __refcount_add(blocks[i], -1);
+        }
+        else
+        {
+            __block_forget(blocks[i]);
+            blocks[numOwned++] = blocks[i];
+        }
+    }
+
+    qsort(blocks, numOwned, sizeof(DWORD), __block_number_compare);
+
+    for( i = 1; i <= numOwned && result == OP_SUCCESS; i++ )
+    {
+        if( i == numOwned || blocks[i] != blocks[i - 1] + 1 )
+        {
+            result = __bitmap_free_range(blocks[runStart], i - runStart);
+            runStart = i;
+        }
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Marca como buracos os ponteiros de 'from' até o fim de um bloco de indireção
+
+Entra:
+    indBlockNumber -> bloco de indireção
+    from -> índice do primeiro ponteiro a ser removido
+    buffer -> buffer auxiliar com o tamanho de um bloco
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __block_clear_ptrs(DWORD indBlockNumber, DWORD from, BYTE *buffer)
+{
+    DWORD blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+
+    if( __block_read(indBlockNumber, buffer) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    memset(buffer + from * sizeof(DWORD), 0xFF, (blockNumberPerBlock - from) * sizeof(DWORD));
+
+    return __block_write(indBlockNumber, buffer);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Aloca um novo bloco com o mesmo conteúdo do bloco informado (um bloco
+        comprimido é copiado sem ser descomprimido)
+
+Entra:
+    blockNumber -> bloco a ser copiado
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o número do novo bloco
+    Se ocorreu algum erro, retorna INVALID_PTR.
+-----------------------------------------------------------------------------*/
+DWORD __block_copy_new(DWORD blockNumber)
+{
+    BYTE *buffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+    int newBlockNumber = __bitmap_search_from(BITMAP_DADOS, 0);
+    DWORD result = INVALID_PTR;
+
+    // Sem o bit gravado no bitmap, o bloco seria entregue de novo à próxima cópia
+    if( newBlockNumber > 0 && __block_read(blockNumber, buffer) == OP_SUCCESS &&
+        __bitmap_set(BITMAP_DADOS, newBlockNumber, 1) == OP_SUCCESS )
+    {
+        if( __block_write(newBlockNumber, buffer) == OP_SUCCESS &&
+            __block_set_zsectors(newBlockNumber, __block_zsectors(blockNumber)) == OP_SUCCESS &&
+            __checksum_set(newBlockNumber, __checksum_get(blockNumber)) == OP_SUCCESS )
+        {
+            result = newBlockNumber;
+        }
+        else
+        {
+            __block_forget(newBlockNumber);
+            __bitmap_set(BITMAP_DADOS, newBlockNumber, 0);
+        }
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Garante que o 'idxBlock'ézimo bloco do inode não é compartilhado com outro
+        arquivo, copiando-o para um bloco novo se necessário (copy-on-write)
+
+Entra:
+    inode -> inode dono do bloco (é atualizado)
+    inodeNumber -> número do inode
+    idxBlock -> índice do bloco relativo ao inode
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __block_unshare(struct t2fs_inode *inode, DWORD inodeNumber, DWORD idxBlock)
+{
+    int blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD blockNumber = __block_get_by_idx(idxBlock, inode);
+    DWORD newBlockNumber;
+
+    if( blockNumber == INVALID_PTR || __refcount_get(blockNumber) == 0 )
+    {
+        return OP_SUCCESS;
+    }
+
+    newBlockNumber = __block_copy_new(blockNumber);
+
+    if( newBlockNumber == INVALID_PTR )
+    {
+        return OP_ERROR;
+    }
+
+    __refcount_add(blockNumber, -1);
+
+    // Os blocos de indireção nunca são compartilhados: basta trocar o ponteiro
+    if( idxBlock < 2 )
+    {
+        inode->dataPtr[idxBlock] = newBlockNumber;
+
+        return __inode_write(inode, inodeNumber);
+    }
+    else if( idxBlock - 2 < blockNumberPerBlock )
+    {
+        return __block_write_ptr(idxBlock - 2, newBlockNumber, inode->singleIndPtr);
+    }
+    else
+    {
+        int idxBase = idxBlock - blockNumberPerBlock - 2;
+        BYTE *entry = __block_get_entry(idxBase / blockNumberPerBlock, sizeof(DWORD), inode->doubleIndPtr);
+        DWORD ptrBlockNumber = buffer_to_dword(entry, 0);
+
+        free(entry);
+
+        return __block_write_ptr(idxBase % blockNumberPerBlock, newBlockNumber, ptrBlockNumber);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Garante que os blocos que contêm os bytes [pointer, pointer + size) não são
+        compartilhados, antes de serem alterados
+
+Entra:
+    inode -> inode dono dos blocos (é atualizado)
+    inodeNumber -> número do inode
+    pointer -> posição do primeiro byte a ser alterado
+    size -> número de bytes a serem alterados
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_unshare_range(struct t2fs_inode *inode, DWORD inodeNumber, DWORD pointer, DWORD size)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD idxBlock;
+
+    if( __refcount_load() != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( g_fs->refcount.dir == NULL || size == 0 )
+    {
+        return OP_SUCCESS;
+    }
+
+    for( idxBlock = pointer / blockBytes; idxBlock <= (pointer + size - 1) / blockBytes && idxBlock < inode->blocksFileSize; idxBlock++ )
+    {
+        if( __block_unshare(inode, inodeNumber, idxBlock) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve bytes no fragmento de um arquivo embutido, reservando o fragmento na
+        primeira escrita. O setor é montado em memória e escrito uma única vez.
+
+Entra:
+    inode -> inode embutido (o fragmento é atualizado, mas o inode não é escrito)
+    pointer -> posição, em bytes, do início da escrita
+    buffer -> bytes a serem escritos
+    size -> número de bytes (pointer + size não pode passar de INLINE_DATA_SIZE)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_inline_write(struct t2fs_inode *inode, DWORD pointer, char *buffer, int size)
+{
+    BYTE sectorBuffer[SECTOR_SIZE];
+    DWORD fragment = inode->reservado[INODE_FRAGMENT];
+
+    if( fragment == INVALID_PTR )
+    {
+        memset(sectorBuffer, 0, SECTOR_SIZE);
+    }
+    else if( __disk_read(fragment, sectorBuffer) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    memcpy(sectorBuffer + pointer, buffer, size);
+
+    if( fragment == INVALID_PTR )
+    {
+        fragment = __fragment_alloc(1);
+
+        if( fragment == INVALID_PTR )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    if( __disk_write(fragment, sectorBuffer) != OP_SUCCESS )
+    {
+        if( inode->reservado[INODE_FRAGMENT] == INVALID_PTR )
+        {
+            __fragment_free(fragment, 1);
+        }
+
+        return OP_ERROR;
+    }
+
+    inode->reservado[INODE_FRAGMENT] = fragment;
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Passa um arquivo embutido a guardar seu conteúdo em blocos: o conteúdo do
+        fragmento é copiado para o primeiro bloco e o fragmento é liberado
+
+Entra:
+    inode -> inode embutido (é atualizado)
+    inodeNumber -> número do inode
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_inline_migrate(struct t2fs_inode *inode, DWORD inodeNumber)
+{
+    BYTE sectorBuffer[SECTOR_SIZE];
+    DWORD fragment = inode->reservado[INODE_FRAGMENT];
+    int hasData = fragment != INVALID_PTR && inode->bytesFileSize > 0;
+
+    if( hasData && __disk_read(fragment, sectorBuffer) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    inode->reservado[INODE_FLAGS] &= ~INODE_FLAG_INLINE;
+    inode->reservado[INODE_FRAGMENT] = INVALID_PTR;
+
+    // Os bytes do fragmento após o fim do arquivo são zeros: o setor é copiado inteiro
+    if( hasData && (__block_alocate_at(inode, inodeNumber, 0) != OP_SUCCESS ||
+                    __inode_write_bytes(0, (char*)sectorBuffer, SECTOR_SIZE, inode) != OP_SUCCESS) )
+    {
+        inode->reservado[INODE_FLAGS] |= INODE_FLAG_INLINE;
+        inode->reservado[INODE_FRAGMENT] = fragment;
+
+        return OP_ERROR;
+    }
+
+    __fragment_free(fragment, 1);
+
+    return __inode_write(inode, inodeNumber);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Altera o tamanho de um arquivo embutido que continua cabendo no fragmento.
+        Os bytes após o novo fim são zerados; um arquivo vazio libera o fragmento.
+
+Entra:
+    inode -> inode embutido (é atualizado)
+    inodeNumber -> número do inode
+    newSize -> novo tamanho, em bytes (até INLINE_DATA_SIZE)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_inline_truncate(struct t2fs_inode *inode, DWORD inodeNumber, DWORD newSize)
+{
+    BYTE sectorBuffer[SECTOR_SIZE];
+    DWORD fragment = inode->reservado[INODE_FRAGMENT];
+
+    if( newSize == 0 )
+    {
+        __fragment_free(fragment, 1);
+        inode->reservado[INODE_FRAGMENT] = INVALID_PTR;
+    }
+    else if( newSize < inode->bytesFileSize && fragment != INVALID_PTR )
+    {
+        if( __disk_read(fragment, sectorBuffer) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        memset(sectorBuffer + newSize, 0, SECTOR_SIZE - newSize);
+
+        if( __disk_write(fragment, sectorBuffer) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    inode->bytesFileSize = newSize;
+
+    return __inode_write(inode, inodeNumber);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Move o último bloco (parcial) do arquivo para um fragmento, se o empacotamento
+        de caudas está ligado no disco. Apenas os setores que contêm dados são copiados;
+        o bloco é liberado. Blocos compartilhados (ver clone2), comprimidos e buracos
+        ficam como estão.
+
+Entra:
+    inode -> inode do arquivo (é atualizado)
+    inodeNumber -> número do inode
+
+Saída:
+    Se a operação foi realizada com sucesso (ou não havia o que empacotar), retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_pack_tail(struct t2fs_inode *inode, DWORD inodeNumber)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD tailIdx = inode->bytesFileSize / blockBytes;
+    DWORD numSectors = __inode_fragment_sectors(inode);
+    DWORD bytesFileSize = inode->bytesFileSize;
+    DWORD blockNumber, fragment, i;
+    BYTE *buffer;
+    int result = OP_SUCCESS;
+
+    if( (g_fs->sbe->features & SB_FEATURE_TAILPACK) == 0 || inode->reservado[INODE_FLAGS] != 0 ||
+        bytesFileSize % blockBytes == 0 || numSectors >= g_fs->sb->blockSize || inode->blocksFileSize != tailIdx + 1 )
+    {
+        return OP_SUCCESS;
+    }
+
+    blockNumber = __block_get_by_idx(tailIdx, inode);
+
+    if( blockNumber == INVALID_PTR || __refcount_get(blockNumber) > 0 || __block_zsectors(blockNumber) > 0 )
+    {
+        return OP_SUCCESS;
+    }
+
+    // Sem espaço para fragmentos: a cauda continua no bloco
+    fragment = __fragment_alloc(numSectors);
+
+    if( fragment == INVALID_PTR )
+    {
+        return OP_SUCCESS;
+    }
+
+    buffer = (BYTE*)malloc(blockBytes);
+
+    if( __block_read_data(blockNumber, buffer) != OP_SUCCESS )
+    {
+        result = OP_ERROR;
+    }
+
+    for( i = 0; i < numSectors && result == OP_SUCCESS; i++ )
+    {
+        result = __disk_write(fragment + i, buffer + i * SECTOR_SIZE) == OP_SUCCESS ? OP_SUCCESS : OP_ERROR;
+    }
+
+    free(buffer);
+
+    if( result != OP_SUCCESS || __block_free(inode, inodeNumber) != OP_SUCCESS )
+    {
+        __fragment_free(fragment, numSectors);
+
+        return OP_ERROR;
+    }
+
+    inode->bytesFileSize = bytesFileSize;
+    inode->reservado[INODE_FLAGS] |= INODE_FLAG_TAIL;
+    inode->reservado[INODE_FRAGMENT] = fragment;
+
+    return __inode_write(inode, inodeNumber);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Devolve a cauda guardada num fragmento a um bloco próprio do arquivo, antes
+        de uma operação que altera o arquivo
+
+Entra:
+    inode -> inode do arquivo (é atualizado)
+    inodeNumber -> número do inode
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_unpack_tail(struct t2fs_inode *inode, DWORD inodeNumber)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD tailIdx = inode->bytesFileSize / blockBytes;
+    DWORD numSectors = __inode_fragment_sectors(inode);
+    DWORD fragment = inode->reservado[INODE_FRAGMENT];
+    BYTE *buffer;
+    DWORD i;
+    int result = OP_SUCCESS;
+
+    if( !__inode_has_tail(inode) )
+    {
+        return OP_SUCCESS;
+    }
+
+    buffer = (BYTE*)malloc(numSectors * SECTOR_SIZE);
+
+    for( i = 0; i < numSectors && result == OP_SUCCESS; i++ )
+    {
+        result = __disk_read(fragment + i, buffer + i * SECTOR_SIZE) == OP_SUCCESS ? OP_SUCCESS : OP_ERROR;
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        inode->reservado[INODE_FLAGS] &= ~INODE_FLAG_TAIL;
+        inode->reservado[INODE_FRAGMENT] = INVALID_PTR;
+
+        // Setores inteiros: a escrita não precisa ler o bloco novo
+        if( __block_alocate_at(inode, inodeNumber, tailIdx) != OP_SUCCESS ||
+            __inode_write_bytes(tailIdx * blockBytes, (char*)buffer, numSectors * SECTOR_SIZE, inode) != OP_SUCCESS )
+        {
+            inode->reservado[INODE_FLAGS] |= INODE_FLAG_TAIL;
+            inode->reservado[INODE_FRAGMENT] = fragment;
+            result = OP_ERROR;
+        }
+        else
+        {
+            __fragment_free(fragment, numSectors);
+        }
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Altera o tamanho do arquivo para 'newSize' bytes. Ao reduzir, o mapa de blocos
+        é lido uma única vez, os blocos de dados e de indireção que ficam sem uso são
+        liberados em lote e os blocos de indireção mantidos são reescritos uma vez cada.
+        Ao aumentar, o trecho novo fica como um buraco. O inode é escrito uma única vez.
+        Tamanhos além do que o mapa de blocos endereça são recusados.
+
+Entra:
+    inode -> inode do arquivo (é atualizado)
+    inodeNumber -> número do inode
+    newSize -> novo tamanho, em bytes
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_truncate(struct t2fs_inode *inode, DWORD inodeNumber, DWORD newSize)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD blockNumberPerBlock = blockBytes / sizeof(DWORD);
+    DWORD keepBlocks = (newSize + blockBytes - 1) / blockBytes;
+    DWORD zeroStart = newSize < inode->bytesFileSize ? newSize : inode->bytesFileSize;
+    DWORD *blocks, *freed, numFreed = 0, i, j;
+    BYTE *buffer;
+    int result = OP_SUCCESS;
+
+    // Maior que o mapa de blocos (diretos, indireção simples e dupla) consegue endereçar
+    if( newSize > (2ULL + blockNumberPerBlock + (unsigned long long)blockNumberPerBlock * blockNumberPerBlock) * blockBytes )
+    {
+        return OP_ERROR;
+    }
+
+    if( __inode_is_inline(inode) )
+    {
+        if( newSize <= INLINE_DATA_SIZE )
+        {
+            return __inode_inline_truncate(inode, inodeNumber, newSize);
+        }
+
+        // Estendido além do fragmento: passa a usar blocos
+        if( __inode_inline_migrate(inode, inodeNumber) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    if( __inode_has_tail(inode) )
+    {
+        // Cauda removida inteira: basta liberar o fragmento
+        if( newSize <= (inode->bytesFileSize / blockBytes) * blockBytes )
+        {
+            __fragment_free(inode->reservado[INODE_FRAGMENT], __inode_fragment_sectors(inode));
+            inode->reservado[INODE_FLAGS] &= ~INODE_FLAG_TAIL;
+            inode->reservado[INODE_FRAGMENT] = INVALID_PTR;
+        }
+        else if( __inode_unpack_tail(inode, inodeNumber) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    buffer = (BYTE*)malloc(blockBytes);
+
+    if( keepBlocks < inode->blocksFileSize )
+    {
+        blocks = (DWORD*)malloc((inode->blocksFileSize + 1) * sizeof(DWORD));
+        freed = (DWORD*)malloc((inode->blocksFileSize + blockNumberPerBlock + 2) * sizeof(DWORD));
+
+        result = __inode_map_read(inode, blocks, NULL);
+
+        for( i = keepBlocks; i < inode->blocksFileSize && result == OP_SUCCESS; i++ )
+        {
+            freed[numFreed++] = blocks[i];
+        }
+
+        for( i = keepBlocks; i < 2; i++ )
+        {
+            inode->dataPtr[i] = INVALID_PTR;
+        }
+
+        if( __block_is_valid(inode->singleIndPtr) && result == OP_SUCCESS )
+        {
+            if( keepBlocks <= 2 )
+            {
+                freed[numFreed++] = inode->singleIndPtr;
+                inode->singleIndPtr = INVALID_PTR;
+            }
+            else if( keepBlocks - 2 < blockNumberPerBlock )
+            {
+                result = __block_clear_ptrs(inode->singleIndPtr, keepBlocks - 2, buffer);
+            }
+        }
+
+        if( __block_is_valid(inode->doubleIndPtr) && result == OP_SUCCESS )
+        {
+            DWORD idxBase = 2 + blockNumberPerBlock;
+            BYTE *listBuffer = (BYTE*)malloc(blockBytes);
+            int listChanged = 0;
+
+            result = __block_read(inode->doubleIndPtr, listBuffer);
+
+            for( j = 0; j < blockNumberPerBlock && result == OP_SUCCESS; j++ )
+            {
+                DWORD indBlockNumber = buffer_to_dword(listBuffer, j * sizeof(DWORD));
+                DWORD indStart = idxBase + j * blockNumberPerBlock;
+
+                if( !__block_is_valid(indBlockNumber) )
+                {
+                    continue;
+                }
+
+                if( indStart >= keepBlocks )
+                {
+                    freed[numFreed++] = indBlockNumber;
+                    memset(listBuffer + j * sizeof(DWORD), 0xFF, sizeof(DWORD));
+                    listChanged = 1;
+                }
+                else if( keepBlocks < indStart + blockNumberPerBlock )
+                {
+                    result = __block_clear_ptrs(indBlockNumber, keepBlocks - indStart, buffer);
+                }
+            }
+
+            if( keepBlocks <= idxBase )
+            {
+                freed[numFreed++] = inode->doubleIndPtr;
+                inode->doubleIndPtr = INVALID_PTR;
+            }
+            else if( listChanged && result == OP_SUCCESS )
+            {
+                result = __block_write(inode->doubleIndPtr, listBuffer);
+            }
+
+            free(listBuffer);
+        }
+
+        if( result == OP_SUCCESS )
+        {
+            result = __block_release_list(freed, numFreed);
+            inode->blocksFileSize = keepBlocks;
+        }
+
+        free(blocks);
+        free(freed);
+    }
+
+    // O restante do último bloco mantido passa a ser lido como zeros
+    if( result == OP_SUCCESS && zeroStart % blockBytes != 0 && __block_get_by_idx(zeroStart / blockBytes, inode) != INVALID_PTR )
+    {
+        DWORD size = blockBytes - (zeroStart % blockBytes);
+
+        memset(buffer, 0, size);
+
+        if( __inode_unshare_range(inode, inodeNumber, zeroStart, size) != OP_SUCCESS ||
+            __inode_write_bytes(zeroStart, (char*)buffer, size, inode) != OP_SUCCESS )
+        {
+            result = OP_ERROR;
+        }
+    }
+
+    free(buffer);
+
+    if( result == OP_SUCCESS )
+    {
+        inode->bytesFileSize = newSize;
+        result = __inode_write(inode, inodeNumber);
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê a entrada referenciada por pointer
+
+Entra:
+    pointer -> ponteiro de entrada com referencia ao handler
+    size -> tamanho da entrada
+    inode -> inode onde procurar
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna um buffer com a entrada
+    Se ocorreu algum erro, retorna NULL.
+-----------------------------------------------------------------------------*/
+BYTE* __entry_read(DWORD pointer, int size, struct t2fs_inode *inode)
+{
+    DWORD dataBlockNumber = __block_navigate(pointer, size, inode);
+
+    if( dataBlockNumber != INVALID_PTR )
+    {
+        int entryPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / size;
+        int idxEntry = pointer % entryPerBlock;
+
+        return __block_get_entry(idxEntry, size, dataBlockNumber);
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Encontra o record pelo ponteiro
+
+Entra:
+    idxRecord -> índice do record no bloco
+    inode -> inode associado
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o record
+    Se ocorreu algum erro, retorna NULL.
+-----------------------------------------------------------------------------*/
+struct t2fs_record* __record_get_by_idx(DWORD pointer, struct t2fs_inode *inode)
+{
+    BYTE* entryBuffer = __entry_read(pointer, sizeof(struct t2fs_record), inode);
+    struct t2fs_record *record = NULL;
+
+    if( entryBuffer != NULL )
+    {
+        record = buffer_to_record(entryBuffer, 0);
+
+        return record;
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Encontra o registro associado ao nome no inode especificado
+
+Entra:
+    name -> nome da entrada
+    inode -> inode para procurar
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o record
+    Se ocorreu algum erro, retorna NULL.
+-----------------------------------------------------------------------------*/
+struct t2fs_record* __record_get_by_name(char *name, struct t2fs_inode *inode)
+{
+    int pointer = 0;
+    struct t2fs_record *record = NULL, *foundRecord = NULL;
+
+    do
+    {
+        record = __record_get_by_idx(pointer, inode);
+
+        if( record != NULL )
+        {
+            if( record->TypeVal == TYPEVAL_REGULAR || record->TypeVal == TYPEVAL_DIRETORIO )
+            {
+                if( strcmp(name, record->name) == 0 )
+                {
+                    foundRecord = record;
+
+                    return foundRecord;
+                }
+            }
+        }
+
+        pointer++;
+
+    } while( record != NULL );
+
+    return foundRecord;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Encontra o índice de um 'record' pelo seu nome
+
+Entra:
+    name -> nome pelo qual procurar
+    inode -> inode onde procurar
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o índice (int. >= 0)
+    Se ocorreu algum erro, retorna INVALID_PTR.
+-----------------------------------------------------------------------------*/
+DWORD __record_get_idx_by_name(char *name, struct t2fs_inode *inode)
+{
+    int pointer = 0;
+    int idxFound = INVALID_PTR;
+    struct t2fs_record *record = NULL;
+
+    do
+    {
+        record = __record_get_by_idx(pointer, inode);
+
+        if( record != NULL )
+        {
+            if( record->TypeVal == TYPEVAL_REGULAR || record->TypeVal == TYPEVAL_DIRETORIO )
+            {
+                if( strcmp(name, record->name) == 0)
+                {
+                    idxFound = pointer;
+
+                    return idxFound;
+                }
+            }
+        }
+
+        pointer++;
+
+    } while( record != NULL );
+
+    return idxFound;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula a posição da dica do diretório na cache. O número do inode é espalhado
+        para que diretórios no início de zonas diferentes (ver __zone_for_dir), com números
+        múltiplos do tamanho da cache, não disputem a mesma posição.
+
+Entra:
+    inodeNumber -> número do inode do diretório
+
+Saída:
+    Índice na cache.
+-----------------------------------------------------------------------------*/
+DWORD __dir_hint_slot(DWORD inodeNumber)
+{
+    return ((inodeNumber * 2654435761u) >> 16) % DIR_HINT_CACHE_SIZE;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Retorna a dica de registro livre do diretório
+
+Entra:
+    inodeNumber -> número do inode do diretório
+
+Saída:
+    Índice a partir do qual procurar um registro livre (0 se não há dica).
+-----------------------------------------------------------------------------*/
+DWORD __dir_hint_get(DWORD inodeNumber)
+{
+    DIR_HINT *hint = &g_fs->dirHints[__dir_hint_slot(inodeNumber)];
+
+    if( hint->valid && hint->inodeNumber == inodeNumber )
+    {
+        return hint->firstFree;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Atualiza a dica de registro livre do diretório
+
+Entra:
+    inodeNumber -> número do inode do diretório
+    firstFree -> nenhum registro antes deste índice está livre
+-----------------------------------------------------------------------------*/
+void __dir_hint_set(DWORD inodeNumber, DWORD firstFree)
+{
+    DIR_HINT *hint = &g_fs->dirHints[__dir_hint_slot(inodeNumber)];
+
+    if( !hint->valid || hint->inodeNumber != inodeNumber )
+    {
+        hint->liveKnown = 0;
+        hint->lastChild = 0;
+    }
+
+    hint->inodeNumber = inodeNumber;
+    hint->firstFree = firstFree;
+    hint->valid = 1;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa que o registro 'idxRecord' do diretório ficou livre
+
+Entra:
+    inodeNumber -> número do inode do diretório
+    idxRecord -> índice do registro liberado
+-----------------------------------------------------------------------------*/
+void __dir_hint_release(DWORD inodeNumber, DWORD idxRecord)
+{
+    DIR_HINT *hint = &g_fs->dirHints[__dir_hint_slot(inodeNumber)];
+
+    if( hint->valid && hint->inodeNumber == inodeNumber && idxRecord < hint->firstFree )
+    {
+        hint->firstFree = idxRecord;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Registra o número de registros válidos do diretório
+
+Entra:
+    inodeNumber -> número do inode do diretório
+    liveRecords -> número de registros válidos
+-----------------------------------------------------------------------------*/
+void __dir_hint_set_live(DWORD inodeNumber, DWORD liveRecords)
+{
+    DIR_HINT *hint = &g_fs->dirHints[__dir_hint_slot(inodeNumber)];
+
+    if( !hint->valid || hint->inodeNumber != inodeNumber )
+    {
+        __dir_hint_set(inodeNumber, 0);
+    }
+
+    hint->liveRecords = liveRecords;
+    hint->liveKnown = 1;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Ajusta o número de registros válidos do diretório, se conhecido
+
+Entra:
+    inodeNumber -> número do inode do diretório
+    delta -> variação no número de registros
+-----------------------------------------------------------------------------*/
+void __dir_hint_count(DWORD inodeNumber, int delta)
+{
+    DIR_HINT *hint = &g_fs->dirHints[__dir_hint_slot(inodeNumber)];
+
+    if( hint->valid && hint->inodeNumber == inodeNumber && hint->liveKnown )
+    {
+        hint->liveRecords += delta;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Retorna o último inode alocado para uma entrada do diretório
+
+Entra:
+    inodeNumber -> número do inode do diretório
+
+Saída:
+    Número do inode (0 se desconhecido).
+-----------------------------------------------------------------------------*/
+DWORD __dir_hint_last_child(DWORD inodeNumber)
+{
+    DIR_HINT *hint = &g_fs->dirHints[__dir_hint_slot(inodeNumber)];
+
+    return hint->valid && hint->inodeNumber == inodeNumber ? hint->lastChild : 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Registra o último inode alocado para uma entrada do diretório (só se o diretório
+        já tem dica)
+
+Entra:
+    inodeNumber -> número do inode do diretório
+    childInodeNumber -> inode alocado
+-----------------------------------------------------------------------------*/
+void __dir_hint_set_last_child(DWORD inodeNumber, DWORD childInodeNumber)
+{
+    DIR_HINT *hint = &g_fs->dirHints[__dir_hint_slot(inodeNumber)];
+
+    if( hint->valid && hint->inodeNumber == inodeNumber )
+    {
+        hint->lastChild = childInodeNumber;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Descarta a dica de registro livre do diretório (ex.: inode liberado)
+
+Entra:
+    inodeNumber -> número do inode do diretório
+-----------------------------------------------------------------------------*/
+void __dir_hint_invalidate(DWORD inodeNumber)
+{
+    DIR_HINT *hint = &g_fs->dirHints[__dir_hint_slot(inodeNumber)];
+
+    if( hint->inodeNumber == inodeNumber )
+    {
+        hint->valid = 0;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa o número de setores usados para gravar as dicas dos diretórios no bloco
+        do superbloco (ver __dir_hints_write)
+
+Saída:
+    Número de setores (0 se o bloco do superbloco não tem espaço para as dicas).
+-----------------------------------------------------------------------------*/
+DWORD __dir_hints_sectors()
+{
+    DWORD numSectors = (DIR_HINT_CACHE_SIZE * DIR_HINT_DISK_SIZE + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+    return SB_HINTS_SECTOR + numSectors <= g_fs->sb->superblockSize * g_fs->sb->blockSize ? numSectors : 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Grava as dicas dos diretórios nos setores livres do bloco do superbloco, a partir
+        de SB_HINTS_SECTOR. Cada dica ocupa DIR_HINT_DISK_SIZE bytes: número do inode
+        (INVALID_PTR se a dica não é válida), primeiro registro livre e registros válidos
+        (DIR_HINT_LIVE_UNKNOWN se desconhecido). Se o bloco não tem espaço para as dicas,
+        nada é gravado.
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __dir_hints_write()
+{
+    BYTE buffer[SECTOR_SIZE];
+    DWORD numSectors = __dir_hints_sectors();
+    DWORD idxSector, values[3], pos;
+    BYTE *buffer_value;
+    DIR_HINT *hint;
+    int i, j, k;
+
+    for( idxSector = 0; idxSector < numSectors; idxSector++ )
+    {
+        memset(buffer, 0, SECTOR_SIZE);
+
+        for( i = 0; i < SECTOR_SIZE / DIR_HINT_DISK_SIZE; i++ )
+        {
+            pos = idxSector * (SECTOR_SIZE / DIR_HINT_DISK_SIZE) + i;
+
+            if( pos >= DIR_HINT_CACHE_SIZE )
+            {
+                break;
+            }
+
+            hint = &g_fs->dirHints[pos];
+            values[0] = hint->valid ? hint->inodeNumber : INVALID_PTR;
+            values[1] = hint->firstFree;
+            values[2] = hint->liveKnown ? hint->liveRecords : DIR_HINT_LIVE_UNKNOWN;
+
+            for( j = 0; j < 3; j++ )
+            {
+                buffer_value = dword_to_buffer(values[j]);
+
+                for( k = 0; k < sizeof(DWORD); k++ )
+                {
+                    buffer[i * DIR_HINT_DISK_SIZE + j * sizeof(DWORD) + k] = buffer_value[k];
+                }
+
+                free(buffer_value);
+            }
+        }
+
+        if( __disk_write(SB_HINTS_SECTOR + idxSector, buffer) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê as dicas dos diretórios gravadas por __dir_hints_write. Dicas fora da posição
+        esperada na cache são descartadas.
+-----------------------------------------------------------------------------*/
+void __dir_hints_read()
+{
+    BYTE buffer[SECTOR_SIZE];
+    DWORD numSectors = __dir_hints_sectors();
+    DWORD idxSector, inodeNumber, liveRecords, pos;
+    DIR_HINT *hint;
+    int i;
+
+    for( idxSector = 0; idxSector < numSectors; idxSector++ )
+    {
+        if( __disk_read(SB_HINTS_SECTOR + idxSector, buffer) != OP_SUCCESS )
+        {
+            return;
+        }
+
+        for( i = 0; i < SECTOR_SIZE / DIR_HINT_DISK_SIZE; i++ )
+        {
+            pos = idxSector * (SECTOR_SIZE / DIR_HINT_DISK_SIZE) + i;
+            inodeNumber = buffer_to_dword(buffer, i * DIR_HINT_DISK_SIZE);
+
+            if( pos >= DIR_HINT_CACHE_SIZE || inodeNumber == INVALID_PTR || __dir_hint_slot(inodeNumber) != pos )
+            {
+                continue;
+            }
+
+            hint = &g_fs->dirHints[pos];
+            liveRecords = buffer_to_dword(buffer, i * DIR_HINT_DISK_SIZE + 2 * sizeof(DWORD));
+
+            hint->inodeNumber = inodeNumber;
+            hint->firstFree = buffer_to_dword(buffer, i * DIR_HINT_DISK_SIZE + sizeof(DWORD));
+            hint->liveKnown = liveRecords != DIR_HINT_LIVE_UNKNOWN;
+            hint->liveRecords = hint->liveKnown ? liveRecords : 0;
+            hint->valid = 1;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Grava os contadores das zonas de um disco sem grupos no setor 0, logo após a
+        extensão do superbloco (ver SB_ZONES_OFFSET): número de zonas (0 se as zonas não
+        foram calculadas) e, para cada zona, inodes e blocos livres. Num disco com grupos
+        a tabela de descritores já está no disco.
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __zone_counts_write()
+{
+    BYTE buffer[SECTOR_SIZE];
+    DWORD values[1 + 2 * ZONE_MAX_COUNT], zone, numValues = 1;
+    BYTE *buffer_value;
+    int j, k;
+
+    if( g_fs->sbe->groupBlocks != 0 )
+    {
+        return OP_SUCCESS;
+    }
+
+    if( __disk_read(0, buffer) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    values[0] = g_fs->zones != NULL ? g_fs->zoneCount : 0;
+
+    for( zone = 0; zone < values[0]; zone++ )
+    {
+        values[numValues++] = __zone_desc(zone)[GROUP_FREE_INODES];
+        values[numValues++] = __zone_desc(zone)[GROUP_FREE_BLOCKS];
+    }
+
+    for( j = 0; j < numValues; j++ )
+    {
+        buffer_value = dword_to_buffer(values[j]);
+
+        for( k = 0; k < sizeof(DWORD); k++ )
+        {
+            buffer[SB_ZONES_OFFSET + j * sizeof(DWORD) + k] = buffer_value[k];
+        }
+
+        free(buffer_value);
+    }
+
+    return __disk_write(0, buffer);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê os contadores das zonas gravados por __zone_counts_write, evitando percorrer
+        os bitmaps no primeiro uso das zonas. Contadores de outra geometria ou cuja soma
+        difere dos livres do superbloco são descartados. O cursor de cada zona começa no
+        início da zona.
+-----------------------------------------------------------------------------*/
+void __zone_counts_read()
+{
+    BYTE buffer[SECTOR_SIZE];
+    DWORD zone, freeInodes = 0, freeBlocks = 0, *desc;
+
+    if( g_fs->sbe->groupBlocks != 0 || g_fs->zones != NULL || __disk_read(0, buffer) != OP_SUCCESS )
+    {
+        return;
+    }
+
+    __zone_geometry();
+
+    if( buffer_to_dword(buffer, SB_ZONES_OFFSET) != g_fs->zoneCount || g_fs->zoneCount > ZONE_MAX_COUNT )
+    {
+        return;
+    }
+
+    g_fs->zones = (DWORD*)calloc(g_fs->zoneCount * GROUP_DESC_WORDS, sizeof(DWORD));
+
+    for( zone = 0; zone < g_fs->zoneCount; zone++ )
+    {
+        desc = __zone_desc(zone);
+        desc[GROUP_FREE_INODES] = buffer_to_dword(buffer, SB_ZONES_OFFSET + (1 + zone * 2) * sizeof(DWORD));
+        desc[GROUP_FREE_BLOCKS] = buffer_to_dword(buffer, SB_ZONES_OFFSET + (2 + zone * 2) * sizeof(DWORD));
+        desc[GROUP_INODE_HINT] = zone * g_fs->zoneInodes;
+        desc[GROUP_BLOCK_HINT] = g_fs->zoneDataStart + zone * g_fs->zoneBlocks;
+        freeInodes += desc[GROUP_FREE_INODES];
+        freeBlocks += desc[GROUP_FREE_BLOCKS];
+    }
+
+    if( freeInodes != g_fs->sbe->freeInodes || freeBlocks != g_fs->sbe->freeBlocks )
+    {
+        __zone_forget();
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Encontra o primeiro registro de 'record' livre, a partir da dica do diretório.
+        Lê os blocos inteiros, atualizando a dica com o resultado da busca.
+
+Entra:
+    inode -> inode onde procurar
+    inodeNumber -> número do inode
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o índice (int. >= 0)
+    Se ocorreu algum erro, retorna INVALID_PTR.
+-----------------------------------------------------------------------------*/
+DWORD __record_get_free_idx(struct t2fs_inode *inode, DWORD inodeNumber)
+{
+    struct t2fs_record record;
+    int entryPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(struct t2fs_record);
+    DWORD pointer = __dir_hint_get(inodeNumber);
+    DWORD idxFree = INVALID_PTR;
+    DWORD idxBlock;
+    BYTE *blockBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+    int i;
+
+    for( idxBlock = pointer / entryPerBlock; idxBlock < inode->blocksFileSize && idxFree == INVALID_PTR; idxBlock++ )
+    {
+        if( __block_read(__block_get_by_idx(idxBlock, inode), blockBuffer) != OP_SUCCESS )
+        {
+            break;
+        }
+
+        for( i = pointer % entryPerBlock; i < entryPerBlock; i++, pointer++ )
+        {
+            buffer_read_record(blockBuffer, i * sizeof(struct t2fs_record), &record);
+
+            if( record.TypeVal == TYPEVAL_INVALIDO )
+            {
+                idxFree = pointer;
+                break;
+            }
+        }
+    }
+
+    free(blockBuffer);
+
+    __dir_hint_set(inodeNumber, pointer);
+
+    return idxFree;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Cria um record no índice do bloco indicado
+
+Entra:
+    record -> dados a serem salvos
+    idxFreeRecord -> índice do espaço livre no bloco
+    blockNumber -> número do bloco onde salvar
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_write(struct t2fs_record *record, int idxFreeRecord, int blockNumber)
+{
+    BYTE buffer[SECTOR_SIZE], *buffer_record = NULL;
+    unsigned int sector = __block_get_sector(blockNumber) + (((idxFreeRecord * sizeof(struct t2fs_record)) / SECTOR_SIZE) % g_fs->sb->blockSize);
+    int idxRecord = (idxFreeRecord % (SECTOR_SIZE/sizeof(struct t2fs_record))) * sizeof(struct t2fs_record);
+    int i;
+
+    if( __disk_read(sector, buffer) == OP_SUCCESS )
+    {
+        buffer_record = record_to_buffer(record);
+
+        for(i = 0; i < sizeof(struct t2fs_record); i++)
+        {
+            buffer[idxRecord + i] = buffer_record[i];
+        }
+
+        if( __disk_write(sector, buffer) == OP_SUCCESS )
+        {
+            return OP_SUCCESS;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Encontra um registro livre no diretório, aumentando-o em um bloco se necessário
+
+Entra:
+    parentInode -> inode do diretório (é atualizado se o diretório crescer)
+    parentInodeNumber -> número do inode do diretório
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o índice (int. >= 0)
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_get_slot(struct t2fs_inode *parentInode, DWORD parentInodeNumber)
+{
+    int idxFreeRecord = __record_get_free_idx(parentInode, parentInodeNumber);
+
+    if( idxFreeRecord == OP_ERROR )
+    {
+        if( __block_alocate(parentInode, parentInodeNumber) == OP_SUCCESS )
+        {
+            parentInode->bytesFileSize = parentInode->blocksFileSize * g_fs->sb->blockSize * SECTOR_SIZE;
+            __inode_write(parentInode, parentInodeNumber);
+
+            __inode_sync_root(parentInode, parentInodeNumber);
+
+            idxFreeRecord = __record_get_free_idx(parentInode, parentInodeNumber);
+        }
+    }
+
+    return idxFreeRecord;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escolhe e procura o inode de um novo arquivo ou diretório. Um diretório vai
+        para a zona escolhida por __zone_for_dir. Na zona do pai, a entrada fica logo após
+        o último irmão alocado (ou após o pai), no mesmo setor; com o setor cheio, num setor
+        vazio da mesma zona, para que os irmãos de diretórios criados em paralelo não se
+        intercalem.
+
+Entra:
+    parentInodeNumber -> inode do diretório pai
+    type -> tipo do novo arquivo (TYPEVAL_REGULAR ou TYPEVAL_DIRETORIO)
+
+Saída:
+    Se encontrou, retorna o número do inode
+    Se não há inode livre, retorna 0
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __zone_inode_search(DWORD parentInodeNumber, int type)
+{
+    DWORD inodesPerSector = SECTOR_SIZE / sizeof(struct t2fs_inode);
+    DWORD totalInodes = __inode_get_total();
+    DWORD zone, goal, lastChild, zoneEnd;
+    int inodeNumber;
+
+    if( g_fs->oldAlloc || __zone_load(0) != OP_SUCCESS )
+    {
+        return __bitmap_search(BITMAP_INODE, 0);
+    }
+
+    zone = type == TYPEVAL_DIRETORIO ? __zone_for_dir(parentInodeNumber) : parentInodeNumber / g_fs->zoneInodes;
+
+    if( zone != parentInodeNumber / g_fs->zoneInodes )
+    {
+        goal = zone * g_fs->zoneInodes;
+    }
+    else
+    {
+        lastChild = __dir_hint_last_child(parentInodeNumber);
+        goal = (lastChild != 0 ? lastChild : parentInodeNumber) + 1;
+        inodeNumber = __bitmap_search_range(BITMAP_INODE, goal, (goal + inodesPerSector - 1) / inodesPerSector * inodesPerSector, 0);
+
+        if( inodeNumber != 0 )
+        {
+            return inodeNumber;
+        }
+    }
+
+    zoneEnd = (zone + 1) * g_fs->zoneInodes < totalInodes ? (zone + 1) * g_fs->zoneInodes : totalInodes;
+    inodeNumber = __bitmap_search_range(BITMAP_INODE, goal, zoneEnd, 1);
+
+    return inodeNumber != 0 ? inodeNumber : __bitmap_search_from(BITMAP_INODE, goal);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Realiza a alocação dos diversos recursos necessários
+
+Entra:
+    name -> nome do record
+    type -> tipo do record
+    parentRecord -> onde escrever o record
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_alocate(char *name, int type, struct t2fs_record* parentRecord)
+{
+    struct t2fs_record *record = NULL;
+    struct t2fs_inode *inode = NULL;
+
+    struct t2fs_inode *parentInode = __inode_get_by_idx(parentRecord->inodeNumber);
+    int idxFreeRecord = __record_get_slot(parentInode, parentRecord->inodeNumber);
+
+    if( idxFreeRecord != OP_ERROR )
+    {
+        record = (struct t2fs_record*)calloc(1, sizeof(struct t2fs_record));
+
+        if( strlen(name) <= (RECORD_NAME_SIZE - 1) )
+        {
+            int b_inode = __zone_inode_search(parentRecord->inodeNumber, type);
+            int b_dados = b_inode > 0 && type == TYPEVAL_DIRETORIO ? __bitmap_search_from(BITMAP_DADOS, __zone_dir_block_goal(b_inode)) : 0;
+
+            // Um arquivo novo é embutido: só recebe um fragmento na primeira escrita
+            if( b_inode > 0 && (b_dados > 0 || type != TYPEVAL_DIRETORIO) )
+            {
+                strncpy(record->name, name, RECORD_NAME_SIZE - 1);
+                record->TypeVal = type;
+                record->inodeNumber = b_inode;
+
+                inode = (struct t2fs_inode*)calloc(1, sizeof(struct t2fs_inode));
+
+                inode->blocksFileSize = type == TYPEVAL_DIRETORIO ? 1 : 0;
+                inode->bytesFileSize = type == TYPEVAL_DIRETORIO ? g_fs->sb->blockSize * SECTOR_SIZE : 0;
+                inode->dataPtr[0] = type == TYPEVAL_DIRETORIO ? b_dados : INVALID_PTR;
+                inode->dataPtr[1] = INVALID_PTR;
+                inode->singleIndPtr = INVALID_PTR;
+                inode->doubleIndPtr = INVALID_PTR;
+                inode->reservado[INODE_FLAGS] = type == TYPEVAL_DIRETORIO ? 0 : INODE_FLAG_INLINE;
+                inode->reservado[INODE_FRAGMENT] = INVALID_PTR;
+
+                if( __inode_write(inode, b_inode) == OP_SUCCESS )
+                {
+                    if( __record_write(record, idxFreeRecord, __block_navigate(idxFreeRecord, sizeof(struct t2fs_record), parentInode)) == OP_SUCCESS )
+                    {
+                        __bitmap_set(BITMAP_INODE, b_inode, 1);
+
+                        __dir_hint_set(parentRecord->inodeNumber, idxFreeRecord + 1);
+                        __dir_hint_count(parentRecord->inodeNumber, 1);
+                        __dir_hint_set_last_child(parentRecord->inodeNumber, b_inode);
+                        __dir_hint_invalidate(b_inode);
+
+                        if( type == TYPEVAL_DIRETORIO )
+                        {
+                            __bitmap_set(BITMAP_DADOS, b_dados, 1);
+                            __block_init(b_dados, 0);
+
+                            struct t2fs_record *selfRecord = (struct t2fs_record*)calloc(1, sizeof(struct t2fs_record));
+                            struct t2fs_record *selfParentRecord = (struct t2fs_record*)calloc(1, sizeof(struct t2fs_record));
+
+                            strcpy(selfRecord->name, ".");
+                            selfRecord->TypeVal = TYPEVAL_DIRETORIO;
+                            selfRecord->inodeNumber = b_inode;
+
+                            strcpy(selfParentRecord->name, "..");
+                            selfParentRecord->TypeVal = TYPEVAL_DIRETORIO;
+                            selfParentRecord->inodeNumber = parentRecord->inodeNumber;
+
+                            __record_write(selfRecord, 0, b_dados);
+                            __record_write(selfParentRecord, 1, b_dados);
+
+                            __dir_hint_set(b_inode, 2);
+                            __dir_hint_set_live(b_inode, 2);
+
+                            free(selfRecord);
+                            free(selfParentRecord);
+                        }
+
+                        free(inode);
+                        free(record);
+
+
+                        return OP_SUCCESS;
+                    }
+                }
+            }
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Calcula a posição do caminho no cache de resolução de caminhos
+
+Entra:
+    parsedPath -> caminho já normalizado
+
+Saída:
+    Índice no cache.
+-----------------------------------------------------------------------------*/
+unsigned int __path_cache_idx(char *parsedPath)
+{
+    unsigned int hash = 5381;
+    int i;
+
+    for( i = 0; parsedPath[i] != '\0'; i++ )
+    {
+        hash = ((hash << 5) + hash) + (BYTE)parsedPath[i];
+    }
+
+    return hash % PATH_CACHE_SIZE;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Procura o record do caminho no cache de resolução de caminhos
+
+Entra:
+    parsedPath -> caminho já normalizado
+
+Saída:
+    Se encontrado, retorna uma cópia do record
+    Se não, retorna NULL.
+-----------------------------------------------------------------------------*/
+struct t2fs_record* __path_cache_get(char *parsedPath)
+{
+    PATH_CACHE_ENTRY *entry = &g_fs->pathCache[__path_cache_idx(parsedPath)];
+    struct t2fs_record *record;
+
+    if( entry->path != NULL && strcmp(entry->path, parsedPath) == 0 )
+    {
+        record = (struct t2fs_record*)malloc(sizeof(struct t2fs_record));
+        memcpy(record, &entry->record, sizeof(struct t2fs_record));
+
+        return record;
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Guarda o record do caminho no cache de resolução de caminhos
+
+Entra:
+    parsedPath -> caminho já normalizado
+    record -> record associado
+-----------------------------------------------------------------------------*/
+void __path_cache_put(char *parsedPath, struct t2fs_record *record)
+{
+    PATH_CACHE_ENTRY *entry = &g_fs->pathCache[__path_cache_idx(parsedPath)];
+
+    free(entry->path);
+
+    entry->path = strdup(parsedPath);
+    memcpy(&entry->record, record, sizeof(struct t2fs_record));
+}
+
+/*-----------------------------------------------------------------------------
+Função: Descarta todo o cache de resolução de caminhos
+-----------------------------------------------------------------------------*/
+void __path_cache_clear()
+{
+    int i;
+
+    for( i = 0; i < PATH_CACHE_SIZE; i++ )
+    {
+        free(g_fs->pathCache[i].path);
+        g_fs->pathCache[i].path = NULL;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Encontra o record indicado pelo caminho informado
+
+Entra:
+    parsedPath -> caminho já normalizado
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o record associado
+    Se ocorreu algum erro, retorna NULL.
+-----------------------------------------------------------------------------*/
+struct t2fs_record* __record_navigate(char *parsedPath)
+{
+    char *auxPathname;
+    struct t2fs_record *record = NULL;
+    struct t2fs_inode *inode = NULL;
+
+    if( parsedPath != NULL )
+    {
+        record = __path_cache_get(parsedPath);
+
+        if( record != NULL )
+        {
+            return record;
+        }
+
+        auxPathname = (char*)calloc(strlen(parsedPath) + 1, sizeof(char));
+        strcpy(auxPathname, parsedPath);
+
+
+        // Caminho absoluto
+        if( auxPathname[0] == '/' )
+        {
+            record = __record_get_by_name(".", g_fs->ri);
+            inode = g_fs->ri;
+        }
+        else
+        {
+            record = g_fs->cwdRecord;
+            inode = __inode_get_by_idx(g_fs->cwdRecord->inodeNumber);
+        }
+
+        char *token;
+
+        while( (token = strsep(&auxPathname, "/")) )
+        {
+            if( strlen(token) > 0 )
+            {
+                record = __record_get_by_name(token, inode);
+
+                if( record != NULL )
+                {
+                    inode = __inode_get_by_idx(record->inodeNumber);
+                }
+                else
+                {
+                    return NULL;
+                }
+            }
+        }
+
+        if( record != NULL )
+        {
+            __path_cache_put(parsedPath, record);
+        }
+
+        return record;
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Cria um record no caminho especificado
+
+Entra:
+    path -> caminho para o record
+    type -> tipo do record
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_create(char *pathname, int type)
+{
+    char* parsedPath = parse_path(pathname, g_fs->cwd);
+
+    if( parsedPath != NULL )
+    {
+        struct t2fs_record *record = __record_navigate(parsedPath);
+
+        // Se já não existe algum record com esse nome
+        if( record == NULL )
+        {
+            char* recordName = extract_recordname(parsedPath);
+            struct t2fs_record *parentRecord = __record_navigate(parsedPath);
+
+            // Se o record pai existe
+            if( parentRecord != NULL && strlen(recordName) > 0 )
+            {
+                return __record_alocate(recordName, type, parentRecord);
+            }
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Verifica se um dado record está aberto
+
+Entra:
+    recordName -> nome do record
+    type -> tipo do record
+    recordWd-> "contexto" do record
+
+Saída:
+    Se veradeiro, retorna 1
+    Se falso 0.
+-----------------------------------------------------------------------------*/
+int __record_is_opened(char* recordName, int type, char* recordWd)
+{
+    HANDLER *handler = NULL;
+    int i;
+
+    if( type == TYPEVAL_REGULAR )
+    {
+        handler = g_fs->files;
+    }
+    else
+    {
+        handler = g_fs->dirs;
+    }
+
+    for( i = 0; i < MAX_NUM_HANDLERS; i++ )
+    {
+        if( !handler[i].free )
+        {
+            if( handler[i].record != NULL )
+            {
+                if( strcmp(handler[i].record->name, recordName) == 0 && strcmp(handler[i].wd, recordWd) == 0 )
+                {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Verifica se um dado diretório está vazio
+
+Entra:
+    recordName -> nome do record
+
+Saída:
+    Se veradeiro, retorna 1
+    Se falso 0.
+-----------------------------------------------------------------------------*/
+int __record_is_dir_empty(struct t2fs_record* dir)
+{
+    struct t2fs_record *record;
+    struct t2fs_inode *inode = __inode_get_by_idx(dir->inodeNumber);
+    int pointer = 0, recordCounter = 0;
+
+    record = __record_get_by_idx(pointer, inode);
+
+    while( record != NULL )
+    {
+        if( record->TypeVal == TYPEVAL_REGULAR || record->TypeVal == TYPEVAL_DIRETORIO )
+        {
+            if( strcmp(record->name, ".") != 0 && strcmp(record->name, "..") != 0 )
+            {
+                recordCounter++;
+            }
+        }
+        else
+        {
+            break;
+        }
+
+        pointer++;
+        record = __record_get_by_idx(pointer, inode);
+    }
+
+    return recordCounter == 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Conta os registros válidos do diretório
+
+Entra:
+    inode -> inode do diretório
+
+Saída:
+    Número de registros válidos (incluindo "." e "..").
+-----------------------------------------------------------------------------*/
+DWORD __record_count_live(struct t2fs_inode *inode)
+{
+    int recordSize = sizeof(struct t2fs_record);
+    int entryPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / recordSize;
+    BYTE *blockBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+    DWORD idxBlock, liveRecords = 0;
+    int i;
+
+    for( idxBlock = 0; idxBlock < inode->blocksFileSize; idxBlock++ )
+    {
+        if( __block_read(__block_get_by_idx(idxBlock, inode), blockBuffer) == OP_SUCCESS )
+        {
+            for( i = 0; i < entryPerBlock; i++ )
+            {
+                BYTE typeVal = blockBuffer[i * recordSize];
+
+                if( typeVal == TYPEVAL_REGULAR || typeVal == TYPEVAL_DIRETORIO )
+                {
+                    liveRecords++;
+                }
+            }
+        }
+    }
+
+    free(blockBuffer);
+
+    return liveRecords;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Verifica se o diretório deve ser compactado (poucos registros válidos
+        para o número de blocos alocados)
+
+Entra:
+    inode -> inode do diretório
+    inodeNumber -> número do inode
+
+Saída:
+    Se veradeiro, retorna 1
+    Se falso 0.
+-----------------------------------------------------------------------------*/
+int __dir_needs_compaction(struct t2fs_inode *inode, DWORD inodeNumber)
+{
+    int entryPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(struct t2fs_record);
+    DIR_HINT *hint = &g_fs->dirHints[__dir_hint_slot(inodeNumber)];
+    DWORD liveRecords;
+
+    if( inode->blocksFileSize <= 1 )
+    {
+        return 0;
+    }
+
+    if( hint->valid && hint->inodeNumber == inodeNumber && hint->liveKnown )
+    {
+        liveRecords = hint->liveRecords;
+    }
+    else
+    {
+        liveRecords = __record_count_live(inode);
+        __dir_hint_set_live(inodeNumber, liveRecords);
+    }
+
+    return (liveRecords * DIR_COMPACT_RATIO) < (inode->blocksFileSize * entryPerBlock);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Compacta o diretório: move os registros válidos para o início (mantendo
+        a ordem), ajusta os ponteiros dos handlers abertos e libera os blocos finais.
+        Os registros são escritos do início para o fim, de forma que cada registro
+        válido sempre existe em ao menos uma posição do diretório.
+
+Entra:
+    inode -> inode do diretório (é atualizado)
+    inodeNumber -> número do inode
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __dir_compact(struct t2fs_inode *inode, DWORD inodeNumber)
+{
+    int blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    int recordSize = sizeof(struct t2fs_record);
+    int entryPerBlock = blockBytes / recordSize;
+    DWORD numEntries = inode->blocksFileSize * entryPerBlock;
+    DWORD *newIdx = (DWORD*)malloc((numEntries + 1) * sizeof(DWORD));
+    BYTE *readBuffer = (BYTE*)malloc(blockBytes);
+    BYTE *writeBuffer = (BYTE*)calloc(blockBytes, sizeof(BYTE));
+    DWORD idxBlock, liveRecords = 0, writeBlock = 0;
+    int i, result = OP_SUCCESS;
+
+    for( idxBlock = 0; idxBlock < inode->blocksFileSize && result == OP_SUCCESS; idxBlock++ )
+    {
+        if( __block_read(__block_get_by_idx(idxBlock, inode), readBuffer) != OP_SUCCESS )
+        {
+            result = OP_ERROR;
+            break;
+        }
+
+        for( i = 0; i < entryPerBlock; i++ )
+        {
+            BYTE typeVal = readBuffer[i * recordSize];
+
+            newIdx[idxBlock * entryPerBlock + i] = liveRecords;
+
+            if( typeVal == TYPEVAL_REGULAR || typeVal == TYPEVAL_DIRETORIO )
+            {
+                memcpy(writeBuffer + (liveRecords % entryPerBlock) * recordSize, readBuffer + i * recordSize, recordSize);
+                liveRecords++;
+
+                // Bloco destino cheio: nunca está à frente do bloco lido
+                if( liveRecords % entryPerBlock == 0 )
+                {
+                    if( __block_write(__block_get_by_idx(writeBlock, inode), writeBuffer) != OP_SUCCESS )
+                    {
+                        result = OP_ERROR;
+                        break;
+                    }
+
+                    memset(writeBuffer, 0, blockBytes);
+                    writeBlock++;
+                }
+            }
+        }
+    }
+
+    if( result == OP_SUCCESS && (liveRecords % entryPerBlock != 0 || writeBlock == 0) )
+    {
+        result = __block_write(__block_get_by_idx(writeBlock, inode), writeBuffer);
+        writeBlock++;
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        newIdx[numEntries] = liveRecords;
+
+        for( i = 0; i < MAX_NUM_HANDLERS; i++ )
+        {
+            if( !g_fs->dirs[i].free && g_fs->dirs[i].record != NULL && g_fs->dirs[i].record->inodeNumber == inodeNumber )
+            {
+                g_fs->dirs[i].pointer = g_fs->dirs[i].pointer < numEntries ? newIdx[g_fs->dirs[i].pointer] : liveRecords;
+            }
+        }
+
+        while( inode->blocksFileSize > writeBlock )
+        {
+            if( __block_free(inode, inodeNumber) != OP_SUCCESS )
+            {
+                result = OP_ERROR;
+                break;
+            }
+        }
+
+        inode->bytesFileSize = inode->blocksFileSize * blockBytes;
+
+        if( __inode_write(inode, inodeNumber) != OP_SUCCESS )
+        {
+            result = OP_ERROR;
+        }
+
+        __inode_sync_root(inode, inodeNumber);
+
+        __dir_hint_set(inodeNumber, liveRecords);
+        __dir_hint_set_live(inodeNumber, liveRecords);
+    }
+
+    free(newIdx);
+    free(readBuffer);
+    free(writeBuffer);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Libera todos os blocos e o próprio inode
+
+Entra:
+    inodeNumber -> número do inode a ser liberado
+-----------------------------------------------------------------------------*/
+void __inode_free(DWORD inodeNumber)
+{
+    struct t2fs_inode *inode = __inode_get_by_idx(inodeNumber);
+
+    if( inode != NULL )
+    {
+        __inode_truncate(inode, inodeNumber, 0);
+        free(inode);
+    }
+
+    __bitmap_set(BITMAP_INODE, inodeNumber, 0);
+    __dir_hint_invalidate(inodeNumber);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Remove o record pelo nome
+
+Entra:
+    name -> nome do record
+    parentRecord -> record pai
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_free(char* name, struct t2fs_record* parentRecord)
+{
+    struct t2fs_inode *parentInode = __inode_get_by_idx(parentRecord->inodeNumber);
+    struct t2fs_record *record;
+    int idxRecord = __record_get_idx_by_name(name, parentInode);
+
+    if( idxRecord != OP_ERROR )
+    {
+        record = __record_get_by_name(name, parentInode);
+
+        record->TypeVal = TYPEVAL_INVALIDO;
+
+        __record_write(record, idxRecord, __block_navigate(idxRecord, sizeof(struct t2fs_record), parentInode));
+        __path_cache_clear();
+        __dir_hint_release(parentRecord->inodeNumber, idxRecord);
+        __dir_hint_count(parentRecord->inodeNumber, -1);
+
+        __inode_free(record->inodeNumber);
+
+        if( __dir_needs_compaction(parentInode, parentRecord->inodeNumber) )
+        {
+            __dir_compact(parentInode, parentRecord->inodeNumber);
+        }
+
+        return OP_SUCCESS;
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Deleta o record
+
+Entra:
+    path -> caminho para o record
+    type -> tipo do record
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_delete(char *pathname, int type)
+{
+    char* parsedPath = parse_path(pathname, g_fs->cwd);
+
+    if( parsedPath != NULL )
+    {
+        struct t2fs_record *record = __record_navigate(parsedPath);
+
+        // Se existe algum record com esse nome
+        if( record != NULL )
+        {
+            char* recordName = extract_recordname(parsedPath);
+            struct t2fs_record *parentRecord = __record_navigate(parsedPath);
+
+            // Se é válido e se é do tipo indicado
+            if( strlen(recordName) > 0 && record->TypeVal == type )
+            {
+                if( !__record_is_opened(recordName, type, parsedPath) )
+                {
+                    if( type == TYPEVAL_DIRETORIO )
+                    {
+                        if( !__record_is_dir_empty(record) )
+                        {
+
+                            return OP_ERROR;
+                        }
+                    }
+
+                    return __record_free(recordName, parentRecord);
+                }
+            }
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Troca o prefixo 'oldPrefix' de um caminho por 'newPrefix'
+
+Entra:
+    path -> caminho a ser verificado
+    oldPrefix -> prefixo (caminho de um diretório ou arquivo)
+    newPrefix -> novo prefixo
+
+Saída:
+    Se o caminho é 'oldPrefix' ou está abaixo dele, retorna o novo caminho
+    Se não, retorna NULL.
+-----------------------------------------------------------------------------*/
+char* __path_replace_prefix(char *path, char *oldPrefix, char *newPrefix)
+{
+    int prefixLen = strlen(oldPrefix);
+    char *newPath;
+
+    if( path == NULL || strncmp(path, oldPrefix, prefixLen) != 0 || (path[prefixLen] != '\0' && path[prefixLen] != '/') )
+    {
+        return NULL;
+    }
+
+    newPath = (char*)calloc(strlen(newPrefix) + strlen(path + prefixLen) + 1, sizeof(char));
+    strcpy(newPath, newPrefix);
+    strcat(newPath, path + prefixLen);
+
+    return newPath;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Atualiza os handlers e o diretório corrente após um record ser movido
+
+Entra:
+    inodeNumber -> inode do record movido
+    newName -> novo nome do record
+    newWd -> novo caminho do diretório pai do record
+    oldPath -> caminho antigo do record
+    newPath -> caminho novo do record
+-----------------------------------------------------------------------------*/
+void __handler_rename(DWORD inodeNumber, char *newName, char *newWd, char *oldPath, char *newPath)
+{
+    HANDLER *handlers[2] = { g_fs->files, g_fs->dirs };
+    char *replaced;
+    int i, j;
+
+    for( j = 0; j < 2; j++ )
+    {
+        for( i = 0; i < MAX_NUM_HANDLERS; i++ )
+        {
+            if( handlers[j][i].free || handlers[j][i].record == NULL )
+            {
+                continue;
+            }
+
+            if( handlers[j][i].record->inodeNumber == inodeNumber )
+            {
+                strcpy(handlers[j][i].record->name, newName);
+                handlers[j][i].wd = strdup(newWd);
+            }
+            else if( (replaced = __path_replace_prefix(handlers[j][i].wd, oldPath, newPath)) != NULL )
+            {
+                handlers[j][i].wd = replaced;
+            }
+        }
+    }
+
+    if( (replaced = __path_replace_prefix(g_fs->cwd, oldPath, newPath)) != NULL )
+    {
+        g_fs->cwd = replaced;
+
+        if( g_fs->cwdRecord->inodeNumber == inodeNumber )
+        {
+            strcpy(g_fs->cwdRecord->name, newName);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Move (renomeia) um record, alterando apenas as entradas de diretório.
+        O registro destino é escrito antes de o registro origem ser invalidado, de
+        forma que uma falha no meio da operação nunca perde os dois nomes. Se o destino
+        é um arquivo regular existente, seu registro é substituído e seu inode liberado.
+
+Entra:
+    oldpath -> caminho atual do record
+    newpath -> novo caminho do record
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_rename(char *oldpath, char *newpath)
+{
+    char *srcPath = parse_path(oldpath, g_fs->cwd);
+    char *dstPath = parse_path(newpath, g_fs->cwd);
+    char *srcFullPath, *dstFullPath, *srcName, *dstName;
+    struct t2fs_record *record, *dstRecord, *srcParent, *dstParent, *parentLink;
+    struct t2fs_inode *srcParentInode, *dstParentInode, *inode;
+    int idxSrc, idxDst, idxParentLink;
+
+    if( srcPath == NULL || dstPath == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    record = __record_navigate(srcPath);
+
+    if( record == NULL || strcmp(srcPath, "/") == 0 )
+    {
+        return OP_ERROR;
+    }
+
+    if( strcmp(srcPath, dstPath) == 0 )
+    {
+        return OP_SUCCESS;
+    }
+
+    // Um diretório não pode ser movido para dentro de si mesmo
+    if( __path_replace_prefix(dstPath, srcPath, "") != NULL )
+    {
+        return OP_ERROR;
+    }
+
+    dstRecord = __record_navigate(dstPath);
+
+    srcFullPath = strdup(srcPath);
+    dstFullPath = strdup(dstPath);
+    srcName = extract_recordname(srcPath);
+    dstName = extract_recordname(dstPath);
+    srcParent = __record_navigate(srcPath);
+    dstParent = __record_navigate(dstPath);
+
+    if( srcParent == NULL || dstParent == NULL || dstParent->TypeVal != TYPEVAL_DIRETORIO )
+    {
+        return OP_ERROR;
+    }
+
+    if( strlen(dstName) == 0 || strlen(dstName) > (RECORD_NAME_SIZE - 1) || strcmp(dstName, ".") == 0 || strcmp(dstName, "..") == 0 ||
+        strcmp(srcName, ".") == 0 || strcmp(srcName, "..") == 0 )
+    {
+        return OP_ERROR;
+    }
+
+    if( dstRecord != NULL )
+    {
+        if( dstRecord->TypeVal != TYPEVAL_REGULAR || record->TypeVal != TYPEVAL_REGULAR || __record_is_opened(dstName, TYPEVAL_REGULAR, dstPath) )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    dstParentInode = __inode_get_by_idx(dstParent->inodeNumber);
+    srcParentInode = srcParent->inodeNumber == dstParent->inodeNumber ? dstParentInode : __inode_get_by_idx(srcParent->inodeNumber);
+
+    idxSrc = __record_get_idx_by_name(srcName, srcParentInode);
+    idxDst = dstRecord != NULL ? __record_get_idx_by_name(dstName, dstParentInode) : __record_get_slot(dstParentInode, dstParent->inodeNumber);
+
+    if( idxSrc == OP_ERROR || idxDst == OP_ERROR )
+    {
+        return OP_ERROR;
+    }
+
+    // 1. Publica o novo nome
+    strncpy(record->name, dstName, RECORD_NAME_SIZE - 1);
+
+    if( __record_write(record, idxDst, __block_navigate(idxDst, sizeof(struct t2fs_record), dstParentInode)) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    // 2. Diretório movido para outro pai: atualiza o ".."
+    if( record->TypeVal == TYPEVAL_DIRETORIO && srcParent->inodeNumber != dstParent->inodeNumber )
+    {
+        inode = __inode_get_by_idx(record->inodeNumber);
+        idxParentLink = __record_get_idx_by_name("..", inode);
+        parentLink = __record_get_by_name("..", inode);
+
+        if( parentLink != NULL )
+        {
+            parentLink->inodeNumber = dstParent->inodeNumber;
+            __record_write(parentLink, idxParentLink, __block_navigate(idxParentLink, sizeof(struct t2fs_record), inode));
+        }
+    }
+
+    // 3. Remove o nome antigo
+    record->TypeVal = TYPEVAL_INVALIDO;
+    __record_write(record, idxSrc, __block_navigate(idxSrc, sizeof(struct t2fs_record), srcParentInode));
+
+    __path_cache_clear();
+    __dir_hint_release(srcParent->inodeNumber, idxSrc);
+    __dir_hint_count(srcParent->inodeNumber, -1);
+
+    if( dstRecord != NULL )
+    {
+        // 4. Libera o arquivo substituído
+        __inode_free(dstRecord->inodeNumber);
+    }
+    else
+    {
+        __dir_hint_set(dstParent->inodeNumber, idxDst + 1);
+        __dir_hint_count(dstParent->inodeNumber, 1);
+    }
+
+    __handler_rename(record->inodeNumber, dstName, dstPath, srcFullPath, dstFullPath);
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Acrescenta um número ao fim da lista, aumentando-a se necessário
+
+Entra:
+    list -> lista
+    value -> número a ser acrescentado
+-----------------------------------------------------------------------------*/
+void __list_append(DWORD_LIST *list, DWORD value)
+{
+    if( list->count == list->capacity )
+    {
+        list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        list->items = (DWORD*)realloc(list->items, list->capacity * sizeof(DWORD));
+    }
+
+    list->items[list->count++] = value;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Acrescenta às listas todos os blocos do inode (dados e indireção) e o seu
+        fragmento, se houver
+
+Entra:
+    inode -> inode cujos blocos devem ser coletados
+    blocks -> lista onde colocar os blocos
+    fragments -> lista onde colocar o primeiro setor e o número de setores do fragmento
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_collect_blocks(struct t2fs_inode *inode, DWORD_LIST *blocks, DWORD_LIST *fragments)
+{
+    DWORD blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD *map = (DWORD*)malloc((inode->blocksFileSize + 1) * sizeof(DWORD));
+    DWORD i;
+    int result = __inode_map_read(inode, map, NULL);
+
+    if( inode->reservado[INODE_FLAGS] != 0 && inode->reservado[INODE_FRAGMENT] != INVALID_PTR )
+    {
+        __list_append(fragments, inode->reservado[INODE_FRAGMENT]);
+        __list_append(fragments, __inode_fragment_sectors(inode));
+    }
+
+    for( i = 0; i < inode->blocksFileSize && result == OP_SUCCESS; i++ )
+    {
+        if( map[i] != INVALID_PTR )
+        {
+            __list_append(blocks, map[i]);
+        }
+    }
+
+    if( __block_is_valid(inode->singleIndPtr) )
+    {
+        __list_append(blocks, inode->singleIndPtr);
+    }
+
+    if( __block_is_valid(inode->doubleIndPtr) && result == OP_SUCCESS )
+    {
+        for( i = 0; i < blockNumberPerBlock; i++ )
+        {
+            DWORD indBlockNumber = __block_read_ptr(i, inode->doubleIndPtr);
+
+            if( __block_is_valid(indBlockNumber) )
+            {
+                __list_append(blocks, indBlockNumber);
+            }
+        }
+
+        __list_append(blocks, inode->doubleIndPtr);
+    }
+
+    free(map);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Percorre, em pós-ordem, a árvore do diretório 'inodeNumber', coletando os
+        inodes, os blocos e os fragmentos de todos os seus arquivos e subdiretórios (e
+        dele mesmo). Cada bloco de diretório é lido uma única vez.
+
+Entra:
+    inodeNumber -> inode do diretório
+    inodes -> lista onde colocar os inodes
+    blocks -> lista onde colocar os blocos
+    fragments -> lista onde colocar os fragmentos (setor inicial e número de setores)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __tree_collect(DWORD inodeNumber, DWORD_LIST *inodes, DWORD_LIST *blocks, DWORD_LIST *fragments)
+{
+    struct t2fs_inode *inode = __inode_get_by_idx(inodeNumber);
+    int entryPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(struct t2fs_record);
+    struct t2fs_record record;
+    BYTE *blockBuffer;
+    DWORD idxBlock;
+    int i, result = OP_SUCCESS;
+
+    if( inode == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    blockBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+
+    for( idxBlock = 0; idxBlock < inode->blocksFileSize && result == OP_SUCCESS; idxBlock++ )
+    {
+        DWORD blockNumber = __block_get_by_idx(idxBlock, inode);
+
+        if( blockNumber == INVALID_PTR )
+        {
+            continue;
+        }
+
+        if( __block_read(blockNumber, blockBuffer) != OP_SUCCESS )
+        {
+            result = OP_ERROR;
+            break;
+        }
+
+        for( i = 0; i < entryPerBlock && result == OP_SUCCESS; i++ )
+        {
+            buffer_read_record(blockBuffer, i * sizeof(struct t2fs_record), &record);
+
+            if( strcmp(record.name, ".") == 0 || strcmp(record.name, "..") == 0 )
+            {
+                continue;
+            }
+
+            if( record.TypeVal == TYPEVAL_DIRETORIO )
+            {
+                result = __tree_collect(record.inodeNumber, inodes, blocks, fragments);
+            }
+            else if( record.TypeVal == TYPEVAL_REGULAR )
+            {
+                struct t2fs_inode *fileInode = __inode_get_by_idx(record.inodeNumber);
+
+                result = fileInode != NULL ? __inode_collect_blocks(fileInode, blocks, fragments) : OP_ERROR;
+                __list_append(inodes, record.inodeNumber);
+
+                free(fileInode);
+            }
+        }
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        result = __inode_collect_blocks(inode, blocks, fragments);
+        __list_append(inodes, inodeNumber);
+    }
+
+    free(blockBuffer);
+    free(inode);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Verifica se algum arquivo ou diretório dentro de 'treePath' (inclusive) está
+        aberto ou é o diretório corrente
+
+Entra:
+    treePath -> caminho absoluto da raiz da árvore
+
+Saída:
+    Se verdadeiro, retorna 1
+    Se falso 0.
+-----------------------------------------------------------------------------*/
+int __tree_is_in_use(char *treePath)
+{
+    HANDLER *handlers[2] = { g_fs->files, g_fs->dirs };
+    char *inside;
+    int i, j;
+
+    for( j = 0; j < 2; j++ )
+    {
+        for( i = 0; i < MAX_NUM_HANDLERS; i++ )
+        {
+            if( handlers[j][i].free || handlers[j][i].record == NULL || handlers[j][i].wd == NULL )
+            {
+                continue;
+            }
+
+            // 'wd' é o diretório que contém o record aberto
+            char *path = (char*)calloc(strlen(handlers[j][i].wd) + strlen(handlers[j][i].record->name) + 2, sizeof(char));
+
+            strcpy(path, handlers[j][i].wd);
+
+            if( strcmp(path, "/") != 0 )
+            {
+                strcat(path, "/");
+            }
+
+            strcat(path, handlers[j][i].record->name);
+            inside = __path_replace_prefix(path, treePath, "");
+            free(path);
+
+            if( inside != NULL )
+            {
+                free(inside);
+
+                return 1;
+            }
+        }
+    }
+
+    inside = __path_replace_prefix(g_fs->cwd, treePath, "");
+
+    if( inside != NULL )
+    {
+        free(inside);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Remove o diretório 'pathname' e todo o seu conteúdo
+
+Entra:
+    pathname -> caminho do diretório
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_rmtree(char *pathname)
+{
+    char *parsedPath = parse_path(pathname, g_fs->cwd);
+    char *treePath, *recordName;
+    struct t2fs_record *record, *parentRecord;
+    struct t2fs_inode *parentInode;
+    DWORD_LIST inodes = { NULL, 0, 0 }, blocks = { NULL, 0, 0 }, fragments = { NULL, 0, 0 };
+    DWORD i;
+    int idxRecord, result;
+
+    if( parsedPath == NULL || strcmp(parsedPath, "/") == 0 )
+    {
+        return OP_ERROR;
+    }
+
+    record = __record_navigate(parsedPath);
+
+    if( record == NULL || record->TypeVal != TYPEVAL_DIRETORIO )
+    {
+        return OP_ERROR;
+    }
+
+    treePath = strdup(parsedPath);
+    recordName = extract_recordname(parsedPath);
+    parentRecord = __record_navigate(parsedPath);
+
+    if( parentRecord == NULL || __tree_is_in_use(treePath) )
+    {
+        free(treePath);
+
+        return OP_ERROR;
+    }
+
+    free(treePath);
+
+    parentInode = __inode_get_by_idx(parentRecord->inodeNumber);
+    idxRecord = __record_get_idx_by_name(recordName, parentInode);
+    result = idxRecord != OP_ERROR ? __tree_collect(record->inodeNumber, &inodes, &blocks, &fragments) : OP_ERROR;
+
+    if( result == OP_SUCCESS )
+    {
+        // Remove a entrada da raiz da árvore e libera todo o conteúdo de uma vez
+        record->TypeVal = TYPEVAL_INVALIDO;
+        __record_write(record, idxRecord, __block_navigate(idxRecord, sizeof(struct t2fs_record), parentInode));
+
+        __path_cache_clear();
+        __dir_hint_release(parentRecord->inodeNumber, idxRecord);
+        __dir_hint_count(parentRecord->inodeNumber, -1);
+
+        result = __block_release_list(blocks.items, blocks.count);
+
+        for( i = 0; i + 1 < fragments.count; i += 2 )
+        {
+            __fragment_free(fragments.items[i], fragments.items[i + 1]);
+        }
+
+        for( i = 0; i < inodes.count; i++ )
+        {
+            __bitmap_set(BITMAP_INODE, inodes.items[i], 0);
+            __dir_hint_invalidate(inodes.items[i]);
+        }
+
+        if( __dir_needs_compaction(parentInode, parentRecord->inodeNumber) )
+        {
+            __dir_compact(parentInode, parentRecord->inodeNumber);
+        }
+    }
+
+    free(inodes.items);
+    free(blocks.items);
+    free(fragments.items);
+    free(parentInode);
+    free(record);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Faz o inode 'dstInode' compartilhar os blocos de dados de 'srcInode'.
+        Apenas os blocos de indireção (metadados) são copiados; cada bloco de dados
+        ganha uma referência na tabela de contadores.
+
+Entra:
+    srcInode -> inode de origem
+    dstInode -> inode de destino, sem blocos (é atualizado)
+    dstInodeNumber -> número do inode de destino
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_clone(struct t2fs_inode *srcInode, struct t2fs_inode *dstInode, DWORD dstInodeNumber)
+{
+    int blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD *blocks = (DWORD*)malloc((srcInode->blocksFileSize + 1) * sizeof(DWORD));
+    DWORD_LIST copies = { NULL, 0, 0 };
+    DWORD indBlocks = 0, i;
+    int j, result = OP_SUCCESS;
+
+    if( __inode_map_read(srcInode, blocks, &indBlocks) != OP_SUCCESS || g_fs->sbe->freeBlocks < indBlocks )
+    {
+        free(blocks);
+
+        return OP_ERROR;
+    }
+
+    // As páginas dos contadores são criadas antes de qualquer alteração, para que o incremento não falhe
+    for( i = 0; i < srcInode->blocksFileSize; i++ )
+    {
+        if( blocks[i] != INVALID_PTR && __refcount_reserve(blocks[i]) != OP_SUCCESS )
+        {
+            free(blocks);
+
+            return OP_ERROR;
+        }
+    }
+
+    dstInode->reservado[INODE_FLAGS] = srcInode->reservado[INODE_FLAGS];
+    dstInode->reservado[INODE_FRAGMENT] = INVALID_PTR;
+
+    // Fragmentos não são compartilhados: o conteúdo embutido (ou a cauda) é copiado
+    if( srcInode->reservado[INODE_FRAGMENT] != INVALID_PTR && srcInode->reservado[INODE_FLAGS] != 0 )
+    {
+        dstInode->reservado[INODE_FRAGMENT] = __fragment_copy(srcInode->reservado[INODE_FRAGMENT], __inode_fragment_sectors(srcInode));
+
+        if( dstInode->reservado[INODE_FRAGMENT] == INVALID_PTR )
+        {
+            free(blocks);
+
+            return OP_ERROR;
+        }
+    }
+
+    if( __inode_is_inline(srcInode) )
+    {
+        free(blocks);
+
+        dstInode->bytesFileSize = srcInode->bytesFileSize;
+        result = __inode_write(dstInode, dstInodeNumber);
+
+        if( result != OP_SUCCESS )
+        {
+            __fragment_free(dstInode->reservado[INODE_FRAGMENT], __inode_fragment_sectors(srcInode));
+        }
+
+        return result;
+    }
+
+    dstInode->dataPtr[0] = srcInode->dataPtr[0];
+    dstInode->dataPtr[1] = srcInode->dataPtr[1];
+    dstInode->singleIndPtr = INVALID_PTR;
+    dstInode->doubleIndPtr = INVALID_PTR;
+
+    if( srcInode->singleIndPtr != INVALID_PTR )
+    {
+        dstInode->singleIndPtr = __block_copy_new(srcInode->singleIndPtr);
+        result = dstInode->singleIndPtr != INVALID_PTR ? OP_SUCCESS : OP_ERROR;
+        __list_append(&copies, dstInode->singleIndPtr);
+    }
+
+    if( srcInode->doubleIndPtr != INVALID_PTR && result == OP_SUCCESS )
+    {
+        dstInode->doubleIndPtr = __block_copy_new(srcInode->doubleIndPtr);
+        result = dstInode->doubleIndPtr != INVALID_PTR ? OP_SUCCESS : OP_ERROR;
+        __list_append(&copies, dstInode->doubleIndPtr);
+
+        for( j = 0; j < blockNumberPerBlock && result == OP_SUCCESS; j++ )
+        {
+            BYTE *entry = __block_get_entry(j, sizeof(DWORD), srcInode->doubleIndPtr);
+            DWORD indBlockNumber = buffer_to_dword(entry, 0);
+
+            free(entry);
+
+            if( indBlockNumber != INVALID_PTR )
+            {
+                DWORD newIndBlockNumber = __block_copy_new(indBlockNumber);
+
+                if( newIndBlockNumber == INVALID_PTR )
+                {
+                    result = OP_ERROR;
+                }
+                else
+                {
+                    __list_append(&copies, newIndBlockNumber);
+                    result = __block_write_ptr(j, newIndBlockNumber, dstInode->doubleIndPtr);
+                }
+            }
+        }
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        dstInode->blocksFileSize = srcInode->blocksFileSize;
+        dstInode->bytesFileSize = srcInode->bytesFileSize;
+
+        result = __inode_write(dstInode, dstInodeNumber);
+    }
+
+    // Os blocos de dados só ganham a referência com o inode gravado; sem ele, as cópias
+    // dos blocos de indireção e o fragmento copiado não pertencem a ninguém
+    if( result == OP_SUCCESS )
+    {
+        for( i = 0; i < srcInode->blocksFileSize; i++ )
+        {
+            if( blocks[i] != INVALID_PTR )
+            {
+                __refcount_add(blocks[i], 1);
+            }
+        }
+    }
+    else
+    {
+        for( i = 0; i < copies.count; i++ )
+        {
+            if( copies.items[i] != INVALID_PTR )
+            {
+                __block_forget(copies.items[i]);
+                __bitmap_set(BITMAP_DADOS, copies.items[i], 0);
+            }
+        }
+
+        __fragment_free(dstInode->reservado[INODE_FRAGMENT], __inode_fragment_sectors(srcInode));
+    }
+
+    free(copies.items);
+    free(blocks);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Cria o arquivo 'dstpath' compartilhando os blocos de dados do arquivo 'srcpath'
+
+Entra:
+    srcpath -> caminho do arquivo de origem
+    dstpath -> caminho do novo arquivo
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_clone(char *srcpath, char *dstpath)
+{
+    char *srcPath = parse_path(srcpath, g_fs->cwd);
+    char *dstPath;
+    struct t2fs_record *srcRecord, *dstRecord;
+    struct t2fs_inode *srcInode, *dstInode;
+    int result = OP_ERROR;
+
+    if( srcPath == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    srcRecord = __record_navigate(srcPath);
+
+    if( srcRecord == NULL || srcRecord->TypeVal != TYPEVAL_REGULAR )
+    {
+        return OP_ERROR;
+    }
+
+    if( __refcount_create() != OP_SUCCESS || __record_create(dstpath, TYPEVAL_REGULAR) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    dstPath = parse_path(dstpath, g_fs->cwd);
+    dstRecord = __record_navigate(dstPath);
+
+    if( dstRecord == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    srcInode = __inode_get_by_idx(srcRecord->inodeNumber);
+    dstInode = __inode_get_by_idx(dstRecord->inodeNumber);
+
+    if( srcInode != NULL && dstInode != NULL )
+    {
+        // Descarta o bloco inicial do arquivo recém-criado
+        while( dstInode->blocksFileSize > 0 )
+        {
+            __block_free(dstInode, dstRecord->inodeNumber);
+        }
+
+        result = __inode_clone(srcInode, dstInode, dstRecord->inodeNumber);
+
+        if( result != OP_SUCCESS )
+        {
+            __record_delete(dstpath, TYPEVAL_REGULAR);
+        }
+    }
+
+    free(srcInode);
+    free(dstInode);
+    free(srcRecord);
+    free(dstRecord);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Encontra (ou não) um handler de diretório e ou arquivo disponível
+
+Entra:
+    type -> tipo do record (o que implica no tipo do handler)
+
+Saída:
+    Se há handler disponível, retorna o índice
+    Se ocorreu algum erro, retorn OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __handler_get_free_idx(int type)
+{
+    int i;
+    HANDLER *handler;
+
+    if( type == TYPEVAL_REGULAR || type == TYPEVAL_DIRETORIO )
+    {
+        handler = type == TYPEVAL_REGULAR ? g_fs->files : g_fs->dirs;
+
+        for(i = 0; i < MAX_NUM_HANDLERS; i++)
+        {
+            if( handler[i].free )
+            {
+                return i;
+            }
+        }
+    }
+
+    return INVALID_PTR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Aloca um dado caminho
+
+Entra:
+    pathname -> caminho a ser alocado
+    type -> tipo do caminho (o que implica no tipo do handler)
+
+Saída:
+    Se há handler disponível, retorna o índice
+    Se ocorreu algum erro, retorn OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __handler_alocate(char* pathname, int type)
+{
+    char* parsedPath = parse_path(pathname, g_fs->cwd);
+
+    if( parsedPath != NULL )
+    {
+        struct t2fs_record *record = __record_navigate(parsedPath);
+
+        if( record != NULL )
+        {
+            int freeHandler = -1;
+            HANDLER *handler = NULL;
+
+            freeHandler = __handler_get_free_idx(type);
+            handler = type == TYPEVAL_REGULAR ? g_fs->files : g_fs->dirs;
+
+            if( freeHandler != INVALID_PTR )
+            {
+                handler[freeHandler].record = record;
+                handler[freeHandler].pointer = 0;
+                handler[freeHandler].free = 0;
+
+                // Tira o nome do record sendo adicionado do path
+                extract_recordname(parsedPath);
+                handler[freeHandler].wd = parsedPath;
+
+                return freeHandler;
+            }
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Desaloca um dado caminho
+
+Entra:
+    handle -> id no handler
+    type -> tipo do caminho (o que implica no tipo do handler)
+
+Saída:
+    Se há handler disponível, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorn OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __handler_free(int handle, int type)
+{
+    HANDLER *handler = NULL;
+
+    if( handle >= 0 && handle < MAX_NUM_HANDLERS )
+    {
+        if( type == TYPEVAL_REGULAR || type == TYPEVAL_DIRETORIO )
+        {
+            handler = type == TYPEVAL_REGULAR ? g_fs->files : g_fs->dirs;
+
+            if( !(handler[handle].free || handler[handle].record == NULL) )
+            {
+                handler[handle].record = NULL;
+                handler[handle].wd = NULL;
+                handler[handle].pointer = 0;
+                handler[handle].free = 1;
+
+                return OP_SUCCESS;
+            }
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Compara duas referências de inode pelo número do inode (para qsort)
+-----------------------------------------------------------------------------*/
+int __inode_ref_compare(const void *a, const void *b)
+{
+    DWORD inodeA = ((INODE_REF*)a)->inodeNumber;
+    DWORD inodeB = ((INODE_REF*)b)->inodeNumber;
+
+    return (inodeA > inodeB) - (inodeA < inodeB);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Preenche o tamanho das entradas lidas em lote, buscando os inodes em
+        ordem crescente para que entradas no mesmo setor de inodes dividam a leitura.
+        g_fs->lock é travada apenas durante cada leitura (ver nftw2).
+
+Entra:
+    dentries -> entradas a serem preenchidas
+    refs -> referências (inode, entrada) de cada entrada
+    count -> número de entradas
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __dentries_fill_size(DIRENT2 *dentries, INODE_REF *refs, int count)
+{
+    BYTE buffer[SECTOR_SIZE];
+    struct t2fs_inode inode;
+    unsigned int sector, lastSector = 0;
+    int i, hasSector = 0, result;
+
+    qsort(refs, count, sizeof(INODE_REF), __inode_ref_compare);
+
+    for( i = 0; i < count; i++ )
+    {
+        sector = __inode_get_sector(refs[i].inodeNumber);
+
+        if( !hasSector || sector != lastSector )
+        {
+            pthread_mutex_lock(&g_fs->lock);
+            result = __disk_read(sector, buffer);
+            pthread_mutex_unlock(&g_fs->lock);
+
+            if( result != OP_SUCCESS )
+            {
+                return OP_ERROR;
+            }
+
+            lastSector = sector;
+            hasSector = 1;
+        }
+
+        buffer_read_inode(buffer, __inode_get_sector_idx(refs[i].inodeNumber), &inode);
+        dentries[refs[i].idxEntry].fileSize = inode.bytesFileSize;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê em lote as entradas válidas do diretório a partir do ponteiro do handler,
+        decodificando cada bloco do diretório em uma única passada
+
+Entra:
+    handler -> handler do diretório (tem o ponteiro avançado)
+    dentries -> vetor onde colocar as entradas
+    max -> número máximo de entradas a serem lidas
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o número de entradas lidas
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_read_entries(HANDLER *handler, DIRENT2 *dentries, int max)
+{
+    struct t2fs_record record;
+    struct t2fs_inode *inode = __inode_get_by_idx(handler->record->inodeNumber);
+    int entryPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(struct t2fs_record);
+    DWORD idxBlock;
+    int i, count = 0, readOk = 1, result = OP_ERROR;
+    BYTE *blockBuffer;
+    INODE_REF *refs;
+
+    if( inode == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    blockBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+    refs = (INODE_REF*)malloc(max * sizeof(INODE_REF));
+
+    for( idxBlock = handler->pointer / entryPerBlock; count < max && idxBlock < inode->blocksFileSize && readOk; idxBlock++ )
+    {
+        if( __block_read(__block_get_by_idx(idxBlock, inode), blockBuffer) != OP_SUCCESS )
+        {
+            readOk = 0;
+            break;
+        }
+
+        for( i = handler->pointer % entryPerBlock; i < entryPerBlock && count < max; i++ )
+        {
+            buffer_read_record(blockBuffer, i * sizeof(struct t2fs_record), &record);
+            handler->pointer += 1;
+
+            if( record.TypeVal == TYPEVAL_REGULAR || record.TypeVal == TYPEVAL_DIRETORIO )
+            {
+                strcpy(dentries[count].name, record.name);
+                dentries[count].fileType = record.TypeVal;
+                refs[count].inodeNumber = record.inodeNumber;
+                refs[count].idxEntry = count;
+                count++;
+            }
+        }
+    }
+
+    if( readOk && __dentries_fill_size(dentries, refs, count) == OP_SUCCESS )
+    {
+        // Fim das entradas: volta ao início, como readdir2
+        if( count == 0 )
+        {
+            handler->pointer = 0;
+        }
+
+        result = count;
+    }
+
+    free(blockBuffer);
+    free(refs);
+    free(inode);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Insere um diretório no fim da fila (usada pela thread dona da fila)
+
+Entra:
+    deque -> fila
+    item -> diretório a ser inserido
+-----------------------------------------------------------------------------*/
+void __walk_push(WALK_DEQUE *deque, WALK_ITEM item)
+{
+    pthread_mutex_lock(&deque->lock);
+
+    if( deque->tail == deque->capacity )
+    {
+        // Reaproveita o espaço já roubado do início antes de crescer
+        if( deque->head > 0 )
+        {
+            memmove(deque->items, deque->items + deque->head, (deque->tail - deque->head) * sizeof(WALK_ITEM));
+            deque->tail -= deque->head;
+            deque->head = 0;
+        }
+
+        if( deque->tail == deque->capacity )
+        {
+            deque->capacity = deque->capacity == 0 ? 16 : deque->capacity * 2;
+            deque->items = (WALK_ITEM*)realloc(deque->items, deque->capacity * sizeof(WALK_ITEM));
+        }
+    }
+
+    deque->items[deque->tail++] = item;
+
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Retira um diretório da fila, do fim (dona) ou do início (roubo)
+
+Entra:
+    deque -> fila
+    item -> onde colocar o diretório retirado
+    steal -> 1 para retirar do início, 0 para retirar do fim
+
+Saída:
+    Se havia um diretório na fila, retorna 1
+    Se a fila estava vazia, 0.
+-----------------------------------------------------------------------------*/
+int __walk_take(WALK_DEQUE *deque, WALK_ITEM *item, int steal)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&deque->lock);
+
+    if( deque->head < deque->tail )
+    {
+        *item = steal ? deque->items[deque->head++] : deque->items[--deque->tail];
+        found = 1;
+
+        if( deque->head == deque->tail )
+        {
+            deque->head = 0;
+            deque->tail = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+
+    return found;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Enfileira um subdiretório na fila da thread e acorda uma thread ociosa
+
+Entra:
+    worker -> thread que encontrou o subdiretório
+    item -> subdiretório a ser visitado
+-----------------------------------------------------------------------------*/
+void __walk_enqueue(WALK_WORKER *worker, WALK_ITEM item)
+{
+    WALK_POOL *pool = worker->pool;
+
+    // 'queued' só muda com a trava do percurso: uma thread ociosa não perde o aviso
+    pthread_mutex_lock(&pool->lock);
+    pool->pending += 1;
+    __walk_push(&pool->deques[worker->id], item);
+    pool->queued += 1;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê todas as entradas válidas de um diretório, com tipo e tamanho. Cada bloco
+        do diretório é lido uma vez e os inodes das entradas são lidos em lote.
+        g_fs->lock é travada apenas durante cada acesso ao disco, de forma que as
+        threads de nftw2 intercalam suas leituras e decodificam os blocos em paralelo.
+
+Entra:
+    inodeNumber -> inode do diretório
+    dentries -> onde colocar o vetor de entradas (alocado pela função)
+    inodes -> onde colocar o vetor com o inode de cada entrada (alocado pela função)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o número de entradas
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __dir_read_all(DWORD inodeNumber, DIRENT2 **dentries, DWORD **inodes)
+{
+    int entryPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(struct t2fs_record);
+    struct t2fs_inode *inode;
+    struct t2fs_record record;
+    BYTE *blockBuffer;
+    INODE_REF *refs;
+    DWORD *map = NULL;
+    DWORD idxBlock;
+    int i, count = 0, result;
+
+    pthread_mutex_lock(&g_fs->lock);
+    inode = __inode_get_by_idx(inodeNumber);
+
+    if( inode != NULL )
+    {
+        map = (DWORD*)malloc((inode->blocksFileSize + 1) * sizeof(DWORD));
+        result = __inode_map_read(inode, map, NULL);
+    }
+    else
+    {
+        result = OP_ERROR;
+    }
+
+    pthread_mutex_unlock(&g_fs->lock);
+
+    if( result != OP_SUCCESS )
+    {
+        free(map);
+        free(inode);
+
+        return OP_ERROR;
+    }
+
+    blockBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+    *dentries = (DIRENT2*)malloc((inode->blocksFileSize * entryPerBlock + 1) * sizeof(DIRENT2));
+    refs = (INODE_REF*)malloc((inode->blocksFileSize * entryPerBlock + 1) * sizeof(INODE_REF));
+
+    for( idxBlock = 0; idxBlock < inode->blocksFileSize && result == OP_SUCCESS; idxBlock++ )
+    {
+        if( map[idxBlock] == INVALID_PTR )
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&g_fs->lock);
+        result = __block_read(map[idxBlock], blockBuffer);
+        pthread_mutex_unlock(&g_fs->lock);
+
+        if( result != OP_SUCCESS )
+        {
+            break;
+        }
+
+        for( i = 0; i < entryPerBlock; i++ )
+        {
+            buffer_read_record(blockBuffer, i * sizeof(struct t2fs_record), &record);
+
+            if( (record.TypeVal == TYPEVAL_REGULAR || record.TypeVal == TYPEVAL_DIRETORIO) &&
+                strcmp(record.name, ".") != 0 && strcmp(record.name, "..") != 0 )
+            {
+                strcpy((*dentries)[count].name, record.name);
+                (*dentries)[count].fileType = record.TypeVal;
+                refs[count].inodeNumber = record.inodeNumber;
+                refs[count].idxEntry = count;
+                count++;
+            }
+        }
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        result = __dentries_fill_size(*dentries, refs, count);
+    }
+
+    *inodes = (DWORD*)malloc((count + 1) * sizeof(DWORD));
+
+    for( i = 0; i < count; i++ )
+    {
+        (*inodes)[refs[i].idxEntry] = refs[i].inodeNumber;
+    }
+
+    free(blockBuffer);
+    free(refs);
+    free(map);
+    free(inode);
+
+    if( result != OP_SUCCESS )
+    {
+        free(*dentries);
+        free(*inodes);
+        *dentries = NULL;
+        *inodes = NULL;
+
+        return OP_ERROR;
+    }
+
+    return count;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Visita um diretório do percurso de nftw2: lê suas entradas (ver __dir_read_all),
+        enfileira os subdiretórios na fila da thread e chama a função do percurso para
+        cada entrada
+
+Entra:
+    worker -> thread que visita o diretório
+    item -> diretório a ser visitado
+-----------------------------------------------------------------------------*/
+void __walk_dir(WALK_WORKER *worker, WALK_ITEM *item)
+{
+    WALK_POOL *pool = worker->pool;
+    DIRENT2 *dentries;
+    DWORD *inodes;
+    char *path;
+    int i, count, stop;
+
+    count = __dir_read_all(item->inodeNumber, &dentries, &inodes);
+
+    if( count == OP_ERROR )
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->error = 1;
+        pthread_mutex_unlock(&pool->lock);
+
+        return;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        pthread_mutex_lock(&pool->lock);
+        stop = pool->stop != 0 || pool->error;
+        pthread_mutex_unlock(&pool->lock);
+
+        if( stop )
+        {
+            break;
+        }
+
+        path = (char*)malloc(strlen(item->path) + strlen(dentries[i].name) + 2);
+        sprintf(path, "%s%s%s", item->path, strcmp(item->path, "/") == 0 ? "" : "/", dentries[i].name);
+
+        int fnResult = pool->fn(path, &dentries[i], pool->arg);
+
+        // A função do percurso pode ter usado outro sistema de arquivos
+        g_fs = pool->fs;
+
+        if( fnResult != 0 )
+        {
+            pthread_mutex_lock(&pool->lock);
+            if( pool->stop == 0 )
+            {
+                pool->stop = fnResult;
+            }
+            pthread_mutex_unlock(&pool->lock);
+        }
+
+        if( fnResult == 0 && dentries[i].fileType == TYPEVAL_DIRETORIO )
+        {
+            WALK_ITEM child = { inodes[i], path };
+
+            __walk_enqueue(worker, child);
+        }
+        else
+        {
+            free(path);
+        }
+    }
+
+    free(dentries);
+    free(inodes);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Laço de uma thread de nftw2: visita os diretórios da própria fila e, quando
+        ela se esvazia, rouba das filas das outras threads. Sem nada a roubar, a thread
+        dorme até um diretório ser enfileirado ou o percurso terminar.
+
+Entra:
+    arg -> WALK_WORKER da thread
+-----------------------------------------------------------------------------*/
+void *__walk_worker(void *arg)
+{
+    WALK_WORKER *worker = (WALK_WORKER*)arg;
+    WALK_POOL *pool = worker->pool;
+    WALK_ITEM item;
+    int i, found, done;
+
+    g_fs = pool->fs;
+
+    while( 1 )
+    {
+        found = __walk_take(&pool->deques[worker->id], &item, 0);
+
+        for( i = 1; !found && i < pool->nthreads; i++ )
+        {
+            found = __walk_take(&pool->deques[(worker->id + i) % pool->nthreads], &item, 1);
+        }
+
+        if( !found )
+        {
+            // Outra thread ainda pode enfileirar subdiretórios
+            pthread_mutex_lock(&pool->lock);
+
+            while( pool->queued == 0 && pool->pending > 0 )
+            {
+                pthread_cond_wait(&pool->wake, &pool->lock);
+            }
+
+            done = pool->pending == 0;
+            pthread_mutex_unlock(&pool->lock);
+
+            if( done )
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        pool->queued -= 1;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->visit(worker, &item);
+        free(item.path);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->pending -= 1;
+
+        if( pool->pending == 0 )
+        {
+            pthread_cond_broadcast(&pool->wake);
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Distribui os diretórios de um percurso entre as threads, a partir do diretório
+        raiz, até não restar trabalho. O percurso deve ter 'visit', 'fn' e 'arg'
+        preenchidos; os demais campos são preenchidos pela função.
+
+Entra:
+    pool -> percurso
+    root -> diretório raiz do percurso (o caminho é liberado pela função)
+    nthreads -> número de threads
+
+Saída:
+    Se todo o percurso foi realizado, retorna 0
+    Se 'fn' interrompeu o percurso, retorna o valor retornado por 'fn'
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __walk_run(WALK_POOL *pool, WALK_ITEM root, int nthreads)
+{
+    WALK_WORKER *workers;
+    pthread_t *threads;
+    int i, created;
+
+    if( nthreads < 1 )
+    {
+        nthreads = 1;
+    }
+
+    pool->deques = (WALK_DEQUE*)calloc(nthreads, sizeof(WALK_DEQUE));
+    pool->nthreads = nthreads;
+    pool->fs = g_fs;
+    pool->pending = 1;
+    pool->queued = 1;
+    pool->stop = 0;
+    pool->error = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for( i = 0; i < nthreads; i++ )
+    {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    __walk_push(&pool->deques[0], root);
+
+    workers = (WALK_WORKER*)malloc(nthreads * sizeof(WALK_WORKER));
+    threads = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+
+    for( i = 0; i < nthreads; i++ )
+    {
+        workers[i].pool = pool;
+        workers[i].id = i;
+    }
+
+    // A thread chamadora trabalha como a thread 0
+    for( created = 1; created < nthreads; created++ )
+    {
+        if( pthread_create(&threads[created], NULL, __walk_worker, &workers[created]) != 0 )
+        {
+            break;
+        }
+    }
+
+    __walk_worker(&workers[0]);
+
+    for( i = 1; i < created; i++ )
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Itens que sobraram numa fila após uma interrupção
+    for( i = 0; i < nthreads; i++ )
+    {
+        while( __walk_take(&pool->deques[i], &root, 0) )
+        {
+            free(root.path);
+        }
+
+        free(pool->deques[i].items);
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->deques);
+    free(workers);
+    free(threads);
+
+    if( pool->error )
+    {
+        return OP_ERROR;
+    }
+
+    return pool->stop;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Percorre a árvore a partir de um diretório (ver nftw2)
+
+Entra:
+    pathname -> caminho do diretório raiz do percurso
+    fn -> função chamada para cada entrada
+    arg -> argumento de 'fn'
+    nthreads -> número de threads
+
+Saída:
+    Se todo o percurso foi realizado, retorna 0
+    Se 'fn' interrompeu o percurso, retorna o valor retornado por 'fn'
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __tree_walk(char *pathname, NFTW2_FN fn, void *arg, int nthreads)
+{
+    WALK_POOL pool;
+    WALK_ITEM root;
+    struct t2fs_record *record;
+    char *parsedPath;
+
+    if( fn == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    pthread_mutex_lock(&g_fs->lock);
+    parsedPath = parse_path(pathname, g_fs->cwd);
+    record = parsedPath != NULL ? __record_navigate(parsedPath) : NULL;
+    pthread_mutex_unlock(&g_fs->lock);
+
+    if( record == NULL || record->TypeVal != TYPEVAL_DIRETORIO )
+    {
+        return OP_ERROR;
+    }
+
+    pool.visit = __walk_dir;
+    pool.fn = fn;
+    pool.arg = arg;
+
+    root.inodeNumber = record->inodeNumber;
+    root.path = strdup(parsedPath);
+
+    return __walk_run(&pool, root, nthreads);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa o primeiro bloco da área de dados (após o superbloco, os bitmaps e a
+        área de inodes)
+
+Saída:
+    Número do bloco.
+-----------------------------------------------------------------------------*/
+DWORD __fsck_first_data_block()
+{
+    return g_fs->sb->superblockSize + g_fs->sb->freeBlocksBitmapSize + g_fs->sb->freeInodeBitmapSize + g_fs->sb->inodeAreaSize;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê um bitmap inteiro para a memória, em leituras de até FSCK_READ_SECTORS setores
+
+Entra:
+    handle -> bitmap (BITMAP_INODE ou BITMAP_DADOS)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o bitmap (setores inteiros)
+    Se ocorreu algum erro, retorna NULL.
+-----------------------------------------------------------------------------*/
+BYTE *__fsck_bitmap_read(int handle)
+{
+    DWORD numSectors = (__bitmap_size(handle) + SECTOR_SIZE * 8 - 1) / (SECTOR_SIZE * 8);
+    BYTE *bitmap = (BYTE*)malloc(numSectors * SECTOR_SIZE + 1);
+    unsigned int firstSector = __bitmap_get_sector(handle, 0);
+    DWORD i, count;
+
+    for( i = 0; i < numSectors; i += count )
+    {
+        count = numSectors - i < FSCK_READ_SECTORS ? numSectors - i : FSCK_READ_SECTORS;
+
+        if( __disk_read_range(firstSector + i, count, bitmap + i * SECTOR_SIZE) != OP_SUCCESS )
+        {
+            free(bitmap);
+
+            return NULL;
+        }
+    }
+
+    return bitmap;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Conta os bits livres e os trechos de bits livres de um bitmap em memória
+
+Entra:
+    bitmap -> bitmap
+    numBits -> número de bits válidos do bitmap
+    freeBits -> onde colocar a quantidade de bits livres
+    freeRuns -> onde colocar a quantidade de trechos de bits livres
+-----------------------------------------------------------------------------*/
+void __fsck_bitmap_count(BYTE *bitmap, DWORD numBits, DWORD *freeBits, DWORD *freeRuns)
+{
+    DWORD bit;
+    int isFree, previousFree = 0;
+
+    *freeBits = 0;
+    *freeRuns = 0;
+
+    for( bit = 0; bit < numBits; bit++ )
+    {
+        isFree = ((bitmap[bit / 8] >> (bit % 8)) & 1) == 0;
+
+        if( isFree )
+        {
+            *freeBits += 1;
+            *freeRuns += previousFree ? 0 : 1;
+        }
+
+        previousFree = isFree;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Confere um ponteiro de bloco de um inode e o acrescenta à lista do trecho
+
+Entra:
+    region -> trecho da área de inodes
+    pointer -> ponteiro (buracos são ignorados)
+
+Saída:
+    Se o ponteiro aponta para um bloco da área de dados, retorna 1
+    Se é um buraco ou um ponteiro inválido (contado em 'badPointers'), 0.
+-----------------------------------------------------------------------------*/
+int __fsck_pointer(FSCK_REGION *region, DWORD pointer)
+{
+    if( pointer == INVALID_PTR || pointer == 0 )
+    {
+        return 0;
+    }
+
+    if( pointer < __fsck_first_data_block() || pointer >= g_fs->sb->diskSize )
+    {
+        region->badPointers++;
+
+        return 0;
+    }
+
+    __list_append(&region->blocks, pointer);
+
+    return 1;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê um bloco de ponteiros (indireção) com g_fs->lock travada
+
+Entra:
+    blockNumber -> número do bloco
+    buffer -> buffer com o tamanho de um bloco
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __fsck_read_block(DWORD blockNumber, BYTE *buffer)
+{
+    int result;
+
+    pthread_mutex_lock(&g_fs->lock);
+    result = __disk_read_range(__block_get_sector(blockNumber), g_fs->sb->blockSize, buffer);
+    pthread_mutex_unlock(&g_fs->lock);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Coleta os blocos (dados e indireção) e o fragmento de um inode. Como em
+        __inode_map_read, só os ponteiros de dados até 'blocksFileSize' são considerados.
+
+Entra:
+    region -> trecho da área de inodes que recebe os blocos
+    inode -> inode
+    indBuffer -> buffer com o tamanho de um bloco
+    listBuffer -> buffer com o tamanho de um bloco
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __fsck_inode_blocks(FSCK_REGION *region, struct t2fs_inode *inode, BYTE *indBuffer, BYTE *listBuffer)
+{
+    DWORD blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD sector = inode->reservado[INODE_FRAGMENT];
+    DWORD numSectors, i, j, idxBase;
+
+    if( (inode->reservado[INODE_FLAGS] & (INODE_FLAG_INLINE | INODE_FLAG_TAIL)) != 0 && sector != INVALID_PTR )
+    {
+        numSectors = __inode_fragment_sectors(inode);
+
+        if( numSectors == 0 || g_fs->refcount.dir == NULL || g_fs->sb->blockSize >= 32 || sector / g_fs->sb->blockSize < __fsck_first_data_block() ||
+            sector / g_fs->sb->blockSize >= g_fs->sb->diskSize || sector % g_fs->sb->blockSize + numSectors > g_fs->sb->blockSize )
+        {
+            region->badPointers++;
+        }
+        else
+        {
+            __list_append(&region->fragments, sector);
+            __list_append(&region->fragments, numSectors);
+        }
+    }
+
+    for( i = 0; i < 2 && i < inode->blocksFileSize; i++ )
+    {
+        __fsck_pointer(region, inode->dataPtr[i]);
+    }
+
+    if( __fsck_pointer(region, inode->singleIndPtr) )
+    {
+        if( __fsck_read_block(inode->singleIndPtr, indBuffer) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        for( i = 0; i < blockNumberPerBlock && 2 + i < inode->blocksFileSize; i++ )
+        {
+            __fsck_pointer(region, buffer_to_dword(indBuffer, i * sizeof(DWORD)));
+        }
+    }
+
+    if( __fsck_pointer(region, inode->doubleIndPtr) )
+    {
+        if( __fsck_read_block(inode->doubleIndPtr, listBuffer) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        for( j = 0; j < blockNumberPerBlock; j++ )
+        {
+            idxBase = 2 + blockNumberPerBlock + j * blockNumberPerBlock;
+
+            if( !__fsck_pointer(region, buffer_to_dword(listBuffer, j * sizeof(DWORD))) || idxBase >= inode->blocksFileSize )
+            {
+                continue;
+            }
+
+            if( __fsck_read_block(buffer_to_dword(listBuffer, j * sizeof(DWORD)), indBuffer) != OP_SUCCESS )
+            {
+                return OP_ERROR;
+            }
+
+            for( i = 0; i < blockNumberPerBlock && idxBase + i < inode->blocksFileSize; i++ )
+            {
+                __fsck_pointer(region, buffer_to_dword(indBuffer, i * sizeof(DWORD)));
+            }
+        }
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê um trecho da área de inodes em leituras de até FSCK_READ_SECTORS setores
+        (com g_fs->lock travada) e coleta os blocos dos inodes alcançáveis
+
+Entra:
+    arg -> FSCK_REGION do trecho (recebe o resultado)
+-----------------------------------------------------------------------------*/
+void *__fsck_scan_region(void *arg)
+{
+    FSCK_REGION *region = (FSCK_REGION*)arg;
+    DWORD inodesPerSector = SECTOR_SIZE / sizeof(struct t2fs_inode);
+    unsigned int areaSector;
+    struct t2fs_inode inode;
+    BYTE *buffer, *indBuffer, *listBuffer;
+    DWORD sector, count, k, inodeNumber;
+
+    g_fs = region->fs;
+    region->result = OP_SUCCESS;
+
+    areaSector = __inode_get_sector(0);
+    buffer = (BYTE*)malloc(FSCK_READ_SECTORS * SECTOR_SIZE);
+    indBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+    listBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+
+    for( sector = region->firstSector; sector < region->endSector && region->result == OP_SUCCESS; sector += count )
+    {
+        count = region->endSector - sector < FSCK_READ_SECTORS ? region->endSector - sector : FSCK_READ_SECTORS;
+
+        pthread_mutex_lock(&g_fs->lock);
+        region->result = __disk_read_range(areaSector + sector, count, buffer);
+        pthread_mutex_unlock(&g_fs->lock);
+
+        for( k = 0; k < count * inodesPerSector && region->result == OP_SUCCESS; k++ )
+        {
+            inodeNumber = sector * inodesPerSector + k;
+
+            if( !region->state->reachable[inodeNumber] )
+            {
+                continue;
+            }
+
+            buffer_read_inode(buffer, k * sizeof(struct t2fs_inode), &inode);
+            region->result = __fsck_inode_blocks(region, &inode, indBuffer, listBuffer);
+        }
+    }
+
+    free(buffer);
+    free(indBuffer);
+    free(listBuffer);
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Visita um diretório na verificação de fsck2: marca os inodes das entradas como
+        alcançáveis, confere se estão ocupados no bitmap e enfileira os subdiretórios
+        ainda não vistos. Com 'repair', remove os registros que apontam para fora da
+        área de inodes.
+
+Entra:
+    worker -> thread que visita o diretório
+    item -> diretório a ser visitado
+-----------------------------------------------------------------------------*/
+void __fsck_dir(WALK_WORKER *worker, WALK_ITEM *item)
+{
+    WALK_POOL *pool = worker->pool;
+    FSCK_STATE *state = (FSCK_STATE*)pool->arg;
+    int entryPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(struct t2fs_record);
+    DWORD totalInodes = __inode_get_total();
+    struct t2fs_inode *inode;
+    struct t2fs_record record;
+    BYTE *blockBuffer;
+    DWORD *map = NULL;
+    DWORD idxBlock;
+    int i, first, remove, result;
+
+    pthread_mutex_lock(&g_fs->lock);
+    inode = __inode_get_by_idx(item->inodeNumber);
+
+    if( inode != NULL )
+    {
+        map = (DWORD*)malloc((inode->blocksFileSize + 1) * sizeof(DWORD));
+        result = __inode_map_read(inode, map, NULL);
+    }
+    else
+    {
+        result = OP_ERROR;
+    }
+
+    pthread_mutex_unlock(&g_fs->lock);
+
+    blockBuffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+
+    for( idxBlock = 0; result == OP_SUCCESS && idxBlock < inode->blocksFileSize; idxBlock++ )
+    {
+        // Ponteiros para as áreas de controle são informados na varredura dos inodes
+        if( map[idxBlock] == INVALID_PTR || map[idxBlock] < __fsck_first_data_block() )
+        {
+            continue;
+        }
+
+        if( __fsck_read_block(map[idxBlock], blockBuffer) != OP_SUCCESS )
+        {
+            result = OP_ERROR;
+            break;
+        }
+
+        for( i = 0; i < entryPerBlock; i++ )
+        {
+            buffer_read_record(blockBuffer, i * sizeof(struct t2fs_record), &record);
+
+            if( (record.TypeVal != TYPEVAL_REGULAR && record.TypeVal != TYPEVAL_DIRETORIO) ||
+                strcmp(record.name, ".") == 0 || strcmp(record.name, "..") == 0 )
+            {
+                continue;
+            }
+
+            first = 0;
+            remove = 0;
+
+            pthread_mutex_lock(&state->lock);
+
+            if( record.inodeNumber >= totalInodes )
+            {
+                state->badRecords++;
+                remove = state->repair;
+            }
+            else
+            {
+                // Um registro para um inode livre no bitmap conta como referência (o bitmap é corrigido)
+                if( ((state->inodeBitmap[record.inodeNumber / 8] >> (record.inodeNumber % 8)) & 1) == 0 )
+                {
+                    state->badRecords++;
+                }
+
+                first = !state->reachable[record.inodeNumber];
+                state->reachable[record.inodeNumber] = 1;
+
+                // O mesmo inode em dois registros (não há links): apenas informado
+                if( !first )
+                {
+                    state->badRecords++;
+                }
+            }
+
+            pthread_mutex_unlock(&state->lock);
+
+            if( remove )
+            {
+                record.TypeVal = TYPEVAL_INVALIDO;
+
+                pthread_mutex_lock(&g_fs->lock);
+
+                if( __record_write(&record, idxBlock * entryPerBlock + i, map[idxBlock]) == OP_SUCCESS )
+                {
+                    __dir_hint_release(item->inodeNumber, idxBlock * entryPerBlock + i);
+                    __dir_hint_count(item->inodeNumber, -1);
+                    state->removedRecords++;
+                }
+
+                pthread_mutex_unlock(&g_fs->lock);
+            }
+
+            if( first && record.TypeVal == TYPEVAL_DIRETORIO )
+            {
+                WALK_ITEM child = { record.inodeNumber, NULL };
+
+                __walk_enqueue(worker, child);
+            }
+        }
+    }
+
+    if( result != OP_SUCCESS )
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->error = 1;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    free(blockBuffer);
+    free(map);
+    free(inode);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Verifica (e, com 'repair', corrige) o sistema de arquivos corrente (ver fsck2)
+
+Entra:
+    stats -> onde colocar o resultado da verificação
+    repair -> flag indicando se as inconsistências devem ser corrigidas
+    nthreads -> número de threads
+
+Saída:
+    Se a verificação foi realizada, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __fsck(FSCK2_STATS *stats, int repair, int nthreads)
+{
+    DWORD totalInodes = __inode_get_total();
+    DWORD diskSize = g_fs->sb->diskSize;
+    DWORD firstData = __fsck_first_data_block();
+    DWORD areaSectors = g_fs->sb->inodeAreaSize * g_fs->sb->blockSize;
+    DWORD tables[4][2] = { { g_fs->sbe->refcountBlock, g_fs->sbe->refcountSize },
+                           { g_fs->sbe->checksumBlock, g_fs->sbe->checksumSize },
+                           { g_fs->sbe->dedupBlock, g_fs->sbe->dedupSize },
+                           { g_fs->sbe->groupTableBlock, g_fs->sbe->groupBlocks != 0 ? g_fs->sbe->groupTableSize : 0 } };
+    PAGED_TABLE *pagedTables[3] = { &g_fs->refcount, &g_fs->checksum, &g_fs->dedup };
+    BYTE *blockBitmap, *fixedBlockBitmap, *fixedInodeBitmap, *controlBlocks;
+    DWORD *refs, *fragMask = NULL;
+    DWORD_LIST fixes = { NULL, 0, 0 };
+    DWORD freeBits, freeRuns, numRegions, sectorsPerRegion;
+    DWORD b, i, j, mask, count, value, expected, onDisk;
+    FSCK_REGION *regions;
+    pthread_t *threads;
+    int *started;
+    FSCK_STATE state;
+    WALK_POOL pool;
+    WALK_ITEM root = { 0, NULL };
+    int result = OP_SUCCESS, control;
+
+    memset(stats, 0, sizeof(FSCK2_STATS));
+    memset(&state, 0, sizeof(FSCK_STATE));
+
+    // As threads da varredura consultam o diretório dos contadores: é lido antes delas, junto
+    // com os diretórios das outras tabelas, cujas páginas também são blocos de controle
+    if( __refcount_load() != OP_SUCCESS || __checksum_load() != OP_SUCCESS || __dedup_load() != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    // 1. Bitmaps do disco, em leituras grandes
+    state.inodeBitmap = __fsck_bitmap_read(BITMAP_INODE);
+    blockBitmap = __fsck_bitmap_read(BITMAP_DADOS);
+
+    if( state.inodeBitmap == NULL || blockBitmap == NULL )
+    {
+        free(state.inodeBitmap);
+        free(blockBitmap);
+
+        return OP_ERROR;
+    }
+
+    // 2. Percurso paralelo da árvore: inodes alcançáveis e registros inválidos
+    state.reachable = (BYTE*)calloc(totalInodes, sizeof(BYTE));
+    state.reachable[0] = 1;
+    state.repair = repair;
+    pthread_mutex_init(&state.lock, NULL);
+
+    pool.visit = __fsck_dir;
+    pool.fn = NULL;
+    pool.arg = &state;
+
+    if( __walk_run(&pool, root, nthreads) != 0 )
+    {
+        result = OP_ERROR;
+    }
+
+    pthread_mutex_destroy(&state.lock);
+
+    // 3. Varredura paralela da área de inodes: blocos dos inodes alcançáveis
+    nthreads = nthreads < 1 ? 1 : nthreads;
+    numRegions = (areaSectors + FSCK_READ_SECTORS - 1) / FSCK_READ_SECTORS;
+    numRegions = numRegions < 1 ? 1 : numRegions;
+    numRegions = numRegions > nthreads ? nthreads : numRegions;
+    sectorsPerRegion = (areaSectors + numRegions - 1) / numRegions;
+
+    regions = (FSCK_REGION*)calloc(numRegions, sizeof(FSCK_REGION));
+    threads = (pthread_t*)malloc(numRegions * sizeof(pthread_t));
+    started = (int*)calloc(numRegions, sizeof(int));
+
+    for( i = 0; i < numRegions; i++ )
+    {
+        regions[i].fs = g_fs;
+        regions[i].state = &state;
+        regions[i].firstSector = i * sectorsPerRegion < areaSectors ? i * sectorsPerRegion : areaSectors;
+        regions[i].endSector = (i + 1) * sectorsPerRegion < areaSectors ? (i + 1) * sectorsPerRegion : areaSectors;
+    }
+
+    // O primeiro trecho é lido pela própria thread; se não foi possível criar uma thread, o trecho também é
+    for( i = 1; i < numRegions && result == OP_SUCCESS; i++ )
+    {
+        started[i] = pthread_create(&threads[i], NULL, __fsck_scan_region, &regions[i]) == 0;
+    }
+
+    for( i = 0; i < numRegions && result == OP_SUCCESS; i++ )
+    {
+        if( started[i] )
+        {
+            pthread_join(threads[i], NULL);
+        }
+        else
+        {
+            __fsck_scan_region(&regions[i]);
+        }
+    }
+
+    for( i = 0; i < numRegions && result == OP_SUCCESS; i++ )
+    {
+        result = regions[i].result;
+    }
+
+    // 4. Referências de cada bloco: áreas de controle, tabelas, páginas das tabelas, blocos e fragmentos dos inodes
+    refs = (DWORD*)calloc(diskSize, sizeof(DWORD));
+    controlBlocks = (BYTE*)calloc(diskSize, sizeof(BYTE));
+
+    for( b = 0; b < firstData && b < diskSize; b++ )
+    {
+        refs[b] = 1;
+        controlBlocks[b] = 1;
+    }
+
+    for( i = 0; i < 4; i++ )
+    {
+        for( b = tables[i][0]; b < tables[i][0] + tables[i][1] && b < diskSize; b++ )
+        {
+            refs[b]++;
+            controlBlocks[b] = 1;
+        }
+    }
+
+    for( i = 0; i < 3; i++ )
+    {
+        for( j = 0; pagedTables[i]->dir != NULL && j < g_fs->tablePageCount; j++ )
+        {
+            b = pagedTables[i]->dir[j];
+
+            if( b != 0 && b < diskSize )
+            {
+                refs[b]++;
+                controlBlocks[b] = 1;
+            }
+        }
+    }
+
+    for( i = 0; i < numRegions && result == OP_SUCCESS; i++ )
+    {
+        stats->badPointers += regions[i].badPointers;
+
+        for( j = 0; j < regions[i].blocks.count; j++ )
+        {
+            refs[regions[i].blocks.items[j]]++;
+        }
+
+        for( j = 0; j + 1 < regions[i].fragments.count; j += 2 )
+        {
+            b = regions[i].fragments.items[j] / g_fs->sb->blockSize;
+            mask = ((1u << regions[i].fragments.items[j + 1]) - 1) << (regions[i].fragments.items[j] % g_fs->sb->blockSize);
+
+            fragMask = fragMask != NULL ? fragMask : (DWORD*)calloc(diskSize, sizeof(DWORD));
+
+            // Setores reclamados por dois fragmentos
+            if( (fragMask[b] & mask) != 0 )
+            {
+                stats->duplicateBlocks++;
+            }
+
+            fragMask[b] |= mask;
+        }
+    }
+
+    // 5. Comparação com o bitmap de dados e com os contadores de referência
+    fixedBlockBitmap = (BYTE*)malloc(((diskSize + SECTOR_SIZE * 8 - 1) / (SECTOR_SIZE * 8)) * SECTOR_SIZE + 1);
+    memcpy(fixedBlockBitmap, blockBitmap, ((diskSize + SECTOR_SIZE * 8 - 1) / (SECTOR_SIZE * 8)) * SECTOR_SIZE);
+
+    for( b = 0; b < diskSize && result == OP_SUCCESS; b++ )
+    {
+        mask = fragMask != NULL ? fragMask[b] : 0;
+        value = __refcount_value(b);
+        expected = refs[b] > 0 || mask != 0;
+        onDisk = (blockBitmap[b / 8] >> (b % 8)) & 1;
+        control = controlBlocks[b] && refs[b] > 0;
+
+        if( control && refs[b] > 1 )
+        {
+            stats->duplicateBlocks++;
+        }
+        else if( mask != 0 )
+        {
+            // Bloco de fragmentos: o contador guarda os setores ocupados
+            if( refs[b] > 0 )
+            {
+                stats->duplicateBlocks++;
+            }
+            else if( value != (REFCOUNT_FRAGMENT | mask) )
+            {
+                stats->badRefcounts++;
+
+                if( repair )
+                {
+                    __list_append(&fixes, b);
+                    __list_append(&fixes, REFCOUNT_FRAGMENT | mask);
+                    stats->repaired++;
+                }
+            }
+        }
+        else if( refs[b] > 0 && !control )
+        {
+            count = (value & REFCOUNT_FRAGMENT) ? 0 : value & REFCOUNT_COUNT;
+
+            // Mais referências do que o contador permite: uma escrita não copiaria o bloco
+            if( refs[b] > 1 + count )
+            {
+                stats->duplicateBlocks++;
+            }
+
+            if( g_fs->refcount.dir != NULL && (refs[b] != 1 + count || (value & REFCOUNT_FRAGMENT)) )
+            {
+                stats->badRefcounts++;
+
+                if( repair && refs[b] - 1 <= REFCOUNT_COUNT )
+                {
+                    __list_append(&fixes, b);
+                    __list_append(&fixes, ((value & REFCOUNT_FRAGMENT) ? 0 : value & REFCOUNT_ZSECTORS) | (refs[b] - 1));
+                    stats->repaired++;
+                }
+            }
+        }
+        else if( refs[b] == 0 && (value & (REFCOUNT_FRAGMENT | REFCOUNT_COUNT)) != 0 )
+        {
+            stats->badRefcounts++;
+
+            if( repair )
+            {
+                __list_append(&fixes, b);
+                __list_append(&fixes, 0);
+                stats->repaired++;
+            }
+        }
+
+        if( expected && !onDisk )
+        {
+            stats->missingBlocks++;
+            fixedBlockBitmap[b / 8] |= 1 << (b % 8);
+        }
+        else if( !expected && onDisk )
+        {
+            stats->leakedBlocks++;
+            fixedBlockBitmap[b / 8] &= ~(1 << (b % 8));
+
+            if( repair )
+            {
+                __block_forget(b);
+            }
+        }
+
+        stats->blocksUsed += expected;
+    }
+
+    // 6. Comparação com o bitmap de inodes
+    fixedInodeBitmap = (BYTE*)malloc(((totalInodes + SECTOR_SIZE * 8 - 1) / (SECTOR_SIZE * 8)) * SECTOR_SIZE + 1);
+    memcpy(fixedInodeBitmap, state.inodeBitmap, ((totalInodes + SECTOR_SIZE * 8 - 1) / (SECTOR_SIZE * 8)) * SECTOR_SIZE);
+
+    for( i = 0; i < totalInodes && result == OP_SUCCESS; i++ )
+    {
+        onDisk = (state.inodeBitmap[i / 8] >> (i % 8)) & 1;
+
+        if( onDisk && !state.reachable[i] )
+        {
+            stats->orphanInodes++;
+            fixedInodeBitmap[i / 8] &= ~(1 << (i % 8));
+        }
+        else if( !onDisk && state.reachable[i] )
+        {
+            fixedInodeBitmap[i / 8] |= 1 << (i % 8);
+        }
+
+        stats->inodesUsed += state.reachable[i];
+    }
+
+    stats->badRecords = state.badRecords;
+
+    // 7. Contadores de livres da extensão do superbloco, conferidos com os bitmaps do disco
+    if( result == OP_SUCCESS )
+    {
+        __fsck_bitmap_count(blockBitmap, diskSize, &freeBits, &freeRuns);
+        stats->badCounters += (freeBits != g_fs->sbe->freeBlocks) + (freeRuns != g_fs->sbe->freeBlockRuns);
+
+        __fsck_bitmap_count(state.inodeBitmap, totalInodes, &freeBits, &freeRuns);
+        stats->badCounters += freeBits != g_fs->sbe->freeInodes;
+
+        // Livres de cada grupo: os grupos ocupam setores inteiros dos dois bitmaps
+        for( i = 0; g_fs->sbe->groupBlocks != 0 && g_fs->zones != NULL && i < g_fs->zoneCount; i++ )
+        {
+            count = diskSize - i * g_fs->zoneBlocks < g_fs->zoneBlocks ? diskSize - i * g_fs->zoneBlocks : g_fs->zoneBlocks;
+            __fsck_bitmap_count(blockBitmap + i * (g_fs->zoneBlocks / 8), count, &freeBits, &freeRuns);
+            stats->badCounters += freeBits != __zone_desc(i)[GROUP_FREE_BLOCKS];
+
+            __fsck_bitmap_count(state.inodeBitmap + i * (g_fs->zoneInodes / 8), g_fs->zoneInodes, &freeBits, &freeRuns);
+            stats->badCounters += freeBits != __zone_desc(i)[GROUP_FREE_INODES];
+        }
+    }
+
+    // 8. Correção: setores dos bitmaps que mudaram e contadores recalculados a partir deles
+    if( repair && result == OP_SUCCESS )
+    {
+        __summary_mark_dirty();
+
+        for( i = 0; i < (diskSize + SECTOR_SIZE * 8 - 1) / (SECTOR_SIZE * 8) && result == OP_SUCCESS; i++ )
+        {
+            if( memcmp(blockBitmap + i * SECTOR_SIZE, fixedBlockBitmap + i * SECTOR_SIZE, SECTOR_SIZE) != 0 )
+            {
+                result = __disk_write(__bitmap_get_sector(BITMAP_DADOS, i * SECTOR_SIZE * 8), fixedBlockBitmap + i * SECTOR_SIZE);
+            }
+        }
+
+        for( i = 0; i < (totalInodes + SECTOR_SIZE * 8 - 1) / (SECTOR_SIZE * 8) && result == OP_SUCCESS; i++ )
+        {
+            if( memcmp(state.inodeBitmap + i * SECTOR_SIZE, fixedInodeBitmap + i * SECTOR_SIZE, SECTOR_SIZE) != 0 )
+            {
+                result = __disk_write(__bitmap_get_sector(BITMAP_INODE, i * SECTOR_SIZE * 8), fixedInodeBitmap + i * SECTOR_SIZE);
+            }
+        }
+
+        // Os contadores são corrigidos depois dos bitmaps: uma página nova só pode ocupar um bloco de fato livre
+        for( i = 0; i + 1 < fixes.count && result == OP_SUCCESS; i += 2 )
+        {
+            result = __refcount_set(fixes.items[i], fixes.items[i + 1]);
+        }
+
+        if( result == OP_SUCCESS )
+        {
+            // Inodes marcados por registros que apontavam para inodes livres também são corrigidos
+            for( i = 0; i < totalInodes; i++ )
+            {
+                stats->repaired += ((state.inodeBitmap[i / 8] ^ fixedInodeBitmap[i / 8]) >> (i % 8)) & 1;
+            }
+
+            stats->repaired += stats->missingBlocks + stats->leakedBlocks + stats->badCounters + state.removedRecords;
+
+            if( state.removedRecords > 0 )
+            {
+                __path_cache_clear();
+            }
+
+            result = __summary_rebuild();
+            __summary_flush();
+        }
+    }
+
+    for( i = 0; i < numRegions; i++ )
+    {
+        free(regions[i].blocks.items);
+        free(regions[i].fragments.items);
+    }
+
+    free(regions);
+    free(threads);
+    free(started);
+    free(refs);
+    free(controlBlocks);
+    free(fixes.items);
+    free(fragMask);
+    free(blockBitmap);
+    free(fixedBlockBitmap);
+    free(fixedInodeBitmap);
+    free(state.inodeBitmap);
+    free(state.reachable);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Conta os trechos de blocos consecutivos de um mapa de blocos de dados
+        (buracos separam trechos, como em stat2)
+
+Entra:
+    blocks -> mapa de blocos (ver __inode_map_read)
+    numBlocks -> número de entradas do mapa
+
+Saída:
+    Número de trechos.
+-----------------------------------------------------------------------------*/
+DWORD __defrag_extents(DWORD *blocks, DWORD numBlocks)
+{
+    DWORD i, extents = 0;
+
+    for( i = 0; i < numBlocks; i++ )
+    {
+        if( blocks[i] != INVALID_PTR && (i == 0 || blocks[i] != blocks[i - 1] + 1) )
+        {
+            extents++;
+        }
+    }
+
+    return extents;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Acrescenta um bloco à lista de blocos a serem realocados
+
+Entra:
+    moves -> lista de blocos
+    numMoves -> número de blocos da lista (incrementado)
+    kind -> tipo do bloco (DEFRAG_DATA, DEFRAG_SINGLE, DEFRAG_DOUBLE ou DEFRAG_LIST)
+    index -> índice do bloco no arquivo (dados) ou na indireção dupla (DEFRAG_LIST)
+    oldBlock -> bloco atual
+-----------------------------------------------------------------------------*/
+void __defrag_add(DEFRAG_MOVE *moves, DWORD *numMoves, int kind, DWORD index, DWORD oldBlock)
+{
+    moves[*numMoves].kind = kind;
+    moves[*numMoves].index = index;
+    moves[*numMoves].oldBlock = oldBlock;
+    (*numMoves)++;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Acrescenta à lista de blocos a serem realocados os blocos de dados de um
+        intervalo do arquivo. Buracos e blocos compartilhados ficam no lugar.
+
+Entra:
+    moves -> lista de blocos
+    numMoves -> número de blocos da lista (incrementado)
+    blocks -> mapa de blocos do arquivo
+    first -> primeiro índice do intervalo
+    end -> índice seguinte ao último do intervalo
+-----------------------------------------------------------------------------*/
+void __defrag_add_data(DEFRAG_MOVE *moves, DWORD *numMoves, DWORD *blocks, DWORD first, DWORD end)
+{
+    DWORD i;
+
+    for( i = first; i < end; i++ )
+    {
+        if( blocks[i] != INVALID_PTR && __refcount_get(blocks[i]) == 0 )
+        {
+            __defrag_add(moves, numMoves, DEFRAG_DATA, i, blocks[i]);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Troca, num bloco de indireção em memória, as entradas de um intervalo do
+        arquivo cujos blocos foram realocados
+
+Entra:
+    buffer -> bloco de indireção
+    blocks -> mapa de blocos atual
+    newBlocks -> mapa de blocos após a realocação
+    first -> índice no arquivo da primeira entrada do bloco de indireção
+    numEntries -> número de entradas do bloco de indireção
+    numBlocks -> número de entradas dos mapas
+-----------------------------------------------------------------------------*/
+void __defrag_patch(BYTE *buffer, DWORD *blocks, DWORD *newBlocks, DWORD first, DWORD numEntries, DWORD numBlocks)
+{
+    BYTE *entry;
+    DWORD i;
+
+    for( i = 0; i < numEntries && first + i < numBlocks; i++ )
+    {
+        if( blocks[first + i] != newBlocks[first + i] )
+        {
+            entry = dword_to_buffer(newBlocks[first + i]);
+            memcpy(buffer + i * sizeof(DWORD), entry, sizeof(DWORD));
+            free(entry);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Espera o necessário para que a desfragmentação não passe do limite de blocos
+        copiados por segundo
+
+Entra:
+    state -> estado da desfragmentação
+-----------------------------------------------------------------------------*/
+void __defrag_throttle(DEFRAG_STATE *state)
+{
+    struct timespec now, delay;
+    long long elapsed, expected;
+
+    if( state->maxBlocksPerSecond == 0 )
+    {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    // Tempos em microssegundos desde o início
+    elapsed = (now.tv_sec - state->start.tv_sec) * 1000000LL + (now.tv_nsec - state->start.tv_nsec) / 1000;
+    expected = (long long)state->stats->blocksMoved * 1000000LL / state->maxBlocksPerSecond;
+
+    if( expected > elapsed )
+    {
+        delay.tv_sec = (expected - elapsed) / 1000000;
+        delay.tv_nsec = ((expected - elapsed) % 1000000) * 1000;
+        nanosleep(&delay, NULL);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Realoca os blocos de um inode para um trecho contíguo de blocos livres
+        (ver defrag2). As cópias são gravadas e o inode
+        passa a apontar para elas antes da liberação dos blocos antigos; se ocorrer
+        um erro antes disso, as cópias são descartadas e o inode fica como estava.
+
+Entra:
+    inode -> inode do arquivo (atualizado)
+    inodeNumber -> número do inode
+    state -> estado da desfragmentação
+
+Saída:
+    Se a operação foi realizada com sucesso (mesmo sem realocar), retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_defrag(struct t2fs_inode *inode, DWORD inodeNumber, DEFRAG_STATE *state)
+{
+    DWORD blockNumberPerBlock = (g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(DWORD);
+    DWORD numBlocks = inode->blocksFileSize;
+    DWORD newSingle = inode->singleIndPtr, newDouble = inode->doubleIndPtr;
+    DWORD *blocks, *newBlocks, *lists, *newLists;
+    DWORD numIndBlocks = 0, numMoves = 0, numSet = 0, extents, breaks = 0, fingerprint, k;
+    DEFRAG_MOVE *moves;
+    BYTE *buffer;
+    int result, first = 0;
+
+    if( __inode_is_inline(inode) || numBlocks == 0 )
+    {
+        return OP_SUCCESS;
+    }
+
+    blocks = (DWORD*)malloc(numBlocks * sizeof(DWORD));
+
+    if( __inode_map_read(inode, blocks, &numIndBlocks) != OP_SUCCESS )
+    {
+        free(blocks);
+
+        return OP_ERROR;
+    }
+
+    extents = __defrag_extents(blocks, numBlocks);
+    state->stats->extentsBefore += extents;
+
+    newBlocks = (DWORD*)malloc(numBlocks * sizeof(DWORD));
+    lists = (DWORD*)calloc(blockNumberPerBlock, sizeof(DWORD));
+    newLists = (DWORD*)calloc(blockNumberPerBlock, sizeof(DWORD));
+    moves = (DEFRAG_MOVE*)malloc((numBlocks + numIndBlocks) * sizeof(DEFRAG_MOVE));
+    buffer = (BYTE*)malloc(g_fs->sb->blockSize * SECTOR_SIZE);
+    result = OP_SUCCESS;
+
+    // Blocos de indireção logo antes dos dados, que ficam num único trecho
+    if( __block_is_valid(inode->singleIndPtr) )
+    {
+        __defrag_add(moves, &numMoves, DEFRAG_SINGLE, 0, inode->singleIndPtr);
+    }
+
+    if( __block_is_valid(inode->doubleIndPtr) )
+    {
+        __defrag_add(moves, &numMoves, DEFRAG_DOUBLE, 0, inode->doubleIndPtr);
+        result = __block_read(inode->doubleIndPtr, buffer);
+
+        for( k = 0; k < blockNumberPerBlock && result == OP_SUCCESS; k++ )
+        {
+            lists[k] = buffer_to_dword(buffer, k * sizeof(DWORD));
+
+            if( __block_is_valid(lists[k]) )
+            {
+                __defrag_add(moves, &numMoves, DEFRAG_LIST, k, lists[k]);
+            }
+        }
+    }
+
+    __defrag_add_data(moves, &numMoves, blocks, 0, numBlocks);
+
+    for( k = 1; k < numMoves; k++ )
+    {
+        breaks += moves[k].oldBlock != moves[k - 1].oldBlock + 1;
+    }
+
+    // Arquivos já contíguos ficam no lugar; sem trecho livre suficiente, o arquivo é pulado
+    if( result == OP_SUCCESS && breaks > 0 )
+    {
+        first = __bitmap_search_run(numMoves);
+        result = first == OP_ERROR ? OP_ERROR : OP_SUCCESS;
+        state->stats->filesSkipped += first == 0;
+    }
+
+    if( result == OP_SUCCESS && first > 0 )
+    {
+        memcpy(newBlocks, blocks, numBlocks * sizeof(DWORD));
+        memcpy(newLists, lists, blockNumberPerBlock * sizeof(DWORD));
+
+        for( k = 0; k < numMoves; k++ )
+        {
+            switch( moves[k].kind )
+            {
+                case DEFRAG_DATA: newBlocks[moves[k].index] = first + k; break;
+                case DEFRAG_SINGLE: newSingle = first + k; break;
+                case DEFRAG_DOUBLE: newDouble = first + k; break;
+                default: newLists[moves[k].index] = first + k; break;
+            }
+        }
+
+        // As páginas dos contadores das cópias comprimidas e dos checksums das cópias são
+        // criadas antes, com o trecho marcado para que nenhuma página ocupe um dos seus blocos
+        for( k = 0; k < numMoves; k++ )
+        {
+            __bitmap_set(BITMAP_DADOS, first + k, 1);
+        }
+
+        for( k = 0; k < numMoves && result == OP_SUCCESS; k++ )
+        {
+            if( moves[k].kind == DEFRAG_DATA && __block_zsectors(moves[k].oldBlock) != 0 )
+            {
+                result = __refcount_reserve(first + k);
+            }
+
+            if( result == OP_SUCCESS && moves[k].kind == DEFRAG_DATA && __checksum_get(moves[k].oldBlock) != 0 )
+            {
+                result = __checksum_reserve(first + k);
+            }
+        }
+
+        for( k = 0; k < numMoves; k++ )
+        {
+            __bitmap_set(BITMAP_DADOS, first + k, 0);
+        }
+
+        // Cópias: os blocos de dados vão crus (comprimidos ou não), com o seu checksum;
+        // os blocos de indireção passam a apontar para as cópias
+        for( k = 0; k < numMoves && result == OP_SUCCESS; k++ )
+        {
+            result = __bitmap_set(BITMAP_DADOS, first + k, 1);
+
+            if( result != OP_SUCCESS )
+            {
+                break;
+            }
+
+            numSet++;
+            result = __block_read(moves[k].oldBlock, buffer);
+
+            if( result == OP_SUCCESS )
+            {
+                switch( moves[k].kind )
+                {
+                    case DEFRAG_SINGLE:
+                        __defrag_patch(buffer, blocks, newBlocks, 2, blockNumberPerBlock, numBlocks);
+                        break;
+                    case DEFRAG_LIST:
+                        __defrag_patch(buffer, blocks, newBlocks, 2 + blockNumberPerBlock + moves[k].index * blockNumberPerBlock, blockNumberPerBlock, numBlocks);
+                        break;
+                    case DEFRAG_DOUBLE:
+                        __defrag_patch(buffer, lists, newLists, 0, blockNumberPerBlock, blockNumberPerBlock);
+                        break;
+                }
+
+                result = __block_write(first + k, buffer);
+            }
+
+            if( result == OP_SUCCESS && moves[k].kind == DEFRAG_DATA )
+            {
+                result = __block_set_zsectors(first + k, __block_zsectors(moves[k].oldBlock));
+            }
+
+            if( result == OP_SUCCESS && moves[k].kind == DEFRAG_DATA )
+            {
+                result = __checksum_set(first + k, __checksum_get(moves[k].oldBlock));
+            }
+
+            state->stats->blocksMoved++;
+            __defrag_throttle(state);
+        }
+
+        if( result == OP_SUCCESS )
+        {
+            for( k = 0; k < 2 && k < numBlocks; k++ )
+            {
+                inode->dataPtr[k] = blocks[k] != INVALID_PTR ? newBlocks[k] : inode->dataPtr[k];
+            }
+
+            inode->singleIndPtr = newSingle;
+            inode->doubleIndPtr = newDouble;
+            result = __inode_write(inode, inodeNumber);
+        }
+
+        if( result == OP_SUCCESS )
+        {
+            __inode_sync_root(inode, inodeNumber);
+
+            // O inode já aponta para as cópias: os blocos antigos são liberados
+            for( k = 0; k < numMoves; k++ )
+            {
+                fingerprint = __dedup_get(moves[k].oldBlock);
+
+                __block_forget(moves[k].oldBlock);
+                __bitmap_set(BITMAP_DADOS, moves[k].oldBlock, 0);
+
+                if( fingerprint != 0 )
+                {
+                    __dedup_insert(first + k, fingerprint);
+                }
+            }
+
+            state->stats->filesMoved++;
+            extents = __defrag_extents(newBlocks, numBlocks);
+        }
+        else
+        {
+            for( k = 0; k < numSet; k++ )
+            {
+                __block_forget(first + k);
+                __bitmap_set(BITMAP_DADOS, first + k, 0);
+            }
+
+            state->stats->blocksMoved -= numSet;
+        }
+    }
+
+    state->stats->extentsAfter += extents;
+
+    free(blocks);
+    free(newBlocks);
+    free(lists);
+    free(newLists);
+    free(moves);
+    free(buffer);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Coleta o caminho de cada entrada visitada por um percurso (ver __path_list_build)
+
+Entra:
+    path -> caminho absoluto da entrada
+    entry -> dados da entrada
+    arg -> lista de caminhos (PATH_LIST)
+
+Saída:
+    Sempre 0 (o percurso continua).
+-----------------------------------------------------------------------------*/
+int __path_collect(const char *path, const DIRENT2 *entry, void *arg)
+{
+    PATH_LIST *list = (PATH_LIST*)arg;
+
+    if( list->count == list->capacity )
+    {
+        list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        list->items = (char**)realloc(list->items, list->capacity * sizeof(char*));
+    }
+
+    list->items[list->count++] = strdup(path);
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Monta a lista com o caminho informado e, se for um diretório, os caminhos de
+        toda a sua árvore
+
+Entra:
+    parsedPath -> caminho já normalizado
+    list -> lista vazia onde colocar os caminhos
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se o caminho não existe ou ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __path_list_build(char *parsedPath, PATH_LIST *list)
+{
+    struct t2fs_record *record = parsedPath != NULL ? __record_navigate(parsedPath) : NULL;
+    int result = OP_SUCCESS;
+
+    if( record == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    __path_collect(parsedPath, NULL, list);
+
+    if( record->TypeVal == TYPEVAL_DIRETORIO && __tree_walk(parsedPath, __path_collect, list, 1) != 0 )
+    {
+        result = OP_ERROR;
+    }
+
+    free(record);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Libera os caminhos da lista
+
+Entra:
+    list -> lista de caminhos
+-----------------------------------------------------------------------------*/
+void __path_list_free(PATH_LIST *list)
+{
+    DWORD i;
+
+    for( i = 0; i < list->count; i++ )
+    {
+        free(list->items[i]);
+    }
+
+    free(list->items);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Desfragmenta um arquivo ou a árvore de um diretório (ver defrag2). Os caminhos
+        são coletados antes das realocações; cada arquivo é procurado de novo na sua
+        vez, e os que sumiram nesse meio tempo são ignorados.
+
+Entra:
+    pathname -> caminho do arquivo ou do diretório
+    maxBlocksPerSecond -> limite de blocos copiados por segundo (0 se sem limite)
+    fn -> função de progresso (pode ser NULL)
+    arg -> argumento de 'fn'
+    stats -> onde colocar o resultado
+
+Saída:
+    Se toda a desfragmentação foi realizada, retorna 0
+    Se 'fn' interrompeu a desfragmentação, retorna o valor retornado por 'fn'
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __defrag(char *pathname, DWORD maxBlocksPerSecond, DEFRAG2_FN fn, void *arg, DEFRAG2_STATS *stats)
+{
+    struct t2fs_record *record;
+    struct t2fs_inode *inode;
+    PATH_LIST list = { NULL, 0, 0 };
+    DEFRAG_STATE state;
+    DWORD i;
+    int result;
+
+    memset(stats, 0, sizeof(DEFRAG2_STATS));
+    state.maxBlocksPerSecond = maxBlocksPerSecond;
+    state.stats = stats;
+    clock_gettime(CLOCK_MONOTONIC, &state.start);
+
+    result = __path_list_build(parse_path(pathname, g_fs->cwd), &list);
+
+    for( i = 0; i < list.count && result == OP_SUCCESS; i++ )
+    {
+        record = __record_navigate(list.items[i]);
+
+        if( record == NULL )
+        {
+            continue;
+        }
+
+        inode = __inode_get_by_idx(record->inodeNumber);
+        result = inode != NULL ? __inode_defrag(inode, record->inodeNumber, &state) : OP_ERROR;
+        stats->files++;
+
+        free(inode);
+        free(record);
+        __summary_flush();
+
+        if( result == OP_SUCCESS && fn != NULL )
+        {
+            result = fn(list.items[i], stats, arg);
+        }
+    }
+
+    __path_list_free(&list);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê a disposição de um arquivo ou diretório a partir do mapa de blocos do seu
+        inode (ver layout2)
+
+Entra:
+    record -> record do arquivo
+    file -> onde colocar a disposição
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __layout_file(struct t2fs_record *record, LAYOUT2_FILE *file)
+{
+    struct t2fs_inode *inode = __inode_get_by_idx(record->inodeNumber);
+    DWORD *blocks, i;
+    int result;
+
+    if( inode == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    memset(file, 0, sizeof(LAYOUT2_FILE));
+    file->fileType = record->TypeVal;
+    file->inodeNumber = record->inodeNumber;
+    file->fileSize = inode->bytesFileSize;
+
+    blocks = (DWORD*)malloc((inode->blocksFileSize + 1) * sizeof(DWORD));
+    result = __inode_map_read(inode, blocks, &file->indirectBlocks);
+
+    if( (__inode_is_inline(inode) || __inode_has_tail(inode)) && inode->reservado[INODE_FRAGMENT] != INVALID_PTR )
+    {
+        file->dataSectors = __inode_fragment_sectors(inode);
+    }
+
+    for( i = 0; i < inode->blocksFileSize && result == OP_SUCCESS; i++ )
+    {
+        if( blocks[i] == INVALID_PTR )
+        {
+            file->holes++;
+            continue;
+        }
+
+        file->blocks++;
+        file->sharedBlocks += __refcount_get(blocks[i]) > 0;
+        file->dataSectors += __block_zsectors(blocks[i]) > 0 ? __block_zsectors(blocks[i]) : g_fs->sb->blockSize;
+
+        if( i == 0 || blocks[i] != blocks[i - 1] + 1 )
+        {
+            file->runs++;
+        }
+    }
+
+    if( result == OP_SUCCESS && record->TypeVal == TYPEVAL_DIRETORIO )
+    {
+        file->records = inode->blocksFileSize * ((g_fs->sb->blockSize * SECTOR_SIZE) / sizeof(struct t2fs_record));
+        file->liveRecords = __record_count_live(inode);
+    }
+
+    free(blocks);
+    free(inode);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Conta os trechos de blocos livres do disco, a partir do bitmap de dados lido
+        em leituras grandes, e os agrupa por tamanho
+
+Entra:
+    stats -> onde colocar os blocos livres, os trechos e o histograma
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __layout_free_extents(LAYOUT2_STATS *stats)
+{
+    BYTE *bitmap = __fsck_bitmap_read(BITMAP_DADOS);
+    DWORD bit, run = 0, bucket;
+
+    if( bitmap == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    // Um bit além do fim do disco fecha o último trecho
+    for( bit = 0; bit <= g_fs->sb->diskSize; bit++ )
+    {
+        if( bit < g_fs->sb->diskSize && ((bitmap[bit / 8] >> (bit % 8)) & 1) == 0 )
+        {
+            run++;
+            continue;
+        }
+
+        if( run > 0 )
+        {
+            for( bucket = 0; bucket + 1 < LAYOUT2_HISTOGRAM_SIZE && (run >> (bucket + 1)) > 0; bucket++ );
+
+            stats->freeBlocks += run;
+            stats->freeExtents++;
+            stats->freeExtentHistogram[bucket]++;
+            stats->largestFreeExtent = run > stats->largestFreeExtent ? run : stats->largestFreeExtent;
+            run = 0;
+        }
+    }
+
+    free(bitmap);
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa a disposição de um arquivo ou da árvore de um diretório (ver layout2)
+
+Entra:
+    pathname -> caminho do arquivo ou do diretório
+    fn -> função chamada para cada arquivo (pode ser NULL)
+    arg -> argumento de 'fn'
+    stats -> onde colocar o resumo
+
+Saída:
+    Se todo o relatório foi feito, retorna 0
+    Se 'fn' interrompeu o relatório, retorna o valor retornado por 'fn'
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __layout(char *pathname, LAYOUT2_FN fn, void *arg, LAYOUT2_STATS *stats)
+{
+    struct t2fs_record *record;
+    PATH_LIST list = { NULL, 0, 0 };
+    LAYOUT2_FILE file;
+    DWORD i;
+    int result;
+
+    memset(stats, 0, sizeof(LAYOUT2_STATS));
+
+    result = __path_list_build(parse_path(pathname, g_fs->cwd), &list);
+
+    if( result == OP_SUCCESS )
+    {
+        result = __layout_free_extents(stats);
+    }
+
+    for( i = 0; i < list.count && result == OP_SUCCESS; i++ )
+    {
+        record = __record_navigate(list.items[i]);
+
+        if( record == NULL )
+        {
+            continue;
+        }
+
+        result = __layout_file(record, &file);
+        free(record);
+
+        if( result != OP_SUCCESS )
+        {
+            break;
+        }
+
+        stats->files += file.fileType == TYPEVAL_REGULAR;
+        stats->directories += file.fileType == TYPEVAL_DIRETORIO;
+        stats->fragmentedFiles += file.runs > 1;
+        stats->dataBlocks += file.blocks;
+        stats->runs += file.runs;
+        stats->indirectBlocks += file.indirectBlocks;
+
+        if( file.fileType == TYPEVAL_DIRETORIO )
+        {
+            stats->dirBlocks += file.blocks;
+            stats->dirRecords += file.records;
+            stats->dirLiveRecords += file.liveRecords;
+        }
+
+        if( fn != NULL )
+        {
+            result = fn(list.items[i], &file, arg);
+        }
+    }
+
+    __path_list_free(&list);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escolhe o sistema de arquivos corrente da thread na entrada de uma função da API
+
+Entra:
+    fs -> sistema de arquivos montado
+    write -> flag indicando se a função altera o disco
+
+Saída:
+    Se o sistema de arquivos pode ser usado, retorna OP_SUCCESS
+    Se não foi montado ou foi montado sem alterações (e a função altera o disco), retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __fs_enter(T2FS *fs, int write)
+{
+    if( fs == NULL || (write && fs->readOnly) )
+    {
+        return OP_ERROR;
+    }
+
+    g_fs = fs;
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Realiza a leitura do superbloco do disco
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __init_superblock_read()
+{
+    BYTE buffer[SECTOR_SIZE];
+    unsigned int sector_superblock = 0;
+
+    if( __disk_read(sector_superblock, buffer) == OP_SUCCESS )
+    {
+        g_fs->sb = buffer_to_superblock(buffer, 0);
+        g_fs->tablePageCount = (g_fs->sb->diskSize + __paged_page_entries() - 1) / __paged_page_entries();
+
+        return OP_SUCCESS;
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Realiza a leitura dos contadores de espaço livre da extensão do superbloco.
+        Se a extensão não existe ou não foi fechada corretamente, recalcula a partir
+        dos bitmaps.
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __init_summary_read()
+{
+    BYTE buffer[SECTOR_SIZE];
+
+    if( __disk_read(0, buffer) == OP_SUCCESS )
+    {
+        g_fs->sbe = buffer_to_superblock_ext(buffer, SB_EXT_OFFSET);
+
+        if( strncmp(g_fs->sbe->id, SB_EXT_ID, 4) != 0 )
+        {
+            g_fs->sbe->refcountBlock = 0;
+            g_fs->sbe->refcountSize = 0;
+            g_fs->sbe->features = 0;
+            g_fs->sbe->checksumBlock = 0;
+            g_fs->sbe->checksumSize = 0;
+            g_fs->sbe->dedupBlock = 0;
+            g_fs->sbe->dedupSize = 0;
+            g_fs->sbe->unmountState = 0;
+            g_fs->sbe->blockHint = 0;
+            g_fs->sbe->inodeHint = 0;
+            g_fs->sbe->fragmentHint = 0;
+            g_fs->sbe->groupBlocks = 0;
+            g_fs->sbe->groupInodes = 0;
+            g_fs->sbe->groupTableBlock = 0;
+            g_fs->sbe->groupTableSize = 0;
+        }
+        else if( g_fs->sbe->state == SB_STATE_CLEAN )
+        {
+            return OP_SUCCESS;
+        }
+
+        return __summary_rebuild();
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Realiza a leitura do inode referente ao diretório raiz
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __init_rootinode_read()
+{
+    g_fs->ri = __inode_get_by_idx(0);
+
+    if( g_fs->ri != NULL )
+    {
+        return OP_SUCCESS;
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Inicializa as varíaveis necessárias para correta execução
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __init()
+{
+    int i;
+
+    // As tabelas de contadores, checksums e impressões digitais são lidas no primeiro uso (ver __paged_entry)
+    if( __init_superblock_read() == OP_SUCCESS && __init_summary_read() == OP_SUCCESS &&
+        (g_fs->sbe->groupBlocks == 0 || __zone_load(0) == OP_SUCCESS) &&
+        __init_rootinode_read() == OP_SUCCESS )
+    {
+        for(i = 0; i < MAX_NUM_HANDLERS; i++)
+        {
+            g_fs->files[i].free = 1;
+            g_fs->files[i].record = NULL;
+            g_fs->files[i].wd = NULL;
+
+            g_fs->dirs[i].free = 1;
+            g_fs->dirs[i].record = NULL;
+            g_fs->dirs[i].wd = NULL;
+        }
+
+        for(i = 0; i < DIR_HINT_CACHE_SIZE; i++)
+        {
+            g_fs->dirHints[i].valid = 0;
+        }
+
+        // Desmontagem limpa: as dicas dos diretórios e os contadores das zonas gravados na desmontagem continuam válidos
+        if( g_fs->sbe->unmountState == SB_UNMOUNT_CLEAN )
+        {
+            __dir_hints_read();
+            __zone_counts_read();
+        }
+
+        for(i = 0; i < INODE_CACHE_SIZE; i++)
+        {
+            g_fs->inodeCache[i].valid = 0;
+        }
+
+        __path_cache_clear();
+
+        g_fs->cwd = strdup("/");
+        g_fs->cwdRecord = __record_get_by_name(".", g_fs->ri);
+
+        return OP_SUCCESS;
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve 'size' bytes a partir da posição 'pointer' de um inode que usa blocos,
+        alocando os buracos e copiando os blocos compartilhados que forem alterados
+
+Entra:
+    inode -> inode do arquivo (é atualizado)
+    inodeNumber -> número do inode
+    pointer -> posição, em bytes, do início da escrita
+    buffer -> bytes a serem escritos
+    size -> número de bytes a serem escritos
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_store_blocks(struct t2fs_inode *inode, DWORD inodeNumber, DWORD pointer, char *buffer, int size)
+{
+    // Apenas os blocos efetivamente escritos são alocados; os demais ficam como buracos
+    if( __inode_alocate_range(inode, inodeNumber, pointer, size) != OP_SUCCESS ||
+        __inode_unshare_range(inode, inodeNumber, pointer, size) != OP_SUCCESS ||
+        __inode_write_bytes(pointer, buffer, size, inode) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve 'size' bytes a partir da posição 'pointer' de um inode que usa blocos,
+        com a deduplicação ligada: cada bloco inteiro escrito que já existe no índice
+        passa a apontar para o bloco existente (que ganha uma referência) em vez de
+        ser gravado; os demais são gravados e entram no índice.
+
+Entra:
+    inode -> inode do arquivo (é atualizado)
+    inodeNumber -> número do inode
+    pointer -> posição, em bytes, do início da escrita
+    buffer -> bytes a serem escritos
+    size -> número de bytes a serem escritos
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_store_dedup(struct t2fs_inode *inode, DWORD inodeNumber, DWORD pointer, char *buffer, int size)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD position = pointer, end = pointer + size;
+    DWORD idxBlock, current, match, fingerprint;
+    DWORD chunk;
+
+    while( position < end )
+    {
+        idxBlock = position / blockBytes;
+        chunk = (idxBlock + 1) * blockBytes - position;
+
+        if( chunk > end - position )
+        {
+            chunk = end - position;
+        }
+
+        // Trechos parciais de um bloco são escritos normalmente e o bloco sai do índice
+        if( chunk < blockBytes )
+        {
+            if( __inode_store_blocks(inode, inodeNumber, position, buffer + (position - pointer), chunk) != OP_SUCCESS )
+            {
+                return OP_ERROR;
+            }
+
+            position += chunk;
+            continue;
+        }
+
+        g_fs->dedupLookups++;
+        fingerprint = __dedup_fingerprint((BYTE*)buffer + (position - pointer));
+        match = __dedup_find((BYTE*)buffer + (position - pointer), fingerprint);
+        current = __block_get_by_idx(idxBlock, inode);
+
+        if( match != INVALID_PTR )
+        {
+            g_fs->dedupHits++;
+
+            if( match != current )
+            {
+                if( __refcount_add(match, 1) != OP_SUCCESS )
+                {
+                    return OP_ERROR;
+                }
+
+                if( __block_map_at(inode, inodeNumber, idxBlock, match) != OP_SUCCESS )
+                {
+                    __refcount_add(match, -1);
+
+                    return OP_ERROR;
+                }
+
+                __block_release(current);
+            }
+        }
+        else
+        {
+            if( __inode_store_blocks(inode, inodeNumber, position, buffer + (position - pointer), chunk) != OP_SUCCESS )
+            {
+                return OP_ERROR;
+            }
+
+            __dedup_insert(__block_get_by_idx(idxBlock, inode), fingerprint);
+        }
+
+        position += chunk;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve 'size' bytes a partir da posição 'pointer' do inode, alocando o que
+        for preciso e aumentando o arquivo se a escrita passa do fim. Um arquivo
+        embutido continua no fragmento enquanto couber nele.
+
+Entra:
+    inode -> inode do arquivo (é atualizado)
+    inodeNumber -> número do inode
+    pointer -> posição, em bytes, do início da escrita
+    buffer -> bytes a serem escritos
+    size -> número de bytes a serem escritos
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_store(struct t2fs_inode *inode, DWORD inodeNumber, DWORD pointer, char *buffer, int size)
+{
+    int result = OP_ERROR;
+
+    if( __inode_is_inline(inode) && pointer + size <= INLINE_DATA_SIZE )
+    {
+        result = __inode_inline_write(inode, pointer, buffer, size);
+    }
+
+    // Arquivo embutido que não cabe mais no fragmento (ou sem fragmento disponível) passa a usar blocos
+    if( result != OP_SUCCESS )
+    {
+        if( (__inode_is_inline(inode) && __inode_inline_migrate(inode, inodeNumber) != OP_SUCCESS) ||
+            __inode_unpack_tail(inode, inodeNumber) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        result = (g_fs->sbe->features & SB_FEATURE_DEDUP) ?
+                 __inode_store_dedup(inode, inodeNumber, pointer, buffer, size) :
+                 __inode_store_blocks(inode, inodeNumber, pointer, buffer, size);
+
+        if( result != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+    }
+
+    if( pointer + size > inode->bytesFileSize )
+    {
+        inode->bytesFileSize = pointer + size;
+    }
+
+    return __inode_write(inode, inodeNumber);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve 'size' bytes na posição corrente do arquivo do handler
+
+Entra:
+    handler -> handler do arquivo
+    buffer -> bytes a serem escritos
+    size -> número de bytes a serem escritos
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o número de bytes escritos
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __file_write(HANDLER *handler, char *buffer, int size)
+{
+    struct t2fs_inode *inode = __inode_get_by_idx(handler->record->inodeNumber);
+    int result = OP_ERROR;
+
+    if( inode != NULL && __inode_store(inode, handler->record->inodeNumber, handler->pointer, buffer, size) == OP_SUCCESS )
+    {
+        handler->pointer += size;
+        result = size;
+    }
+
+    free(inode);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Altera o tamanho do arquivo do handler (ver __inode_truncate)
+
+Entra:
+    handler -> handler do arquivo
+    size -> novo tamanho, em bytes
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __file_truncate(HANDLER *handler, DWORD size)
+{
+    struct t2fs_inode *inode = __inode_get_by_idx(handler->record->inodeNumber);
+    int result = OP_ERROR;
+
+    if( inode != NULL )
+    {
+        result = __inode_truncate(inode, handler->record->inodeNumber, size);
+        free(inode);
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Liga ou desliga a compressão dos blocos gravados no arquivo do handler. Ao
+        ligar, o conteúdo embutido ou empacotado num fragmento volta a um bloco, já que
+        apenas blocos são comprimidos. Blocos já gravados ficam como estão até serem
+        reescritos.
+
+Entra:
+    handler -> handler do arquivo
+    enable -> flag indicando se a compressão deve ser ligada
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __file_compress(HANDLER *handler, int enable)
+{
+    struct t2fs_inode *inode = __inode_get_by_idx(handler->record->inodeNumber);
+    DWORD inodeNumber = handler->record->inodeNumber;
+    int result = OP_ERROR;
+
+    if( inode == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    if( !enable )
+    {
+        inode->reservado[INODE_FLAGS] &= ~INODE_FLAG_COMPRESSED;
+        result = __inode_write(inode, inodeNumber);
+    }
+    else if( __refcount_create() == OP_SUCCESS &&
+             (!__inode_is_inline(inode) || __inode_inline_migrate(inode, inodeNumber) == OP_SUCCESS) &&
+             __inode_unpack_tail(inode, inodeNumber) == OP_SUCCESS )
+    {
+        inode->reservado[INODE_FLAGS] |= INODE_FLAG_COMPRESSED;
+        result = __inode_write(inode, inodeNumber);
+    }
+
+    free(inode);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Empacota a cauda do arquivo do handler (ver __inode_pack_tail) quando ele é
+        fechado pelo último handler que o mantinha aberto
+
+Entra:
+    handler -> handler do arquivo sendo fechado
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __file_pack_tail(HANDLER *handler)
+{
+    struct t2fs_inode *inode;
+    int i, result = OP_ERROR;
+
+    for( i = 0; i < MAX_NUM_HANDLERS; i++ )
+    {
+        if( &g_fs->files[i] != handler && !g_fs->files[i].free && g_fs->files[i].record != NULL &&
+            g_fs->files[i].record->inodeNumber == handler->record->inodeNumber )
+        {
+            return OP_SUCCESS;
+        }
+    }
+
+    inode = __inode_get_by_idx(handler->record->inodeNumber);
+
+    if( inode != NULL )
+    {
+        result = __inode_pack_tail(inode, handler->record->inodeNumber);
+        free(inode);
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Preenche as informações de um record e do seu inode
+
+Entra:
+    record -> record a ser descrito
+    stats -> estrutura onde colocar as informações
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __record_stat(struct t2fs_record *record, STAT2 *stats)
+{
+    struct t2fs_inode *inode = __inode_get_by_idx(record->inodeNumber);
+    DWORD *blocks, indBlocks = 0;
+    DWORD i;
+    int result;
+
+    if( inode == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    blocks = (DWORD*)malloc((inode->blocksFileSize + 1) * sizeof(DWORD));
+    result = __inode_map_read(inode, blocks, &indBlocks);
+
+    if( result == OP_SUCCESS )
+    {
+        stats->fileType = record->TypeVal;
+        stats->inodeNumber = record->inodeNumber;
+        stats->fileSize = inode->bytesFileSize;
+        stats->blocksFileSize = 0;
+        stats->directBlocks = 0;
+        stats->indirectBlocks = indBlocks;
+        stats->extents = 0;
+        stats->dataSectors = 0;
+
+        if( (__inode_is_inline(inode) || __inode_has_tail(inode)) && inode->reservado[INODE_FRAGMENT] != INVALID_PTR )
+        {
+            stats->dataSectors = __inode_fragment_sectors(inode);
+        }
+
+        // Buracos não ocupam blocos e separam trechos
+        for( i = 0; i < inode->blocksFileSize; i++ )
+        {
+            if( blocks[i] == INVALID_PTR )
+            {
+                continue;
+            }
+
+            stats->blocksFileSize++;
+            stats->directBlocks += i < 2 ? 1 : 0;
+            stats->dataSectors += __block_zsectors(blocks[i]) > 0 ? __block_zsectors(blocks[i]) : g_fs->sb->blockSize;
+
+            if( i == 0 || blocks[i] != blocks[i - 1] + 1 )
+            {
+                stats->extents++;
+            }
+        }
+    }
+
+    free(blocks);
+    free(inode);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Copia 'len' bytes entre dois inodes, bloco a bloco, sem passar pelos buffers
+        do usuário. Os blocos do destino são alocados antes da cópia; cada bloco do
+        destino é montado em memória (lendo-o apenas se for coberto parcialmente) a
+        partir dos blocos da origem, lidos uma única vez cada.
+
+Entra:
+    srcInode -> inode de origem
+    srcOffset -> posição, em bytes, do início da cópia na origem
+    dstInode -> inode de destino (é atualizado)
+    dstInodeNumber -> número do inode de destino
+    dstOffset -> posição, em bytes, do início da cópia no destino
+    len -> número de bytes a serem copiados (já limitado ao tamanho da origem)
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __inode_copy_range(struct t2fs_inode *srcInode, DWORD srcOffset, struct t2fs_inode *dstInode, DWORD dstInodeNumber, DWORD dstOffset, DWORD len)
+{
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD neededBlocks = (dstOffset + len + blockBytes - 1) / blockBytes;
+    DWORD *srcMap, *dstMap;
+    BYTE *srcBuffer, *dstBuffer;
+    DWORD idxBlock, cachedSrcBlock = INVALID_PTR;
+    int compress = (dstInode->reservado[INODE_FLAGS] & INODE_FLAG_COMPRESSED) != 0;
+    int result = OP_SUCCESS;
+
+    // Origem embutida ou destino que continua embutido: o trecho cabe num setor
+    if( __inode_is_inline(srcInode) || (__inode_is_inline(dstInode) && dstOffset + len <= INLINE_DATA_SIZE) )
+    {
+        char *smallBuffer = (char*)malloc(len);
+
+        result = __inode_read_bytes(srcOffset, smallBuffer, len, srcInode);
+
+        if( result == OP_SUCCESS )
+        {
+            result = __inode_store(dstInode, dstInodeNumber, dstOffset, smallBuffer, len);
+        }
+
+        free(smallBuffer);
+
+        return result;
+    }
+
+    if( (__inode_is_inline(dstInode) && __inode_inline_migrate(dstInode, dstInodeNumber) != OP_SUCCESS) ||
+        __inode_unpack_tail(dstInode, dstInodeNumber) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( __inode_alocate_range(dstInode, dstInodeNumber, dstOffset, len) != OP_SUCCESS ||
+        __inode_unshare_range(dstInode, dstInodeNumber, dstOffset, len) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    srcMap = (DWORD*)malloc((srcInode->blocksFileSize + 1) * sizeof(DWORD));
+    dstMap = (DWORD*)malloc((dstInode->blocksFileSize + 1) * sizeof(DWORD));
+    srcBuffer = (BYTE*)malloc(blockBytes);
+    dstBuffer = (BYTE*)malloc(blockBytes);
+
+    if( __inode_map_read(srcInode, srcMap, NULL) != OP_SUCCESS || __inode_map_read(dstInode, dstMap, NULL) != OP_SUCCESS )
+    {
+        result = OP_ERROR;
+    }
+
+    for( idxBlock = dstOffset / blockBytes; idxBlock < neededBlocks && result == OP_SUCCESS; idxBlock++ )
+    {
+        DWORD blockStart = idxBlock * blockBytes;
+        DWORD start = dstOffset > blockStart ? dstOffset : blockStart;
+        DWORD end = (dstOffset + len) < (blockStart + blockBytes) ? (dstOffset + len) : (blockStart + blockBytes);
+        DWORD pos = start;
+
+        // Bloco coberto parcialmente: preserva o restante do conteúdo
+        if( start > blockStart || end < blockStart + blockBytes )
+        {
+            if( __block_read_data(dstMap[idxBlock], dstBuffer) != OP_SUCCESS )
+            {
+                result = OP_ERROR;
+                break;
+            }
+        }
+
+        while( pos < end )
+        {
+            DWORD srcPos = srcOffset + (pos - dstOffset);
+            DWORD srcBlock = srcPos / blockBytes;
+            DWORD chunk = blockBytes - (srcPos % blockBytes);
+
+            if( chunk > end - pos )
+            {
+                chunk = end - pos;
+            }
+
+            if( srcBlock != cachedSrcBlock )
+            {
+                // Cauda da origem num fragmento
+                if( __inode_has_tail(srcInode) && srcBlock == srcInode->bytesFileSize / blockBytes )
+                {
+                    memset(srcBuffer, 0, blockBytes);
+
+                    if( __inode_read_bytes(srcBlock * blockBytes, (char*)srcBuffer, srcInode->bytesFileSize % blockBytes, srcInode) != OP_SUCCESS )
+                    {
+                        result = OP_ERROR;
+                        break;
+                    }
+                }
+                // Buraco na origem (inclusive após o último bloco): é copiado como zeros
+                else if( srcBlock >= srcInode->blocksFileSize || srcMap[srcBlock] == INVALID_PTR )
+                {
+                    memset(srcBuffer, 0, blockBytes);
+                }
+                else if( __block_read_data(srcMap[srcBlock], srcBuffer) != OP_SUCCESS )
+                {
+                    result = OP_ERROR;
+                    break;
+                }
+
+                cachedSrcBlock = srcBlock;
+            }
+
+            memcpy(dstBuffer + (pos - blockStart), srcBuffer + (srcPos % blockBytes), chunk);
+            pos += chunk;
+        }
+
+        if( result == OP_SUCCESS && __block_write_data(dstMap[idxBlock], dstBuffer, compress) != OP_SUCCESS )
+        {
+            result = OP_ERROR;
+        }
+    }
+
+    if( result == OP_SUCCESS )
+    {
+        if( dstOffset + len > dstInode->bytesFileSize )
+        {
+            dstInode->bytesFileSize = dstOffset + len;
+        }
+
+        result = __inode_write(dstInode, dstInodeNumber);
+    }
+
+    free(srcMap);
+    free(dstMap);
+    free(srcBuffer);
+    free(dstBuffer);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Copia bytes entre dois arquivos abertos (ver copy_file_range2)
+
+Entra:
+    src -> handler do arquivo de origem
+    srcOffset -> posição de início na origem
+    dst -> handler do arquivo de destino
+    dstOffset -> posição de início no destino
+    len -> número máximo de bytes a serem copiados
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna o número de bytes copiados
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __file_copy_range(HANDLER *src, DWORD srcOffset, HANDLER *dst, DWORD dstOffset, DWORD len)
+{
+    struct t2fs_inode *srcInode = __inode_get_by_idx(src->record->inodeNumber);
+    struct t2fs_inode *dstInode = __inode_get_by_idx(dst->record->inodeNumber);
+    int result = OP_ERROR;
+
+    if( srcInode != NULL && dstInode != NULL )
+    {
+        if( srcOffset >= srcInode->bytesFileSize )
+        {
+            len = 0;
+        }
+        else if( len > srcInode->bytesFileSize - srcOffset )
+        {
+            len = srcInode->bytesFileSize - srcOffset;
+        }
+
+        // Cópia no mesmo arquivo só é permitida entre trechos disjuntos
+        if( src->record->inodeNumber == dst->record->inodeNumber && len > 0 &&
+            srcOffset < dstOffset + len && dstOffset < srcOffset + len )
+        {
+            result = OP_ERROR;
+        }
+        else if( len == 0 || __inode_copy_range(srcInode, srcOffset, dstInode, dst->record->inodeNumber, dstOffset, len) == OP_SUCCESS )
+        {
+            result = len;
+        }
+    }
+
+    free(srcInode);
+    free(dstInode);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Procura, a partir de 'offset', o primeiro byte do arquivo que está num bloco
+        com dados (SEEK2_DATA) ou num buraco (SEEK2_HOLE)
+
+Entra:
+    handler -> handler do arquivo
+    offset -> posição inicial da busca
+    whence -> SEEK2_DATA ou SEEK2_HOLE
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna a posição encontrada
+    Se ocorreu algum erro (ou não há dados após 'offset'), retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __file_seek_region(HANDLER *handler, DWORD offset, int whence)
+{
+    struct t2fs_inode *inode = __inode_get_by_idx(handler->record->inodeNumber);
+    DWORD blockBytes = g_fs->sb->blockSize * SECTOR_SIZE;
+    DWORD *blocks, idxBlock, numBlocks;
+    unsigned long long position = INVALID_PTR;
+    int result = OP_ERROR;
+
+    if( inode == NULL || offset >= inode->bytesFileSize )
+    {
+        free(inode);
+
+        return OP_ERROR;
+    }
+
+    // Um arquivo embutido é um único trecho de dados
+    if( __inode_is_inline(inode) )
+    {
+        result = whence == SEEK2_DATA ? offset : inode->bytesFileSize;
+        free(inode);
+
+        return result;
+    }
+
+    blocks = (DWORD*)malloc((inode->blocksFileSize + 1) * sizeof(DWORD));
+
+    if( __inode_map_read(inode, blocks, NULL) == OP_SUCCESS )
+    {
+        // Blocos lógicos do arquivo, sem calcular o fim em bytes (arquivos perto de 4 GB)
+        numBlocks = inode->bytesFileSize / blockBytes + (inode->bytesFileSize % blockBytes != 0);
+
+        // O fim do arquivo é um buraco implícito
+        position = whence == SEEK2_HOLE ? inode->bytesFileSize : INVALID_PTR;
+
+        for( idxBlock = offset / blockBytes; idxBlock < numBlocks; idxBlock++ )
+        {
+            int isData = (idxBlock < inode->blocksFileSize && blocks[idxBlock] != INVALID_PTR) ||
+                         (__inode_has_tail(inode) && idxBlock == inode->bytesFileSize / blockBytes);
+
+            if( isData == (whence == SEEK2_DATA) )
+            {
+                position = (unsigned long long)idxBlock * blockBytes > offset ? (unsigned long long)idxBlock * blockBytes : offset;
+                break;
+            }
+        }
+
+        // A posição é devolvida como int por lseek2
+        result = position <= INT_MAX ? (int)position : OP_ERROR;
+    }
+
+    free(blocks);
+    free(inode);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Usada para identificar os desenvolvedores do T2FS.
+	Essa função copia um string de identificação para o ponteiro indicado por "name".
+	Essa cópia não pode exceder o tamanho do buffer, informado pelo parâmetro "size".
+	O string deve ser formado apenas por caracteres ASCII (Valores entre 0x20 e 0x7A) e terminado por \0.
+	O string deve conter o nome e número do cartão dos participantes do grupo.
+
+Entra:	name -> buffer onde colocar o string de identificação.
+	size -> tamanho do buffer "name" (número máximo de bytes a serem copiados).
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int identify2 (char *name, int size)
+{
+    char names[150] = "Luís Augusto Weber Mercado - 265041\nMatheus Tavares Frigo - 262521\nNicholas de Aquino Lau - 268618\n";
+
+    if( size >= strlen(names) )
+    {
+        strcpy(name, names);
+
+        return OP_SUCCESS;
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Criar um novo arquivo.
+	O nome desse novo arquivo é aquele informado pelo parâmetro "filename".
+	O contador de posição do arquivo (current pointer) deve ser colocado na posição zero.
+	Caso já exista um arquivo ou diretório com o mesmo nome, a função deverá retornar um erro de criação.
+	A função deve retornar o identificador (handle) do arquivo.
+	Esse handle será usado em chamadas posteriores do sistema de arquivo para fins de manipulação do arquivo criado.
+
+Entra:	filename -> nome do arquivo a ser criado.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o handle do arquivo (número positivo).
+	Em caso de erro, deve ser retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+FILE2 t2fs_create2 (T2FS *fs, char *filename)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    int result = __record_create(filename, TYPEVAL_REGULAR);
+
+    __summary_flush();
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Apagar um arquivo do disco.
+	O nome do arquivo a ser apagado é aquele informado pelo parâmetro "filename".
+
+Entra:	filename -> nome do arquivo a ser apagado.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_delete2 (T2FS *fs, char *filename)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    int result = __record_delete(filename, TYPEVAL_REGULAR);
+
+    __summary_flush();
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Move (renomeia) um arquivo ou diretório.
+	Apenas as entradas de diretório são alteradas: a entrada "newpath" é escrita com o mesmo i-node
+		de "oldpath" e, em seguida, a entrada "oldpath" é removida. Os dados não são copiados.
+	Uma falha no meio da operação pode deixar os dois nomes, mas nunca nenhum deles.
+	Ao mover um diretório para outro diretório pai, a sua entrada ".." é atualizada.
+	Se "newpath" já existe e é um arquivo regular (não aberto), ele é substituído por "oldpath".
+	São considerados erros:
+		(a) "oldpath" não existente ou diretório pai de "newpath" não existente;
+		(b) "newpath" existente que não seja um arquivo regular, ou "oldpath" diretório e "newpath" existente;
+		(c) mover um diretório para dentro de si mesmo.
+
+Entra:	oldpath -> caminho atual do arquivo ou diretório
+	newpath -> novo caminho do arquivo ou diretório
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_rename2 (T2FS *fs, char *oldpath, char *newpath)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    int result = __record_rename(oldpath, newpath);
+
+    __summary_flush();
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Cria o arquivo "dstpath" como uma cópia do arquivo regular "srcpath" (reflink).
+	Os blocos de dados não são copiados: os dois arquivos passam a compartilhá-los e apenas os
+		blocos de indireção são duplicados. O número de referências de cada bloco é mantido numa
+		tabela criada no disco no primeiro uso (declarada na extensão do superbloco).
+	Ao escrever num bloco compartilhado, o arquivo recebe uma cópia privada do bloco (copy-on-write);
+		o conteúdo do outro arquivo não é alterado.
+	São considerados erros: "srcpath" inexistente ou que não seja um arquivo regular,
+		"dstpath" já existente e falta de espaço para os blocos de indireção.
+
+Entra:	srcpath -> caminho do arquivo a ser clonado
+	dstpath -> caminho do novo arquivo
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_clone2 (T2FS *fs, char *srcpath, char *dstpath)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    int result = __record_clone(srcpath, dstpath);
+
+    __summary_flush();
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Abre um arquivo existente no disco.
+	O nome desse novo arquivo é aquele informado pelo parâmetro "filename".
+	Ao abrir um arquivo, o contador de posição do arquivo (current pointer) deve ser colocado na posição zero.
+	A função deve retornar o identificador (handle) do arquivo.
+	Esse handle será usado em chamadas posteriores do sistema de arquivo para fins de manipulação do arquivo criado.
+	Todos os arquivos abertos por esta chamada são abertos em leitura e em escrita.
+	O ponto em que a leitura, ou escrita, será realizada é fornecido pelo valor current_pointer (ver função seek2).
+
+Entra:	filename -> nome do arquivo a ser apagado.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o handle do arquivo (número positivo)
+	Em caso de erro, deve ser retornado um valor negativo
+-----------------------------------------------------------------------------*/
+FILE2 t2fs_open2 (T2FS *fs, char *filename)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return __handler_alocate(filename, TYPEVAL_REGULAR);
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Fecha o arquivo identificado pelo parâmetro "handle".
+
+Entra:	handle -> identificador do arquivo a ser fechado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_close2 (T2FS *fs, FILE2 handle)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( !g_fs->readOnly && handle >= 0 && handle < MAX_NUM_HANDLERS && !(g_fs->files[handle].free || g_fs->files[handle].record == NULL) )
+    {
+        __file_pack_tail(&g_fs->files[handle]);
+    }
+
+    int result = __handler_free(handle, TYPEVAL_REGULAR);
+
+    __summary_flush();
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Realiza a leitura de "size" bytes do arquivo identificado por "handle".
+	Os bytes lidos são colocados na área apontada por "buffer".
+	Após a leitura, o contador de posição (current pointer) deve ser ajustado para o byte seguinte ao último lido.
+
+Entra:	handle -> identificador do arquivo a ser lido
+	buffer -> buffer onde colocar os bytes lidos do arquivo
+	size -> número de bytes a serem lidos
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o número de bytes lidos.
+	Se o valor retornado for menor do que "size", então o contador de posição atingiu o final do arquivo.
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int t2fs_read2 (T2FS *fs, FILE2 handle, char *buffer, int size)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 )
+    {
+        if( !(g_fs->files[handle].free || g_fs->files[handle].record == NULL) )
+        {
+            struct t2fs_inode *inode = __inode_get_by_idx(g_fs->files[handle].record->inodeNumber);
+            DWORD pointer = g_fs->files[handle].pointer;
+            int count = size;
+
+            // A leitura termina no fim do arquivo; bytes nulos (e buracos) são dados válidos
+            if( inode == NULL || size < 0 )
+            {
+                free(inode);
+
+                return OP_ERROR;
+            }
+
+            if( pointer >= inode->bytesFileSize )
+            {
+                count = 0;
+            }
+            else if( size > inode->bytesFileSize - pointer )
+            {
+                count = inode->bytesFileSize - pointer;
+            }
+
+            if( __inode_read_bytes(pointer, buffer, count, inode) != OP_SUCCESS )
+            {
+                free(inode);
+
+                return OP_ERROR;
+            }
+
+            g_fs->files[handle].pointer += count;
+            free(inode);
+
+            return count;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Realiza a escrita de "size" bytes no arquivo identificado por "handle".
+	Os bytes a serem escritos estão na área apontada por "buffer".
+	Após a escrita, o contador de posição (current pointer) deve ser ajustado para o byte seguinte ao último escrito.
+
+Entra:	handle -> identificador do arquivo a ser escrito
+	buffer -> buffer de onde pegar os bytes a serem escritos no arquivo
+	size -> número de bytes a serem escritos
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o número de bytes efetivamente escritos.
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int t2fs_write2 (T2FS *fs, FILE2 handle, char *buffer, int size)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 )
+    {
+        if( !(g_fs->files[handle].free || g_fs->files[handle].record == NULL) )
+        {
+            int result = __file_write(&g_fs->files[handle], buffer, size);
+
+            __summary_flush();
+
+            return result;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Copia "len" bytes do arquivo "src", a partir da posição "srcOffset", para o arquivo "dst",
+		a partir da posição "dstOffset", sem passar os dados pela aplicação.
+	Os blocos necessários no destino são alocados antes da cópia e os dados são copiados bloco a bloco
+		dentro da biblioteca. Diferente de read2, bytes nulos são copiados normalmente.
+	Se a origem tem menos de "srcOffset + len" bytes, são copiados apenas os bytes existentes.
+	Os contadores de posição (current pointer) dos dois arquivos não são alterados.
+	Se "src" e "dst" são o mesmo arquivo, os trechos de origem e destino não podem se sobrepor.
+
+Entra:	src -> identificador do arquivo de origem
+	srcOffset -> deslocamento, em bytes, do início da cópia na origem
+	dst -> identificador do arquivo de destino
+	dstOffset -> deslocamento, em bytes, do início da cópia no destino
+	len -> número de bytes a serem copiados
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o número de bytes copiados.
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int t2fs_copy_file_range2 (T2FS *fs, FILE2 src, DWORD srcOffset, FILE2 dst, DWORD dstOffset, DWORD len)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( src >= 0 && src < MAX_NUM_HANDLERS && dst >= 0 && dst < MAX_NUM_HANDLERS )
+    {
+        if( !(g_fs->files[src].free || g_fs->files[src].record == NULL || g_fs->files[dst].free || g_fs->files[dst].record == NULL) )
+        {
+            int result = __file_copy_range(&g_fs->files[src], srcOffset, &g_fs->files[dst], dstOffset, len);
+
+            __summary_flush();
+
+            return result;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Função usada para truncar um arquivo.
+	Remove do arquivo todos os bytes a partir da posição atual do contador de posição (CP)
+	Todos os bytes a partir da posição CP (inclusive) serão removidos do arquivo.
+	Após a operação, o arquivo deverá contar com CP bytes e o ponteiro estará no final do arquivo
+
+Entra:	handle -> identificador do arquivo a ser truncado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_truncate2 (T2FS *fs, FILE2 handle)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 )
+    {
+        if( !(g_fs->files[handle].free || g_fs->files[handle].record == NULL) )
+        {
+            int result = __file_truncate(&g_fs->files[handle], g_fs->files[handle].pointer);
+
+            __summary_flush();
+
+            return result;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Altera o tamanho do arquivo identificado por "handle" para "size" bytes.
+	Se "size" é menor que o tamanho atual, os bytes a partir da posição "size" são removidos e os
+		blocos que deixam de ser usados são liberados. Se é maior, o trecho acrescentado fica como
+		um buraco, que é lido como zeros e não ocupa blocos. Um tamanho maior que o máximo de um
+		arquivo (blocos diretos, de indireção simples e dupla) é um erro.
+	O contador de posição (current pointer) do arquivo não é alterado.
+
+Entra:	handle -> identificador do arquivo
+	size -> novo tamanho do arquivo, em bytes
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_ftruncate2 (T2FS *fs, FILE2 handle, DWORD size)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 && handle < MAX_NUM_HANDLERS )
+    {
+        if( !(g_fs->files[handle].free || g_fs->files[handle].record == NULL) )
+        {
+            int result = __file_truncate(&g_fs->files[handle], size);
+
+            __summary_flush();
+
+            return result;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Liga ou desliga a compressão do arquivo identificado por "handle".
+	Com a compressão ligada, cada bloco gravado é comprimido de forma independente e ocupa apenas
+		os setores necessários, de forma que leituras em posições aleatórias descomprimem um único
+		bloco. Blocos que não diminuem ao menos um setor são gravados sem compressão.
+	Leituras e escritas continuam transparentes. Blocos já gravados ficam como estão até serem
+		reescritos; a escolha é gravada no i-node e herdada por clone2.
+
+Entra:	handle -> identificador do arquivo
+	enable -> diferente de zero para ligar, zero para desligar
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_fcompress2 (T2FS *fs, FILE2 handle, int enable)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 && handle < MAX_NUM_HANDLERS )
+    {
+        if( !(g_fs->files[handle].free || g_fs->files[handle].record == NULL) )
+        {
+            int result = __file_compress(&g_fs->files[handle], enable);
+
+            __summary_flush();
+
+            return result;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Informa os metadados do arquivo ou diretório indicado por "pathname", sem abrir um handle.
+	São informados o tipo, o tamanho em bytes e em blocos, o número do i-node e o layout dos blocos
+		(ponteiros diretos em uso, blocos de indireção e número de trechos contíguos de dados).
+
+Entra:	pathname -> caminho do arquivo ou diretório
+	stats -> estrutura de dados onde a função coloca as informações.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_stat2 (T2FS *fs, char *pathname, STAT2 *stats)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( stats != NULL )
+    {
+        char* parsedPath = parse_path(pathname, g_fs->cwd);
+
+        if( parsedPath != NULL )
+        {
+            struct t2fs_record *record = __record_navigate(parsedPath);
+
+            if( record != NULL )
+            {
+                int result = __record_stat(record, stats);
+
+                free(record);
+
+                return result;
+            }
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Informa os metadados do arquivo identificado por "handle" (ver stat2).
+
+Entra:	handle -> identificador do arquivo
+	stats -> estrutura de dados onde a função coloca as informações.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_fstat2 (T2FS *fs, FILE2 handle, STAT2 *stats)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 && handle < MAX_NUM_HANDLERS && stats != NULL )
+    {
+        if( !(g_fs->files[handle].free || g_fs->files[handle].record == NULL) )
+        {
+            return __record_stat(g_fs->files[handle].record, stats);
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Reposiciona o contador de posições (current pointer) do arquivo identificado por "handle".
+	A nova posição é determinada pelo parâmetro "offset".
+	O parâmetro "offset" corresponde ao deslocamento, em bytes, contados a partir do início do arquivo.
+	Se o valor de "offset" for "-1", o current_pointer deverá ser posicionado no byte seguinte ao final do arquivo,
+		Isso é útil para permitir que novos dados sejam adicionados no final de um arquivo já existente.
+
+Entra:	handle -> identificador do arquivo a ser escrito
+	offset -> deslocamento, em bytes, onde posicionar o "current pointer".
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_seek2 (T2FS *fs, FILE2 handle, DWORD offset)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 )
+    {
+        if( !(g_fs->files[handle].free || g_fs->files[handle].record == NULL) )
+        {
+            if( offset != -1 )
+            {
+                g_fs->files[handle].pointer = offset;
+            }
+            else
+            {
+                g_fs->files[handle].pointer = __inode_get_by_idx(g_fs->files[handle].record->inodeNumber)->bytesFileSize;
+            }
+
+            return OP_SUCCESS;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Reposiciona o contador de posições (current pointer) do arquivo identificado por "handle",
+		de acordo com o modo "whence":
+	SEEK2_SET  -> posiciona em "offset" (como seek2). A posição pode estar além do fim do arquivo:
+		uma escrita nessa posição deixa um buraco, que não ocupa blocos e é lido como zeros.
+	SEEK2_DATA -> posiciona no primeiro byte, a partir de "offset", que pertence a um bloco com dados.
+	SEEK2_HOLE -> posiciona no primeiro byte, a partir de "offset", que pertence a um buraco.
+		O fim do arquivo é considerado um buraco.
+	Com SEEK2_DATA e SEEK2_HOLE, é erro "offset" estar no fim do arquivo ou além dele, assim
+		como não existir dados após "offset" (SEEK2_DATA).
+
+Entra:	handle -> identificador do arquivo
+	offset -> deslocamento, em bytes, a partir do início do arquivo
+	whence -> modo de reposicionamento (SEEK2_SET, SEEK2_DATA ou SEEK2_HOLE)
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna a nova posição do arquivo.
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int t2fs_lseek2 (T2FS *fs, FILE2 handle, DWORD offset, int whence)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 && handle < MAX_NUM_HANDLERS )
+    {
+        if( !(g_fs->files[handle].free || g_fs->files[handle].record == NULL) )
+        {
+            int position = OP_ERROR;
+
+            if( whence == SEEK2_SET )
+            {
+                position = offset;
+            }
+            else if( whence == SEEK2_DATA || whence == SEEK2_HOLE )
+            {
+                position = __file_seek_region(&g_fs->files[handle], offset, whence);
+            }
+
+            if( position >= 0 )
+            {
+                g_fs->files[handle].pointer = position;
+            }
+
+            return position;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Criar um novo diretório.
+	O caminho desse novo diretório é aquele informado pelo parâmetro "pathname".
+		O caminho pode ser ser absoluto ou relativo.
+	São considerados erros de criação quaisquer situações em que o diretório não possa ser criado.
+		Isso inclui a existência de um arquivo ou diretório com o mesmo "pathname".
+
+Entra:	pathname -> caminho do diretório a ser criado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_mkdir2 (T2FS *fs, char *pathname)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    int result = __record_create(pathname, TYPEVAL_DIRETORIO);
+
+    __summary_flush();
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Apagar um subdiretório do disco.
+	O caminho do diretório a ser apagado é aquele informado pelo parâmetro "pathname".
+	São considerados erros quaisquer situações que impeçam a operação.
+		Isso inclui:
+			(a) o diretório a ser removido não está vazio;
+			(b) "pathname" não existente;
+			(c) algum dos componentes do "pathname" não existe (caminho inválido);
+			(d) o "pathname" indicado não é um arquivo;
+
+Entra:	pathname -> caminho do diretório a ser criado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_rmdir2 (T2FS *fs, char *pathname)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    int result = __record_delete(pathname, TYPEVAL_DIRETORIO);
+
+    __summary_flush();
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Apaga o diretório "pathname" e todo o seu conteúdo (arquivos e subdiretórios).
+	A árvore é percorrida uma única vez, em pós-ordem; os i-nodes e blocos de todos os seus
+		elementos são liberados em lote ao final.
+	São considerados erros:
+		(a) "pathname" não existente ou que não seja um diretório;
+		(b) "pathname" ser o diretório raiz;
+		(c) algum arquivo ou diretório da árvore estar aberto, ou o diretório corrente estar na árvore.
+
+Entra:	pathname -> caminho do diretório a ser apagado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_rmtree2 (T2FS *fs, char *pathname)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    int result = __record_rmtree(pathname);
+
+    __summary_flush();
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Altera o diretório atual de trabalho (working directory).
+		O caminho desse diretório é informado no parâmetro "pathname".
+		São considerados erros:
+			(a) qualquer situação que impeça a realização da operação
+			(b) não existência do "pathname" informado.
+
+Entra:	pathname -> caminho do novo diretório de trabalho.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+		Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_chdir2 (T2FS *fs, char *pathname)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    char* parsedPath = parse_path(pathname, g_fs->cwd);
+
+    if( parsedPath != NULL )
+    {
+        struct t2fs_record *record = __record_navigate(parsedPath);
+
+        if( record != NULL )
+        {
+            if( record->TypeVal == TYPEVAL_DIRETORIO )
+            {
+                g_fs->cwd = parsedPath;
+                g_fs->cwdRecord = record;
+
+                return OP_SUCCESS;
+            }
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Informa o diretório atual de trabalho.
+		O "pathname" do diretório de trabalho deve ser copiado para o buffer indicado por "pathname".
+			Essa cópia não pode exceder o tamanho do buffer, informado pelo parâmetro "size".
+		São considerados erros:
+			(a) quaisquer situações que impeçam a realização da operação
+			(b) espaço insuficiente no buffer "pathname", cujo tamanho está informado por "size".
+
+Entra:	pathname -> buffer para onde copiar o pathname do diretório de trabalho
+		size -> tamanho do buffer pathname
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+		Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_getcwd2 (T2FS *fs, char *pathname, int size)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( size >= strlen(g_fs->cwd) )
+    {
+        strncpy(pathname, g_fs->cwd, strlen(g_fs->cwd));
+
+        pathname[strlen(g_fs->cwd)] = '\0';
+
+        return OP_SUCCESS;
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Abre um diretório existente no disco.
+	O caminho desse diretório é aquele informado pelo parâmetro "pathname".
+	Se a operação foi realizada com sucesso, a função:
+		(a) deve retornar o identificador (handle) do diretório
+		(b) deve posicionar o ponteiro de entradas (current entry) na primeira posição válida do diretório "pathname".
+	O handle retornado será usado em chamadas posteriores do sistema de arquivo para fins de manipulação do diretório.
+
+Entra:	pathname -> caminho do diretório a ser aberto
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o identificador do diretório (handle).
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+DIR2 t2fs_opendir2 (T2FS *fs, char *pathname)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return __handler_alocate(pathname, TYPEVAL_DIRETORIO);
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Realiza a leitura das entradas do diretório identificado por "handle".
+	A cada chamada da função é lida a entrada seguinte do diretório representado pelo identificador "handle".
+	Algumas das informações dessas entradas devem ser colocadas no parâmetro "dentry".
+	Após realizada a leitura de uma entrada, o ponteiro de entradas (current entry) deve ser ajustado para a próxima entrada válida, seguinte à última lida.
+	São considerados erros:
+		(a) qualquer situação que impeça a realização da operação
+		(b) término das entradas válidas do diretório identificado por "handle".
+
+Entra:	handle -> identificador do diretório cujas entradas deseja-se ler.
+	dentry -> estrutura de dados onde a função coloca as informações da entrada lida.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero)
+	Em caso de erro, será retornado um valor diferente de zero ( e "dentry" não será válido).
+-----------------------------------------------------------------------------*/
+int t2fs_readdir2 (T2FS *fs, DIR2 handle, DIRENT2 *dentry)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 )
+    {
+        if( !(g_fs->dirs[handle].free || g_fs->dirs[handle].record == NULL) )
+        {
+            struct t2fs_record *record;
+            struct t2fs_inode *inode = __inode_get_by_idx(g_fs->dirs[handle].record->inodeNumber);
+
+            record = __record_get_by_idx(g_fs->dirs[handle].pointer, inode);
+
+            if( record != NULL )
+            {
+                while( record->TypeVal == TYPEVAL_INVALIDO )
+                {
+                    g_fs->dirs[handle].pointer += 1;
+                    record = __record_get_by_idx(g_fs->dirs[handle].pointer, inode);
+
+                    if( record == NULL )
+                    {
+                        break;
+                    }
+                }
+
+                if( record != NULL )
+                {
+                    if( record->TypeVal == TYPEVAL_REGULAR || record->TypeVal == TYPEVAL_DIRETORIO )
+                    {
+                        strcpy(dentry->name, record->name);
+                        dentry->fileType = record->TypeVal;
+                        dentry->fileSize = (__inode_get_by_idx(record->inodeNumber))->bytesFileSize;
+
+                        g_fs->dirs[handle].pointer += 1;
+
+                        return OP_SUCCESS;
+                    }
+                }
+            }
+
+            g_fs->dirs[handle].pointer = 0;
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Realiza a leitura, em lote, das entradas do diretório identificado por "handle".
+	A partir do ponteiro de entradas (current entry), lê até "max" entradas válidas, colocando-as em "dentries".
+	Cada bloco do diretório é lido uma única vez e os inodes das entradas são buscados em ordem crescente,
+		de forma que entradas cujos inodes estão no mesmo setor compartilham a mesma leitura.
+	Após a leitura, o ponteiro de entradas é ajustado para a entrada seguinte à última lida.
+
+Entra:	handle -> identificador do diretório cujas entradas deseja-se ler.
+	dentries -> vetor com espaço para pelo menos "max" entradas.
+	max -> número máximo de entradas a serem lidas.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o número de entradas lidas.
+		Se retornar "0" (zero), não há mais entradas válidas (e o ponteiro volta ao início do diretório).
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int t2fs_getdents2 (T2FS *fs, DIR2 handle, DIRENT2 *dentries, int max)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( handle >= 0 && handle < MAX_NUM_HANDLERS && dentries != NULL && max > 0 )
+    {
+        if( !(g_fs->dirs[handle].free || g_fs->dirs[handle].record == NULL) )
+        {
+            return __record_read_entries(&g_fs->dirs[handle], dentries, max);
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Percorre a árvore do diretório "pathname", chamando "fn" para cada arquivo e subdiretório encontrado.
+	Os diretórios são distribuídos entre "nthreads" threads com roubo de trabalho entre as filas.
+
+Entra:	pathname -> caminho do diretório raiz do percurso
+	fn -> função chamada para cada entrada
+	arg -> argumento repassado a "fn"
+	nthreads -> número de threads
+
+Saída:	Se todo o percurso foi realizado, a função retorna "0" (zero).
+	Se "fn" interrompeu o percurso, retorna o valor diferente de zero retornado por "fn".
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int t2fs_nftw2 (T2FS *fs, char *pathname, NFTW2_FN fn, void *arg, int nthreads)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return __tree_walk(pathname, fn, arg, nthreads);
+}
+
+
+/*-----------------------------------------------------------------------------
+Função:	Compacta o diretório informado por "pathname".
+	As entradas válidas são movidas para o início do diretório (mantendo a ordem) e os blocos
+		que ficaram sem entradas são liberados.
+	Os handles abertos para o diretório continuam válidos: seus ponteiros de entradas são ajustados
+		para a mesma entrada seguinte de antes da compactação.
+	A compactação também é realizada automaticamente quando, após uma remoção, menos de 1/4
+		das entradas de um diretório com mais de um bloco estão ocupadas.
+
+Entra:	pathname -> caminho do diretório a ser compactado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_compactdir2 (T2FS *fs, char *pathname)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    char* parsedPath = parse_path(pathname, g_fs->cwd);
+
+    if( parsedPath != NULL )
+    {
+        struct t2fs_record *record = __record_navigate(parsedPath);
+
+        if( record != NULL && record->TypeVal == TYPEVAL_DIRETORIO )
+        {
+            struct t2fs_inode *inode = __inode_get_by_idx(record->inodeNumber);
+
+            if( inode != NULL )
+            {
+                int result = __dir_compact(inode, record->inodeNumber);
+
+                free(inode);
+                __summary_flush();
+
+                return result;
+            }
+        }
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Informa o espaço total e livre do sistema de arquivos.
+	Os valores vêm de contadores mantidos em memória e persistidos na extensão do superbloco,
+		de forma que a consulta não percorre os bitmaps.
+	Além dos totais, informa um resumo da fragmentação do espaço livre (quantidade e tamanho médio
+		dos trechos contíguos de blocos livres).
+	Também informa o estado da deduplicação (ver dedup2): o tamanho do índice, os blocos poupados
+		e os contadores de buscas desde a inicialização.
+	Em discos formatados com grupos de alocação (ver mkfs2), informa também o número de grupos.
+
+Entra:	stats -> estrutura de dados onde a função coloca as informações.
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_statfs2 (T2FS *fs, STATFS2 *stats)
+{
+    DWORD entries, page, j, *entry;
+
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    // As estatísticas de deduplicação contam as entradas das páginas existentes da tabela de
+    // impressões, sem montar o índice
+    if( stats != NULL && (!(g_fs->sbe->features & SB_FEATURE_DEDUP) || __dedup_load() == OP_SUCCESS) )
+    {
+        entries = __paged_page_entries();
+
+        stats->blockSize = g_fs->sb->blockSize * SECTOR_SIZE;
+        stats->totalBlocks = g_fs->sb->diskSize;
+        stats->freeBlocks = g_fs->sbe->freeBlocks;
+        stats->totalInodes = __inode_get_total();
+        stats->freeInodes = g_fs->sbe->freeInodes;
+        stats->freeBlockRuns = g_fs->sbe->freeBlockRuns;
+        stats->avgFreeRunSize = g_fs->sbe->freeBlockRuns > 0 ? g_fs->sbe->freeBlocks / g_fs->sbe->freeBlockRuns : 0;
+        stats->dedupBlocks = 0;
+        stats->dedupSavedBlocks = 0;
+        stats->dedupLookups = g_fs->dedupLookups;
+        stats->dedupHits = g_fs->dedupHits;
+        stats->dedupFalseMatches = g_fs->dedupFalseMatches;
+        stats->groups = g_fs->sbe->groupBlocks != 0 ? g_fs->zoneCount : 0;
+
+        for( page = 0; g_fs->dedup.dir != NULL && page < g_fs->tablePageCount; page++ )
+        {
+            entry = g_fs->dedup.dir[page] != 0 ? __paged_entry(&g_fs->dedup, page * entries, 0) : NULL;
+
+            for( j = 0; entry != NULL && j < entries && page * entries + j < g_fs->sb->diskSize; j++ )
+            {
+                if( entry[j] != 0 )
+                {
+                    stats->dedupBlocks++;
+                    stats->dedupSavedBlocks += __refcount_get(page * entries + j);
+                }
+            }
+        }
+
+        return OP_SUCCESS;
+    }
+
+    return OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Liga ou desliga o empacotamento de caudas no disco.
+	Com o empacotamento ligado, ao fechar um arquivo o seu último bloco, se parcial, é movido
+		para um fragmento dentro de um bloco compartilhado com as caudas de outros arquivos.
+	A escolha é gravada no disco. Caudas já empacotadas continuam válidas ao desligar o modo.
+
+Entra:	enable -> diferente de zero para ligar, zero para desligar
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_tailpack2 (T2FS *fs, int enable)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( enable )
+    {
+        g_fs->sbe->features |= SB_FEATURE_TAILPACK;
+    }
+    else
+    {
+        g_fs->sbe->features &= ~SB_FEATURE_TAILPACK;
+    }
+
+    return __summary_write();
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Liga ou desliga os checksums dos blocos de dados no disco.
+	Com os checksums ligados, cada bloco de dados de arquivo gravado tem o seu CRC32C registrado
+		numa tabela declarada na extensão do superbloco (criada quando o modo é ligado).
+		Ao ler o bloco, o CRC é conferido e uma divergência faz a leitura falhar.
+	Ao desligar o modo a tabela é descartada: os blocos já gravados ficam sem checksum, assim como
+		os fragmentos de arquivos pequenos. A escolha é gravada no disco.
+
+Entra:	enable -> diferente de zero para ligar, zero para desligar
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_checksum2 (T2FS *fs, int enable)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( enable )
+    {
+        if( __paged_create(&g_fs->checksum, &g_fs->sbe->checksumBlock, &g_fs->sbe->checksumSize) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        g_fs->sbe->features |= SB_FEATURE_CHECKSUM;
+    }
+    else
+    {
+        // Sem o modo a tabela não é mantida: entradas antigas não podem sobreviver até o modo voltar
+        if( __paged_discard(&g_fs->checksum, &g_fs->sbe->checksumBlock, &g_fs->sbe->checksumSize) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        g_fs->sbe->features &= ~SB_FEATURE_CHECKSUM;
+    }
+
+    __summary_flush();
+
+    return __summary_write();
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Liga ou desliga a deduplicação de blocos no disco.
+	Com a deduplicação ligada, cada bloco inteiro escrito num arquivo é procurado, pela sua impressão
+		digital (CRC32C do conteúdo), num índice dos blocos já gravados. Se existe um bloco com o mesmo
+		conteúdo (conferido byte a byte), o arquivo passa a apontar para ele, que ganha uma referência,
+		e nada é gravado. Uma escrita posterior em qualquer um dos arquivos copia o bloco (copy-on-write).
+	As impressões ficam numa tabela declarada na extensão do superbloco (criada quando o modo é
+		ligado), a partir da qual o índice é montado em memória na primeira escrita deduplicada.
+		Ao desligar o modo a tabela é descartada: os blocos já gravados deixam de ser procurados.
+	Escritas parciais de blocos não são deduplicadas. A escolha é gravada no disco.
+
+Entra:	enable -> diferente de zero para ligar, zero para desligar
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_dedup2 (T2FS *fs, int enable)
+{
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    if( enable )
+    {
+        // Blocos deduplicados são compartilhados: precisam dos contadores de referência
+        if( __refcount_create() != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        if( __paged_create(&g_fs->dedup, &g_fs->sbe->dedupBlock, &g_fs->sbe->dedupSize) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        g_fs->sbe->features |= SB_FEATURE_DEDUP;
+    }
+    else
+    {
+        // Sem o modo a tabela não é mantida: é descartada junto com o índice
+        if( __paged_discard(&g_fs->dedup, &g_fs->sbe->dedupBlock, &g_fs->sbe->dedupSize) != OP_SUCCESS )
+        {
+            return OP_ERROR;
+        }
+
+        free(g_fs->dedupHead);
+        free(g_fs->dedupNext);
+        g_fs->dedupHead = NULL;
+        g_fs->dedupNext = NULL;
+        g_fs->sbe->features &= ~SB_FEATURE_DEDUP;
+    }
+
+    __summary_flush();
+
+    return __summary_write();
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Verifica a consistência do sistema de arquivos e, opcionalmente, corrige o que encontrou.
+	A árvore de diretórios é percorrida a partir da raiz por "nthreads" threads (como em nftw2),
+		marcando os i-nodes alcançáveis; em seguida a área de i-nodes é lida em leituras sequenciais
+		grandes, dividida entre as threads, e os blocos de cada i-node alcançável (dados, indireção
+		e fragmentos) são contados. Os bitmaps montados em memória são comparados com os bitmaps
+		do disco, e as referências de cada bloco com a tabela de contadores de referência.
+	Com "repair", os bitmaps do disco passam a refletir a árvore: i-nodes órfãos e blocos sem
+		referência são liberados, i-nodes e blocos em uso são marcados como ocupados, registros
+		que apontam para fora da área de i-nodes são removidos, os contadores de referência
+		são ajustados e os contadores de livres são recalculados. Ponteiros inválidos e setores
+		de fragmentos reclamados por dois arquivos são apenas informados.
+	Não deve haver arquivos abertos durante a verificação.
+
+Entra:	stats -> estrutura de dados onde a função coloca o resultado da verificação
+	repair -> diferente de zero para corrigir as inconsistências encontradas
+	nthreads -> número de threads (valores menores que 1 usam apenas a thread chamadora)
+
+Saída:	Se a verificação foi realizada, a função retorna "0" (zero), mesmo que tenha encontrado
+		inconsistências (ver "stats").
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_fsck2 (T2FS *fs, FSCK2_STATS *stats, int repair, int nthreads)
+{
+    if( stats == NULL || __fs_enter(fs, repair) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return __fsck(stats, repair, nthreads);
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Desfragmenta o arquivo "pathname" ou, se for um diretório, o diretório e toda a sua árvore
+		("/" desfragmenta o sistema de arquivos inteiro).
+	Os blocos de cada arquivo fragmentado são copiados para um trecho contíguo de blocos livres: os
+		blocos de indireção no início do trecho, seguidos dos blocos de dados na ordem do arquivo.
+		O i-node passa a apontar para as cópias de uma vez e só então os blocos antigos são liberados.
+	Blocos compartilhados com outros arquivos (clone2 e dedup2) ficam no lugar. Um arquivo sem trecho
+		livre do tamanho necessário não é alterado.
+	Os handles abertos continuam válidos.
+
+Entra:	pathname -> caminho do arquivo ou do diretório
+	maxBlocksPerSecond -> limite de blocos copiados por segundo (0 para não limitar)
+	fn -> função chamada após cada arquivo com o caminho e o progresso, além de "arg" (pode ser NULL)
+	arg -> argumento repassado a "fn"
+	stats -> estrutura de dados onde a função coloca o resultado (pode ser NULL)
+
+Saída:	Se toda a desfragmentação foi realizada, a função retorna "0" (zero).
+	Se "fn" interrompeu a desfragmentação, retorna o valor diferente de zero retornado por "fn".
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int t2fs_defrag2 (T2FS *fs, char *pathname, DWORD maxBlocksPerSecond, DEFRAG2_FN fn, void *arg, DEFRAG2_STATS *stats)
+{
+    DEFRAG2_STATS localStats;
+
+    if( __fs_enter(fs, 1) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return __defrag(pathname, maxBlocksPerSecond, fn, arg, stats != NULL ? stats : &localStats);
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Informa a disposição no disco do arquivo "pathname" ou, se for um diretório, do diretório e de toda
+		a sua árvore ("/" cobre o sistema de arquivos inteiro), sem alterar o disco.
+	Para cada arquivo, "fn" recebe os trechos contíguos, os buracos, os blocos compartilhados e os blocos
+		de indireção, lidos do mapa de blocos do i-node; para diretórios, também os registros válidos
+		e os que cabem nos blocos alocados.
+	"stats" recebe os totais e os trechos de blocos livres do disco inteiro, agrupados por tamanho.
+
+Entra:	pathname -> caminho do arquivo ou do diretório
+	fn -> função chamada com o caminho absoluto e a disposição de cada arquivo, além de "arg" (pode ser NULL)
+	arg -> argumento repassado a "fn"
+	stats -> estrutura de dados onde a função coloca o resumo
+
+Saída:	Se todo o relatório foi feito, a função retorna "0" (zero).
+	Se "fn" interrompeu o relatório, retorna o valor diferente de zero retornado por "fn".
+	Em caso de erro, será retornado um valor negativo.
+-----------------------------------------------------------------------------*/
+int t2fs_layout2 (T2FS *fs, char *pathname, LAYOUT2_FN fn, void *arg, LAYOUT2_STATS *stats)
+{
+    if( stats == NULL || __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return __layout(pathname, fn, arg, stats);
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Fecha o diretório identificado pelo parâmetro "handle".
+
+Entra:	handle -> identificador do diretório que se deseja fechar (encerrar a operação).
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_closedir2 (T2FS *fs, DIR2 handle)
+{
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    return __handler_free(handle, TYPEVAL_DIRETORIO);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Libera toda a memória de um sistema de arquivos (montado ou com a montagem
+        interrompida)
+
+Entra:
+    fs -> sistema de arquivos
+-----------------------------------------------------------------------------*/
+void __fs_free(T2FS *fs)
+{
+    int i;
+
+    for( i = 0; i < PATH_CACHE_SIZE; i++ )
+    {
+        free(fs->pathCache[i].path);
+    }
+
+    free(fs->sb);
+    free(fs->sbe);
+
+    __paged_free(&fs->refcount, fs->tablePageCount);
+    __paged_free(&fs->checksum, fs->tablePageCount);
+    __paged_free(&fs->dedup, fs->tablePageCount);
+    free(fs->dedupHead);
+    free(fs->dedupNext);
+    free(fs->dataCache);
+    free(fs->zones);
+    free(fs->zonesDirty);
+    free(fs->ri);
+    free(fs->cwd);
+    free(fs->cwdRecord);
+
+    pthread_mutex_destroy(&fs->lock);
+    free(fs);
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Monta o sistema de arquivos gravado num dispositivo, criando um contexto próprio
+		(superbloco, tabelas, caches, handles e diretório corrente) que é usado com as
+		variantes t2fs_* das funções da API. Várias imagens podem ficar montadas ao mesmo
+		tempo. As funções sem o prefixo t2fs_ usam um sistema de arquivos padrão, montado
+		na primeira chamada sobre o disco de apidisk.
+
+Entra:	backend -> dispositivo da imagem (a estrutura é copiada; 'data' deve continuar válido
+		até a desmontagem)
+	options -> opções de montagem (NULL para as opções padrão)
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna o sistema de arquivos montado.
+	Em caso de erro, será retornado NULL.
+-----------------------------------------------------------------------------*/
+T2FS *t2fs_mount (T2FS_BACKEND *backend, T2FS_OPTIONS *options)
+{
+    T2FS *fs;
+
+    if( backend == NULL || backend->readSector == NULL || backend->writeSector == NULL )
+    {
+        return NULL;
+    }
+
+    fs = (T2FS*)calloc(1, sizeof(T2FS));
+    fs->backend = *backend;
+    fs->readOnly = options != NULL && options->readOnly;
+    fs->oldAlloc = options != NULL && options->oldAlloc;
+    fs->dataCacheBlock = INVALID_PTR;
+    pthread_mutex_init(&fs->lock, NULL);
+
+    g_fs = fs;
+
+    if( __init() != OP_SUCCESS )
+    {
+        __fs_free(fs);
+        g_fs = NULL;
+
+        return NULL;
+    }
+
+    return fs;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Desmonta um sistema de arquivos montado com t2fs_mount.
+	Os arquivos que ainda estão abertos são fechados, as tabelas são gravadas no dispositivo
+		e toda a memória do contexto é liberada. O dispositivo não é fechado.
+	A desmontagem grava as dicas de registros livres dos diretórios e marca o disco como
+		desmontado corretamente: a próxima montagem carrega os contadores, os cursores de
+		alocação e as dicas sem percorrer os bitmaps. Se o disco foi alterado sem ser
+		desmontado e uma operação foi interrompida, a montagem reconstrói os contadores a
+		partir dos bitmaps, com várias threads.
+
+Entra:	fs -> sistema de arquivos a ser desmontado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_unmount (T2FS *fs)
+{
+    int i;
+
+    if( __fs_enter(fs, 0) != OP_SUCCESS )
+    {
+        return OP_ERROR;
+    }
+
+    for( i = 0; i < MAX_NUM_HANDLERS; i++ )
+    {
+        if( !g_fs->readOnly && !(g_fs->files[i].free || g_fs->files[i].record == NULL) )
+        {
+            __file_pack_tail(&g_fs->files[i]);
+        }
+
+        __handler_free(i, TYPEVAL_REGULAR);
+        __handler_free(i, TYPEVAL_DIRETORIO);
+    }
+
+    __summary_flush();
+
+    // Desmontagem limpa: as dicas dos diretórios e os contadores das zonas são gravados antes da marca que os valida
+    if( !g_fs->readOnly && __dir_hints_write() == OP_SUCCESS && __zone_counts_write() == OP_SUCCESS )
+    {
+        g_fs->sbe->unmountState = SB_UNMOUNT_CLEAN;
+        __summary_write();
+    }
+
+    if( !g_fs->readOnly && g_fs->backend.flush != NULL )
+    {
+        g_fs->backend.flush(g_fs->backend.data);
+    }
+
+    if( fs == g_fs_default )
+    {
+        g_fs_default = NULL;
+    }
+
+    __fs_free(fs);
+    g_fs = NULL;
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê um setor de um arquivo de imagem (dispositivo de t2fs_backend_file). As
+        posições são off_t: compilada com _FILE_OFFSET_BITS=64 (ver makefile), a imagem
+        pode passar de 2 GB também em 32 bits.
+
+Entra:
+    data -> arquivo de imagem aberto
+    sector -> setor a ser lido
+    buffer -> buffer com o tamanho de um setor
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __backend_file_read(void *data, unsigned int sector, unsigned char *buffer)
+{
+    FILE *file = (FILE*)data;
+
+    if( fseeko(file, (off_t)sector * SECTOR_SIZE, SEEK_SET) != 0 || fread(buffer, 1, SECTOR_SIZE, file) != SECTOR_SIZE )
+    {
+        return OP_ERROR;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê setores consecutivos de um arquivo de imagem numa única leitura
+        (dispositivo de t2fs_backend_file)
+
+Entra:
+    data -> arquivo de imagem aberto
+    sector -> primeiro setor a ser lido
+    count -> número de setores
+    buffer -> buffer com o tamanho de 'count' setores
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __backend_file_read_range(void *data, unsigned int sector, unsigned int count, unsigned char *buffer)
+{
+    FILE *file = (FILE*)data;
+
+    if( fseeko(file, (off_t)sector * SECTOR_SIZE, SEEK_SET) != 0 || fread(buffer, SECTOR_SIZE, count, file) != count )
+    {
+        return OP_ERROR;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve um setor num arquivo de imagem (dispositivo de t2fs_backend_file)
+
+Entra:
+    data -> arquivo de imagem aberto
+    sector -> setor a ser escrito
+    buffer -> buffer com o tamanho de um setor
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __backend_file_write(void *data, unsigned int sector, unsigned char *buffer)
+{
+    FILE *file = (FILE*)data;
+
+    if( fseeko(file, (off_t)sector * SECTOR_SIZE, SEEK_SET) != 0 || fwrite(buffer, 1, SECTOR_SIZE, file) != SECTOR_SIZE )
+    {
+        return OP_ERROR;
+    }
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Envia ao sistema operacional as escritas pendentes de um arquivo de imagem
+        (dispositivo de t2fs_backend_file)
+
+Entra:
+    data -> arquivo de imagem aberto
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna OP_SUCCESS
+    Se ocorreu algum erro, retorna OP_ERROR.
+-----------------------------------------------------------------------------*/
+int __backend_file_flush(void *data)
+{
+    return fflush((FILE*)data) == 0 ? OP_SUCCESS : OP_ERROR;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Prepara um dispositivo sobre um arquivo de imagem (no mesmo formato de apidisk:
+		setores gravados em sequência, a partir do setor zero).
+
+Entra:	backend -> estrutura onde a função coloca o dispositivo
+	path -> caminho do arquivo de imagem, que deve existir
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_backend_file (T2FS_BACKEND *backend, char *path)
+{
+    FILE *file;
+
+    if( backend == NULL || path == NULL || (file = fopen(path, "r+b")) == NULL )
+    {
+        return OP_ERROR;
+    }
+
+    backend->readSector = __backend_file_read;
+    backend->writeSector = __backend_file_write;
+    backend->flush = __backend_file_flush;
+    backend->data = file;
+    backend->readSectors = __backend_file_read_range;
+
+    return OP_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+Função:	Fecha um dispositivo preparado com t2fs_backend_file (após desmontar o sistema de
+		arquivos que o usa).
+
+Entra:	backend -> dispositivo a ser fechado
+
+Saída:	Se a operação foi realizada com sucesso, a função retorna "0" (zero).
+	Em caso de erro, será retornado um valor diferente de zero.
+-----------------------------------------------------------------------------*/
+int t2fs_backend_close (T2FS_BACKEND *backend)
+{
+    int result;
+
+    if( backend == NULL || backend->data == NULL || backend->readSector != __backend_file_read )
+    {
+        return OP_ERROR;
+    }
+
+    result = fclose((FILE*)backend->data) == 0 ? OP_SUCCESS : OP_ERROR;
+    backend->data = NULL;
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê um setor do disco de apidisk (dispositivo do sistema de arquivos padrão)
+-----------------------------------------------------------------------------*/
+int __backend_apidisk_read(void *data, unsigned int sector, unsigned char *buffer)
+{
+    return read_sector(sector, buffer);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve um setor no disco de apidisk (dispositivo do sistema de arquivos padrão)
+-----------------------------------------------------------------------------*/
+int __backend_apidisk_write(void *data, unsigned int sector, unsigned char *buffer)
+{
+    return write_sector(sector, buffer);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa o sistema de arquivos padrão, montando-o sobre o disco de apidisk na
+        primeira chamada
+
+Saída:
+    Se a montagem foi realizada com sucesso, retorna o sistema de arquivos padrão
+    Se ocorreu algum erro, retorna NULL (a montagem é tentada de novo na próxima chamada).
+-----------------------------------------------------------------------------*/
+T2FS *__fs_default()
+{
+    T2FS_BACKEND backend;
+
+    if( g_fs_default == NULL )
+    {
+        backend.readSector = __backend_apidisk_read;
+        backend.writeSector = __backend_apidisk_write;
+        backend.flush = NULL;
+        backend.data = NULL;
+        backend.readSectors = NULL;
+
+        g_fs_default = t2fs_mount(&backend, NULL);
+    }
+
+    return g_fs_default;
+}
+
+/*-----------------------------------------------------------------------------
+Funções da API sobre o sistema de arquivos padrão (ver as variantes t2fs_*)
+-----------------------------------------------------------------------------*/
+FILE2 create2 (char *filename)
+{
+    return t2fs_create2(__fs_default(), filename);
+}
+
+int delete2 (char *filename)
+{
+    return t2fs_delete2(__fs_default(), filename);
+}
+
+int rename2 (char *oldpath, char *newpath)
+{
+    return t2fs_rename2(__fs_default(), oldpath, newpath);
+}
+
+int clone2 (char *srcpath, char *dstpath)
+{
+    return t2fs_clone2(__fs_default(), srcpath, dstpath);
+}
+
+FILE2 open2 (char *filename)
+{
+    return t2fs_open2(__fs_default(), filename);
+}
+
+int close2 (FILE2 handle)
+{
+    return t2fs_close2(__fs_default(), handle);
+}
+
+int read2 (FILE2 handle, char *buffer, int size)
+{
+    return t2fs_read2(__fs_default(), handle, buffer, size);
+}
+
+int write2 (FILE2 handle, char *buffer, int size)
+{
+    return t2fs_write2(__fs_default(), handle, buffer, size);
+}
+
+int copy_file_range2 (FILE2 src, DWORD srcOffset, FILE2 dst, DWORD dstOffset, DWORD len)
+{
+    return t2fs_copy_file_range2(__fs_default(), src, srcOffset, dst, dstOffset, len);
+}
+
+int truncate2 (FILE2 handle)
+{
+    return t2fs_truncate2(__fs_default(), handle);
+}
+
+int ftruncate2 (FILE2 handle, DWORD size)
+{
+    return t2fs_ftruncate2(__fs_default(), handle, size);
+}
+
+int fcompress2 (FILE2 handle, int enable)
+{
+    return t2fs_fcompress2(__fs_default(), handle, enable);
+}
+
+int stat2 (char *pathname, STAT2 *stats)
+{
+    return t2fs_stat2(__fs_default(), pathname, stats);
+}
+
+int fstat2 (FILE2 handle, STAT2 *stats)
+{
+    return t2fs_fstat2(__fs_default(), handle, stats);
+}
+
+int seek2 (FILE2 handle, DWORD offset)
+{
+    return t2fs_seek2(__fs_default(), handle, offset);
+}
+
+int lseek2 (FILE2 handle, DWORD offset, int whence)
+{
+    return t2fs_lseek2(__fs_default(), handle, offset, whence);
+}
+
+int mkdir2 (char *pathname)
+{
+    return t2fs_mkdir2(__fs_default(), pathname);
+}
+
+int rmdir2 (char *pathname)
+{
+    return t2fs_rmdir2(__fs_default(), pathname);
+}
+
+int rmtree2 (char *pathname)
+{
+    return t2fs_rmtree2(__fs_default(), pathname);
+}
+
+int chdir2 (char *pathname)
+{
+    return t2fs_chdir2(__fs_default(), pathname);
+}
+
+int getcwd2 (char *pathname, int size)
+{
+    return t2fs_getcwd2(__fs_default(), pathname, size);
+}
+
+DIR2 opendir2 (char *pathname)
+{
+    return t2fs_opendir2(__fs_default(), pathname);
+}
+
+int readdir2 (DIR2 handle, DIRENT2 *dentry)
+{
+    return t2fs_readdir2(__fs_default(), handle, dentry);
+}
+
+int getdents2 (DIR2 handle, DIRENT2 *dentries, int max)
+{
+    return t2fs_getdents2(__fs_default(), handle, dentries, max);
+}
+
+int nftw2 (char *pathname, NFTW2_FN fn, void *arg, int nthreads)
+{
+    return t2fs_nftw2(__fs_default(), pathname, fn, arg, nthreads);
+}
+
+int compactdir2 (char *pathname)
+{
+    return t2fs_compactdir2(__fs_default(), pathname);
+}
+
+int tailpack2 (int enable)
+{
+    return t2fs_tailpack2(__fs_default(), enable);
+}
+
+int checksum2 (int enable)
+{
+    return t2fs_checksum2(__fs_default(), enable);
+}
+
+int statfs2 (STATFS2 *stats)
+{
+    return t2fs_statfs2(__fs_default(), stats);
+}
+
+int dedup2 (int enable)
+{
+    return t2fs_dedup2(__fs_default(), enable);
+}
+
+int fsck2 (FSCK2_STATS *stats, int repair, int nthreads)
+{
+    return t2fs_fsck2(__fs_default(), stats, repair, nthreads);
+}
+
+int defrag2 (char *pathname, DWORD maxBlocksPerSecond, DEFRAG2_FN fn, void *arg, DEFRAG2_STATS *stats)
+{
+    return t2fs_defrag2(__fs_default(), pathname, maxBlocksPerSecond, fn, arg, stats);
+}
+
+int layout2 (char *pathname, LAYOUT2_FN fn, void *arg, LAYOUT2_STATS *stats)
+{
+    return t2fs_layout2(__fs_default(), pathname, fn, arg, stats);
+}
+
+int closedir2 (DIR2 handle)
+{
+    return t2fs_closedir2(__fs_default(), handle);
 }
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/t2fs.h"
+#include "../include/crc32c.h"
+
+#define BENCH_FILE_SIZE (2 * 1024 * 1024)
+#define BENCH_CHUNK (64 * 1024)
+#define BENCH_PASSES 5
+#define BENCH_CRC_BLOCK 1024
+#define BENCH_CRC_ROUNDS 20000
+
+/*-----------------------------------------------------------------------------
+Função: Informa o tempo corrente, em segundos
+-----------------------------------------------------------------------------*/
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Mede a vazão de uma implementação do CRC32C sobre blocos de 1 KB
+
+Entra:
+    fn -> implementação a ser medida
+    buffer -> bloco de dados
+
+Saída:
+    Vazão, em MB/s.
+-----------------------------------------------------------------------------*/
+double bench_crc(unsigned int (*fn)(unsigned int, unsigned char *, int), unsigned char *buffer)
+{
+    volatile unsigned int sink = 0;
+    double start = now();
+    int i;
+
+    for( i = 0; i < BENCH_CRC_ROUNDS; i++ )
+    {
+        sink ^= fn(0, buffer, BENCH_CRC_BLOCK);
+    }
+
+    return (double)BENCH_CRC_ROUNDS * BENCH_CRC_BLOCK / (now() - start) / (1024 * 1024);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Grava um arquivo com os checksums ligados ou desligados
+
+Entra:
+    filename -> nome do arquivo
+    data -> conteúdo do arquivo
+    checksum -> flag indicando se os checksums devem estar ligados
+
+Saída:
+    Se a operação foi realizada com sucesso, retorna 0
+    Se ocorreu algum erro, retorna 1.
+-----------------------------------------------------------------------------*/
+int bench_write(char *filename, char *data, int checksum)
+{
+    FILE2 handle;
+    int i, ok = 1;
+
+    checksum2(checksum);
+    delete2(filename);
+    create2(filename);
+    handle = open2(filename);
+
+    for( i = 0; i < BENCH_FILE_SIZE; i += BENCH_CHUNK )
+    {
+        ok &= write2(handle, data + i, BENCH_CHUNK) == BENCH_CHUNK;
+    }
+
+    close2(handle);
+
+    return ok ? 0 : 1;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Mede a vazão da leitura sequencial de um arquivo
+
+Entra:
+    filename -> nome do arquivo
+    data -> conteúdo esperado
+
+Saída:
+    Vazão da leitura, em MB/s (0 se o conteúdo lido é diferente do esperado).
+-----------------------------------------------------------------------------*/
+double bench_read(char *filename, char *data)
+{
+    char *readBuffer = (char*)malloc(BENCH_FILE_SIZE);
+    FILE2 handle = open2(filename);
+    double start, elapsed;
+    int i, ok = 1;
+
+    start = now();
+
+    for( i = 0; i < BENCH_FILE_SIZE; i += BENCH_CHUNK )
+    {
+        ok &= read2(handle, readBuffer + i, BENCH_CHUNK) == BENCH_CHUNK;
+    }
+
+    elapsed = now() - start;
+    ok &= memcmp(readBuffer, data, BENCH_FILE_SIZE) == 0;
+
+    close2(handle);
+    free(readBuffer);
+
+    return ok ? BENCH_FILE_SIZE / elapsed / (1024 * 1024) : 0;
+}
+
+int main()
+{
+    unsigned char block[BENCH_CRC_BLOCK];
+    char *data = (char*)malloc(BENCH_FILE_SIZE);
+    double plain, verified, rate;
+    int i, ok = 1;
+
+    for( i = 0; i < BENCH_FILE_SIZE; i++ )
+    {
+        data[i] = (char)rand();
+    }
+
+    memcpy(block, data, BENCH_CRC_BLOCK);
+
+    printf("----BENCHMARK DE CHECKSUMS----\n");
+    printf("CRC32C (blocos de %d bytes, %d bits): %s %8.0f MB/s  portável %8.0f MB/s\n", BENCH_CRC_BLOCK, (int)sizeof(void*) * 8,
+           crc32c_hardware() ? "SSE4.2" : "(sem SSE4.2)", bench_crc(crc32c, block), bench_crc(crc32c_portable, block));
+
+    // As leituras dos dois arquivos são alternadas; vale a melhor passada de cada um
+    plain = verified = 0;
+
+    if( bench_write("/bench_plain", data, 0) != 0 || bench_write("/bench_crc", data, 1) != 0 )
+    {
+        printf("ERRO: escrita dos arquivos\n");
+        free(data);
+
+        return 1;
+    }
+
+    checksum2(0);
+
+    for( i = 0; i < BENCH_PASSES; i++ )
+    {
+        rate = bench_read("/bench_plain", data);
+        ok &= rate != 0;
+        plain = rate > plain ? rate : plain;
+
+        rate = bench_read("/bench_crc", data);
+        ok &= rate != 0;
+        verified = rate > verified ? rate : verified;
+    }
+
+    delete2("/bench_plain");
+    delete2("/bench_crc");
+
+    printf("Leitura sequencial (%d MB, leituras de %d KB, %d passadas):\n", BENCH_FILE_SIZE / (1024 * 1024), BENCH_CHUNK / 1024, BENCH_PASSES);
+    printf("    sem checksum %8.2f MB/s\n", plain);
+    printf("    com checksum %8.2f MB/s\n", verified);
+
+    if( !ok )
+    {
+        printf("ERRO: conteúdo lido diferente do gravado\n");
+        free(data);
+
+        return 1;
+    }
+
+    printf("    custo da verificação: %.1f%%\n", (plain / verified - 1) * 100);
+    free(data);
+
+    return 0;
+}
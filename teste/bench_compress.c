@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/t2fs.h"
+
+#define BENCH_FILE_SIZE (512 * 1024)
+#define BENCH_CHUNK 4096
+#define BENCH_RANDOM_READS 512
+
+/*-----------------------------------------------------------------------------
+Função: Informa o tempo corrente, em segundos
+-----------------------------------------------------------------------------*/
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Preenche o buffer com linhas de log em JSON (dados que comprimem bem)
+-----------------------------------------------------------------------------*/
+void fill_logs(char *buffer, int size)
+{
+    static const char *levels[] = { "info", "warn", "debug", "error" };
+    char line[128];
+    int pos = 0, i = 0, len;
+
+    while( pos < size )
+    {
+        len = sprintf(line, "{\"ts\": %d, \"level\": \"%s\", \"req\": %d, \"msg\": \"request served\"}\n",
+                      1540000000 + i, levels[rand() % 4], rand() % 1000);
+        memcpy(buffer + pos, line, pos + len <= size ? len : size - pos);
+        pos += len;
+        i++;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Preenche o buffer com bytes aleatórios (dados que não comprimem)
+-----------------------------------------------------------------------------*/
+void fill_random(char *buffer, int size)
+{
+    int i;
+
+    for( i = 0; i < size; i++ )
+    {
+        buffer[i] = (char)rand();
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Grava, lê sequencialmente e lê em posições aleatórias um arquivo, com ou sem
+        compressão, e imprime as vazões e a taxa de compressão obtidas
+-----------------------------------------------------------------------------*/
+int bench(char *label, char *data, int compress)
+{
+    char *readBuffer = (char*)malloc(BENCH_FILE_SIZE);
+    double start, writeTime, readTime, randomTime;
+    STAT2 stats;
+    FILE2 handle;
+    int i, ok = 1;
+
+    delete2("/bench");
+    create2("/bench");
+    handle = open2("/bench");
+
+    if( handle < 0 || fcompress2(handle, compress) != 0 )
+    {
+        printf("%-8s %-10s erro ao criar o arquivo\n", label, compress ? "comprimido" : "normal");
+        free(readBuffer);
+
+        return 1;
+    }
+
+    start = now();
+
+    for( i = 0; i < BENCH_FILE_SIZE; i += BENCH_CHUNK )
+    {
+        ok &= write2(handle, data + i, BENCH_CHUNK) == BENCH_CHUNK;
+    }
+
+    writeTime = now() - start;
+    close2(handle);
+
+    handle = open2("/bench");
+    start = now();
+
+    for( i = 0; i < BENCH_FILE_SIZE; i += BENCH_CHUNK )
+    {
+        ok &= read2(handle, readBuffer + i, BENCH_CHUNK) == BENCH_CHUNK;
+    }
+
+    readTime = now() - start;
+    ok &= memcmp(readBuffer, data, BENCH_FILE_SIZE) == 0;
+
+    start = now();
+
+    for( i = 0; i < BENCH_RANDOM_READS; i++ )
+    {
+        DWORD offset = rand() % (BENCH_FILE_SIZE - 64);
+
+        seek2(handle, offset);
+        ok &= read2(handle, readBuffer, 64) == 64 && memcmp(readBuffer, data + offset, 64) == 0;
+    }
+
+    randomTime = now() - start;
+    fstat2(handle, &stats);
+    close2(handle);
+    delete2("/bench");
+
+    printf("%-8s %-10s escrita %8.2f MB/s  leitura %8.2f MB/s  aleatória %8.0f leituras/s  taxa %5.2fx  %s\n",
+           label, compress ? "comprimido" : "normal",
+           BENCH_FILE_SIZE / writeTime / (1024 * 1024), BENCH_FILE_SIZE / readTime / (1024 * 1024),
+           BENCH_RANDOM_READS / randomTime, (double)BENCH_FILE_SIZE / (stats.dataSectors * SECTOR_SIZE),
+           ok ? "ok" : "CONTEÚDO DIFERENTE");
+
+    free(readBuffer);
+
+    return ok ? 0 : 1;
+}
+
+int main()
+{
+    char *logs = (char*)malloc(BENCH_FILE_SIZE);
+    char *random = (char*)malloc(BENCH_FILE_SIZE);
+    int errors = 0;
+
+    printf("----BENCHMARK DE COMPRESSÃO (arquivo de %d KB, escritas e leituras de %d bytes)----\n",
+           BENCH_FILE_SIZE / 1024, BENCH_CHUNK);
+
+    srand(1);
+    fill_logs(logs, BENCH_FILE_SIZE);
+    fill_random(random, BENCH_FILE_SIZE);
+
+    errors += bench("logs", logs, 0);
+    errors += bench("logs", logs, 1);
+    errors += bench("bytes", random, 0);
+    errors += bench("bytes", random, 1);
+
+    free(logs);
+    free(random);
+
+    return errors;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/t2fs.h"
+
+#define BENCH_LIB_SIZE (64 * 1024)
+#define BENCH_ZERO_SIZE (16 * 1024)
+#define BENCH_NUM_LIBS 3
+#define BENCH_NUM_FILES 8
+#define BENCH_FILE_SIZE (2 * BENCH_LIB_SIZE + BENCH_ZERO_SIZE)
+#define BENCH_CHUNK (16 * 1024)
+
+/*-----------------------------------------------------------------------------
+Função: Informa o tempo corrente, em segundos
+-----------------------------------------------------------------------------*/
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Preenche os arquivos no formato de artefatos de build: cada arquivo junta duas
+        "bibliotecas" (de um conjunto pequeno, repetidas entre os arquivos) separadas
+        por páginas zeradas
+-----------------------------------------------------------------------------*/
+void fill_artifacts(char *files, char *libs)
+{
+    char *file;
+    int i;
+
+    for( i = 0; i < BENCH_NUM_FILES; i++ )
+    {
+        file = files + i * BENCH_FILE_SIZE;
+
+        memcpy(file, libs + (i % BENCH_NUM_LIBS) * BENCH_LIB_SIZE, BENCH_LIB_SIZE);
+        memset(file + BENCH_LIB_SIZE, 0, BENCH_ZERO_SIZE);
+        memcpy(file + BENCH_LIB_SIZE + BENCH_ZERO_SIZE, libs + ((i + 1) % BENCH_NUM_LIBS) * BENCH_LIB_SIZE, BENCH_LIB_SIZE);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Preenche o buffer com bytes aleatórios (nenhum bloco repetido)
+-----------------------------------------------------------------------------*/
+void fill_random(char *buffer, int size)
+{
+    int i;
+
+    for( i = 0; i < size; i++ )
+    {
+        buffer[i] = (char)rand();
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Grava os arquivos com a deduplicação ligada ou desligada e imprime a vazão da
+        escrita, os blocos ocupados e a taxa de deduplicação obtida
+-----------------------------------------------------------------------------*/
+int bench(char *label, char *files, int dedup)
+{
+    char *readBuffer = (char*)malloc(BENCH_FILE_SIZE);
+    STATFS2 before, after;
+    double start, writeTime;
+    char filename[32];
+    FILE2 handle;
+    DWORD usedBlocks;
+    int i, j, ok = 1;
+
+    dedup2(dedup);
+    statfs2(&before);
+    start = now();
+
+    for( i = 0; i < BENCH_NUM_FILES; i++ )
+    {
+        sprintf(filename, "/bench%d", i);
+        create2(filename);
+        handle = open2(filename);
+
+        for( j = 0; j < BENCH_FILE_SIZE; j += BENCH_CHUNK )
+        {
+            ok &= write2(handle, files + i * BENCH_FILE_SIZE + j, BENCH_CHUNK) == BENCH_CHUNK;
+        }
+
+        close2(handle);
+    }
+
+    writeTime = now() - start;
+    statfs2(&after);
+    usedBlocks = before.freeBlocks - after.freeBlocks;
+
+    for( i = 0; i < BENCH_NUM_FILES; i++ )
+    {
+        sprintf(filename, "/bench%d", i);
+        handle = open2(filename);
+        ok &= read2(handle, readBuffer, BENCH_FILE_SIZE) == BENCH_FILE_SIZE &&
+              memcmp(readBuffer, files + i * BENCH_FILE_SIZE, BENCH_FILE_SIZE) == 0;
+        close2(handle);
+        delete2(filename);
+    }
+
+    printf("%-10s %-12s escrita %8.2f MB/s  blocos %5u  taxa %5.2fx  buscas %5u  encontrados %5u  %s\n",
+           label, dedup ? "deduplicado" : "normal",
+           (double)BENCH_NUM_FILES * BENCH_FILE_SIZE / writeTime / (1024 * 1024), usedBlocks,
+           (double)BENCH_NUM_FILES * BENCH_FILE_SIZE / before.blockSize / usedBlocks,
+           after.dedupLookups - before.dedupLookups, after.dedupHits - before.dedupHits,
+           ok ? "ok" : "CONTEÚDO DIFERENTE");
+
+    free(readBuffer);
+
+    return ok ? 0 : 1;
+}
+
+int main()
+{
+    char *libs = (char*)malloc(BENCH_NUM_LIBS * BENCH_LIB_SIZE);
+    char *artifacts = (char*)malloc(BENCH_NUM_FILES * BENCH_FILE_SIZE);
+    char *random = (char*)malloc(BENCH_NUM_FILES * BENCH_FILE_SIZE);
+    int errors = 0;
+
+    printf("----BENCHMARK DE DEDUPLICAÇÃO (%d arquivos de %d KB, escritas de %d KB)----\n",
+           BENCH_NUM_FILES, BENCH_FILE_SIZE / 1024, BENCH_CHUNK / 1024);
+
+    srand(1);
+    fill_random(libs, BENCH_NUM_LIBS * BENCH_LIB_SIZE);
+    fill_artifacts(artifacts, libs);
+    fill_random(random, BENCH_NUM_FILES * BENCH_FILE_SIZE);
+
+    // As tabelas da deduplicação são criadas antes das medições
+    dedup2(1);
+
+    errors += bench("artefatos", artifacts, 0);
+    errors += bench("artefatos", artifacts, 1);
+    errors += bench("únicos", random, 0);
+    errors += bench("únicos", random, 1);
+
+    dedup2(0);
+
+    free(libs);
+    free(artifacts);
+    free(random);
+
+    return errors;
+}
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/t2fs.h"
+
+#define BENCH_IMAGE "t2fs_disk_bench.dat"
+#define BENCH_DISK_BLOCKS 16384
+#define BENCH_FILE_SIZE (1024 * 1024)
+#define BENCH_AGED_FILES 4
+#define BENCH_CHUNK (64 * 1024)
+#define BENCH_PASSES 5
+#define BENCH_RATE 16384
+
+/*-----------------------------------------------------------------------------
+Dispositivo que repassa as operações para o arquivo de imagem, contando os setores
+lidos, as leituras (de um setor ou de setores consecutivos) e os saltos (leituras que
+não começam no setor seguinte ao da leitura anterior)
+-----------------------------------------------------------------------------*/
+T2FS_BACKEND g_image;
+unsigned long g_sectorsRead = 0;
+unsigned long g_reads = 0;
+unsigned long g_seeks = 0;
+unsigned int g_nextSector = 0;
+
+void count_read(unsigned int sector, unsigned int count)
+{
+    g_sectorsRead += count;
+    g_reads++;
+    g_seeks += sector != g_nextSector;
+    g_nextSector = sector + count;
+}
+
+int counting_read(void *data, unsigned int sector, unsigned char *buffer)
+{
+    count_read(sector, 1);
+
+    return g_image.readSector(g_image.data, sector, buffer);
+}
+
+int counting_read_range(void *data, unsigned int sector, unsigned int count, unsigned char *buffer)
+{
+    count_read(sector, count);
+
+    return g_image.readSectors(g_image.data, sector, count, buffer);
+}
+
+int counting_write(void *data, unsigned int sector, unsigned char *buffer)
+{
+    return g_image.writeSector(g_image.data, sector, buffer);
+}
+
+int counting_flush(void *data)
+{
+    return g_image.flush(g_image.data);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa o tempo corrente, em segundos
+-----------------------------------------------------------------------------*/
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Conta os arquivos processados pela desfragmentação
+-----------------------------------------------------------------------------*/
+int progress(const char *path, const DEFRAG2_STATS *stats, void *arg)
+{
+    (*(int*)arg)++;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Mede a leitura sequencial de um arquivo e imprime a vazão (melhor passada), os
+        setores lidos, as leituras e os saltos por passada
+
+Saída:
+    Se o conteúdo lido é o esperado, retorna 0
+    Caso contrário, retorna 1.
+-----------------------------------------------------------------------------*/
+int bench_read(T2FS *fs, char *label, char *filename, char *data)
+{
+    char *readBuffer = (char*)malloc(BENCH_FILE_SIZE);
+    double start, elapsed, best = 0;
+    unsigned long sectors = 0, reads = 0, seeks = 0;
+    FILE2 handle;
+    STAT2 stats;
+    int i, j, ok = 1;
+
+    for( i = 0; i < BENCH_PASSES; i++ )
+    {
+        handle = t2fs_open2(fs, filename);
+        g_sectorsRead = g_reads = g_seeks = 0;
+        start = now();
+
+        for( j = 0; j < BENCH_FILE_SIZE; j += BENCH_CHUNK )
+        {
+            ok &= t2fs_read2(fs, handle, readBuffer + j, BENCH_CHUNK) == BENCH_CHUNK;
+        }
+
+        elapsed = now() - start;
+        best = best == 0 || elapsed < best ? elapsed : best;
+        sectors = g_sectorsRead;
+        reads = g_reads;
+        seeks = g_seeks;
+
+        t2fs_close2(fs, handle);
+        ok &= memcmp(readBuffer, data, BENCH_FILE_SIZE) == 0;
+    }
+
+    t2fs_stat2(fs, filename, &stats);
+
+    printf("%-15s leitura %8.2f MB/s  trechos %5u  setores lidos %5lu  leituras %5lu  saltos %5lu  %s\n", label,
+           BENCH_FILE_SIZE / best / (1024 * 1024), stats.extents, sectors, reads, seeks, ok ? "ok" : "CONTEÚDO DIFERENTE");
+
+    free(readBuffer);
+
+    return ok ? 0 : 1;
+}
+
+int main()
+{
+    T2FS_BACKEND backend = { counting_read, counting_write, counting_flush, NULL, counting_read_range };
+    MKFS2_OPTIONS geometry = { BENCH_DISK_BLOCKS, 4, 1024, 0, 0 };
+    char *data = (char*)malloc(BENCH_FILE_SIZE);
+    DEFRAG2_STATS stats;
+    FILE2 handles[BENCH_AGED_FILES];
+    char filename[32];
+    double start, elapsed;
+    int i, j, files = 0, errors = 0;
+    T2FS *fs;
+
+    for( i = 0; i < BENCH_FILE_SIZE; i++ )
+    {
+        data[i] = (char)rand();
+    }
+
+    if( mkfs2(BENCH_IMAGE, &geometry) != 0 || t2fs_backend_file(&g_image, BENCH_IMAGE) != 0 || (fs = t2fs_mount(&backend, NULL)) == NULL )
+    {
+        printf("ERRO: preparação da imagem\n");
+
+        return 1;
+    }
+
+    // Arquivo gravado de uma vez numa imagem nova
+    t2fs_create2(fs, "/novo");
+    handles[0] = t2fs_open2(fs, "/novo");
+
+    for( i = 0; i < BENCH_FILE_SIZE; i += BENCH_CHUNK )
+    {
+        t2fs_write2(fs, handles[0], data + i, BENCH_CHUNK);
+    }
+
+    t2fs_close2(fs, handles[0]);
+
+    // Imagem envelhecida: arquivos gravados ao mesmo tempo, um bloco de cada vez, e
+    // depois apagados, exceto o primeiro
+    for( i = 0; i < BENCH_AGED_FILES; i++ )
+    {
+        sprintf(filename, "/velho%d", i);
+        t2fs_create2(fs, filename);
+        handles[i] = t2fs_open2(fs, filename);
+    }
+
+    for( j = 0; j < BENCH_FILE_SIZE; j += 1024 )
+    {
+        for( i = 0; i < BENCH_AGED_FILES; i++ )
+        {
+            t2fs_write2(fs, handles[i], data + j, 1024);
+        }
+    }
+
+    for( i = 0; i < BENCH_AGED_FILES; i++ )
+    {
+        t2fs_close2(fs, handles[i]);
+
+        if( i > 0 )
+        {
+            sprintf(filename, "/velho%d", i);
+            t2fs_delete2(fs, filename);
+        }
+    }
+
+    printf("----BENCHMARK DE DESFRAGMENTAÇÃO (arquivos de %d KB, leituras de %d KB, %d passadas)----\n",
+           BENCH_FILE_SIZE / 1024, BENCH_CHUNK / 1024, BENCH_PASSES);
+
+    errors += bench_read(fs, "imagem nova", "/novo", data);
+    errors += bench_read(fs, "envelhecida", "/velho0", data);
+
+    start = now();
+
+    if( t2fs_defrag2(fs, "/", BENCH_RATE, progress, &files, &stats) != 0 )
+    {
+        printf("ERRO: desfragmentação\n");
+        errors++;
+    }
+
+    elapsed = now() - start;
+
+    errors += bench_read(fs, "desfragmentada", "/velho0", data);
+
+    printf("desfragmentação: %d arquivos, %u realocados, %u blocos em %.2f s (%.0f blocos/s, limite %d), trechos %u -> %u\n",
+           files, stats.filesMoved, stats.blocksMoved, elapsed, stats.blocksMoved / elapsed, BENCH_RATE,
+           stats.extentsBefore, stats.extentsAfter);
+
+    t2fs_unmount(fs);
+    t2fs_backend_close(&g_image);
+    remove(BENCH_IMAGE);
+    free(data);
+
+    return errors;
+}
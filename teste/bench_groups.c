@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/t2fs.h"
+
+#define BENCH_IMAGE "t2fs_disk_bench.dat"
+#define BENCH_DISK_BLOCKS 65536
+#define BENCH_INODES 65536
+#define BENCH_GROUP_BLOCKS 2048
+#define BENCH_DIRS 32
+#define BENCH_FILE_SIZE (24 * 1024)
+#define BENCH_FULL_PERCENT 95
+#define BENCH_NEW_FILES 256
+#define BENCH_NEW_FILE_SIZE 4096
+
+/*-----------------------------------------------------------------------------
+Dispositivo que repassa as operações para o arquivo de imagem, contando as leituras e
+os setores lidos dos bitmaps (a área entre o superbloco e a área de inodes)
+-----------------------------------------------------------------------------*/
+T2FS_BACKEND g_image;
+unsigned int g_bitmapStart = 0;
+unsigned int g_bitmapEnd = 0;
+unsigned long g_reads = 0;
+unsigned long g_bitmapSectors = 0;
+
+void count_read(unsigned int sector, unsigned int count)
+{
+    unsigned int i;
+
+    g_reads++;
+
+    for( i = sector; i < sector + count; i++ )
+    {
+        g_bitmapSectors += i >= g_bitmapStart && i < g_bitmapEnd;
+    }
+}
+
+int counting_read(void *data, unsigned int sector, unsigned char *buffer)
+{
+    count_read(sector, 1);
+
+    return g_image.readSector(g_image.data, sector, buffer);
+}
+
+int counting_read_range(void *data, unsigned int sector, unsigned int count, unsigned char *buffer)
+{
+    count_read(sector, count);
+
+    return g_image.readSectors(g_image.data, sector, count, buffer);
+}
+
+int counting_write(void *data, unsigned int sector, unsigned char *buffer)
+{
+    return g_image.writeSector(g_image.data, sector, buffer);
+}
+
+int counting_flush(void *data)
+{
+    return g_image.flush(g_image.data);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa o tempo corrente, em segundos
+-----------------------------------------------------------------------------*/
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê do superbloco a faixa de setores dos bitmaps (campos WORD em little endian)
+-----------------------------------------------------------------------------*/
+void bitmap_range()
+{
+    unsigned char sector[SECTOR_SIZE];
+    unsigned int superblockSize, dataBitmap, inodeBitmap, blockSize;
+
+    g_image.readSector(g_image.data, 0, sector);
+    superblockSize = sector[6] | (sector[7] << 8);
+    dataBitmap = sector[8] | (sector[9] << 8);
+    inodeBitmap = sector[10] | (sector[11] << 8);
+    blockSize = sector[14] | (sector[15] << 8);
+
+    g_bitmapStart = superblockSize * blockSize;
+    g_bitmapEnd = (superblockSize + dataBitmap + inodeBitmap) * blockSize;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Envelhece a imagem: enche os diretórios em rodízio até BENCH_FULL_PERCENT do
+        disco e apaga um arquivo a cada quatro, deixando buracos espalhados
+-----------------------------------------------------------------------------*/
+void populate(T2FS *fs, char *data)
+{
+    char pathname[64];
+    STATFS2 stats;
+    FILE2 handle;
+    int i, k = 0;
+
+    for( i = 0; i < BENCH_DIRS; i++ )
+    {
+        sprintf(pathname, "/dir%d", i);
+        t2fs_mkdir2(fs, pathname);
+    }
+
+    do
+    {
+        for( i = 0; i < BENCH_DIRS; i++ )
+        {
+            sprintf(pathname, "/dir%d/arq%d", i, k);
+            t2fs_create2(fs, pathname);
+            handle = t2fs_open2(fs, pathname);
+            t2fs_write2(fs, handle, data, BENCH_FILE_SIZE);
+            t2fs_close2(fs, handle);
+        }
+
+        k++;
+        t2fs_statfs2(fs, &stats);
+    }
+    while( stats.freeBlocks > (DWORD)(BENCH_DISK_BLOCKS / 100) * (100 - BENCH_FULL_PERCENT) );
+
+    for( ; k > 0; k-- )
+    {
+        for( i = k % 4; i < BENCH_DIRS; i += 4 )
+        {
+            sprintf(pathname, "/dir%d/arq%d", i, k - 1);
+            t2fs_delete2(fs, pathname);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Formata e envelhece uma imagem com o layout indicado e mede, após remontá-la, a
+        criação de arquivos pequenos nos diretórios existentes: a primeira criação (que,
+        sem grupos, conta os livres das zonas nos bitmaps) e as seguintes
+
+Saída:
+    Se não ocorreu erro, retorna 0
+    Caso contrário, retorna 1.
+-----------------------------------------------------------------------------*/
+int bench_layout(char *label, DWORD groupBlocks, int oldAlloc, char *data)
+{
+    T2FS_BACKEND backend = { counting_read, counting_write, counting_flush, NULL, counting_read_range };
+    MKFS2_OPTIONS geometry = { BENCH_DISK_BLOCKS, 2, BENCH_INODES, 0, 0, groupBlocks };
+    T2FS_OPTIONS options = { 0, oldAlloc };
+    unsigned long firstSectors, firstReads;
+    char pathname[64];
+    double start, elapsed;
+    STATFS2 stats;
+    FILE2 handle;
+    int i, created = 0;
+    T2FS *fs;
+
+    if( mkfs2(BENCH_IMAGE, &geometry) != 0 || t2fs_backend_file(&g_image, BENCH_IMAGE) != 0 || (fs = t2fs_mount(&backend, &options)) == NULL )
+    {
+        printf("ERRO: preparação da imagem\n");
+
+        return 1;
+    }
+
+    bitmap_range();
+    populate(fs, data);
+
+    t2fs_unmount(fs);
+    fs = t2fs_mount(&backend, &options);
+
+    g_reads = g_bitmapSectors = 0;
+    start = now();
+
+    for( i = 0; i < BENCH_NEW_FILES; i++ )
+    {
+        sprintf(pathname, "/dir%d/novo%d", i % BENCH_DIRS, i);
+        created += t2fs_create2(fs, pathname) == 0;
+        handle = t2fs_open2(fs, pathname);
+        t2fs_write2(fs, handle, data, BENCH_NEW_FILE_SIZE);
+        t2fs_close2(fs, handle);
+
+        if( i == 0 )
+        {
+            firstSectors = g_bitmapSectors;
+            firstReads = g_reads;
+        }
+    }
+
+    elapsed = now() - start;
+    t2fs_statfs2(fs, &stats);
+
+    printf("%-14s grupos %3u  livres %2u%%  primeiro arquivo: leituras %5lu  setores de bitmap %4lu  "
+           "demais, por arquivo: leituras %6.1f  setores de bitmap %6.1f  (%7.2f ms)\n",
+           label, stats.groups, stats.freeBlocks * 100 / stats.totalBlocks, firstReads, firstSectors,
+           (double)(g_reads - firstReads) / (BENCH_NEW_FILES - 1), (double)(g_bitmapSectors - firstSectors) / (BENCH_NEW_FILES - 1),
+           elapsed * 1000);
+
+    t2fs_unmount(fs);
+    t2fs_backend_close(&g_image);
+    remove(BENCH_IMAGE);
+
+    return created == BENCH_NEW_FILES ? 0 : 1;
+}
+
+int main()
+{
+    char *data = (char*)malloc(BENCH_FILE_SIZE);
+    int i, errors = 0;
+
+    for( i = 0; i < BENCH_FILE_SIZE; i++ )
+    {
+        data[i] = (char)rand();
+    }
+
+    printf("----BENCHMARK DE GRUPOS DE ALOCAÇÃO (%d blocos de 1 KB, %d%% ocupados e 1/4 dos arquivos apagados, %d arquivos novos de %d bytes)----\n",
+           BENCH_DISK_BLOCKS, BENCH_FULL_PERCENT, BENCH_NEW_FILES, BENCH_NEW_FILE_SIZE);
+
+    errors += bench_layout("primeiro livre", 0, 1, data);
+    errors += bench_layout("zonas", 0, 0, data);
+    errors += bench_layout("grupos", BENCH_GROUP_BLOCKS, 0, data);
+
+    free(data);
+
+    return errors;
+}
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/t2fs.h"
+
+#define BENCH_IMAGE "t2fs_disk_bench.dat"
+#define BENCH_DISK_BLOCKS 16384
+#define BENCH_INODES 2048
+#define BENCH_DIRS 8
+#define BENCH_SUBDIRS 2
+#define BENCH_FILES 40
+#define BENCH_FILE_SIZE 2000
+#define BENCH_INODES_PER_SECTOR (SECTOR_SIZE / 32)
+
+/*-----------------------------------------------------------------------------
+Dispositivo que repassa as operações para o arquivo de imagem, contando as leituras e,
+como se houvesse uma cache de setores na frente do disco (esvaziada a cada diretório
+listado), os setores distintos lidos e os saltos entre eles (um setor ainda não lido
+que não segue o último setor novo)
+-----------------------------------------------------------------------------*/
+T2FS_BACKEND g_image;
+unsigned char g_seen[BENCH_DISK_BLOCKS * 4];
+unsigned long g_reads = 0;
+unsigned long g_distinct = 0;
+unsigned long g_seeks = 0;
+unsigned int g_nextSector = 0;
+
+void count_read(unsigned int sector, unsigned int count)
+{
+    unsigned int i;
+
+    g_reads++;
+
+    for( i = sector; i < sector + count && i < sizeof(g_seen); i++ )
+    {
+        if( !g_seen[i] )
+        {
+            g_seen[i] = 1;
+            g_distinct++;
+            g_seeks += i != g_nextSector;
+            g_nextSector = i + 1;
+        }
+    }
+}
+
+int counting_read(void *data, unsigned int sector, unsigned char *buffer)
+{
+    count_read(sector, 1);
+
+    return g_image.readSector(g_image.data, sector, buffer);
+}
+
+int counting_read_range(void *data, unsigned int sector, unsigned int count, unsigned char *buffer)
+{
+    count_read(sector, count);
+
+    return g_image.readSectors(g_image.data, sector, count, buffer);
+}
+
+int counting_write(void *data, unsigned int sector, unsigned char *buffer)
+{
+    return g_image.writeSector(g_image.data, sector, buffer);
+}
+
+int counting_flush(void *data)
+{
+    return g_image.flush(g_image.data);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa o tempo corrente, em segundos
+-----------------------------------------------------------------------------*/
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Povoa a imagem como uma árvore que cresce aos poucos: os arquivos são criados
+        em rodízio entre todos os diretórios, intercalando os irmãos
+-----------------------------------------------------------------------------*/
+void populate(T2FS *fs, char *data)
+{
+    char pathname[64];
+    FILE2 handle;
+    int i, j, k;
+
+    for( i = 0; i < BENCH_DIRS; i++ )
+    {
+        sprintf(pathname, "/dir%d", i);
+        t2fs_mkdir2(fs, pathname);
+    }
+
+    for( j = 0; j < BENCH_SUBDIRS; j++ )
+    {
+        for( i = 0; i < BENCH_DIRS; i++ )
+        {
+            sprintf(pathname, "/dir%d/sub%d", i, j);
+            t2fs_mkdir2(fs, pathname);
+        }
+    }
+
+    for( k = 0; k < BENCH_FILES; k++ )
+    {
+        for( i = 0; i < BENCH_DIRS; i++ )
+        {
+            for( j = -1; j < BENCH_SUBDIRS; j++ )
+            {
+                if( j < 0 )
+                {
+                    sprintf(pathname, "/dir%d/arq%d", i, k);
+                }
+                else
+                {
+                    sprintf(pathname, "/dir%d/sub%d/arq%d", i, j, k);
+                }
+
+                t2fs_create2(fs, pathname);
+                handle = t2fs_open2(fs, pathname);
+                t2fs_write2(fs, handle, data, BENCH_FILE_SIZE);
+                t2fs_close2(fs, handle);
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lista um diretório e lê os metadados de cada entrada (como 'ls -l'), com a cache
+        de setores vazia
+
+Saída:
+    Quantidade de setores distintos da área de inodes que guardam as entradas.
+-----------------------------------------------------------------------------*/
+int list_dir(T2FS *fs, char *dirname, int *entries)
+{
+    DWORD sectors[BENCH_FILES + BENCH_SUBDIRS + 2];
+    char pathname[320];
+    DIRENT2 dentry;
+    STAT2 stats;
+    DIR2 handle;
+    int i, numSectors = 0;
+
+    memset(g_seen, 0, sizeof(g_seen));
+    g_nextSector = 0;
+    handle = t2fs_opendir2(fs, dirname);
+
+    while( t2fs_readdir2(fs, handle, &dentry) == 0 )
+    {
+        if( strcmp(dentry.name, ".") == 0 || strcmp(dentry.name, "..") == 0 )
+        {
+            continue;
+        }
+
+        sprintf(pathname, "%s/%s", dirname, dentry.name);
+        t2fs_stat2(fs, pathname, &stats);
+        (*entries)++;
+
+        for( i = 0; i < numSectors && sectors[i] != stats.inodeNumber / BENCH_INODES_PER_SECTOR; i++ );
+
+        if( i == numSectors && numSectors < BENCH_FILES + BENCH_SUBDIRS + 2 )
+        {
+            sectors[numSectors++] = stats.inodeNumber / BENCH_INODES_PER_SECTOR;
+        }
+    }
+
+    t2fs_closedir2(fs, handle);
+
+    return numSectors;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Povoa uma imagem nova com a política de alocação indicada e mede a listagem
+        (readdir + stat) de todos os diretórios, com os caches vazios
+
+Saída:
+    Se não ocorreu erro, retorna 0
+    Caso contrário, retorna 1.
+-----------------------------------------------------------------------------*/
+int bench_policy(char *label, int oldAlloc, char *data)
+{
+    T2FS_BACKEND backend = { counting_read, counting_write, counting_flush, NULL, counting_read_range };
+    MKFS2_OPTIONS geometry = { BENCH_DISK_BLOCKS, 4, BENCH_INODES, 0, 0 };
+    T2FS_OPTIONS options = { 0, oldAlloc };
+    char dirname[64];
+    double start, elapsed;
+    int i, j, entries = 0, inodeSectors = 0, dirs = 0;
+    T2FS *fs;
+
+    if( mkfs2(BENCH_IMAGE, &geometry) != 0 || t2fs_backend_file(&g_image, BENCH_IMAGE) != 0 || (fs = t2fs_mount(&backend, &options)) == NULL )
+    {
+        printf("ERRO: preparação da imagem\n");
+
+        return 1;
+    }
+
+    populate(fs, data);
+
+    // Remonta a imagem para começar com os caches vazios
+    t2fs_unmount(fs);
+    fs = t2fs_mount(&backend, &options);
+
+    g_reads = g_distinct = g_seeks = 0;
+    start = now();
+
+    for( i = 0; i < BENCH_DIRS; i++ )
+    {
+        sprintf(dirname, "/dir%d", i);
+        inodeSectors += list_dir(fs, dirname, &entries);
+        dirs++;
+
+        for( j = 0; j < BENCH_SUBDIRS; j++ )
+        {
+            sprintf(dirname, "/dir%d/sub%d", i, j);
+            inodeSectors += list_dir(fs, dirname, &entries);
+            dirs++;
+        }
+    }
+
+    elapsed = now() - start;
+
+    printf("%-14s %5d entradas em %7.2f ms  leituras %6lu  por diretório: setores de inodes %5.1f  setores distintos %5.1f  saltos %5.1f\n",
+           label, entries, elapsed * 1000, g_reads, (double)inodeSectors / dirs, (double)g_distinct / dirs, (double)g_seeks / dirs);
+
+    t2fs_unmount(fs);
+    t2fs_backend_close(&g_image);
+    remove(BENCH_IMAGE);
+
+    return entries == dirs * BENCH_FILES + BENCH_DIRS * BENCH_SUBDIRS ? 0 : 1;
+}
+
+int main()
+{
+    char *data = (char*)malloc(BENCH_FILE_SIZE);
+    int i, errors = 0;
+
+    for( i = 0; i < BENCH_FILE_SIZE; i++ )
+    {
+        data[i] = (char)rand();
+    }
+
+    printf("----BENCHMARK DE LOCALIDADE (%d diretórios com %d subdiretórios, %d arquivos de %d bytes em cada, criados em rodízio)----\n",
+           BENCH_DIRS, BENCH_SUBDIRS, BENCH_FILES, BENCH_FILE_SIZE);
+
+    errors += bench_policy("primeiro livre", 1, data);
+    errors += bench_policy("localidade", 0, data);
+
+    free(data);
+
+    return errors;
+}
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/t2fs.h"
+
+#define BENCH_IMAGE "t2fs_disk_bench.dat"
+#define BENCH_MOUNTS 200
+#define BENCH_DIRS 8
+#define BENCH_FILES_PER_DIR 16
+#define BENCH_DATA_SIZE (64 * 1024)
+
+#define BENCH_MOUNT_ONLY 0      /* Só a montagem, sem alterações */
+#define BENCH_READ 1            /* Montagem sem alterações e leitura do início de um arquivo */
+#define BENCH_CREATE 2          /* Montagem com alterações e criação de um arquivo */
+
+/*-----------------------------------------------------------------------------
+Dispositivo que repassa as operações para o arquivo de imagem, contando os setores
+-----------------------------------------------------------------------------*/
+T2FS_BACKEND g_image;
+unsigned long g_sectorsRead = 0;
+
+int counting_read(void *data, unsigned int sector, unsigned char *buffer)
+{
+    g_sectorsRead++;
+
+    return g_image.readSector(g_image.data, sector, buffer);
+}
+
+int counting_write(void *data, unsigned int sector, unsigned char *buffer)
+{
+    return g_image.writeSector(g_image.data, sector, buffer);
+}
+
+int counting_flush(void *data)
+{
+    return g_image.flush(g_image.data);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Informa o tempo corrente, em segundos
+-----------------------------------------------------------------------------*/
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Copia o arquivo de imagem do disco para outro arquivo
+-----------------------------------------------------------------------------*/
+int copy_image(char *src, char *dst)
+{
+    char buffer[SECTOR_SIZE];
+    FILE *in = fopen(src, "rb"), *out = fopen(dst, "wb");
+    size_t count;
+
+    if( in == NULL || out == NULL )
+    {
+        return -1;
+    }
+
+    while( (count = fread(buffer, 1, SECTOR_SIZE, in)) > 0 )
+    {
+        fwrite(buffer, 1, count, out);
+    }
+
+    fclose(in);
+    fclose(out);
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Marca a imagem como interrompida no meio de uma operação (estado sujo), o que
+        obriga a próxima montagem a reconstruir os contadores
+-----------------------------------------------------------------------------*/
+void mark_dirty()
+{
+    unsigned char state[4] = { SB_STATE_DIRTY, 0, 0, 0 };
+
+    fseek((FILE*)g_image.data, SB_EXT_OFFSET + 4, SEEK_SET);
+    fwrite(state, 1, 4, (FILE*)g_image.data);
+    fflush((FILE*)g_image.data);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Mede montagens seguidas da imagem e imprime o tempo médio e os setores lidos por
+        montagem. Com BENCH_READ, cada montagem é seguida da leitura do início de um arquivo,
+        que lê as tabelas usadas pela leitura; com BENCH_CREATE, a montagem permite alterações
+        e é seguida da criação de um arquivo (removido fora da medição).
+-----------------------------------------------------------------------------*/
+int bench(char *label, int dirty, int op)
+{
+    T2FS_BACKEND backend = { counting_read, counting_write, counting_flush, NULL };
+    T2FS_OPTIONS options = { op != BENCH_CREATE };
+    double start, elapsed = 0;
+    unsigned long sectors = 0;
+    char buffer[SECTOR_SIZE];
+    FILE2 handle;
+    T2FS *fs;
+    int i;
+
+    for( i = 0; i < BENCH_MOUNTS; i++ )
+    {
+        if( dirty )
+        {
+            mark_dirty();
+        }
+
+        g_sectorsRead = 0;
+        start = now();
+        fs = t2fs_mount(&backend, &options);
+
+        if( fs != NULL && op == BENCH_READ )
+        {
+            handle = t2fs_open2(fs, "/bench_data");
+
+            if( t2fs_read2(fs, handle, buffer, SECTOR_SIZE) != SECTOR_SIZE )
+            {
+                printf("%-8s erro na leitura\n", label);
+            }
+
+            t2fs_close2(fs, handle);
+        }
+
+        if( fs != NULL && op == BENCH_CREATE && t2fs_create2(fs, "/bench_new") != 0 )
+        {
+            printf("%-8s erro na criação\n", label);
+        }
+
+        elapsed += now() - start;
+        sectors += g_sectorsRead;
+
+        if( fs == NULL )
+        {
+            printf("%-8s erro na montagem\n", label);
+
+            return 1;
+        }
+
+        if( op == BENCH_CREATE )
+        {
+            t2fs_delete2(fs, "/bench_new");
+        }
+
+        t2fs_unmount(fs);
+    }
+
+    printf("%-16s montagem %8.1f us  setores lidos %6.1f\n", label, elapsed / BENCH_MOUNTS * 1e6, (double)sectors / BENCH_MOUNTS);
+
+    return 0;
+}
+
+int main()
+{
+    T2FS_BACKEND backend = { counting_read, counting_write, counting_flush, NULL };
+    char path[64], *data = (char*)malloc(BENCH_DATA_SIZE);
+    FILE2 handle;
+    T2FS *fs;
+    int i, j, errors = 0;
+
+    if( copy_image("t2fs_disk.dat", BENCH_IMAGE) != 0 || t2fs_backend_file(&g_image, BENCH_IMAGE) != 0 )
+    {
+        printf("ERRO: cópia do disco\n");
+        free(data);
+
+        return 1;
+    }
+
+    for( i = 0; i < BENCH_DATA_SIZE; i++ )
+    {
+        data[i] = 'a' + (i / SECTOR_SIZE) % 26;
+    }
+
+    // Preenche a imagem com alguns diretórios e um arquivo com checksums, deduplicado e clonado
+    // (as tabelas de checksums, impressões digitais e contadores passam a existir) e desmonta corretamente
+    fs = t2fs_mount(&backend, NULL);
+
+    if( fs != NULL && (t2fs_checksum2(fs, 1) != 0 || t2fs_dedup2(fs, 1) != 0 || t2fs_create2(fs, "/bench_data") != 0) )
+    {
+        t2fs_unmount(fs);
+        fs = NULL;
+    }
+
+    if( fs != NULL )
+    {
+        handle = t2fs_open2(fs, "/bench_data");
+        t2fs_write2(fs, handle, data, BENCH_DATA_SIZE);
+        t2fs_close2(fs, handle);
+        t2fs_clone2(fs, "/bench_data", "/bench_clone");
+    }
+
+    for( i = 0; fs != NULL && i < BENCH_DIRS; i++ )
+    {
+        sprintf(path, "/bench%d", i);
+        t2fs_mkdir2(fs, path);
+
+        for( j = 0; j < BENCH_FILES_PER_DIR; j++ )
+        {
+            sprintf(path, "/bench%d/f%d", i, j);
+            t2fs_create2(fs, path);
+        }
+    }
+
+    if( fs == NULL || t2fs_unmount(fs) != 0 )
+    {
+        printf("ERRO: preparação da imagem\n");
+        free(data);
+
+        return 1;
+    }
+
+    printf("----BENCHMARK DE MONTAGEM (%d montagens)----\n", BENCH_MOUNTS);
+
+    errors += bench("limpa", 0, BENCH_MOUNT_ONLY);
+    errors += bench("limpa + leitura", 0, BENCH_READ);
+    errors += bench("limpa + create2", 0, BENCH_CREATE);
+    errors += bench("suja", 1, BENCH_MOUNT_ONLY);
+
+    t2fs_backend_close(&g_image);
+    remove(BENCH_IMAGE);
+    free(data);
+
+    return errors;
+}
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/t2fs.h"
+
+#define FORMAT_JSON 0
+#define FORMAT_CSV 1
+
+/*-----------------------------------------------------------------------------
+Estado da impressão do relatório
+-----------------------------------------------------------------------------*/
+typedef struct {
+    int format;         /* FORMAT_JSON ou FORMAT_CSV */
+    char *image;        /* Arquivo da imagem */
+    char *pathname;     /* Caminho analisado */
+    int count;          /* Arquivos já impressos */
+    int started;        /* Flag indicando se o cabeçalho já foi impresso */
+} REPORT;
+
+void usage()
+{
+    printf("uso: layout2 [-f json|csv] arquivo [caminho]\n");
+    printf("    caminho: arquivo ou diretório a ser analisado (padrão: /)\n");
+}
+
+/*-----------------------------------------------------------------------------
+Função: Imprime o caminho entre aspas, com os caracteres especiais escapados para
+        JSON ou (aspas duplicadas) para CSV
+-----------------------------------------------------------------------------*/
+void print_path(const char *path, int format)
+{
+    const char *c;
+
+    putchar('"');
+
+    for( c = path; *c != '\0'; c++ )
+    {
+        if( *c == '"' )
+        {
+            printf(format == FORMAT_JSON ? "\\\"" : "\"\"");
+        }
+        else if( format == FORMAT_JSON && *c == '\\' )
+        {
+            printf("\\\\");
+        }
+        else if( format == FORMAT_JSON && (unsigned char)*c < 0x20 )
+        {
+            printf("\\u%04x", (unsigned char)*c);
+        }
+        else
+        {
+            putchar(*c);
+        }
+    }
+
+    putchar('"');
+}
+
+/*-----------------------------------------------------------------------------
+Função: Imprime o cabeçalho do relatório, uma única vez (nada é impresso se o caminho
+        é inválido)
+-----------------------------------------------------------------------------*/
+void print_header(REPORT *report)
+{
+    if( report->started )
+    {
+        return;
+    }
+
+    report->started = 1;
+
+    if( report->format == FORMAT_JSON )
+    {
+        printf("{\n  \"image\": ");
+        print_path(report->image, FORMAT_JSON);
+        printf(",\n  \"path\": ");
+        print_path(report->pathname, FORMAT_JSON);
+        printf(",\n  \"files\": [");
+    }
+    else
+    {
+        printf("path,type,inode,size,blocks,runs,holes,shared_blocks,indirect_blocks,data_sectors,records,live_records\n");
+    }
+}
+
+/*-----------------------------------------------------------------------------
+Função: Imprime a disposição de um arquivo (uma linha do relatório)
+-----------------------------------------------------------------------------*/
+int print_file(const char *path, const LAYOUT2_FILE *file, void *arg)
+{
+    REPORT *report = (REPORT*)arg;
+
+    print_header(report);
+
+    if( report->format == FORMAT_JSON )
+    {
+        printf("%s\n    {\"path\": ", report->count > 0 ? "," : "");
+        print_path(path, FORMAT_JSON);
+        printf(", \"type\": \"%s\", \"inode\": %u, \"size\": %u, \"blocks\": %u, \"runs\": %u, \"holes\": %u, "
+               "\"shared_blocks\": %u, \"indirect_blocks\": %u, \"data_sectors\": %u",
+               file->fileType == TYPEVAL_DIRETORIO ? "dir" : "file", file->inodeNumber, file->fileSize, file->blocks,
+               file->runs, file->holes, file->sharedBlocks, file->indirectBlocks, file->dataSectors);
+
+        if( file->fileType == TYPEVAL_DIRETORIO )
+        {
+            printf(", \"records\": %u, \"live_records\": %u", file->records, file->liveRecords);
+        }
+
+        printf("}");
+    }
+    else
+    {
+        print_path(path, FORMAT_CSV);
+        printf(",%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", file->fileType == TYPEVAL_DIRETORIO ? "dir" : "file",
+               file->inodeNumber, file->fileSize, file->blocks, file->runs, file->holes, file->sharedBlocks,
+               file->indirectBlocks, file->dataSectors, file->records, file->liveRecords);
+    }
+
+    report->count++;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Imprime o resumo: totais, utilização dos diretórios e histograma dos trechos livres
+-----------------------------------------------------------------------------*/
+void print_summary(LAYOUT2_STATS *stats, STATFS2 *fs, int format)
+{
+    DWORD values[] = { fs->blockSize, fs->totalBlocks, stats->files, stats->directories, stats->fragmentedFiles,
+                       stats->dataBlocks, stats->runs, stats->indirectBlocks, stats->dirBlocks, stats->dirRecords,
+                       stats->dirLiveRecords, stats->freeBlocks, stats->freeExtents, stats->largestFreeExtent };
+    char *names[] = { "block_size", "total_blocks", "files", "directories", "fragmented_files",
+                      "data_blocks", "runs", "indirect_blocks", "dir_blocks", "dir_records",
+                      "dir_live_records", "free_blocks", "free_extents", "largest_free_extent" };
+    int i, numValues = sizeof(values) / sizeof(DWORD);
+
+    if( format == FORMAT_JSON )
+    {
+        printf("\n  ],\n  \"summary\": {");
+
+        for( i = 0; i < numValues; i++ )
+        {
+            printf("%s\n    \"%s\": %u", i > 0 ? "," : "", names[i], values[i]);
+        }
+
+        printf(",\n    \"free_extent_histogram\": [");
+
+        for( i = 0; i < LAYOUT2_HISTOGRAM_SIZE; i++ )
+        {
+            printf("%s{\"min_blocks\": %u, \"extents\": %u}", i > 0 ? ", " : "", 1u << i, stats->freeExtentHistogram[i]);
+        }
+
+        printf("]\n  }\n}\n");
+    }
+    else
+    {
+        // Segunda tabela, separada por uma linha em branco
+        printf("\nkey,value\n");
+
+        for( i = 0; i < numValues; i++ )
+        {
+            printf("%s,%u\n", names[i], values[i]);
+        }
+
+        for( i = 0; i < LAYOUT2_HISTOGRAM_SIZE; i++ )
+        {
+            printf("free_extents_min_%u,%u\n", 1u << i, stats->freeExtentHistogram[i]);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    T2FS_BACKEND backend;
+    T2FS_OPTIONS options = { 1 };
+    LAYOUT2_STATS stats;
+    STATFS2 fsStats;
+    REPORT report = { FORMAT_JSON, NULL, "/", 0, 0 };
+    T2FS *fs;
+    int i = 1;
+
+    if( argc > 2 && strcmp(argv[1], "-f") == 0 )
+    {
+        if( strcmp(argv[2], "csv") == 0 )
+        {
+            report.format = FORMAT_CSV;
+        }
+        else if( strcmp(argv[2], "json") != 0 )
+        {
+            usage();
+
+            return 1;
+        }
+
+        i = 3;
+    }
+
+    if( argc - i < 1 || argc - i > 2 )
+    {
+        usage();
+
+        return 1;
+    }
+
+    report.image = argv[i];
+
+    if( argc - i == 2 )
+    {
+        report.pathname = argv[i + 1];
+    }
+
+    // A imagem é montada sem alterações
+    if( t2fs_backend_file(&backend, argv[i]) != 0 || (fs = t2fs_mount(&backend, &options)) == NULL )
+    {
+        printf("ERRO: a imagem '%s' não pôde ser montada\n", argv[i]);
+
+        return 1;
+    }
+
+    if( t2fs_layout2(fs, report.pathname, print_file, &report, &stats) != 0 )
+    {
+        printf("ERRO: caminho '%s' inválido ou falha na leitura da imagem\n", report.pathname);
+        t2fs_unmount(fs);
+        t2fs_backend_close(&backend);
+
+        return 1;
+    }
+
+    t2fs_statfs2(fs, &fsStats);
+    print_header(&report);
+    print_summary(&stats, &fsStats, report.format);
+
+    t2fs_unmount(fs);
+    t2fs_backend_close(&backend);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/t2fs.h"
+
+/*-----------------------------------------------------------------------------
+Função: Informa o tempo corrente, em segundos
+-----------------------------------------------------------------------------*/
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void usage()
+{
+    printf("uso: mkfs2 [-b setores_por_bloco] [-i inodes] [-B blocos_bitmap_dados] [-I blocos_bitmap_inodes] [-g blocos_por_grupo] arquivo tamanho\n");
+    printf("    tamanho: em bytes, com sufixo opcional K, M ou G (ex.: 64M, 4G)\n");
+    printf("    blocos_por_grupo: divide o disco em grupos de alocação (múltiplo de %d)\n", GROUP_ALIGN);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Converte um tamanho com sufixo opcional (K, M ou G) para bytes
+
+Saída:
+    Número de bytes (0 se o tamanho é inválido).
+-----------------------------------------------------------------------------*/
+unsigned long long parse_size(char *text)
+{
+    char *end;
+    unsigned long long size = strtoull(text, &end, 10);
+
+    switch( *end )
+    {
+        case 'G': case 'g': size *= 1024;
+        /* fall through */
+        case 'M': case 'm': size *= 1024;
+        /* fall through */
+        case 'K': case 'k': size *= 1024; end++;
+        /* fall through */
+        case '\0': break;
+        default: return 0;
+    }
+
+    return *end == '\0' ? size : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    MKFS2_OPTIONS options;
+    T2FS_BACKEND backend;
+    T2FS_OPTIONS mountOptions = { 1 };
+    STATFS2 stats;
+    unsigned long long size;
+    double start, elapsed;
+    T2FS *fs;
+    int i;
+
+    memset(&options, 0, sizeof(options));
+
+    for( i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2 )
+    {
+        if( strcmp(argv[i], "-b") == 0 )
+        {
+            options.blockSize = (WORD)atoi(argv[i + 1]);
+        }
+        else if( strcmp(argv[i], "-i") == 0 )
+        {
+            options.inodes = (DWORD)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if( strcmp(argv[i], "-B") == 0 )
+        {
+            options.freeBlocksBitmapSize = (WORD)atoi(argv[i + 1]);
+        }
+        else if( strcmp(argv[i], "-I") == 0 )
+        {
+            options.freeInodeBitmapSize = (WORD)atoi(argv[i + 1]);
+        }
+        else if( strcmp(argv[i], "-g") == 0 )
+        {
+            options.groupBlocks = (DWORD)strtoul(argv[i + 1], NULL, 10);
+        }
+        else
+        {
+            usage();
+
+            return 1;
+        }
+    }
+
+    if( argc - i != 2 || (size = parse_size(argv[i + 1])) == 0 )
+    {
+        usage();
+
+        return 1;
+    }
+
+    options.diskSize = (DWORD)(size / ((options.blockSize != 0 ? options.blockSize : MKFS2_DEFAULT_BLOCK_SIZE) * SECTOR_SIZE));
+
+    start = now();
+
+    if( mkfs2(argv[i], &options) != 0 )
+    {
+        printf("ERRO: geometria inválida ou falha ao escrever '%s'\n", argv[i]);
+
+        return 1;
+    }
+
+    elapsed = now() - start;
+
+    // Confere a imagem criada montando-a sem alterações
+    if( t2fs_backend_file(&backend, argv[i]) != 0 || (fs = t2fs_mount(&backend, &mountOptions)) == NULL )
+    {
+        printf("ERRO: a imagem criada não pôde ser montada\n");
+
+        return 1;
+    }
+
+    t2fs_statfs2(fs, &stats);
+    t2fs_unmount(fs);
+    t2fs_backend_close(&backend);
+
+    printf("%s: %u blocos de %u bytes (%u livres), %u i-nodes, %u grupos, formatado em %.3f s\n",
+           argv[i], stats.totalBlocks, stats.blockSize, stats.freeBlocks, stats.totalInodes, stats.groups, elapsed);
+
+    return 0;
+}
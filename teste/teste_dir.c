@@ -1,7 +1,41 @@
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 #include "../include/t2fs.h"
 
+#define INODES_PER_SECTOR (SECTOR_SIZE / sizeof(struct t2fs_inode))
+
+typedef struct {
+    int files;
+    int dirs;
+    int bytes;
+    pthread_mutex_t lock;
+} WALK_COUNT;
+
+int walk_count(const char *path, const DIRENT2 *entry, void *arg)
+{
+    WALK_COUNT *count = (WALK_COUNT*)arg;
+
+    pthread_mutex_lock(&count->lock);
+    if( entry->fileType == TYPEVAL_DIRETORIO )
+    {
+        count->dirs++;
+    }
+    else
+    {
+        count->files++;
+        count->bytes += entry->fileSize;
+    }
+    pthread_mutex_unlock(&count->lock);
+
+    return 0;
+}
+
+int walk_stop(const char *path, const DIRENT2 *entry, void *arg)
+{
+    return strcmp(entry->name, "arq3") == 0 ? 7 : 0;
+}
+
 void ls(char* label, DIR2 handle)
 {
     DIRENT2 dentry;
@@ -16,6 +50,78 @@ void ls(char* label, DIR2 handle)
     }
 }
 
+/*-----------------------------------------------------------------------------
+Função: Informa a posição de uma entrada na ordem de readdir2 (sem '.' e '..'), ou -1
+        se o diretório não tem a entrada. Se 'size' não é NULL, coloca nele o tamanho
+        da entrada.
+-----------------------------------------------------------------------------*/
+int entry_position(char *dirname, char *name, DWORD *size)
+{
+    DIRENT2 dentry;
+    DIR2 handle = opendir2(dirname);
+    int position = 0, found = -1;
+
+    while( handle != -1 && readdir2(handle, &dentry) == 0 )
+    {
+        if( strcmp(dentry.name, ".") == 0 || strcmp(dentry.name, "..") == 0 )
+        {
+            continue;
+        }
+
+        if( strcmp(dentry.name, name) == 0 )
+        {
+            found = position;
+
+            if( size != NULL )
+            {
+                *size = dentry.fileSize;
+            }
+        }
+
+        position++;
+    }
+
+    closedir2(handle);
+
+    return found;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Conta os setores distintos da área de inodes que guardam as entradas do
+        diretório (sem '.' e '..')
+-----------------------------------------------------------------------------*/
+int inode_sectors(char *dirname)
+{
+    DWORD sectors[64];
+    char path[320];
+    DIRENT2 dentry;
+    STAT2 stat;
+    DIR2 handle = opendir2(dirname);
+    int i, numSectors = 0;
+
+    while( handle != -1 && readdir2(handle, &dentry) == 0 )
+    {
+        if( strcmp(dentry.name, ".") == 0 || strcmp(dentry.name, "..") == 0 )
+        {
+            continue;
+        }
+
+        sprintf(path, "%s/%s", dirname, dentry.name);
+        stat2(path, &stat);
+
+        for( i = 0; i < numSectors && sectors[i] != stat.inodeNumber / INODES_PER_SECTOR; i++ );
+
+        if( i == numSectors && numSectors < 64 )
+        {
+            sectors[numSectors++] = stat.inodeNumber / INODES_PER_SECTOR;
+        }
+    }
+
+    closedir2(handle);
+
+    return numSectors;
+}
+
 char* test_verification_int(int result, int expected)
 {
     if( result == expected )
@@ -150,5 +256,223 @@ int main()
 
     printf("\n");
 
+    DIRENT2 dentries[4];
+    int count = 0, batchCount = 0, read = 0;
+    printf("TESTE: LEITURA DE ENTRADAS EM LOTE. Lista o cwd com getdents2 (de 4 em 4) e compara com readdir2.\n");
+    dirs[0] = opendir2(".");
+    while( readdir2(dirs[0], &dentries[0]) == 0 )
+    {
+        count++;
+    }
+    while( (read = getdents2(dirs[0], dentries, 4)) > 0 )
+    {
+        for( i = 0; i < read; i++ )
+        {
+            printf("\tN: '%s' -- T: %d -- S: %d\n", dentries[i].name, dentries[i].fileType, dentries[i].fileSize);
+        }
+
+        batchCount += read;
+    }
+    printf("----RESULTADO 1: %s (mesmo número de entradas que readdir2).\n", test_verification_int(batchCount, count));
+    printf("----RESULTADO 2: %s (fim das entradas).\n", test_verification_int(read, 0));
+    closedir2(dirs[0]);
+
+    printf("\n");
+
+    printf("TESTE: REGISTROS LIVRES. Remove entradas de um diretório com dois blocos e cria outras nos registros liberados.\n");
+    char path[64];
+    DWORD dirSize, dirSizeBefore;
+    chdir2("/");
+    mkdir2("/teste_reg");
+    for( i = 0; i < 20; i++ )
+    {
+        sprintf(path, "/teste_reg/sub%d", i);
+        mkdir2(path);
+    }
+    entry_position("/", "teste_reg", &dirSizeBefore);
+    rmdir2("/teste_reg/sub3");
+    rmdir2("/teste_reg/sub17");
+    mkdir2("/teste_reg/novo1");
+    mkdir2("/teste_reg/novo2");
+    printf("----RESULTADO 1: %s (primeiro registro liberado reaproveitado).\n", test_verification_int(entry_position("/teste_reg", "novo1", NULL), 3));
+    printf("----RESULTADO 2: %s (segundo registro liberado reaproveitado).\n", test_verification_int(entry_position("/teste_reg", "novo2", NULL), 17));
+    entry_position("/", "teste_reg", &dirSize);
+    printf("----RESULTADO 3: %s (diretório não cresceu).\n", test_verification_int(dirSize == dirSizeBefore && dirSize > 1024, 1));
+    printf("----RESULTADO 4: %s (arquivo com nome repetido).\n", test_verification_int(create2("/teste_reg/sub5") < 0, 1));
+    printf("----RESULTADO 5: %s (diretório com nome repetido).\n", test_verification_int(mkdir2("/teste_reg/novo1"), -1));
+    mkdir2("/teste_reg/novo3");
+    printf("----RESULTADO 6: %s (nova entrada no fim, sem registro repetido).\n", test_verification_int(entry_position("/teste_reg", "novo3", NULL), 20));
+    printf("----RESULTADO 7: %s (nome repetido ainda aponta para o diretório).\n", test_verification_int(entry_position("/teste_reg", "sub5", NULL), 5));
+    for( i = 0; i < 20; i++ )
+    {
+        sprintf(path, "/teste_reg/sub%d", i);
+        rmdir2(path);
+    }
+    rmdir2("/teste_reg/novo1");
+    rmdir2("/teste_reg/novo2");
+    rmdir2("/teste_reg/novo3");
+    rmdir2("/teste_reg");
+
+    printf("\n");
+
+    printf("TESTE: COMPACTAR DIRETÓRIO. Cria 40 subdiretórios, remove dois de cada três e compacta o diretório.\n");
+    int survivors = 0, inOrder = 1, lookups = 1;
+    mkdir2("/teste_cmp");
+    for( i = 0; i < 40; i++ )
+    {
+        sprintf(path, "/teste_cmp/sub%d", i);
+        mkdir2(path);
+    }
+    for( i = 0; i < 40; i++ )
+    {
+        sprintf(path, "/teste_cmp/sub%d", i);
+        if( i % 3 != 0 )
+        {
+            rmdir2(path);
+        }
+    }
+    entry_position("/", "teste_cmp", &dirSizeBefore);
+    printf("----RESULTADO 1: %s (diretório compactado).\n", test_verification_int(compactdir2("/teste_cmp"), 0));
+    dirs[0] = opendir2("/teste_cmp");
+    while( (read = getdents2(dirs[0], dentries, 4)) > 0 )
+    {
+        for( i = 0; i < read; i++ )
+        {
+            if( strcmp(dentries[i].name, ".") != 0 && strcmp(dentries[i].name, "..") != 0 )
+            {
+                sprintf(path, "sub%d", survivors * 3);
+                inOrder &= strcmp(dentries[i].name, path) == 0;
+                survivors++;
+            }
+        }
+    }
+    closedir2(dirs[0]);
+    for( i = 0; i < 40; i++ )
+    {
+        sprintf(path, "/teste_cmp/sub%d", i);
+        dirs[0] = opendir2(path);
+        lookups &= (dirs[0] >= 0) == (i % 3 == 0);
+        closedir2(dirs[0]);
+    }
+    entry_position("/", "teste_cmp", &dirSize);
+    printf("----RESULTADO 2: %s (entradas restantes, na ordem original).\n", test_verification_int(survivors == 14 && inOrder, 1));
+    printf("----RESULTADO 3: %s (busca pelos nomes restantes e removidos).\n", test_verification_int(lookups, 1));
+    printf("----RESULTADO 4: %s (diretório reduzido de três blocos a um).\n", test_verification_int(dirSizeBefore == 3 * dirSize, 1));
+    mkdir2("/teste_cmp/novo");
+    printf("----RESULTADO 5: %s (nova entrada após a compactação).\n", test_verification_int(entry_position("/teste_cmp", "novo", NULL), 14));
+    for( i = 0; i < 40; i += 3 )
+    {
+        sprintf(path, "/teste_cmp/sub%d", i);
+        rmdir2(path);
+    }
+    rmdir2("/teste_cmp/novo");
+    rmdir2("/teste_cmp");
+
+    printf("\n");
+
+    STAT2 stat;
+    FILE2 file;
+    chdir2("/");
+    delete2("/teste_mv/arq2");
+    rmdir2("/dir2/teste_mv2");
+    rmdir2("/teste_mv");
+    printf("TESTE: RENOMEAR. Move um diretório para outro pai e substitui um arquivo existente.\n");
+    mkdir2("/teste_mv");
+    printf("----RESULTADO 1: %s (dir. movido).\n", test_verification_int(rename2("/teste_mv", "/dir2/teste_mv2"), 0));
+    printf("----RESULTADO 2: %s (nome antigo removido).\n", test_verification_int(opendir2("/teste_mv"), -1));
+    printf("----RESULTADO 3: %s (nome novo existe).\n", test_verification_int(stat2("/dir2/teste_mv2", &stat), 0));
+    printf("----RESULTADO 4: %s (mover dir. para dentro de si mesmo).\n", test_verification_int(rename2("/dir2", "/dir2/teste_mv2/dir2"), -1));
+    create2("/dir2/teste_mv2/arq1");
+    create2("/dir2/teste_mv2/arq2");
+    file = open2("/dir2/teste_mv2/arq1");
+    write2(file, "publicado", 9);
+    close2(file);
+    printf("----RESULTADO 5: %s (arquivo substituído).\n", test_verification_int(rename2("/dir2/teste_mv2/arq1", "/dir2/teste_mv2/arq2"), 0));
+    stat2("/dir2/teste_mv2/arq2", &stat);
+    printf("----RESULTADO 6: %s (conteúdo do arquivo movido).\n", test_verification_int(stat.fileSize, 9));
+    printf("----RESULTADO 7: %s (nome antigo do arquivo removido).\n", test_verification_int(stat2("/dir2/teste_mv2/arq1", &stat), -1));
+    dirs[0] = opendir2("/dir2/teste_mv2");
+    ls("----DEBUG: Diretório informado '/dir2/teste_mv2'", dirs[0]);
+    closedir2(dirs[0]);
+    delete2("/dir2/teste_mv2/arq2");
+    rmdir2("/dir2/teste_mv2");
+
+    printf("\n");
+
+    printf("TESTE: REMOVER ÁRVORE. Cria uma árvore com subdiretórios e arquivos e a remove com rmtree2.\n");
+    STATFS2 statsBefore, statsAfter;
+    statfs2(&statsBefore);
+    mkdir2("/teste_arv");
+    mkdir2("/teste_arv/sub1");
+    mkdir2("/teste_arv/sub1/sub2");
+    mkdir2("/teste_arv/sub3");
+    for( i = 0; i < 20; i++ )
+    {
+        sprintf(path, "/teste_arv/%s/arq%d", i % 2 ? "sub1/sub2" : "sub3", i);
+        create2(path);
+        file = open2(path);
+        write2(file, "conteudo do arquivo", 19);
+        close2(file);
+    }
+    file = open2("/teste_arv/sub3/arq0");
+    printf("----RESULTADO 1: %s (arquivo da árvore aberto).\n", test_verification_int(rmtree2("/teste_arv"), -1));
+    close2(file);
+    printf("----RESULTADO 2: %s (árvore removida).\n", test_verification_int(rmtree2("/teste_arv"), 0));
+    printf("----RESULTADO 3: %s (diretório não existe mais).\n", test_verification_int(opendir2("/teste_arv"), -1));
+    statfs2(&statsAfter);
+    printf("----RESULTADO 4: %s (i-nodes e blocos liberados).\n", test_verification_int(statsAfter.freeInodes == statsBefore.freeInodes && statsAfter.freeBlocks == statsBefore.freeBlocks, 1));
+    printf("----RESULTADO 5: %s (diretório raiz).\n", test_verification_int(rmtree2("/"), -1));
+
+    printf("\n");
+
+    printf("TESTE: PERCURSO DA ÁRVORE. Percorre uma árvore com nftw2 usando uma e quatro threads.\n");
+    WALK_COUNT walkSingle = { 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+    WALK_COUNT walkPool = { 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+    mkdir2("/teste_perc");
+    mkdir2("/teste_perc/sub1");
+    mkdir2("/teste_perc/sub1/sub2");
+    mkdir2("/teste_perc/sub3");
+    for( i = 0; i < 12; i++ )
+    {
+        sprintf(path, "/teste_perc/%s/arq%d", i % 3 == 0 ? "sub1" : i % 3 == 1 ? "sub1/sub2" : "sub3", i);
+        create2(path);
+        file = open2(path);
+        write2(file, "conteudo do arquivo", 19);
+        close2(file);
+    }
+    printf("----RESULTADO 1: %s (percurso com uma thread).\n", test_verification_int(nftw2("/teste_perc", walk_count, &walkSingle, 1), 0));
+    printf("----RESULTADO 2: %s (entradas visitadas).\n", test_verification_int(walkSingle.files == 12 && walkSingle.dirs == 3 && walkSingle.bytes == 12 * 19, 1));
+    printf("----RESULTADO 3: %s (percurso com quatro threads).\n", test_verification_int(nftw2("/teste_perc", walk_count, &walkPool, 4), 0));
+    printf("----RESULTADO 4: %s (mesmas entradas).\n", test_verification_int(walkPool.files == walkSingle.files && walkPool.dirs == walkSingle.dirs && walkPool.bytes == walkSingle.bytes, 1));
+    printf("----RESULTADO 5: %s (percurso interrompido).\n", test_verification_int(nftw2("/teste_perc", walk_stop, NULL, 4), 7));
+    printf("----RESULTADO 6: %s (raiz não é diretório).\n", test_verification_int(nftw2("/teste_perc/sub1/arq0", walk_count, &walkPool, 2) < 0, 1));
+    rmtree2("/teste_perc");
+
+    printf("\n");
+
+    printf("TESTE: LOCALIDADE DA ALOCAÇÃO. Diretórios do raiz espalhados e irmãos nos mesmos setores de i-nodes.\n");
+    STAT2 statLoc1, statLoc2, statSub;
+    mkdir2("/teste_loc1");
+    mkdir2("/teste_loc2");
+    mkdir2("/teste_loc1/sub");
+    stat2("/teste_loc1", &statLoc1);
+    stat2("/teste_loc2", &statLoc2);
+    stat2("/teste_loc1/sub", &statSub);
+    printf("----RESULTADO 1: %s (diretórios do raiz em setores diferentes).\n", test_verification_int(statLoc1.inodeNumber / INODES_PER_SECTOR != statLoc2.inodeNumber / INODES_PER_SECTOR, 1));
+    printf("----RESULTADO 2: %s (subdiretório junto do pai).\n", test_verification_int(statSub.inodeNumber / INODES_PER_SECTOR == statLoc1.inodeNumber / INODES_PER_SECTOR, 1));
+    // Arquivos criados em rodízio entre o diretório e o subdiretório
+    for( i = 0; i < 24; i++ )
+    {
+        sprintf(path, "/teste_loc1/arq%d", i);
+        create2(path);
+        sprintf(path, "/teste_loc1/sub/arq%d", i);
+        create2(path);
+    }
+    printf("----RESULTADO 3: %s (irmãos em até 4 setores).\n", test_verification_int(inode_sectors("/teste_loc1") <= 4, 1));
+    printf("----RESULTADO 4: %s (irmãos do subdiretório em até 4 setores).\n", test_verification_int(inode_sectors("/teste_loc1/sub") <= 4, 1));
+    printf("----RESULTADO 5: %s (árvore removida).\n", test_verification_int(rmtree2("/teste_loc1") == 0 && rmdir2("/teste_loc2") == 0, 1));
+
+    printf("\n");
+
     return 0;
 }
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "../include/t2fs.h"
+#include "../include/apidisk.h"
 
 void ls(char* label, DIR2 handle)
 {
@@ -40,12 +41,181 @@ char* test_verification_str(char *result, char *expected)
     }
 }
 
+/*-----------------------------------------------------------------------------
+Função: Copia o arquivo de imagem do disco para outro arquivo
+-----------------------------------------------------------------------------*/
+int copy_image(char *src, char *dst)
+{
+    char buffer[SECTOR_SIZE];
+    FILE *in = fopen(src, "rb"), *out = fopen(dst, "wb");
+    size_t count;
+
+    if( in == NULL || out == NULL )
+    {
+        return -1;
+    }
+
+    while( (count = fread(buffer, 1, SECTOR_SIZE, in)) > 0 )
+    {
+        fwrite(buffer, 1, count, out);
+    }
+
+    fclose(in);
+    fclose(out);
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê ou escreve um campo de 4 bytes da extensão do superbloco de um arquivo de imagem
+-----------------------------------------------------------------------------*/
+DWORD image_ext_field(char *path, int offset, int write, DWORD value)
+{
+    FILE *image = fopen(path, "r+b");
+    unsigned char bytes[4];
+    int i;
+
+    if( image == NULL )
+    {
+        return 0;
+    }
+
+    fseek(image, SB_EXT_OFFSET + offset, SEEK_SET);
+
+    if( write )
+    {
+        for( i = 0; i < 4; i++ )
+        {
+            bytes[i] = (value >> (8 * i)) & 0xFF;
+        }
+
+        fwrite(bytes, 1, 4, image);
+    }
+    else if( fread(bytes, 1, 4, image) == 4 )
+    {
+        value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((DWORD)bytes[3] << 24);
+    }
+
+    fclose(image);
+
+    return value;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Escreve um bit do bitmap de dados (ou do bitmap de i-nodes) de um arquivo de imagem
+-----------------------------------------------------------------------------*/
+void image_bitmap_bit(char *path, int inodes, DWORD bit, int value)
+{
+    FILE *image = fopen(path, "r+b");
+    unsigned char sb[16], byte = 0;
+    long offset;
+
+    if( image == NULL || fread(sb, 1, 16, image) != 16 )
+    {
+        return;
+    }
+
+    // superblockSize, freeBlocksBitmapSize e blockSize do superbloco (little endian)
+    offset = (sb[6] | (sb[7] << 8)) + (inodes ? (sb[8] | (sb[9] << 8)) : 0);
+    offset = offset * (sb[14] | (sb[15] << 8)) * SECTOR_SIZE + bit / 8;
+
+    fseek(image, offset, SEEK_SET);
+    if( fread(&byte, 1, 1, image) == 1 )
+    {
+        byte = value ? byte | (1 << (bit % 8)) : byte & ~(1 << (bit % 8));
+        fseek(image, offset, SEEK_SET);
+        fwrite(&byte, 1, 1, image);
+    }
+
+    fclose(image);
+}
+
+/*-----------------------------------------------------------------------------
+Função: Lê ou escreve uma palavra do descritor de um grupo de alocação de um arquivo de imagem
+-----------------------------------------------------------------------------*/
+DWORD image_group_field(char *path, DWORD group, int word, int write, DWORD value)
+{
+    FILE *image = fopen(path, "r+b");
+    unsigned char sb[16], bytes[4];
+    long offset;
+    int i;
+
+    if( image == NULL || fread(sb, 1, 16, image) != 16 )
+    {
+        return 0;
+    }
+
+    fclose(image);
+
+    // groupTableBlock da extensão e blockSize do superbloco (little endian)
+    offset = (long)image_ext_field(path, 72, 0, 0) * (sb[14] | (sb[15] << 8)) * SECTOR_SIZE;
+    offset += (group * GROUP_DESC_WORDS + word) * sizeof(DWORD);
+
+    image = fopen(path, "r+b");
+    fseek(image, offset, SEEK_SET);
+
+    if( write )
+    {
+        for( i = 0; i < 4; i++ )
+        {
+            bytes[i] = (value >> (8 * i)) & 0xFF;
+        }
+
+        fwrite(bytes, 1, 4, image);
+    }
+    else if( fread(bytes, 1, 4, image) == 4 )
+    {
+        value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((DWORD)bytes[3] << 24);
+    }
+
+    fclose(image);
+
+    return value;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Soma as inconsistências encontradas por fsck2
+-----------------------------------------------------------------------------*/
+DWORD fsck_problems(FSCK2_STATS *check)
+{
+    return check->badRecords + check->badPointers + check->orphanInodes + check->leakedBlocks + check->missingBlocks +
+           check->duplicateBlocks + check->badRefcounts + check->badCounters;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Conta as chamadas de progresso de defrag2 e interrompe a desfragmentação
+        na chamada indicada (arg[0]: chamadas; arg[1]: chamada que interrompe, 0 se nenhuma)
+-----------------------------------------------------------------------------*/
+int defrag_progress(const char *path, const DEFRAG2_STATS *progress, void *arg)
+{
+    int *calls = (int*)arg;
+
+    calls[0]++;
+
+    return calls[0] == calls[1] ? 7 : 0;
+}
+
+/*-----------------------------------------------------------------------------
+Função: Guarda a disposição do arquivo de layout2 cujo caminho termina em "/a"
+-----------------------------------------------------------------------------*/
+int layout_capture(const char *path, const LAYOUT2_FILE *file, void *arg)
+{
+    if( strlen(path) >= 2 && strcmp(path + strlen(path) - 2, "/a") == 0 )
+    {
+        memcpy(arg, file, sizeof(LAYOUT2_FILE));
+    }
+
+    return 0;
+}
+
 int main()
 {
     int i;
     int hdir, test = 0;
     char nomes[200];
     FILE2 files[MAX_NUM_HANDLERS];
+    STATFS2 statsBefore, statsAfter;
+    STAT2 stat, fstat;
 
     printf("----TESTES DAS FUNÇÕES DE ARQUIVO----\n");
 
@@ -90,6 +260,7 @@ int main()
     printf("\n");
 
     delete2("teste_file1");
+    statfs2(&statsBefore);
     printf("TESTE: CRIAÇÃO DE ARQUIVO. Cria um arquivo. Mostra o conteúdo do diretório em que foi criado.\n");
     test = create2("teste_file1");
     ls("----DEBUG: Diretório informado '/'", hdir);
@@ -98,6 +269,14 @@ int main()
 
     printf("\n");
 
+    printf("TESTE: ESPAÇO LIVRE. Compara statfs2 antes e depois da criação do arquivo.\n");
+    statfs2(&statsAfter);
+    printf("----DEBUG: Blocos livres: %d/%d -- I-nodes livres: %d/%d -- Trechos livres: %d (média %d blocos).\n", statsAfter.freeBlocks, statsAfter.totalBlocks, statsAfter.freeInodes, statsAfter.totalInodes, statsAfter.freeBlockRuns, statsAfter.avgFreeRunSize);
+    printf("----RESULTADO 1: %s (um i-node a menos).\n", test_verification_int(statsBefore.freeInodes - statsAfter.freeInodes, 1));
+    printf("----RESULTADO 2: %s (arquivo vazio não ocupa blocos).\n", test_verification_int(statsBefore.freeBlocks - statsAfter.freeBlocks, 0));
+
+    printf("\n");
+
     printf("TESTE: CRIAÇÃO DE ARQUIVO. Tenta criar arquivo com mesmo nome de dir ou arquivo.\n");
     test = create2("teste_file1") == create2("dir1");
     ls("----DEBUG: Diretório informado '/'", hdir);
@@ -106,7 +285,7 @@ int main()
     printf("\n");
 
     files[0] = open2("teste_file1");
-    char bufferLeitura[265217];
+    char bufferLeitura[265217] = "";
     char bufferEscrita[265217] = "------0123456789";
 
     printf("TESTE: LEITURA DO ARQUIVO. Arquivo está vazio.\n");
@@ -172,6 +351,591 @@ int main()
 
     printf("\n");
 
+    printf("TESTE: METADADOS DO ARQUIVO. Consulta com stat2 (sem handle) e fstat2 (com handle).\n");
+    printf("----RESULTADO 1: %s (stat2 bem sucedido).\n", test_verification_int(stat2("teste_file1", &stat), 0));
+    printf("----RESULTADO 2: %s (4096 bytes).\n", test_verification_int(stat.fileSize, 4096));
+    printf("----RESULTADO 3: %s (tipo regular).\n", test_verification_int(stat.fileType, TYPEVAL_REGULAR));
+    fstat2(files[0], &fstat);
+    printf("----RESULTADO 4: %s (fstat2 retorna o mesmo i-node).\n", test_verification_int(fstat.inodeNumber, stat.inodeNumber));
+    printf("----RESULTADO 5: %s (arquivo inexistente).\n", test_verification_int(stat2("/dir51/teste_file1", &stat), -1));
+    printf("----DEBUG: i-node %d -- %d blocos -- %d diretos -- %d de indireção -- %d trechos.\n", fstat.inodeNumber, fstat.blocksFileSize, fstat.directBlocks, fstat.indirectBlocks, fstat.extents);
+
+    printf("\n");
+
+    printf("TESTE: CÓPIA ENTRE ARQUIVOS. Copia 3000 bytes de 'teste_file1' (a partir do byte 100) para 'teste_file2' (a partir do byte 10).\n");
+    delete2("teste_file2");
+    create2("teste_file2");
+    files[1] = open2("teste_file2");
+    printf("----RESULTADO 1: %s (3000 bytes copiados).\n", test_verification_int(copy_file_range2(files[0], 100, files[1], 10, 3000), 3000));
+    fstat2(files[1], &fstat);
+    printf("----RESULTADO 2: %s (tamanho do destino).\n", test_verification_int(fstat.fileSize, 3010));
+    seek2(files[1], 10);
+    read2(files[1], bufferLeitura, 3000);
+    bufferLeitura[3000] = '\0';
+    strncpy(bufferEscrita + 4096, bufferEscrita + 100, 3000);
+    bufferEscrita[4096 + 3000] = '\0';
+    printf("----RESULTADO 3: %s (conteúdo copiado).\n", test_verification_str(bufferLeitura, bufferEscrita + 4096));
+    printf("----RESULTADO 4: %s (origem limitada ao fim do arquivo).\n", test_verification_int(copy_file_range2(files[0], 4000, files[1], 0, 1000), 96));
+    close2(files[1]);
+    delete2("teste_file2");
+
+    printf("\n");
+
+    printf("TESTE: CLONE. Clona 'teste_file1' e escreve no clone.\n");
+    char bufferOrigem[17];
+    seek2(files[0], 0);
+    read2(files[0], bufferOrigem, 16);
+    bufferOrigem[16] = '\0';
+    statfs2(&statsAfter);
+    DWORD freeBlocksFirstClone = statsAfter.freeBlocks;
+    clone2("teste_file1", "teste_clone1");
+    fstat2(files[0], &fstat);
+    statfs2(&statsAfter);
+    DWORD freeBlocksClone = statsAfter.freeBlocks;
+    printf("----RESULTADO 1: %s (clone criado).\n", test_verification_int(clone2("teste_file1", "teste_clone2"), 0));
+    statfs2(&statsAfter);
+    printf("----RESULTADO 2: %s (apenas blocos de indireção copiados).\n", test_verification_int(freeBlocksClone - statsAfter.freeBlocks, fstat.indirectBlocks));
+    files[1] = open2("teste_clone2");
+    write2(files[1], "XXXX", 4);
+    seek2(files[1], 0);
+    read2(files[1], bufferLeitura, 16);
+    bufferLeitura[16] = '\0';
+    memcpy(bufferEscrita + 4096, "XXXX", 4);
+    strncpy(bufferEscrita + 4100, bufferOrigem + 4, 13);
+    printf("----RESULTADO 3: %s (clone alterado).\n", test_verification_str(bufferLeitura, bufferEscrita + 4096));
+    seek2(files[0], 0);
+    read2(files[0], bufferLeitura, 16);
+    bufferLeitura[16] = '\0';
+    printf("----RESULTADO 4: %s (origem preservada).\n", test_verification_str(bufferLeitura, bufferOrigem));
+    printf("----RESULTADO 5: %s (destino já existente).\n", test_verification_int(clone2("teste_file1", "teste_clone1") != 0, 1));
+    close2(files[1]);
+    delete2("teste_clone2");
+    statfs2(&statsAfter);
+    printf("----RESULTADO 6: %s (blocos liberados ao apagar o clone).\n", test_verification_int(statsAfter.freeBlocks, freeBlocksClone));
+    delete2("teste_clone1");
+    // A tabela de contadores só ocupa páginas nos trechos com blocos compartilhados
+    DWORD refcountFlatBlocks = (statsAfter.totalBlocks * sizeof(DWORD) + statsAfter.blockSize - 1) / statsAfter.blockSize;
+    printf("----RESULTADO 7: %s (tabela de contadores menor que uma entrada por bloco).\n",
+           test_verification_int(freeBlocksFirstClone - freeBlocksClone - fstat.indirectBlocks < refcountFlatBlocks, 1));
+
+    printf("\n");
+
+    printf("TESTE: ARQUIVO ESPARSO. Escreve 3 bytes no início e 3 bytes após 1 MB, deixando um buraco.\n");
+    create2("teste_sparse");
+    files[1] = open2("teste_sparse");
+    write2(files[1], "abc", 3);
+    lseek2(files[1], 1048576, SEEK2_SET);
+    write2(files[1], "xyz", 3);
+    fstat2(files[1], &fstat);
+    statfs2(&statsAfter);
+    printf("----RESULTADO 1: %s (tamanho do arquivo).\n", test_verification_int(fstat.fileSize, 1048579));
+    printf("----RESULTADO 2: %s (apenas os blocos escritos são alocados).\n", test_verification_int(fstat.blocksFileSize, 2));
+    printf("----RESULTADO 3: %s (buraco após o primeiro bloco).\n", test_verification_int(lseek2(files[1], 0, SEEK2_HOLE), statsAfter.blockSize));
+    printf("----RESULTADO 4: %s (dados após o buraco).\n", test_verification_int(lseek2(files[1], statsAfter.blockSize, SEEK2_DATA), 1048576));
+    lseek2(files[1], 4096, SEEK2_SET);
+    char bufferZeros[16] = {0};
+    memset(bufferLeitura, 'x', 16);
+    read2(files[1], bufferLeitura, 16);
+    printf("----RESULTADO 5: %s (buraco lido como zeros).\n", test_verification_int(memcmp(bufferLeitura, bufferZeros, 16), 0));
+    close2(files[1]);
+    delete2("teste_sparse");
+
+    printf("\n");
+
+    printf("TESTE: FTRUNCATE. Escreve 265216 bytes e reduz o arquivo para 1000 bytes; depois o estende para 5000 bytes.\n");
+    create2("teste_trunc");
+    files[1] = open2("teste_trunc");
+    statfs2(&statsAfter);
+    DWORD freeBlocksTrunc = statsAfter.freeBlocks;
+    write2(files[1], bufferEscrita, 265216);
+    printf("----RESULTADO 1: %s (arquivo reduzido).\n", test_verification_int(ftruncate2(files[1], 1000), 0));
+    fstat2(files[1], &fstat);
+    statfs2(&statsAfter);
+    printf("----RESULTADO 2: %s (tamanho do arquivo).\n", test_verification_int(fstat.fileSize, 1000));
+    printf("----RESULTADO 3: %s (blocos de dados e de indireção liberados).\n", test_verification_int(fstat.blocksFileSize + fstat.indirectBlocks, 1));
+    printf("----RESULTADO 4: %s (blocos devolvidos ao disco).\n", test_verification_int(statsAfter.freeBlocks, freeBlocksTrunc - 1));
+    ftruncate2(files[1], 5000);
+    fstat2(files[1], &fstat);
+    printf("----RESULTADO 5: %s (arquivo estendido com um buraco).\n", test_verification_int(fstat.fileSize == 5000 && fstat.blocksFileSize == 1, 1));
+    // O buraco do fim não tem blocos no mapa do arquivo: a cópia o lê como zeros
+    create2("teste_trunc2");
+    files[2] = open2("teste_trunc2");
+    memset(bufferLeitura, 'x', 4000);
+    write2(files[2], bufferLeitura, 4000);
+    printf("----RESULTADO 6: %s (cópia do buraco do fim).\n", test_verification_int(copy_file_range2(files[1], 1000, files[2], 0, 4000), 4000));
+    seek2(files[2], 0);
+    read2(files[2], bufferLeitura, 4000);
+    for( i = 0; i < 4000 && bufferLeitura[i] == 0; i++ );
+    printf("----RESULTADO 7: %s (buraco copiado como zeros).\n", test_verification_int(i, 4000));
+    close2(files[2]);
+    delete2("teste_trunc2");
+    // Maior tamanho endereçável: dois blocos diretos, um de indireção simples e um de dupla
+    DWORD ptrsPerBlock = statsAfter.blockSize / sizeof(DWORD);
+    unsigned long long maxFileSize = (2ULL + ptrsPerBlock + (unsigned long long)ptrsPerBlock * ptrsPerBlock) * statsAfter.blockSize;
+    printf("----RESULTADO 8: %s (tamanho acima do máximo de um arquivo).\n", test_verification_int(maxFileSize < 0xFFFFFFFFULL && ftruncate2(files[1], (DWORD)maxFileSize + 1) != 0, 1));
+    printf("----RESULTADO 9: %s (tamanho de 4 GB).\n", test_verification_int(ftruncate2(files[1], 0xFFFFFFF0) != 0, 1));
+    fstat2(files[1], &fstat);
+    printf("----RESULTADO 10: %s (arquivo inalterado).\n", test_verification_int(fstat.fileSize, 5000));
+    close2(files[1]);
+    delete2("teste_trunc");
+
+    printf("\n");
+
+    printf("TESTE: ARQUIVO EMBUTIDO. Cria três arquivos de 100 bytes e faz um deles crescer para 2100 bytes.\n");
+    char nomeEmbutido[32];
+    statfs2(&statsAfter);
+    DWORD freeBlocksInline = statsAfter.freeBlocks;
+    for( i = 0; i < 3; i++ )
+    {
+        sprintf(nomeEmbutido, "teste_emb%d", i);
+        create2(nomeEmbutido);
+        files[1] = open2(nomeEmbutido);
+        write2(files[1], bufferEscrita + i, 100);
+        close2(files[1]);
+    }
+    statfs2(&statsAfter);
+    printf("----RESULTADO 1: %s (arquivos dividem um bloco de fragmentos).\n", test_verification_int(freeBlocksInline - statsAfter.freeBlocks <= 1, 1));
+    stat2("teste_emb1", &stat);
+    printf("----RESULTADO 2: %s (nenhum bloco de dados).\n", test_verification_int(stat.fileSize == 100 && stat.blocksFileSize == 0, 1));
+    files[1] = open2("teste_emb1");
+    read2(files[1], bufferLeitura, 100);
+    printf("----RESULTADO 3: %s (conteúdo lido do fragmento).\n", test_verification_int(memcmp(bufferLeitura, bufferEscrita + 1, 100), 0));
+    lseek2(files[1], 100, SEEK2_SET);
+    write2(files[1], bufferEscrita + 101, 2000);
+    seek2(files[1], 0);
+    read2(files[1], bufferLeitura, 2100);
+    fstat2(files[1], &fstat);
+    printf("----RESULTADO 4: %s (arquivo passou a usar blocos).\n", test_verification_int(fstat.fileSize == 2100 && fstat.blocksFileSize == 3, 1));
+    printf("----RESULTADO 5: %s (conteúdo preservado).\n", test_verification_int(memcmp(bufferLeitura, bufferEscrita + 1, 2100), 0));
+    close2(files[1]);
+    for( i = 0; i < 3; i++ )
+    {
+        sprintf(nomeEmbutido, "teste_emb%d", i);
+        delete2(nomeEmbutido);
+    }
+    statfs2(&statsAfter);
+    printf("----RESULTADO 6: %s (blocos e fragmentos liberados).\n", test_verification_int(statsAfter.freeBlocks, freeBlocksInline));
+
+    printf("\n");
+
+    printf("TESTE: EMPACOTAMENTO DE CAUDAS. Cria quatro arquivos de 1100 bytes com tailpack2 ligado e aumenta um deles.\n");
+    printf("----RESULTADO 1: %s (modo ligado).\n", test_verification_int(tailpack2(1), 0));
+    statfs2(&statsAfter);
+    DWORD freeBlocksTail = statsAfter.freeBlocks;
+    for( i = 0; i < 4; i++ )
+    {
+        sprintf(nomeEmbutido, "teste_cauda%d", i);
+        create2(nomeEmbutido);
+        files[1] = open2(nomeEmbutido);
+        write2(files[1], bufferEscrita + i, 1100);
+        close2(files[1]);
+    }
+    statfs2(&statsAfter);
+    printf("----RESULTADO 2: %s (caudas dividem um bloco de fragmentos).\n", test_verification_int(freeBlocksTail - statsAfter.freeBlocks <= 5, 1));
+    stat2("teste_cauda2", &stat);
+    printf("----RESULTADO 3: %s (último bloco liberado).\n", test_verification_int(stat.fileSize == 1100 && stat.blocksFileSize == 1, 1));
+    files[1] = open2("teste_cauda2");
+    printf("----RESULTADO 4: %s (cauda lida do fragmento).\n", test_verification_int(read2(files[1], bufferLeitura, 2000) == 1100 && memcmp(bufferLeitura, bufferEscrita + 2, 1100) == 0, 1));
+    write2(files[1], bufferEscrita + 1102, 1000);
+    close2(files[1]);
+    files[1] = open2("teste_cauda2");
+    printf("----RESULTADO 5: %s (arquivo aumentado).\n", test_verification_int(read2(files[1], bufferLeitura, 3000) == 2100 && memcmp(bufferLeitura, bufferEscrita + 2, 2100) == 0, 1));
+    close2(files[1]);
+    for( i = 0; i < 4; i++ )
+    {
+        sprintf(nomeEmbutido, "teste_cauda%d", i);
+        delete2(nomeEmbutido);
+    }
+    tailpack2(0);
+    statfs2(&statsAfter);
+    printf("----RESULTADO 6: %s (blocos e fragmentos liberados).\n", test_verification_int(statsAfter.freeBlocks, freeBlocksTail));
+
+    printf("\n");
+
+    printf("TESTE: COMPRESSÃO. Escreve 8192 bytes repetitivos num arquivo comprimido e altera um trecho do meio.\n");
+    char bufferComprimido[8192];
+    for( i = 0; i < 8192; i++ )
+    {
+        bufferComprimido[i] = "{\"id\": 42, \"nivel\": \"info\", \"msg\": \"ok\"}\n"[i % 41];
+    }
+    statfs2(&statsAfter);
+    DWORD freeBlocksZ = statsAfter.freeBlocks;
+    create2("teste_comprimido");
+    files[1] = open2("teste_comprimido");
+    printf("----RESULTADO 1: %s (compressão ligada).\n", test_verification_int(fcompress2(files[1], 1), 0));
+    printf("----RESULTADO 2: %s (escrita realizada).\n", test_verification_int(write2(files[1], bufferComprimido, 8192), 8192));
+    fstat2(files[1], &stat);
+    printf("----RESULTADO 3: %s (blocos ocupam menos setores).\n", test_verification_int(stat.blocksFileSize == 8 && stat.dataSectors <= 8, 1));
+    memcpy(bufferComprimido + 3000, bufferEscrita, 2000);
+    seek2(files[1], 3000);
+    write2(files[1], bufferEscrita, 2000);
+    seek2(files[1], 2990);
+    printf("----RESULTADO 4: %s (leitura no meio do arquivo).\n", test_verification_int(read2(files[1], bufferLeitura, 100) == 100 && memcmp(bufferLeitura, bufferComprimido + 2990, 100) == 0, 1));
+    close2(files[1]);
+    files[1] = open2("teste_comprimido");
+    printf("----RESULTADO 5: %s (arquivo lido inteiro).\n", test_verification_int(read2(files[1], bufferLeitura, 10000) == 8192 && memcmp(bufferLeitura, bufferComprimido, 8192) == 0, 1));
+    close2(files[1]);
+    printf("----RESULTADO 6: %s (handle inválido).\n", test_verification_int(fcompress2(files[1], 1), -1));
+    delete2("teste_comprimido");
+    statfs2(&statsAfter);
+    printf("----RESULTADO 7: %s (blocos liberados).\n", test_verification_int(statsAfter.freeBlocks, freeBlocksZ));
+
+    printf("\n");
+
+    printf("TESTE: CHECKSUMS. Grava 4096 bytes com checksum2 ligado e corrompe um setor diretamente no disco.\n");
+    statfs2(&statsAfter);
+    DWORD freeBlocksCrc = statsAfter.freeBlocks;
+    char bufferCrc[4096];
+    unsigned char sectorCrc[SECTOR_SIZE];
+    DWORD sectorNumber, totalSectors = statsAfter.totalBlocks * (statsAfter.blockSize / SECTOR_SIZE);
+    memcpy(bufferCrc, bufferEscrita, 4096);
+    memcpy(bufferCrc + 100, "MARCADOR-CRC-T2FS", 17);
+    printf("----RESULTADO 1: %s (checksums ligados).\n", test_verification_int(checksum2(1), 0));
+    create2("teste_crc");
+    files[1] = open2("teste_crc");
+    printf("----RESULTADO 2: %s (escrita realizada).\n", test_verification_int(write2(files[1], bufferCrc, 4096), 4096));
+    close2(files[1]);
+    files[1] = open2("teste_crc");
+    printf("----RESULTADO 3: %s (conteúdo conferido).\n", test_verification_int(read2(files[1], bufferLeitura, 5000) == 4096 && memcmp(bufferLeitura, bufferCrc, 4096) == 0, 1));
+    for( sectorNumber = 0; sectorNumber < totalSectors; sectorNumber++ )
+    {
+        if( read_sector(sectorNumber, sectorCrc) == 0 && memcmp(sectorCrc + 100, "MARCADOR-CRC-T2FS", 17) == 0 )
+        {
+            sectorCrc[110] ^= 0x01;
+            write_sector(sectorNumber, sectorCrc);
+            break;
+        }
+    }
+    seek2(files[1], 0);
+    printf("----RESULTADO 4: %s (corrupção detectada).\n", test_verification_int(sectorNumber < totalSectors && read2(files[1], bufferLeitura, 5000) == -1, 1));
+    seek2(files[1], 0);
+    write2(files[1], bufferCrc, 1024);
+    seek2(files[1], 0);
+    printf("----RESULTADO 5: %s (bloco regravado).\n", test_verification_int(read2(files[1], bufferLeitura, 5000) == 4096 && memcmp(bufferLeitura, bufferCrc, 4096) == 0, 1));
+    close2(files[1]);
+    delete2("teste_crc");
+    printf("----RESULTADO 6: %s (checksums desligados).\n", test_verification_int(checksum2(0), 0));
+    statfs2(&statsAfter);
+    printf("----RESULTADO 7: %s (tabela de checksums descartada).\n", test_verification_int(statsAfter.freeBlocks, freeBlocksCrc));
+
+    printf("\n");
+
+    printf("TESTE: DEDUPLICAÇÃO. Grava com dedup2 ligado dois arquivos iguais de 8 blocos (metade zerados) e altera um deles.\n");
+    char bufferDedup[8192];
+    memset(bufferDedup, 0, 8192);
+    for( i = 0; i < 4; i++ )
+    {
+        memset(bufferDedup + (2 * i + 1) * 1024, 'a' + i, 1024);
+    }
+    statfs2(&statsAfter);
+    DWORD freeBlocksNoDedup = statsAfter.freeBlocks;
+    printf("----RESULTADO 1: %s (deduplicação ligada).\n", test_verification_int(dedup2(1), 0));
+    statfs2(&statsAfter);
+    DWORD freeBlocksDedup = statsAfter.freeBlocks, hitsDedup = statsAfter.dedupHits;
+    create2("teste_dedup1");
+    files[1] = open2("teste_dedup1");
+    printf("----RESULTADO 2: %s (escrita realizada).\n", test_verification_int(write2(files[1], bufferDedup, 8192), 8192));
+    close2(files[1]);
+    statfs2(&statsAfter);
+    printf("----RESULTADO 3: %s (um bloco zerado, 4 distintos, o de indireção e a página de impressões).\n", test_verification_int(statsAfter.freeBlocks, freeBlocksDedup - 7));
+    create2("teste_dedup2");
+    files[1] = open2("teste_dedup2");
+    write2(files[1], bufferDedup, 8192);
+    close2(files[1]);
+    statfs2(&statsAfter);
+    printf("----RESULTADO 4: %s (cópia ocupa só o bloco de indireção).\n", test_verification_int(statsAfter.freeBlocks, freeBlocksDedup - 8));
+    printf("----RESULTADO 5: %s (blocos encontrados no índice).\n", test_verification_int(statsAfter.dedupHits - hitsDedup, 11));
+    files[1] = open2("teste_dedup2");
+    seek2(files[1], 1034);
+    write2(files[1], "XYZ", 3);
+    close2(files[1]);
+    files[1] = open2("teste_dedup1");
+    printf("----RESULTADO 6: %s (original intacto).\n", test_verification_int(read2(files[1], bufferLeitura, 10000) == 8192 && memcmp(bufferLeitura, bufferDedup, 8192) == 0, 1));
+    close2(files[1]);
+    memcpy(bufferDedup + 1034, "XYZ", 3);
+    files[1] = open2("teste_dedup2");
+    printf("----RESULTADO 7: %s (cópia alterada).\n", test_verification_int(read2(files[1], bufferLeitura, 10000) == 8192 && memcmp(bufferLeitura, bufferDedup, 8192) == 0, 1));
+    close2(files[1]);
+    delete2("teste_dedup1");
+    delete2("teste_dedup2");
+    dedup2(0);
+    statfs2(&statsAfter);
+    printf("----RESULTADO 8: %s (blocos e tabela de impressões liberados).\n", test_verification_int(statsAfter.freeBlocks == freeBlocksNoDedup && statsAfter.dedupBlocks == 0, 1));
+
+    printf("\n");
+
+    printf("TESTE: MONTAGEM DE OUTRA IMAGEM. Copia o disco, monta a cópia com t2fs_mount e a altera sem afetar o disco padrão.\n");
+    T2FS_BACKEND backend;
+    T2FS_OPTIONS options = { 1 };
+    T2FS *fs;
+    FILE2 other;
+    printf("----RESULTADO 1: %s (imagem copiada e montada).\n", test_verification_int(copy_image("t2fs_disk.dat", "t2fs_disk_copia.dat") == 0 &&
+           t2fs_backend_file(&backend, "t2fs_disk_copia.dat") == 0 && (fs = t2fs_mount(&backend, NULL)) != NULL, 1));
+    t2fs_create2(fs, "teste_montagem");
+    other = t2fs_open2(fs, "teste_montagem");
+    printf("----RESULTADO 2: %s (escrita na cópia).\n", test_verification_int(t2fs_write2(fs, other, "montagem", 8), 8));
+    t2fs_close2(fs, other);
+    printf("----RESULTADO 3: %s (arquivo ausente no disco padrão).\n", test_verification_int(open2("teste_montagem"), -1));
+    printf("----RESULTADO 4: %s (desmontagem).\n", test_verification_int(t2fs_unmount(fs), 0));
+    fs = t2fs_mount(&backend, &options);
+    other = t2fs_open2(fs, "teste_montagem");
+    strcpy(bufferLeitura, "");
+    printf("----RESULTADO 5: %s (conteúdo lido após remontar).\n", test_verification_int(t2fs_read2(fs, other, bufferLeitura, 100) == 8 && memcmp(bufferLeitura, "montagem", 8) == 0, 1));
+    t2fs_close2(fs, other);
+    printf("----RESULTADO 6: %s (criação recusada sem alterações).\n", test_verification_int(t2fs_create2(fs, "teste_montagem2"), -1));
+    printf("----RESULTADO 7: %s (desmontagem).\n", test_verification_int(t2fs_unmount(fs), 0));
+    printf("\n");
+
+    printf("TESTE: DESMONTAGEM LIMPA E RECONSTRUÇÃO DOS CONTADORES. Desmonta a cópia, remonta e força a reconstrução a partir dos bitmaps.\n");
+    STATFS2 statsMount;
+    fs = t2fs_mount(&backend, NULL);
+    t2fs_mkdir2(fs, "/dir_montagem");
+    t2fs_create2(fs, "/dir_montagem/arq");
+    t2fs_statfs2(fs, &statsMount);
+    t2fs_unmount(fs);
+    printf("----RESULTADO 1: %s (marca de desmontagem limpa).\n", test_verification_int(image_ext_field("t2fs_disk_copia.dat", 48, 0, 0), SB_UNMOUNT_CLEAN));
+    fs = t2fs_mount(&backend, &options);
+    t2fs_statfs2(fs, &statsAfter);
+    t2fs_unmount(fs);
+    printf("----RESULTADO 2: %s (contadores carregados sem reconstrução).\n", test_verification_int(statsAfter.freeBlocks == statsMount.freeBlocks && statsAfter.freeInodes == statsMount.freeInodes &&
+           image_ext_field("t2fs_disk_copia.dat", 48, 0, 0) == SB_UNMOUNT_CLEAN, 1));
+    // Simula uma queda no meio de uma operação: contadores zerados e estado sujo
+    image_ext_field("t2fs_disk_copia.dat", 4, 1, SB_STATE_DIRTY);
+    image_ext_field("t2fs_disk_copia.dat", 8, 1, 0);
+    image_ext_field("t2fs_disk_copia.dat", 16, 1, 0);
+    fs = t2fs_mount(&backend, NULL);
+    t2fs_statfs2(fs, &statsAfter);
+    printf("----RESULTADO 3: %s (contadores reconstruídos).\n", test_verification_int(statsAfter.freeBlocks == statsMount.freeBlocks && statsAfter.freeBlockRuns == statsMount.freeBlockRuns &&
+           statsAfter.freeInodes == statsMount.freeInodes, 1));
+    printf("----RESULTADO 4: %s (marca removida na reconstrução).\n", test_verification_int(image_ext_field("t2fs_disk_copia.dat", 48, 0, 0), 0));
+    t2fs_unmount(fs);
+    fs = t2fs_mount(&backend, NULL);
+    t2fs_create2(fs, "/dir_montagem/arq2");
+    printf("----RESULTADO 5: %s (marca removida na primeira escrita).\n", test_verification_int(image_ext_field("t2fs_disk_copia.dat", 48, 0, 0), 0));
+    t2fs_unmount(fs);
+    // Contadores das zonas gravados na desmontagem: a soma dos blocos livres confere com o superbloco
+    DWORD zoneCount = image_ext_field("t2fs_disk_copia.dat", SB_ZONES_OFFSET - SB_EXT_OFFSET, 0, 0), zoneFree = 0;
+    for( i = 0; i < zoneCount; i++ )
+    {
+        zoneFree += image_ext_field("t2fs_disk_copia.dat", SB_ZONES_OFFSET - SB_EXT_OFFSET + (2 + 2 * i) * sizeof(DWORD), 0, 0);
+    }
+    printf("----RESULTADO 6: %s (contadores das zonas gravados na desmontagem).\n", test_verification_int(zoneCount > 0 &&
+           zoneFree == image_ext_field("t2fs_disk_copia.dat", 8, 0, 0), 1));
+    t2fs_backend_close(&backend);
+    remove("t2fs_disk_copia.dat");
+
+    printf("\n");
+
+    printf("TESTE: FORMATAÇÃO DE IMAGEM. Cria uma imagem com blocos de 2 KB e 1000 i-nodes com mkfs2 e a usa.\n");
+    MKFS2_OPTIONS geometry = { 2048, 8, 1000, 0, 0 };
+    printf("----RESULTADO 1: %s (imagem formatada e montada).\n", test_verification_int(mkfs2("t2fs_disk_nova.dat", &geometry) == 0 &&
+           t2fs_backend_file(&backend, "t2fs_disk_nova.dat") == 0 && (fs = t2fs_mount(&backend, NULL)) != NULL, 1));
+    t2fs_statfs2(fs, &statsAfter);
+    printf("----RESULTADO 2: %s (geometria: 2048 blocos de 2 KB, 1024 i-nodes).\n", test_verification_int(statsAfter.blockSize == 2048 && statsAfter.totalBlocks == 2048 &&
+           statsAfter.totalInodes == 1024 && statsAfter.freeInodes == 1023 && statsAfter.freeBlockRuns == 1, 1));
+    t2fs_mkdir2(fs, "/dir_nova");
+    t2fs_create2(fs, "/dir_nova/arq");
+    other = t2fs_open2(fs, "/dir_nova/arq");
+    memset(bufferDedup, 'n', 5000);
+    t2fs_write2(fs, other, bufferDedup, 5000);
+    t2fs_seek2(fs, other, 0);
+    printf("----RESULTADO 3: %s (escrita e leitura na imagem nova).\n", test_verification_int(t2fs_read2(fs, other, bufferLeitura, 10000) == 5000 && memcmp(bufferLeitura, bufferDedup, 5000) == 0, 1));
+    t2fs_close2(fs, other);
+    t2fs_unmount(fs);
+    t2fs_backend_close(&backend);
+    remove("t2fs_disk_nova.dat");
+    geometry.freeBlocksBitmapSize = 1;
+    geometry.diskSize = 65536;
+    printf("----RESULTADO 4: %s (bitmap de dados pequeno demais).\n", test_verification_int(mkfs2("t2fs_disk_nova.dat", &geometry), -1));
+
+    printf("\n");
+
+    printf("TESTE: VERIFICAÇÃO E REPARO. Formata uma imagem, cria arquivos, corrompe os bitmaps diretamente e verifica com fsck2.\n");
+    FSCK2_STATS check;
+    geometry.diskSize = 2048;
+    geometry.freeBlocksBitmapSize = 0;
+    mkfs2("t2fs_disk_nova.dat", &geometry);
+    t2fs_backend_file(&backend, "t2fs_disk_nova.dat");
+    fs = t2fs_mount(&backend, NULL);
+    t2fs_mkdir2(fs, "/dir_fsck");
+    t2fs_create2(fs, "/dir_fsck/arq1");
+    other = t2fs_open2(fs, "/dir_fsck/arq1");
+    t2fs_write2(fs, other, bufferDedup, 5000);
+    t2fs_close2(fs, other);
+    t2fs_create2(fs, "/dir_fsck/arq2");
+    t2fs_stat2(fs, "/dir_fsck/arq2", &stat);
+    t2fs_statfs2(fs, &statsMount);
+    t2fs_unmount(fs);
+    fs = t2fs_mount(&backend, &options);
+    printf("----RESULTADO 1: %s (imagem consistente).\n", test_verification_int(t2fs_fsck2(fs, &check, 0, 4) == 0 && fsck_problems(&check) == 0 &&
+           check.inodesUsed == 4 && check.blocksUsed == statsMount.totalBlocks - statsMount.freeBlocks, 1));
+    t2fs_unmount(fs);
+    // Bloco livre marcado como ocupado, i-node órfão e registro que aponta para um i-node livre
+    image_bitmap_bit("t2fs_disk_nova.dat", 0, 2047, 1);
+    image_bitmap_bit("t2fs_disk_nova.dat", 1, 1000, 1);
+    image_bitmap_bit("t2fs_disk_nova.dat", 1, stat.inodeNumber, 0);
+    fs = t2fs_mount(&backend, &options);
+    printf("----RESULTADO 2: %s (inconsistências encontradas).\n", test_verification_int(t2fs_fsck2(fs, &check, 0, 4) == 0 && check.leakedBlocks == 1 &&
+           check.orphanInodes == 1 && check.badRecords == 1 && check.missingBlocks == 0 && check.repaired == 0, 1));
+    printf("----RESULTADO 3: %s (reparo recusado sem alterações).\n", test_verification_int(t2fs_fsck2(fs, &check, 1, 4), -1));
+    t2fs_unmount(fs);
+    fs = t2fs_mount(&backend, NULL);
+    printf("----RESULTADO 4: %s (reparo).\n", test_verification_int(t2fs_fsck2(fs, &check, 1, 4) == 0 && check.repaired >= 3, 1));
+    t2fs_statfs2(fs, &statsAfter);
+    printf("----RESULTADO 5: %s (imagem consistente após o reparo, com uma thread).\n", test_verification_int(t2fs_fsck2(fs, &check, 0, 1) == 0 && fsck_problems(&check) == 0 &&
+           statsAfter.freeBlocks == statsMount.freeBlocks && statsAfter.freeInodes == statsMount.freeInodes, 1));
+    t2fs_unmount(fs);
+    t2fs_backend_close(&backend);
+    remove("t2fs_disk_nova.dat");
+
+    printf("\n");
+
+    printf("TESTE: DESFRAGMENTAÇÃO. Grava dois arquivos de 12 blocos intercalados e os desfragmenta com defrag2, com um deles aberto.\n");
+    DEFRAG2_STATS defrag;
+    FILE2 fragB;
+    int calls[2] = { 0, 0 };
+    mkfs2("t2fs_disk_nova.dat", &geometry);
+    t2fs_backend_file(&backend, "t2fs_disk_nova.dat");
+    fs = t2fs_mount(&backend, NULL);
+    t2fs_mkdir2(fs, "/dir_frag");
+    t2fs_create2(fs, "/dir_frag/a");
+    t2fs_create2(fs, "/dir_frag/b");
+    other = t2fs_open2(fs, "/dir_frag/a");
+    fragB = t2fs_open2(fs, "/dir_frag/b");
+    for( i = 0; i < 12 * 2048; i++ )
+    {
+        bufferEscrita[i] = 'a' + (i / 2048) % 26;
+    }
+    for( i = 0; i < 12; i++ )
+    {
+        t2fs_write2(fs, other, bufferEscrita + i * 2048, 2048);
+        t2fs_write2(fs, fragB, bufferEscrita + i * 2048, 2048);
+    }
+    t2fs_close2(fs, fragB);
+    t2fs_statfs2(fs, &statsMount);
+    t2fs_stat2(fs, "/dir_frag/a", &stat);
+    printf("----RESULTADO 1: %s (12 trechos antes).\n", test_verification_int(stat.extents, 12));
+    t2fs_seek2(fs, other, 100);
+    printf("----RESULTADO 2: %s (arquivo desfragmentado).\n", test_verification_int(t2fs_defrag2(fs, "/dir_frag/a", 0, defrag_progress, calls, &defrag) == 0 &&
+           calls[0] == 1 && defrag.files == 1 && defrag.filesMoved == 1 && defrag.blocksMoved == 13 && defrag.extentsBefore == 12 && defrag.extentsAfter == 1, 1));
+    t2fs_stat2(fs, "/dir_frag/a", &stat);
+    printf("----RESULTADO 3: %s (1 trecho depois).\n", test_verification_int(stat.extents, 1));
+    printf("----RESULTADO 4: %s (leitura pelo handle aberto antes da desfragmentação).\n", test_verification_int(t2fs_read2(fs, other, bufferLeitura, 100) == 100 &&
+           memcmp(bufferLeitura, bufferEscrita + 100, 100) == 0 && t2fs_seek2(fs, other, 0) == 0 && t2fs_read2(fs, other, bufferLeitura, 12 * 2048) == 12 * 2048 &&
+           memcmp(bufferLeitura, bufferEscrita, 12 * 2048) == 0, 1));
+    t2fs_close2(fs, other);
+    calls[1] = 2;
+    printf("----RESULTADO 5: %s (interrompida pela função de progresso).\n", test_verification_int(t2fs_defrag2(fs, "/", 100000, defrag_progress, calls, &defrag), 7));
+    printf("----RESULTADO 6: %s (sistema de arquivos inteiro).\n", test_verification_int(t2fs_defrag2(fs, "/", 0, NULL, NULL, &defrag) == 0 && defrag.files == 4, 1));
+    t2fs_stat2(fs, "/dir_frag/b", &stat);
+    t2fs_statfs2(fs, &statsAfter);
+    printf("----RESULTADO 7: %s (sem blocos perdidos e imagem consistente).\n", test_verification_int(stat.extents == 1 && statsAfter.freeBlocks == statsMount.freeBlocks &&
+           t2fs_fsck2(fs, &check, 0, 1) == 0 && fsck_problems(&check) == 0, 1));
+    t2fs_unmount(fs);
+    t2fs_backend_close(&backend);
+    remove("t2fs_disk_nova.dat");
+
+    printf("\n");
+
+    printf("TESTE: RELATÓRIO DE DISPOSIÇÃO. Grava um arquivo esparso intercalado com outro e consulta layout2.\n");
+    LAYOUT2_STATS layout;
+    LAYOUT2_FILE layoutFile;
+    DWORD histogram = 0;
+    mkfs2("t2fs_disk_nova.dat", &geometry);
+    t2fs_backend_file(&backend, "t2fs_disk_nova.dat");
+    fs = t2fs_mount(&backend, NULL);
+    t2fs_mkdir2(fs, "/dir_layout");
+    t2fs_create2(fs, "/dir_layout/a");
+    t2fs_create2(fs, "/dir_layout/b");
+    other = t2fs_open2(fs, "/dir_layout/a");
+    fragB = t2fs_open2(fs, "/dir_layout/b");
+    for( i = 0; i < 4; i++ )
+    {
+        t2fs_write2(fs, other, bufferEscrita, 2048);
+        t2fs_write2(fs, fragB, bufferEscrita, 2048);
+    }
+    // Buraco de 2 blocos no fim de 'a'
+    t2fs_seek2(fs, other, 6 * 2048);
+    t2fs_write2(fs, other, bufferEscrita, 2048);
+    t2fs_close2(fs, other);
+    t2fs_close2(fs, fragB);
+    t2fs_unmount(fs);
+    fs = t2fs_mount(&backend, &options);
+    t2fs_statfs2(fs, &statsAfter);
+    printf("----RESULTADO 1: %s (árvore inteira, sem alterar o disco).\n", test_verification_int(t2fs_layout2(fs, "/", layout_capture, &layoutFile, &layout) == 0 &&
+           layout.files == 2 && layout.directories == 2 && layout.dirLiveRecords == 3 + 4, 1));
+    printf("----RESULTADO 2: %s (trechos, buracos e indireção do arquivo).\n", test_verification_int(layoutFile.blocks == 5 && layoutFile.runs == 5 &&
+           layoutFile.holes == 2 && layoutFile.indirectBlocks == 1 && layoutFile.fileSize == 7 * 2048, 1));
+    for( i = 0; i < LAYOUT2_HISTOGRAM_SIZE; i++ )
+    {
+        histogram += layout.freeExtentHistogram[i];
+    }
+    printf("----RESULTADO 3: %s (trechos livres iguais aos de statfs2).\n", test_verification_int(layout.freeBlocks == statsAfter.freeBlocks &&
+           layout.freeExtents == statsAfter.freeBlockRuns && histogram == layout.freeExtents, 1));
+    printf("----RESULTADO 4: %s (só o arquivo 'b', intercalado com 'a').\n", test_verification_int(t2fs_layout2(fs, "/dir_layout/b", NULL, NULL, &layout) == 0 &&
+           layout.files == 1 && layout.directories == 0 && layout.fragmentedFiles == 1, 1));
+    printf("----RESULTADO 5: %s (caminho inexistente).\n", test_verification_int(t2fs_layout2(fs, "/dir_layout/c", NULL, NULL, &layout), -1));
+    t2fs_unmount(fs);
+    t2fs_backend_close(&backend);
+    remove("t2fs_disk_nova.dat");
+
+    printf("\n");
+
+    printf("TESTE: GRUPOS DE ALOCAÇÃO. Formata uma imagem de 8192 blocos em 4 grupos, cria dois diretórios com um arquivo cada e confere os descritores.\n");
+    MKFS2_OPTIONS groupGeometry = { 8192, 2, 0, 0, 0, 1000 };
+    STAT2 groupDir[2], groupFile[2];
+    DWORD groupA, groupB, groupFree = 0;
+    printf("----RESULTADO 1: %s (grupos que não ocupam setores inteiros do bitmap).\n", test_verification_int(mkfs2("t2fs_disk_nova.dat", &groupGeometry), -1));
+    groupGeometry.groupBlocks = 2048;
+    printf("----RESULTADO 2: %s (imagem formatada e montada).\n", test_verification_int(mkfs2("t2fs_disk_nova.dat", &groupGeometry) == 0 &&
+           t2fs_backend_file(&backend, "t2fs_disk_nova.dat") == 0 && (fs = t2fs_mount(&backend, NULL)) != NULL, 1));
+    t2fs_statfs2(fs, &statsMount);
+    printf("----RESULTADO 3: %s (4 grupos de 2048 i-nodes).\n", test_verification_int(statsMount.groups == 4 && statsMount.totalInodes == 4 * 2048, 1));
+    memset(bufferDedup, 'g', 5000);
+    for( i = 0; i < 2; i++ )
+    {
+        sprintf(nomes, "/dir_grupo%d", i);
+        t2fs_mkdir2(fs, nomes);
+        t2fs_stat2(fs, nomes, &groupDir[i]);
+        strcat(nomes, "/arq");
+        t2fs_create2(fs, nomes);
+        other = t2fs_open2(fs, nomes);
+        t2fs_write2(fs, other, bufferDedup, 5000);
+        t2fs_close2(fs, other);
+        t2fs_stat2(fs, nomes, &groupFile[i]);
+    }
+    groupA = groupDir[0].inodeNumber / 2048;
+    groupB = groupDir[1].inodeNumber / 2048;
+    printf("----RESULTADO 4: %s (diretórios em grupos diferentes, com os arquivos no grupo do pai).\n", test_verification_int(groupA != groupB &&
+           groupFile[0].inodeNumber / 2048 == groupA && groupFile[1].inodeNumber / 2048 == groupB, 1));
+    t2fs_statfs2(fs, &statsAfter);
+    t2fs_unmount(fs);
+    for( i = 0; i < 4; i++ )
+    {
+        groupFree += image_group_field("t2fs_disk_nova.dat", i, GROUP_FREE_BLOCKS, 0, 0);
+    }
+    // Cada grupo com um diretório e um arquivo usa 2 i-nodes e 12 blocos: o do diretório, 10 de dados e 1 de indireção
+    printf("----RESULTADO 5: %s (descritores gravados na desmontagem).\n", test_verification_int(groupFree == statsAfter.freeBlocks &&
+           image_group_field("t2fs_disk_nova.dat", groupA, GROUP_FREE_INODES, 0, 0) == 2048 - 2 &&
+           image_group_field("t2fs_disk_nova.dat", groupA, GROUP_FREE_BLOCKS, 0, 0) == 2048 - 12 &&
+           image_group_field("t2fs_disk_nova.dat", groupB, GROUP_FREE_BLOCKS, 0, 0) == 2048 - 12, 1));
+    image_group_field("t2fs_disk_nova.dat", groupB, GROUP_FREE_INODES, 1, 7);
+    fs = t2fs_mount(&backend, &options);
+    printf("----RESULTADO 6: %s (descritor divergente encontrado por fsck2).\n", test_verification_int(t2fs_fsck2(fs, &check, 0, 2) == 0 && check.badCounters == 1, 1));
+    t2fs_unmount(fs);
+    fs = t2fs_mount(&backend, NULL);
+    t2fs_fsck2(fs, &check, 1, 2);
+    t2fs_create2(fs, "/dir_grupo1/arq2");
+    t2fs_stat2(fs, "/dir_grupo1/arq2", &stat);
+    printf("----RESULTADO 7: %s (descritor reparado e usado na alocação seguinte).\n", test_verification_int(t2fs_fsck2(fs, &check, 0, 2) == 0 &&
+           fsck_problems(&check) == 0 && stat.inodeNumber / 2048 == groupB, 1));
+    t2fs_unmount(fs);
+    printf("----RESULTADO 8: %s (descritor reparado no disco).\n", test_verification_int(image_group_field("t2fs_disk_nova.dat", groupB, GROUP_FREE_INODES, 0, 0), 2048 - 3));
+    t2fs_backend_close(&backend);
+    remove("t2fs_disk_nova.dat");
+
+    printf("\n");
+
     printf("TESTE: TRUNCAGEM DE ARQUIVO\n");
     strcpy(bufferLeitura, "");
     seek2(files[0], 16);
@@ -233,6 +997,8 @@ int main()
     printf("----RESULTADO 3: %s (arquivo já removido/caminho inválido).\n", test_verification_int(delete2("teste_file1"), -1));
     ls("----DEBUG: Diretório informado '/'", hdir);
     printf("----OBSERVAR: arquivo 'teste_file1' não pode existir.\n");
+    statfs2(&statsAfter);
+    printf("----RESULTADO 4: %s (i-node do arquivo liberado).\n", test_verification_int(statsAfter.freeInodes, statsBefore.freeInodes));
 
     closedir2(hdir);
 